@@ -0,0 +1,176 @@
+/**
+ * @file alloc_bench.cpp
+ * @brief Counts global allocations made while handling common requests
+ *
+ * Replaces the global operator new with one that counts the calls made on
+ * the measuring thread, then runs common requests through handleMessage()
+ * in each wire format, as a worker thread would, after a few warm-up runs
+ * that let the thread's arena, decoder and writers grow to size.
+ *
+ * The response is handed to the connection and outlives the request, so it
+ * is the one allocation a request is expected to make. Requests that go
+ * through the RequestCoalescer make a second one: the result shared with
+ * concurrent callers, of which each caller gets a copy with its own id.
+ * The program exits with status 1 if a request allocates more than that.
+ *
+ * Copying a request off the connection's input buffer and queueing it for a
+ * worker happen on the reactor thread and are not counted.
+ *
+ * Usage: alloc_bench [iterations]
+ */
+
+#include "AdmissionControl.hpp"
+#include "JsonHandler.hpp"
+#include "ProcessCore.hpp"
+#include "ProcessGroup.hpp"
+#include "RequestArena.hpp"
+#include "Session.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+    thread_local bool counting = false;
+    thread_local long allocations = 0;
+
+    void *countedAllocation(size_t size)
+    {
+        if (counting)
+            ++allocations;
+        void *pointer = std::malloc(size ? size : 1);
+        if (!pointer)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    struct Request
+    {
+        const char *label;
+        std::string text;
+        long budget; ///< Allocations allowed per request
+    };
+}
+
+void *operator new(size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return countedAllocation(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int warmup = 10;
+
+    // One client sends every request, far faster than the rate limits allow
+    qnx::AdmissionLimits limits;
+    limits.connection_rate = 0;
+    limits.user_rate = 0;
+    qnx::AdmissionControl::getInstance().configure(limits);
+
+    qnx::ProcessCore::getInstance().collectInfo();
+    const int group = qnx::ProcessGroup::getInstance().createGroup("bench", 1, "Processes of this benchmark");
+    qnx::ProcessGroup::getInstance().addProcessToGroup(getpid(), group);
+
+    const std::string pid = std::to_string(getpid());
+    const Request requests[] = {
+        {"get_process_info", "{\"command\":\"get_process_info\",\"pid\":" + pid + ",\"id\":17}", 2},
+        {"get_processes", "{\"command\":\"get_processes\",\"id\":\"dashboard-1\"}", 1},
+        {"get_processes top 5", "{\"command\":\"get_processes\",\"topic\":\"top\",\"k\":5,\"fields\":[\"pid\",\"cpu_usage\"]}", 1},
+        {"get_process_groups", "{\"command\":\"get_process_groups\",\"id\":3}", 1},
+        {"get_server_stats", "{\"command\":\"get_server_stats\"}", 1},
+        {"unknown command", "{\"command\":\"get_everything_at_once\",\"id\":4}", 1},
+        {"missing pid", "{\"command\":\"get_process_info\"}", 1},
+        {"invalid JSON", "{\"command\":\"get_processes\",", 1},
+    };
+
+    std::cout << std::left << std::setw(22) << "request"
+              << std::setw(8) << "format"
+              << std::right << std::setw(14) << "allocs/req"
+              << std::setw(10) << "budget"
+              << std::setw(12) << "us/req" << std::endl;
+
+    bool within_budget = true;
+    int client_socket = 1000;
+    for (qnx::WireFormat format : {qnx::WireFormat::JSON, qnx::WireFormat::BINARY, qnx::WireFormat::CBOR})
+    {
+        // A client that negotiated the format; nothing is ever sent to the socket
+        qnx::SessionManager::getInstance().setFormat(++client_socket, format);
+        for (const Request &request : requests)
+        {
+            const qnx::CancellationToken cancel = qnx::CancellationToken().startRequest(std::chrono::seconds(10));
+            size_t bytes = 0;
+            for (int i = 0; i < warmup; ++i)
+                bytes += qnx::handleMessage(client_socket, request.text, cancel).size();
+
+            allocations = 0;
+            counting = true;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+                bytes += qnx::handleMessage(client_socket, request.text, cancel).size();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            counting = false;
+
+            const double per_request = static_cast<double>(allocations) / iterations;
+            within_budget = within_budget && per_request <= static_cast<double>(request.budget);
+            std::cout << std::left << std::setw(22) << request.label
+                      << std::setw(8) << qnx::wireFormatName(format)
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(14) << per_request
+                      << std::setw(10) << request.budget
+                      << std::setw(12) << std::chrono::duration<double, std::micro>(elapsed).count() / iterations
+                      << (per_request <= static_cast<double>(request.budget) ? "" : "  OVER BUDGET")
+                      << (bytes == 0 ? "  (no response)" : "") << std::endl;
+        }
+        qnx::SessionManager::getInstance().release(client_socket);
+    }
+
+    std::cout << "\nArena of this thread: " << qnx::RequestArena::forThread().capacity() << " bytes" << std::endl;
+    return within_budget ? 0 : 1;
+}
@@ -0,0 +1,408 @@
+/**
+ * @file cbor_bench.cpp
+ * @brief Conformance check and cost of the CBOR response encoding
+ *
+ * Encodes a set of responses as JSON and as CBOR: the replies of the command
+ * handlers to typical requests, a synthetic process listing, and a document
+ * with edge-case values. Each CBOR response is decoded and written back out
+ * as JSON, which must reproduce the JSON response byte for byte; the program
+ * exits with status 1 if one does not.
+ *
+ * It then times encoding the listing in both formats, and decoding it the
+ * way a collector would: parsing the JSON and reading every process's
+ * numbers, against walking the CBOR item and reading the same numbers.
+ *
+ * Usage: cbor_bench [processes] [iterations]
+ */
+
+#include "FieldSchema.hpp"
+#include "JsonCodec.hpp"
+#include "JsonHandler.hpp"
+#include "ResponseWriter.hpp"
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char *const NAMES[] = {"procnto-smp-instr", "slogger2", "pipe", "devb-sdmmc", "io-sock", "devc-pty",
+                                 "mqueue", "random", "dumper", "qconn", "sshd", "ksh", "sh", "devc-ser8250"};
+
+    std::vector<qnx::ProcessInfo> makeProcesses(size_t count)
+    {
+        std::vector<qnx::ProcessInfo> processes(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            qnx::ProcessInfo &info = processes[i];
+            info.setPid(static_cast<pid_t>(1 + i * 4097 % 999983));
+            info.setName(NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            info.setCpuUsage(static_cast<double>((i * 7919) % 10000) / 137.0 * (i % 5 == 0 ? 0.001 : 1.0));
+            info.setMemoryUsage(static_cast<size_t>(1024 + (i * 104729) % (512 * 1024)) * 4096);
+            info.setNumThreads(1 + static_cast<int>(i % 24));
+            info.setPriority(10 + static_cast<int>(i % 3) * 5);
+            info.setPolicy(2);
+            info.setState(static_cast<int>(i % 4));
+        }
+        return processes;
+    }
+
+    using Document = std::function<void(qnx::ResponseWriter &)>;
+
+    std::string encode(qnx::WireFormat format, const Document &document)
+    {
+        auto writer = qnx::ResponseWriter::acquire(format);
+        document(*writer);
+        return writer->finish();
+    }
+
+    // The reply of the command handlers to a request
+    Document commandReply(const char *request)
+    {
+        return [request](qnx::ResponseWriter &writer)
+        {
+            qnx::JsonDecoder decoder;
+            decoder.parse(request);
+            decoder.pushObject(NULL);
+            const char *command = NULL;
+            decoder.getString("command", command);
+            // processCommand() finishes the writer; the document is rebuilt from its result
+            const std::string response = qnx::processCommand(-1, command, decoder, writer);
+            writer.reset();
+            writer.addEncoded(NULL, response);
+        };
+    }
+
+    void encodeEdgeCases(qnx::ResponseWriter &writer)
+    {
+        writer.startObject(NULL);
+        writer.addString("status", "success");
+        writer.addString("text", "quote \" backslash \\ tab \t newline \n control \x01 caf\xc3\xa9 \xe2\x82\xac");
+        writer.addString("empty", "");
+        writer.addString(std::string(300, 'k').c_str(), std::string(70000, 'v').c_str());
+        for (long long value : {0LL, 23LL, 24LL, 255LL, 256LL, 65535LL, 65536LL, 4294967295LL, 4294967296LL,
+                                -1LL, -24LL, -25LL, -256LL, -257LL, LLONG_MAX, LLONG_MIN})
+        {
+            writer.addInt(("int" + std::to_string(value)).c_str(), value);
+        }
+        writer.startArray("doubles");
+        for (double value : {0.0, -0.0, 0.5, 1.0 / 3.0, 1e300, -2.5e-310, 123456789.0, 0.1, 16777217.0, 3.4028234663852886e38})
+        {
+            writer.addDouble(NULL, value);
+        }
+        writer.endArray();
+        writer.addBool("yes", true);
+        writer.addBool("no", false);
+        writer.startObject("empty_object");
+        writer.endObject();
+        writer.startArray("empty_array");
+        writer.endArray();
+        writer.startArray("nested");
+        writer.startArray(NULL);
+        writer.startObject(NULL);
+        writer.addInt("depth", 3);
+        writer.endObject();
+        writer.endArray();
+        writer.endArray();
+        writer.endObject();
+    }
+
+    /**
+     * @brief Minimal reader for the CBOR the server produces
+     *
+     * Calls the handler for every value, like the ResponseWriter interface.
+     */
+    template <typename Handler>
+    class CborReader
+    {
+    public:
+        CborReader(const std::string &frame, Handler &handler)
+            : p_(reinterpret_cast<const uint8_t *>(frame.data()) + qnx::wire::FRAME_HEADER_SIZE),
+              end_(reinterpret_cast<const uint8_t *>(frame.data()) + frame.size()), handler_(handler)
+        {
+        }
+
+        bool read()
+        {
+            return item(NULL, 0) && p_ == end_;
+        }
+
+    private:
+        bool argument(uint8_t info, uint64_t &value)
+        {
+            if (info < 24)
+            {
+                value = info;
+                return true;
+            }
+            const int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0;
+            if (bytes == 0 || end_ - p_ < bytes)
+                return false;
+            value = 0;
+            for (int i = 0; i < bytes; ++i)
+                value = value << 8 | *p_++;
+            return true;
+        }
+
+        bool text(std::string &out)
+        {
+            uint64_t length;
+            if (p_ == end_ || *p_ >> 5 != 3 || !argument(*p_++ & 0x1F, length) || static_cast<uint64_t>(end_ - p_) < length)
+                return false;
+            out.assign(reinterpret_cast<const char *>(p_), static_cast<size_t>(length));
+            p_ += length;
+            return true;
+        }
+
+        bool item(const char *name, size_t depth)
+        {
+            if (p_ == end_ || depth > qnx::JsonDecoder::MAX_DEPTH)
+                return false;
+            const uint8_t initial = *p_++;
+            switch (initial)
+            {
+            case 0xBF: // Map
+            {
+                handler_.startObject(name);
+                std::string key;
+                while (p_ != end_ && *p_ != 0xFF)
+                {
+                    if (!text(key) || !item(key.c_str(), depth + 1))
+                        return false;
+                }
+                if (p_ == end_)
+                    return false;
+                ++p_;
+                handler_.endObject();
+                return true;
+            }
+            case 0x9F: // Array
+                handler_.startArray(name);
+                while (p_ != end_ && *p_ != 0xFF)
+                {
+                    if (!item(NULL, depth + 1))
+                        return false;
+                }
+                if (p_ == end_)
+                    return false;
+                ++p_;
+                handler_.endArray();
+                return true;
+            case 0xF4:
+            case 0xF5:
+                handler_.addBool(name, initial == 0xF5);
+                return true;
+            case 0xFA:
+            case 0xFB:
+            {
+                const int bytes = initial == 0xFA ? 4 : 8;
+                if (end_ - p_ < bytes)
+                    return false;
+                uint64_t bits = 0;
+                for (int i = 0; i < bytes; ++i)
+                    bits = bits << 8 | *p_++;
+                double value;
+                if (bytes == 4)
+                {
+                    const uint32_t narrow_bits = static_cast<uint32_t>(bits);
+                    float narrow;
+                    std::memcpy(&narrow, &narrow_bits, sizeof(narrow));
+                    value = narrow;
+                }
+                else
+                {
+                    std::memcpy(&value, &bits, sizeof(value));
+                }
+                handler_.addDouble(name, value);
+                return true;
+            }
+            default:
+                break;
+            }
+
+            uint64_t value;
+            switch (initial >> 5)
+            {
+            case 0:
+                if (!argument(initial & 0x1F, value) || value > static_cast<uint64_t>(LLONG_MAX))
+                    return false;
+                handler_.addInt(name, static_cast<long long>(value));
+                return true;
+            case 1:
+                if (!argument(initial & 0x1F, value) || value > static_cast<uint64_t>(LLONG_MAX))
+                    return false;
+                handler_.addInt(name, -1 - static_cast<long long>(value));
+                return true;
+            case 3:
+            {
+                --p_;
+                std::string value_text;
+                if (!text(value_text))
+                    return false;
+                handler_.addString(name, value_text);
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        const uint8_t *p_;
+        const uint8_t *end_;
+        Handler &handler_;
+    };
+
+    // Writes the values read from CBOR back out as JSON
+    struct JsonRewriter
+    {
+        qnx::JsonEncoder encoder;
+        void startObject(const char *name) { encoder.startObject(name); }
+        void endObject() { encoder.endObject(); }
+        void startArray(const char *name) { encoder.startArray(name); }
+        void endArray() { encoder.endArray(); }
+        void addString(const char *name, const std::string &value) { encoder.addString(name, value); }
+        void addInt(const char *name, long long value) { encoder.addInt(name, value); }
+        void addDouble(const char *name, double value) { encoder.addDouble(name, value); }
+        void addBool(const char *name, bool value) { encoder.addBool(name, value); }
+    };
+
+    // Reads the numbers of a listing, as a collector would
+    struct NumberSum
+    {
+        double sum = 0;
+        void startObject(const char *) {}
+        void endObject() {}
+        void startArray(const char *) {}
+        void endArray() {}
+        void addString(const char *, const std::string &) {}
+        void addInt(const char *, long long value) { sum += static_cast<double>(value); }
+        void addDouble(const char *, double value) { sum += value; }
+        void addBool(const char *, bool) {}
+    };
+
+    double sumJson(qnx::JsonDecoder &decoder, const std::string &text)
+    {
+        double sum = 0;
+        if (!decoder.parse(text) || !decoder.pushObject(NULL) || !decoder.pushArray("processes"))
+            return -1;
+        while (decoder.pushObject(NULL))
+        {
+            for (const auto &field : qnx::ProcessInfoSchema::FIELDS)
+            {
+                long long integer = 0;
+                double real = 0;
+                if (field.type == qnx::FieldType::INT && decoder.getInt64(field.name, integer))
+                    sum += static_cast<double>(integer);
+                else if (field.type != qnx::FieldType::STRING && decoder.getDouble(field.name, real))
+                    sum += real;
+            }
+            decoder.pop();
+        }
+        return sum;
+    }
+
+    double sumCbor(const std::string &frame)
+    {
+        NumberSum numbers;
+        CborReader<NumberSum> reader(frame, numbers);
+        return reader.read() ? numbers.sum : -1;
+    }
+
+    template <typename Function>
+    double timePerCall(int iterations, Function &&function)
+    {
+        function(); // Warm-up
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    void printRow(const char *label, double json_us, double cbor_us)
+    {
+        std::cout << std::left << std::setw(24) << label
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << json_us
+                  << std::setw(12) << cbor_us
+                  << std::setw(10) << std::setprecision(2) << json_us / cbor_us << "x" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    const std::vector<qnx::ProcessInfo> processes = makeProcesses(count);
+
+    const Document listing = [&processes](qnx::ResponseWriter &writer)
+    {
+        writer.startObject(NULL);
+        writer.addString("command", "get_processes");
+        writer.addString("status", "success");
+        qnx::encodeProcessList(writer, "processes", processes);
+        writer.endObject();
+    };
+    const std::pair<const char *, Document> documents[] = {
+        {"get_processes", commandReply("{\"command\":\"get_processes\",\"id\":\"r1\"}")},
+        {"get_processes top_cpu", commandReply("{\"command\":\"get_processes\",\"topic\":\"top_cpu\",\"k\":5,\"fields\":[\"pid\",\"cpu_usage\"]}")},
+        {"get_process_groups", commandReply("{\"command\":\"get_process_groups\",\"id\":7}")},
+        {"get_process_history", commandReply("{\"command\":\"get_process_history\",\"pid\":1}")},
+        {"get_server_stats", commandReply("{\"command\":\"get_server_stats\"}")},
+        {"batch", commandReply("{\"command\":\"batch\",\"requests\":[{\"command\":\"get_process_info\",\"pid\":1,\"id\":1},{\"command\":\"nope\"}]}")},
+        {"synthetic listing", listing},
+        {"edge cases", encodeEdgeCases},
+    };
+
+    std::cout << "Round trip CBOR -> JSON against the JSON encoding" << std::endl;
+    bool conformant = true;
+    for (const auto &document : documents)
+    {
+        const std::string json = encode(qnx::WireFormat::JSON, document.second);
+        const std::string cbor = encode(qnx::WireFormat::CBOR, document.second);
+        JsonRewriter rewriter;
+        CborReader<JsonRewriter> reader(cbor, rewriter);
+        const bool read = reader.read();
+        const bool same = read && rewriter.encoder.valid() && rewriter.encoder.buffer() == json;
+        conformant = conformant && same;
+        std::cout << std::left << std::setw(24) << document.first
+                  << std::right << std::setw(10) << json.size() << " bytes JSON"
+                  << std::setw(10) << cbor.size() << " bytes CBOR  "
+                  << (same ? "ok" : read ? "MISMATCH" : "UNREADABLE") << std::endl;
+    }
+    if (!conformant)
+        return 1;
+
+    volatile double sink = 0;
+    std::cout << "\nA " << count << "-process listing, " << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(24) << "operation"
+              << std::right << std::setw(12) << "us JSON"
+              << std::setw(12) << "us CBOR"
+              << std::setw(11) << "JSON/CBOR" << std::endl;
+    printRow("encode",
+             timePerCall(iterations, [&]()
+                         { sink = sink + static_cast<double>(encode(qnx::WireFormat::JSON, listing).size()); }),
+             timePerCall(iterations, [&]()
+                         { sink = sink + static_cast<double>(encode(qnx::WireFormat::CBOR, listing).size()); }));
+
+    const std::string json = encode(qnx::WireFormat::JSON, listing);
+    const std::string cbor = encode(qnx::WireFormat::CBOR, listing);
+    qnx::JsonDecoder decoder;
+    if (sumJson(decoder, json) != sumCbor(cbor))
+    {
+        std::cerr << "The two encodings hold different numbers" << std::endl;
+        return 1;
+    }
+    printRow("decode, read numbers",
+             timePerCall(iterations, [&]()
+                         { sink = sink + sumJson(decoder, json); }),
+             timePerCall(iterations, [&]()
+                         { sink = sink + sumCbor(cbor); }));
+
+    return 0;
+}
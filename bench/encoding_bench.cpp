@@ -0,0 +1,112 @@
+/**
+ * @file encoding_bench.cpp
+ * @brief Benchmark of response encodings for a large process list
+ *
+ * Encodes a synthetic 5000-process get_processes response with every wire
+ * format and compression codec, and reports the mean encode time (including
+ * compression) and the number of bytes that would be sent to the client.
+ *
+ * Usage: encoding_bench [processes] [iterations]
+ */
+
+#include "JsonHandler.hpp"
+#include "ResponseWriter.hpp"
+#include "Compression.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Typical process names on a QNX target; most names repeat many times
+    const char *const NAMES[] = {
+        "procnto-smp-instr", "slogger2", "pipe", "devb-sdmmc", "io-sock", "devc-pty",
+        "mqueue", "random", "dumper", "qconn", "sshd", "ksh", "sh", "devc-ser8250",
+        "io-usb-otg", "devb-nvme", "io-audio", "screen", "pps", "rpm-agent",
+        "sensor-daemon", "can-bridge", "logger", "telemetryd", "inetd", "tinit",
+    };
+
+    std::vector<qnx::ProcessInfo> makeProcesses(size_t count)
+    {
+        std::vector<qnx::ProcessInfo> processes(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            qnx::ProcessInfo &info = processes[i];
+            info.setPid(static_cast<pid_t>(1 + i * 4097 % 999983));
+            info.setName(NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            info.setCpuUsage(static_cast<double>((i * 7919) % 10000) / 137.0);
+            info.setMemoryUsage(1024 + (i * 104729) % (512 * 1024));
+            info.setNumThreads(1 + static_cast<int>(i % 24));
+            info.setPriority(10 + static_cast<int>(i % 3) * 5);
+            info.setPolicy(2);
+            info.setState(static_cast<int>(i % 4));
+        }
+        return processes;
+    }
+
+    std::string encodeList(qnx::WireFormat format, qnx::CompressionCodec codec,
+                           const std::vector<qnx::ProcessInfo> &processes)
+    {
+        auto writer = qnx::ResponseWriter::create(format);
+        writer->startObject(NULL);
+        writer->addString("command", "get_processes");
+        writer->addString("status", "success");
+        writer->addString("topic", "all");
+        qnx::encodeProcessList(*writer, "processes", processes);
+        writer->endObject();
+        return qnx::compressResponse(writer->finish(), codec, 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    const auto processes = makeProcesses(count);
+
+    std::cout << "Encoding " << count << " processes, " << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(14) << "format"
+              << std::right << std::setw(14) << "us/encode"
+              << std::setw(14) << "bytes"
+              << std::setw(14) << "bytes/proc"
+              << std::setw(12) << "MB/s" << std::endl;
+
+    for (const char *codec_name : {"none", "lz4", "zlib"})
+    {
+        qnx::CompressionCodec codec;
+        if (!qnx::parseCompressionCodec(codec_name, codec))
+        {
+            continue; // Not available in this build
+        }
+
+        for (qnx::WireFormat format : {qnx::WireFormat::JSON, qnx::WireFormat::BINARY, qnx::WireFormat::CBOR})
+        {
+            size_t bytes = encodeList(format, codec, processes).size(); // Warm-up
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                bytes = encodeList(format, codec, processes).size();
+            }
+            auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+            double per_encode = elapsed.count() / iterations;
+
+            std::string label = qnx::wireFormatName(format);
+            if (codec != qnx::CompressionCodec::NONE)
+            {
+                label += std::string("+") + codec_name;
+            }
+            std::cout << std::left << std::setw(14) << label
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(14) << per_encode
+                      << std::setw(14) << bytes
+                      << std::setw(14) << static_cast<double>(bytes) / static_cast<double>(count)
+                      << std::setw(12) << static_cast<double>(bytes) / per_encode << std::endl;
+        }
+    }
+
+    return 0;
+}
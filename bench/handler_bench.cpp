@@ -0,0 +1,293 @@
+/**
+ * @file handler_bench.cpp
+ * @brief Benchmark of handleMessage() over a corpus of requests
+ *
+ * Installs a fixed, synthetic snapshot (process list, history and groups)
+ * and replays every request of a corpus file through handleMessage(), the
+ * whole path a worker thread runs: decoding, admission, dispatch, encoding.
+ * Reports the mean time and the number of global allocations per request
+ * for each corpus entry, so a regression in any of them shows up against
+ * the entry it affects.
+ *
+ * The response cache is disabled and admission limits are lifted, so each
+ * request is really handled rather than served from the cache or throttled.
+ * Before that, a full batch is run once under the default admission limits,
+ * and the benchmark fails if any of its entries comes back throttled.
+ * The corpus format is described in bench/handler_corpus.txt.
+ *
+ * Usage: handler_bench [corpus] [iterations] [json|binary|cbor]
+ */
+
+#include "AdmissionControl.hpp"
+#include "JsonHandler.hpp"
+#include "ProcessCore.hpp"
+#include "ProcessGroup.hpp"
+#include "ProcessHistory.hpp"
+#include "ResponseCache.hpp"
+#include "Session.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    thread_local bool counting = false;
+    thread_local long allocations = 0;
+
+    void *countedAllocation(size_t size)
+    {
+        if (counting)
+            ++allocations;
+        void *pointer = std::malloc(size ? size : 1);
+        if (!pointer)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    const size_t PROCESSES = 1000;
+    const size_t HISTORY_PROCESSES = 50;
+    const size_t HISTORY_ENTRIES = 60;
+    const time_t SNAPSHOT_TIME = 1700000000; // Timestamp of the last history entry
+
+    const char *const NAMES[] = {"procnto-smp-instr", "slogger2", "pipe", "devb-sdmmc", "io-sock", "devc-pty",
+                                 "mqueue", "random", "dumper", "qconn", "sshd", "ksh", "sh", "devc-ser8250"};
+
+    const size_t ADMISSION_BATCH = 200; // Entries of the batch checked against the default admission limits
+
+    struct CorpusEntry
+    {
+        std::string label;
+        std::string request;
+    };
+
+    // Same pids and values on every run, whatever runs on this machine
+    void installSnapshot()
+    {
+        std::vector<qnx::ProcessInfo> processes(PROCESSES);
+        std::map<pid_t, std::vector<qnx::ProcessHistoryEntry>> history;
+        for (size_t i = 0; i < PROCESSES; ++i)
+        {
+            qnx::ProcessInfo &info = processes[i];
+            const pid_t pid = static_cast<pid_t>(1 + i * 4097);
+            info.setPid(pid);
+            info.setName(NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            info.setCpuUsage(static_cast<double>((i * 7919) % 10000) / 137.0);
+            info.setMemoryUsage(1024 + (i * 104729) % (512 * 1024));
+            info.setNumThreads(1 + static_cast<int>(i % 24));
+            info.setPriority(10 + static_cast<int>(i % 3) * 5);
+            info.setPolicy(2);
+            info.setState(static_cast<int>(i % 4));
+
+            if (i < HISTORY_PROCESSES)
+            {
+                std::vector<qnx::ProcessHistoryEntry> &entries = history[pid];
+                for (size_t j = 0; j < HISTORY_ENTRIES; ++j)
+                {
+                    entries.push_back({static_cast<double>((i + j * 31) % 1000) / 10.0,
+                                       static_cast<long>(4096 + (i * 7 + j) * 512),
+                                       SNAPSHOT_TIME - static_cast<time_t>(HISTORY_ENTRIES - 1 - j)});
+                }
+            }
+        }
+        qnx::ProcessCore::getInstance().loadSnapshot(std::move(processes));
+        qnx::ProcessHistory::getInstance().restoreHistory(history);
+
+        // Groups only take running processes: pid 1, which is in the snapshot too, and this one
+        const int system = qnx::ProcessGroup::getInstance().createGroup("system", 0, "Core services");
+        const int bench = qnx::ProcessGroup::getInstance().createGroup("bench", 10, "This benchmark");
+        qnx::ProcessGroup::getInstance().addProcessToGroup(1, system);
+        qnx::ProcessGroup::getInstance().addProcessToGroup(getpid(), bench);
+    }
+
+    // A batch runs completely or is refused as a whole: under the default limits, a fresh
+    // connection's batch of ADMISSION_BATCH expensive entries must have none throttled
+    bool checkBatchAdmission()
+    {
+        qnx::AdmissionControl::getInstance().configure(qnx::AdmissionLimits());
+
+        std::string request = "{\"command\":\"batch\",\"requests\":[";
+        for (size_t i = 0; i < ADMISSION_BATCH; ++i)
+        {
+            if (i > 0)
+                request += ',';
+            request += "{\"command\":\"get_process_info\",\"pid\":1}";
+        }
+        request += "]}";
+
+        const int client_socket = 1001; // Never negotiated, so the response is JSON
+        const qnx::CancellationToken cancel = qnx::CancellationToken().startRequest(std::chrono::seconds(10));
+        const std::string response = qnx::handleMessage(client_socket, request, cancel);
+        qnx::AdmissionControl::getInstance().release(client_socket);
+        qnx::SessionManager::getInstance().release(client_socket);
+
+        size_t throttled = 0;
+        for (size_t at = 0; (at = response.find("\"retry_after_ms\"", at)) != std::string::npos; ++at)
+            ++throttled;
+        if (throttled > 0 || response.find("\"results\"") == std::string::npos)
+        {
+            std::cerr << "Batch of " << ADMISSION_BATCH << " get_process_info under the default admission limits: "
+                      << (throttled > 0 ? std::to_string(throttled) + " throttled" : "no results") << std::endl;
+            return false;
+        }
+        std::cout << "batch admission: all " << ADMISSION_BATCH << " entries ran under the default limits\n";
+        return true;
+    }
+
+    // A label, a tab and the request; a label alone is an empty request
+    bool loadCorpus(const char *path, std::vector<CorpusEntry> &corpus)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cerr << "Cannot open corpus " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            const size_t tab = line.find('\t');
+            if (tab == std::string::npos)
+                corpus.push_back({line, std::string()});
+            else
+                corpus.push_back({line.substr(0, tab), line.substr(tab + 1)});
+        }
+        if (corpus.empty())
+        {
+            std::cerr << "Corpus " << path << " has no requests" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+void *operator new(size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new[](size_t size)
+{
+    return countedAllocation(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return countedAllocation(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *corpus_path = argc > 1 ? argv[1] : "bench/handler_corpus.txt";
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2000;
+    qnx::WireFormat format = qnx::WireFormat::JSON;
+    if (argc > 3 && !qnx::parseWireFormat(argv[3], format))
+    {
+        std::cerr << "Unknown format " << argv[3] << std::endl;
+        return 1;
+    }
+    const int warmup = 10;
+
+    std::vector<CorpusEntry> corpus;
+    if (!loadCorpus(corpus_path, corpus))
+        return 1;
+
+    if (!checkBatchAdmission())
+        return 1;
+
+    // One client sends every request, far faster than the rate limits allow
+    qnx::AdmissionLimits limits;
+    limits.connection_rate = 0;
+    limits.user_rate = 0;
+    qnx::AdmissionControl::getInstance().configure(limits);
+    qnx::ResponseCache::getInstance().setBudget(0);
+    installSnapshot();
+
+    // A client that negotiated the format; nothing is ever sent to the socket
+    const int client_socket = 1000;
+    qnx::SessionManager::getInstance().setFormat(client_socket, format);
+
+    std::cout << "corpus " << corpus_path << ", " << corpus.size() << " requests, " << PROCESSES
+              << " processes, format " << qnx::wireFormatName(format) << "\n\n";
+    std::cout << std::left << std::setw(30) << "request"
+              << std::right << std::setw(12) << "ns/req"
+              << std::setw(14) << "allocs/req"
+              << std::setw(12) << "bytes" << std::endl;
+
+    double total_ns = 0;
+    long total_allocations = 0;
+    for (const CorpusEntry &entry : corpus)
+    {
+        const qnx::CancellationToken cancel = qnx::CancellationToken().startRequest(std::chrono::seconds(10));
+        size_t bytes = 0;
+        for (int i = 0; i < warmup; ++i)
+            bytes = qnx::handleMessage(client_socket, entry.request, cancel).size();
+
+        allocations = 0;
+        counting = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            qnx::handleMessage(client_socket, entry.request, cancel);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        counting = false;
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        total_ns += ns;
+        total_allocations += allocations;
+        std::cout << std::left << std::setw(30) << entry.label
+                  << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << ns
+                  << std::setprecision(2)
+                  << std::setw(14) << static_cast<double>(allocations) / iterations
+                  << std::setw(12) << bytes << std::endl;
+    }
+    qnx::SessionManager::getInstance().release(client_socket);
+
+    std::cout << "\nmean over the corpus: " << std::setprecision(0) << total_ns / corpus.size() << " ns/req, "
+              << std::setprecision(2) << static_cast<double>(total_allocations) / iterations / corpus.size()
+              << " allocs/req" << std::endl;
+    return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file json_bench.cpp
+ * @brief Benchmark of the in-tree JSON codec against the QNX JSON library
+ *
+ * Decodes a corpus of typical requests the way the command handlers read
+ * them (parse, enter the root object, look up the members the command
+ * uses), and encodes a synthetic get_processes response. Each is timed with
+ * the in-tree JsonDecoder/JsonEncoder and, when the build has <sys/json.h>
+ * (RPM_HAVE_LIBJSON), with libjson creating a decoder or encoder per
+ * message as the server used to.
+ *
+ * Usage: json_bench [iterations] [processes]
+ */
+
+#include "JsonCodec.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef RPM_HAVE_LIBJSON
+#include <sys/json.h>
+#endif
+
+namespace
+{
+    // Requests as sent by the clients, with the members each handler reads
+    struct Request
+    {
+        const char *label;
+        const char *text;
+        std::vector<const char *> strings;
+        std::vector<const char *> ints;
+        const char *int_array; ///< Member holding an array of integers, or NULL
+    };
+
+    std::vector<Request> makeCorpus()
+    {
+        std::string pids = "{\"command\":\"get_processes\",\"id\":\"list-7\",\"topic\":\"pids\",\"pids\":[";
+        for (int i = 0; i < 64; ++i)
+            pids += (i ? "," : "") + std::to_string(1 + i * 4097);
+        pids += "]}";
+        static const std::string pids_text = pids;
+
+        return {
+            {"get_process_info", "{\"command\":\"get_process_info\",\"id\":42,\"pid\":1234}", {"command"}, {"id", "pid"}, nullptr},
+            {"terminate_process", "{\"command\":\"terminate_process\",\"pid\":77,\"deadline_ms\":250}", {"command"}, {"deadline_ms", "pid"}, nullptr},
+            {"login", "{\"command\":\"login\",\"id\":\"req-1\",\"username\":\"admin\",\"password\":\"s3cr\\u00e9t\"}",
+             {"command", "id", "username", "password"}, {}, nullptr},
+            {"subscribe", "{ \"command\" : \"subscribe\", \"topic\" : \"top_cpu\", \"k\" : 10, \"interval_ms\" : 1000 }",
+             {"command", "topic"}, {"k", "interval_ms"}, nullptr},
+            {"negotiate", "{\"command\":\"negotiate\",\"encoding\":\"binary\",\"compression\":\"lz4\",\"compression_threshold\":4096}",
+             {"command", "encoding", "compression"}, {"compression_threshold"}, nullptr},
+            {"get_processes pids", pids_text.c_str(), {"command", "id", "topic"}, {}, "pids"},
+        };
+    }
+
+    const char *const NAMES[] = {"procnto-smp-instr", "slogger2", "pipe", "devb-sdmmc", "io-sock", "devc-pty",
+                                 "mqueue", "random", "dumper", "qconn", "sshd", "ksh", "sh", "devc-ser8250"};
+
+    long long decodeInTree(qnx::JsonDecoder &decoder, const Request &request)
+    {
+        long long sum = 0;
+        if (!decoder.parse(request.text) || !decoder.pushObject(NULL))
+            return -1;
+        for (const char *name : request.strings)
+        {
+            const char *value = NULL;
+            if (decoder.getString(name, value))
+                sum += value[0];
+        }
+        for (const char *name : request.ints)
+        {
+            int value = 0;
+            if (decoder.getInt(name, value))
+                sum += value;
+        }
+        if (request.int_array && decoder.pushArray(request.int_array))
+        {
+            int value = 0;
+            while (decoder.getInt(NULL, value))
+                sum += value;
+            decoder.pop();
+        }
+        return sum;
+    }
+
+    size_t encodeInTree(qnx::JsonEncoder &encoder, size_t count)
+    {
+        encoder.reset(); // Keeps the buffer of the previous response
+        encoder.startObject(NULL);
+        encoder.addString("command", "get_processes");
+        encoder.addString("status", "success");
+        encoder.startArray("processes");
+        for (size_t i = 0; i < count; ++i)
+        {
+            encoder.startObject(NULL);
+            encoder.addInt("pid", static_cast<long long>(1 + i * 4097 % 999983));
+            encoder.addString("name", NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            encoder.addDouble("cpu_usage", static_cast<double>((i * 7919) % 10000) / 137.0);
+            encoder.addInt("memory_usage", static_cast<long long>(1024 + (i * 104729) % (512 * 1024)));
+            encoder.addInt("num_threads", static_cast<long long>(1 + i % 24));
+            encoder.endObject();
+        }
+        encoder.endArray();
+        encoder.endObject();
+        return encoder.valid() ? encoder.buffer().size() : 0;
+    }
+
+#ifdef RPM_HAVE_LIBJSON
+    long long decodeLibjson(const Request &request)
+    {
+        long long sum = 0;
+        json_decoder_t *decoder = json_decoder_create();
+        if (json_decoder_parse_json_str(decoder, request.text) != JSON_DECODER_OK)
+        {
+            json_decoder_destroy(decoder);
+            return -1;
+        }
+        json_decoder_push_object(decoder, NULL, false);
+        for (const char *name : request.strings)
+        {
+            const char *value = NULL;
+            if (json_decoder_get_string(decoder, name, &value, true) == JSON_DECODER_OK && value)
+                sum += value[0];
+        }
+        for (const char *name : request.ints)
+        {
+            int value = 0;
+            if (json_decoder_get_int(decoder, name, &value, true) == JSON_DECODER_OK)
+                sum += value;
+        }
+        if (request.int_array && json_decoder_push_array(decoder, request.int_array, true) == JSON_DECODER_OK)
+        {
+            int value = 0;
+            while (json_decoder_get_int(decoder, NULL, &value, true) == JSON_DECODER_OK)
+                sum += value;
+            json_decoder_pop(decoder);
+        }
+        json_decoder_destroy(decoder);
+        return sum;
+    }
+
+    size_t encodeLibjson(size_t count)
+    {
+        json_encoder_t *encoder = json_encoder_create();
+        json_encoder_start_object(encoder, NULL);
+        json_encoder_add_string(encoder, "command", "get_processes");
+        json_encoder_add_string(encoder, "status", "success");
+        json_encoder_start_array(encoder, "processes");
+        for (size_t i = 0; i < count; ++i)
+        {
+            json_encoder_start_object(encoder, NULL);
+            json_encoder_add_int(encoder, "pid", static_cast<int>(1 + i * 4097 % 999983));
+            json_encoder_add_string(encoder, "name", NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            json_encoder_add_double(encoder, "cpu_usage", static_cast<double>((i * 7919) % 10000) / 137.0);
+            json_encoder_add_int(encoder, "memory_usage", static_cast<int>(1024 + (i * 104729) % (512 * 1024)));
+            json_encoder_add_int(encoder, "num_threads", static_cast<int>(1 + i % 24));
+            json_encoder_end_object(encoder);
+        }
+        json_encoder_end_array(encoder);
+        json_encoder_end_object(encoder);
+        const char *text = json_encoder_buffer(encoder);
+        const size_t length = text ? std::strlen(text) : 0;
+        json_encoder_destroy(encoder);
+        return length;
+    }
+#endif
+
+    template <typename Function>
+    double timePerCall(int iterations, Function &&function)
+    {
+        function(); // Warm-up
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            function();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    void printRow(const char *label, double in_tree_ns, double libjson_ns, size_t bytes)
+    {
+        std::cout << std::left << std::setw(20) << label
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << in_tree_ns
+                  << std::setw(12) << static_cast<double>(bytes) * 1000.0 / in_tree_ns;
+        if (libjson_ns > 0)
+            std::cout << std::setw(14) << libjson_ns << std::setw(10) << std::setprecision(2) << libjson_ns / in_tree_ns << "x";
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const size_t processes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    const std::vector<Request> corpus = makeCorpus();
+    volatile long long sink = 0;
+
+    std::cout << "Decoding " << corpus.size() << " requests, " << iterations << " iterations each" << std::endl;
+    std::cout << std::left << std::setw(20) << "request"
+              << std::right << std::setw(14) << "ns in-tree"
+              << std::setw(12) << "MB/s"
+#ifdef RPM_HAVE_LIBJSON
+              << std::setw(14) << "ns libjson"
+              << std::setw(11) << "speedup"
+#endif
+              << std::endl;
+
+    qnx::JsonDecoder decoder;
+    for (const Request &request : corpus)
+    {
+        if (decodeInTree(decoder, request) < 0)
+        {
+            std::cerr << "Corpus request rejected: " << request.text << std::endl;
+            return 1;
+        }
+        const double in_tree = timePerCall(iterations, [&]()
+                                           { sink = sink + decodeInTree(decoder, request); });
+        double libjson = 0;
+#ifdef RPM_HAVE_LIBJSON
+        libjson = timePerCall(iterations, [&]()
+                              { sink = sink + decodeLibjson(request); });
+#endif
+        printRow(request.label, in_tree, libjson, std::string(request.text).size());
+    }
+
+    const int encode_iterations = std::max(1, iterations / static_cast<int>(std::max<size_t>(processes, 1)));
+    qnx::JsonEncoder encoder;
+    const size_t bytes = encodeInTree(encoder, processes);
+    std::cout << "\nEncoding a " << processes << "-process listing (" << bytes << " bytes), "
+              << encode_iterations << " iterations" << std::endl;
+    const double in_tree = timePerCall(encode_iterations, [&]()
+                                       { sink = sink + static_cast<long long>(encodeInTree(encoder, processes)); });
+    double libjson = 0;
+#ifdef RPM_HAVE_LIBJSON
+    libjson = timePerCall(encode_iterations, [&]()
+                          { sink = sink + static_cast<long long>(encodeLibjson(processes)); });
+#endif
+    printRow("get_processes", in_tree, libjson, bytes);
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file number_bench.cpp
+ * @brief Benchmark of number formatting in responses
+ *
+ * Formats the numeric fields of a synthetic 5000-process listing (pid,
+ * CPU usage, memory usage, thread count, priority) with the previous
+ * approaches (snprintf for doubles, std::to_string for integers) and with
+ * the formatters the JSON encoder now uses, then encodes the whole listing
+ * as JSON with CPU usage at full precision and rounded to two decimals.
+ *
+ * Usage: number_bench [processes] [iterations]
+ */
+
+#include "JsonCodec.hpp"
+#include "JsonHandler.hpp"
+#include "ResponseWriter.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Row
+    {
+        long long pid;
+        double cpu_usage;
+        long long memory_usage;
+        long long num_threads;
+        long long priority;
+    };
+
+    // CPU usage is a ratio of nanosecond counts, so it rarely has a short decimal form
+    std::vector<Row> makeRows(size_t count)
+    {
+        std::vector<Row> rows(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            rows[i].pid = static_cast<long long>(1 + i * 4097 % 999983);
+            rows[i].cpu_usage = static_cast<double>((i * 7919) % 10000) / 137.0 * (i % 5 == 0 ? 0.001 : 1.0);
+            rows[i].memory_usage = static_cast<long long>(1024 + (i * 104729) % (512 * 1024)) * 4096;
+            rows[i].num_threads = static_cast<long long>(1 + i % 24);
+            rows[i].priority = static_cast<long long>(10 + i % 3 * 5);
+        }
+        return rows;
+    }
+
+    std::vector<qnx::ProcessInfo> makeProcesses(const std::vector<Row> &rows)
+    {
+        std::vector<qnx::ProcessInfo> processes(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            qnx::ProcessInfo &info = processes[i];
+            info.setPid(static_cast<pid_t>(rows[i].pid));
+            info.setName(i % 2 ? "devb-sdmmc" : "io-sock");
+            info.setCpuUsage(rows[i].cpu_usage);
+            info.setMemoryUsage(static_cast<uint64_t>(rows[i].memory_usage));
+            info.setNumThreads(static_cast<int>(rows[i].num_threads));
+            info.setPriority(static_cast<int>(rows[i].priority));
+            info.setPolicy(2);
+            info.setState(static_cast<int>(i % 4));
+        }
+        return processes;
+    }
+
+    size_t formatDoublesSnprintf(const std::vector<Row> &rows, std::string &out)
+    {
+        out.clear();
+        for (const Row &row : rows)
+        {
+            char digits[32];
+            const int length = snprintf(digits, sizeof(digits), "%.15g", row.cpu_usage);
+            out.append(digits, static_cast<size_t>(length));
+            out.push_back(',');
+        }
+        return out.size();
+    }
+
+    size_t formatDoubles(const std::vector<Row> &rows, std::string &out)
+    {
+        out.clear();
+        for (const Row &row : rows)
+        {
+            char digits[qnx::MAX_NUMBER_LENGTH];
+            out.append(digits, static_cast<size_t>(qnx::formatDouble(digits, row.cpu_usage) - digits));
+            out.push_back(',');
+        }
+        return out.size();
+    }
+
+    size_t formatIntegersToString(const std::vector<Row> &rows, std::string &out)
+    {
+        out.clear();
+        for (const Row &row : rows)
+        {
+            for (long long value : {row.pid, row.memory_usage, row.num_threads, row.priority})
+            {
+                out.append(std::to_string(value));
+                out.push_back(',');
+            }
+        }
+        return out.size();
+    }
+
+    size_t formatIntegersToChars(const std::vector<Row> &rows, std::string &out)
+    {
+        out.clear();
+        for (const Row &row : rows)
+        {
+            for (long long value : {row.pid, row.memory_usage, row.num_threads, row.priority})
+            {
+                char digits[24];
+                out.append(digits, static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits));
+                out.push_back(',');
+            }
+        }
+        return out.size();
+    }
+
+    size_t formatIntegers(const std::vector<Row> &rows, std::string &out)
+    {
+        out.clear();
+        for (const Row &row : rows)
+        {
+            for (long long value : {row.pid, row.memory_usage, row.num_threads, row.priority})
+            {
+                char digits[qnx::MAX_NUMBER_LENGTH];
+                out.append(digits, static_cast<size_t>(qnx::formatInteger(digits, value) - digits));
+                out.push_back(',');
+            }
+        }
+        return out.size();
+    }
+
+    size_t encodeListing(const std::vector<qnx::ProcessInfo> &processes)
+    {
+        auto writer = qnx::ResponseWriter::acquire(qnx::WireFormat::JSON);
+        writer->startObject(NULL);
+        writer->addString("command", "get_processes");
+        writer->addString("status", "success");
+        qnx::encodeProcessList(*writer, "processes", processes);
+        writer->endObject();
+        return writer->finish().size();
+    }
+
+    template <typename Function>
+    double timePerCall(int iterations, Function &&function)
+    {
+        function(); // Warm-up
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    void printRow(const char *label, double us, size_t bytes, size_t values)
+    {
+        std::cout << std::left << std::setw(30) << label
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << us
+                  << std::setw(12) << us * 1000.0 / static_cast<double>(values)
+                  << std::setw(12) << bytes << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    const std::vector<Row> rows = makeRows(count);
+    const std::vector<qnx::ProcessInfo> processes = makeProcesses(rows);
+    std::string out;
+    volatile size_t sink = 0;
+
+    std::cout << "Formatting the numbers of " << count << " processes, " << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(30) << "formatter"
+              << std::right << std::setw(12) << "us/pass"
+              << std::setw(12) << "ns/value"
+              << std::setw(12) << "bytes" << std::endl;
+
+    size_t bytes = formatDoublesSnprintf(rows, out);
+    printRow("double snprintf %.15g", timePerCall(iterations, [&]()
+                                                  { sink = sink + formatDoublesSnprintf(rows, out); }),
+             bytes, count);
+    bytes = formatDoubles(rows, out);
+    printRow("double formatDouble", timePerCall(iterations, [&]()
+                                                { sink = sink + formatDoubles(rows, out); }),
+             bytes, count);
+    bytes = formatIntegersToString(rows, out);
+    printRow("integer std::to_string", timePerCall(iterations, [&]()
+                                                   { sink = sink + formatIntegersToString(rows, out); }),
+             bytes, 4 * count);
+    bytes = formatIntegersToChars(rows, out);
+    printRow("integer std::to_chars", timePerCall(iterations, [&]()
+                                                  { sink = sink + formatIntegersToChars(rows, out); }),
+             bytes, 4 * count);
+    bytes = formatIntegers(rows, out);
+    printRow("integer formatInteger", timePerCall(iterations, [&]()
+                                                  { sink = sink + formatIntegers(rows, out); }),
+             bytes, 4 * count);
+
+    std::cout << "\nEncoding the listing as JSON" << std::endl;
+    for (int decimals : {-1, 2})
+    {
+        qnx::ResponseWriter::setPercentageDecimals(decimals);
+        bytes = encodeListing(processes);
+        const std::string label = decimals < 0 ? "cpu_usage full precision" : "cpu_usage " + std::to_string(decimals) + " decimals";
+        printRow(label.c_str(), timePerCall(iterations, [&]()
+                                            { sink = sink + encodeListing(processes); }),
+                 bytes, 8 * count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file priority_bench.cpp
+ * @brief Benchmark of process control latency while the server is flooded with bulk requests
+ *
+ * Starts the socket server on the loopback interface and keeps its workers
+ * saturated with get_processes requests from several pipelining clients,
+ * while one more client sends terminate_process requests one at a time and
+ * measures how long each takes to be answered. The run is repeated without
+ * a request classifier (one queue for everything, as before priority lanes)
+ * and with qnx::classifyRequest, and reports control latency percentiles and
+ * the bulk throughput for both.
+ *
+ * The handler does not touch any process: bulk requests spin for a fixed
+ * time, standing in for encoding a large process table, and every other
+ * request is answered at once.
+ *
+ * Usage: priority_bench [bulk_clients] [bulk_ms] [seconds] [port]
+ */
+
+#include "SocketServer.hpp"
+#include "JsonHandler.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const std::string BULK_REQUEST = "{\"command\":\"get_processes\"}\n";
+    const std::string CONTROL_REQUEST = "{\"command\":\"terminate_process\",\"pid\":1}\n";
+    constexpr int PIPELINE_DEPTH = 4;
+    constexpr auto CONTROL_INTERVAL = std::chrono::milliseconds(5);
+
+    // Stateless sink for the server's connection log; safe to share between threads
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    };
+
+    struct RunResult
+    {
+        std::vector<double> control_ms; ///< Round-trip time of each control request
+        double bulk_rate = 0.0;         ///< Completed bulk requests per second
+    };
+
+    int connectTo(int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    // Read until the given number of newline-terminated responses has arrived
+    bool readResponses(int fd, int count, std::string &buffer)
+    {
+        char chunk[4096];
+        while (count > 0)
+        {
+            size_t newline;
+            while (count > 0 && (newline = buffer.find('\n')) != std::string::npos)
+            {
+                buffer.erase(0, newline + 1);
+                --count;
+            }
+            if (count == 0)
+                break;
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    void bulkClient(int port, const std::atomic<bool> &stop, std::atomic<long> &completed)
+    {
+        int fd = connectTo(port);
+        if (fd < 0)
+            return;
+
+        std::string batch;
+        for (int i = 0; i < PIPELINE_DEPTH; ++i)
+            batch += BULK_REQUEST;
+
+        std::string buffer;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != (ssize_t)batch.size() ||
+                !readResponses(fd, PIPELINE_DEPTH, buffer))
+            {
+                break;
+            }
+            completed.fetch_add(PIPELINE_DEPTH, std::memory_order_relaxed);
+        }
+        close(fd);
+    }
+
+    void controlClient(int port, const std::atomic<bool> &stop, std::vector<double> &latencies)
+    {
+        int fd = connectTo(port);
+        if (fd < 0)
+            return;
+
+        std::string buffer;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            auto start = Clock::now();
+            if (::send(fd, CONTROL_REQUEST.data(), CONTROL_REQUEST.size(), MSG_NOSIGNAL) != (ssize_t)CONTROL_REQUEST.size() ||
+                !readResponses(fd, 1, buffer))
+            {
+                break;
+            }
+            latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            std::this_thread::sleep_for(CONTROL_INTERVAL);
+        }
+        close(fd);
+    }
+
+    RunResult runLoad(int port, int bulk_clients, int seconds)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<long> completed{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < bulk_clients; ++i)
+        {
+            threads.emplace_back(bulkClient, port, std::cref(stop), std::ref(completed));
+        }
+
+        // Let the bulk clients fill the worker queue before measuring
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        long completed_start = completed.load();
+        auto start = Clock::now();
+
+        RunResult result;
+        std::thread control(controlClient, port, std::cref(stop), std::ref(result.control_ms));
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop = true;
+        control.join();
+        auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        result.bulk_rate = static_cast<double>(completed.load() - completed_start) / elapsed.count();
+        return result;
+    }
+
+    double percentile(std::vector<double> &values, double fraction)
+    {
+        if (values.empty())
+            return 0.0;
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int bulk_clients = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int bulk_ms = argc > 2 ? std::atoi(argv[2]) : 20;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 3;
+    const int port = argc > 4 ? std::atoi(argv[4]) : 18080;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    auto handler = [bulk_ms](int, const std::string &message, const qnx::CancellationToken &) -> std::string
+    {
+        if (message.find("get_processes") == std::string::npos)
+            return "{\"status\":\"success\"}";
+
+        // Spin rather than sleep: encoding a large listing keeps a worker busy
+        auto until = Clock::now() + std::chrono::milliseconds(bulk_ms);
+        while (Clock::now() < until)
+        {
+        }
+        return "{\"status\":\"success\",\"processes\":[" + std::string(4096, ' ') + "]}";
+    };
+
+    std::cout << "Loopback port " << port << ", " << bulk_clients << " bulk clients pipelining " << PIPELINE_DEPTH
+              << " requests of " << bulk_ms << " ms, " << seconds << " s per run" << std::endl;
+    std::cout << std::left << std::setw(16) << "queues"
+              << std::right << std::setw(12) << "control"
+              << std::setw(12) << "p50 ms"
+              << std::setw(12) << "p99 ms"
+              << std::setw(12) << "max ms"
+              << std::setw(12) << "bulk/s" << std::endl;
+
+    for (bool lanes : {false, true})
+    {
+        // The server logs every connection; keep that out of the measurement
+        NullBuffer discarded;
+        std::streambuf *console = std::cout.rdbuf(&discarded);
+
+        auto &server = qnx::SocketServer::getInstance();
+        server.setRequestClassifier(lanes ? qnx::SocketServer::RequestClassifier(qnx::classifyRequest) : nullptr);
+        bool started = server.init(port, handler);
+
+        RunResult result;
+        if (started)
+        {
+            result = runLoad(port, bulk_clients, seconds);
+            server.shutdown();
+        }
+        std::cout.rdbuf(console);
+
+        if (!started)
+        {
+            std::cerr << "Failed to start the server" << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(16) << (lanes ? "priority lanes" : "single queue")
+                  << std::right << std::setw(12) << result.control_ms.size()
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << percentile(result.control_ms, 0.50)
+                  << std::setw(12) << percentile(result.control_ms, 0.99)
+                  << std::setw(12) << percentile(result.control_ms, 1.0)
+                  << std::setprecision(0)
+                  << std::setw(12) << result.bulk_rate << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file reactor_bench.cpp
+ * @brief Benchmark of SocketServer accept rate, throughput and CPU cost by I/O backend and reactor count
+ *
+ * Starts the socket server on the loopback interface with every available I/O
+ * backend and 1, 2, 4, ... reactors, and drives it from client threads in two
+ * phases:
+ *
+ * - accept: every client repeatedly connects, sends one request, reads the
+ *   response and disconnects (a dashboard reconnect storm)
+ * - throughput: every client keeps one connection and pipelines requests
+ *
+ * The handler returns a fixed response, so the numbers reflect the cost of the
+ * server's connection handling and I/O rather than of any command. The CPU
+ * column is the server's CPU time per pipelined request: process CPU time
+ * minus the CPU time of the client threads.
+ *
+ * A backend the kernel does not support falls back like the server does, and
+ * is reported under the backend actually used.
+ *
+ * Usage: reactor_bench [max_reactors] [clients] [seconds] [port] [backend]
+ */
+
+#include "SocketServer.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const std::string REQUEST = "{\"command\":\"ping\"}\n";
+    const std::string RESPONSE = "{\"command\":\"ping\",\"status\":\"success\"}";
+    constexpr int PIPELINE_DEPTH = 8;
+
+    // Stateless sink for the server's connection log; safe to share between threads
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    };
+
+    long long cpuNanoseconds(clockid_t clock)
+    {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    struct PhaseResult
+    {
+        double rate = 0.0;          ///< Completed operations per second
+        double server_cpu_us = 0.0; ///< Server CPU time per operation, in microseconds
+    };
+
+    int connectTo(int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        // Reset instead of lingering in TIME_WAIT, so a long storm does not run out of ports
+        struct linger lg = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    // Read until the given number of newline-terminated responses has arrived
+    bool readResponses(int fd, int count, std::string &buffer)
+    {
+        char chunk[4096];
+        while (count > 0)
+        {
+            size_t newline;
+            while (count > 0 && (newline = buffer.find('\n')) != std::string::npos)
+            {
+                buffer.erase(0, newline + 1);
+                --count;
+            }
+            if (count == 0)
+                break;
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    void acceptClient(int port, const std::atomic<bool> &stop, std::atomic<long> &completed,
+                      std::atomic<long long> &client_cpu_ns)
+    {
+        std::string buffer;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            int fd = connectTo(port);
+            if (fd < 0)
+                continue;
+            buffer.clear();
+            if (::send(fd, REQUEST.data(), REQUEST.size(), MSG_NOSIGNAL) == (ssize_t)REQUEST.size() &&
+                readResponses(fd, 1, buffer))
+            {
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }
+            close(fd);
+        }
+        client_cpu_ns.fetch_add(cpuNanoseconds(CLOCK_THREAD_CPUTIME_ID));
+    }
+
+    void pipelineClient(int port, const std::atomic<bool> &stop, std::atomic<long> &completed,
+                        std::atomic<long long> &client_cpu_ns)
+    {
+        int fd = connectTo(port);
+        if (fd < 0)
+            return;
+
+        std::string batch;
+        for (int i = 0; i < PIPELINE_DEPTH; ++i)
+            batch += REQUEST;
+
+        std::string buffer;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (::send(fd, batch.data(), batch.size(), MSG_NOSIGNAL) != (ssize_t)batch.size() ||
+                !readResponses(fd, PIPELINE_DEPTH, buffer))
+            {
+                break;
+            }
+            completed.fetch_add(PIPELINE_DEPTH, std::memory_order_relaxed);
+        }
+        close(fd);
+        client_cpu_ns.fetch_add(cpuNanoseconds(CLOCK_THREAD_CPUTIME_ID));
+    }
+
+    template <typename Client>
+    PhaseResult runPhase(Client client, int port, int clients, int seconds)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<long> completed{0};
+        std::atomic<long long> client_cpu_ns{0};
+        std::vector<std::thread> threads;
+        long long cpu_start = cpuNanoseconds(CLOCK_PROCESS_CPUTIME_ID);
+        for (int i = 0; i < clients; ++i)
+        {
+            threads.emplace_back(client, port, std::cref(stop), std::ref(completed), std::ref(client_cpu_ns));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop = true;
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+        long long server_cpu_ns = cpuNanoseconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start - client_cpu_ns.load();
+
+        PhaseResult result;
+        result.rate = static_cast<double>(completed.load()) / elapsed.count();
+        if (completed.load() > 0)
+        {
+            result.server_cpu_us = static_cast<double>(server_cpu_ns) / 1000.0 / static_cast<double>(completed.load());
+        }
+        return result;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t max_reactors = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                         : std::max(1u, std::thread::hardware_concurrency());
+    const int clients = argc > 2 ? std::atoi(argv[2]) : 12;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 2;
+    const int port = argc > 4 ? std::atoi(argv[4]) : 18080;
+
+    std::vector<qnx::IoBackend> backends = {qnx::IoBackend::SELECT, qnx::IoBackend::EPOLL, qnx::IoBackend::IO_URING};
+    if (argc > 5)
+    {
+        qnx::IoBackend backend;
+        if (!qnx::parseIoBackend(argv[5], backend))
+        {
+            std::cerr << "Unknown I/O backend: " << argv[5] << std::endl;
+            return 1;
+        }
+        backends = {backend};
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Loopback port " << port << ", " << clients << " clients, " << seconds
+              << " s per phase, pipeline depth " << PIPELINE_DEPTH << std::endl;
+    std::cout << std::left << std::setw(10) << "backend"
+              << std::setw(10) << "reactors"
+              << std::right << std::setw(16) << "accepts/s"
+              << std::setw(16) << "requests/s"
+              << std::setw(16) << "cpu us/request" << std::endl;
+
+    for (qnx::IoBackend backend : backends)
+    {
+        for (size_t reactors = 1; reactors <= max_reactors; reactors *= 2)
+        {
+            // The server logs every connection; keep that out of the measurement
+            NullBuffer discarded;
+            std::streambuf *console = std::cout.rdbuf(&discarded);
+
+            qnx::ServerOptions options;
+            options.reactors = reactors;
+            options.backend = backend;
+            bool started = qnx::SocketServer::getInstance().init(
+                port, [](int, const std::string &, const qnx::CancellationToken &)
+                { return RESPONSE; },
+                options);
+
+            PhaseResult accepts;
+            PhaseResult requests;
+            if (started)
+            {
+                accepts = runPhase(acceptClient, port, clients, seconds);
+                requests = runPhase(pipelineClient, port, clients, seconds);
+                qnx::SocketServer::getInstance().shutdown();
+            }
+            std::cout.rdbuf(console);
+
+            if (!started)
+            {
+                std::cerr << "Failed to start the server with " << reactors << " reactors" << std::endl;
+                return 1;
+            }
+            std::cout << std::left << std::setw(10) << qnx::ioBackendName(qnx::SocketServer::getInstance().backend())
+                      << std::setw(10) << reactors
+                      << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(16) << accepts.rate
+                      << std::setw(16) << requests.rate
+                      << std::setprecision(2)
+                      << std::setw(16) << requests.server_cpu_us << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,727 @@
+/**
+ * @file rpm_loadgen.cpp
+ * @brief Load generator and end-to-end latency benchmark for the RPM protocol
+ *
+ * Opens a number of connections to a running server and replays a weighted
+ * mix of commands at a target rate:
+ *
+ * - list: get_processes
+ * - info: get_process_info for the target pid
+ * - control: resume_process for the target pid, which has no effect on a
+ *   running process but takes the process control path
+ * - subscribe: subscribe to the top processes; the subscription is dropped
+ *   again as soon as it is confirmed, so the per-client limit is never hit
+ *
+ * Requests are sent open loop: each connection has a fixed send schedule,
+ * and latency is measured from the time a request was scheduled rather than
+ * the time it was actually written, so a server that falls behind is charged
+ * for the queueing it causes instead of hiding it (coordinated omission).
+ * Latencies are recorded in log-linear histograms with three significant
+ * digits, per command and overall, and the results are written as JSON.
+ *
+ * The tool only uses the socket API and the JSON protocol, so it builds and
+ * runs on Linux as well as on QNX ("make rpm-loadgen" builds it for the host).
+ *
+ * Usage: rpm_loadgen [-H host] [-p port] [-u unix_socket_path] [-c connections] [-r rate]
+ *                    [-d depth] [-t seconds] [-w warmup_seconds] [-m mix] [-P pid]
+ *                    [-l user:password] [-o output.json]
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum Op
+    {
+        LIST,
+        INFO,
+        CONTROL,
+        SUBSCRIBE,
+        OP_COUNT
+    };
+
+    const char *const OP_NAMES[OP_COUNT] = {"list", "info", "control", "subscribe"};
+
+    constexpr auto DRAIN_TIMEOUT = std::chrono::seconds(2); // Wait for outstanding responses after the run
+
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        int port = 8080;
+        std::string unix_path;          ///< Connect to this Unix domain socket instead of TCP
+        int connections = 8;
+        double rate = 1000.0;           ///< Requests per second over all connections, 0 for closed loop
+        int depth = 16;                 ///< Outstanding requests allowed per connection
+        double seconds = 10.0;          ///< Measured duration
+        double warmup = 1.0;            ///< Unmeasured duration before it
+        int weights[OP_COUNT] = {70, 20, 5, 5};
+        int pid = 1;                    ///< Target of info and control requests
+        std::string login;              ///< user:password to log in with, if any
+        std::string output;             ///< Results file, stdout if empty
+    };
+
+    /**
+     * Log-linear latency histogram in the style of HdrHistogram: values below
+     * 2048 have their own bucket and each further power of two is split into
+     * 1024 buckets, so every recorded value keeps three significant digits.
+     */
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram() : counts_(SUB_BUCKETS + 53 * HALF_BUCKETS, 0) {}
+
+        void record(uint64_t value)
+        {
+            ++counts_[indexOf(value)];
+            ++count_;
+            sum_ += value;
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+
+        void merge(const LatencyHistogram &other)
+        {
+            for (size_t i = 0; i < counts_.size(); ++i)
+                counts_[i] += other.counts_[i];
+            count_ += other.count_;
+            sum_ += other.sum_;
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+
+        uint64_t count() const { return count_; }
+        uint64_t min() const { return count_ ? min_ : 0; }
+        uint64_t max() const { return max_; }
+        double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+        // Highest value of the bucket holding the given percentile, capped at the maximum seen
+        uint64_t percentile(double percent) const
+        {
+            if (count_ == 0)
+                return 0;
+            uint64_t rank = static_cast<uint64_t>(percent / 100.0 * count_ + 0.5);
+            rank = std::max<uint64_t>(1, std::min(rank, count_));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts_.size(); ++i)
+            {
+                seen += counts_[i];
+                if (seen >= rank)
+                    return std::min(highestOf(i), max_);
+            }
+            return max_;
+        }
+
+        // Call fn(highest value, count) for every non-empty bucket in increasing order
+        template <typename Fn>
+        void forEachBucket(Fn fn) const
+        {
+            for (size_t i = 0; i < counts_.size(); ++i)
+            {
+                if (counts_[i])
+                    fn(std::min(highestOf(i), max_), counts_[i]);
+            }
+        }
+
+    private:
+        static constexpr uint64_t SUB_BUCKETS = 2048;
+        static constexpr uint64_t HALF_BUCKETS = SUB_BUCKETS / 2;
+
+        static size_t indexOf(uint64_t value)
+        {
+            if (value < SUB_BUCKETS)
+                return static_cast<size_t>(value);
+            int shift = 63 - __builtin_clzll(value) - 10; // value >> shift lies in [1024, 2048)
+            return static_cast<size_t>(SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + ((value >> shift) - HALF_BUCKETS));
+        }
+
+        static uint64_t highestOf(size_t index)
+        {
+            if (index < SUB_BUCKETS)
+                return index;
+            uint64_t shift = (index - SUB_BUCKETS) / HALF_BUCKETS + 1;
+            uint64_t sub = (index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+            return ((sub + 1) << shift) - 1;
+        }
+
+        std::vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t min_ = UINT64_MAX;
+        uint64_t max_ = 0;
+    };
+
+    struct OpStats
+    {
+        LatencyHistogram latency_us;
+        uint64_t sent = 0;
+        uint64_t completed = 0;
+        uint64_t errors = 0;    ///< Responses with a status other than success
+        uint64_t throttled = 0; ///< Errors rejected by admission control
+    };
+
+    struct ClientStats
+    {
+        OpStats ops[OP_COUNT];
+        uint64_t updates = 0;     ///< Subscription pushes received
+        uint64_t unanswered = 0;  ///< Measured requests still outstanding at the end
+        bool connected = false;
+    };
+
+    struct Pending
+    {
+        Op op;
+        Clock::time_point scheduled;
+        bool measured;
+    };
+
+    std::atomic<bool> interrupted{false};
+
+    void onSignal(int)
+    {
+        interrupted = true;
+    }
+
+    int connectTo(const Options &options)
+    {
+        if (!options.unix_path.empty())
+        {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                return -1;
+            struct sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, options.unix_path.c_str(), sizeof(address.sun_path) - 1);
+            if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo *result = nullptr;
+        if (getaddrinfo(options.host.c_str(), std::to_string(options.port).c_str(), &hints, &result) != 0)
+            return -1;
+
+        int fd = -1;
+        for (struct addrinfo *ai = result; ai != nullptr; ai = ai->ai_next)
+        {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+                break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        if (fd >= 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
+    }
+
+    bool sendAll(int fd, const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::string buildRequest(Op op, long long id, int pid)
+    {
+        std::string request = "{\"id\":" + std::to_string(id) + ",";
+        switch (op)
+        {
+        case LIST:
+            request += "\"command\":\"get_processes\"}\n";
+            break;
+        case INFO:
+            request += "\"command\":\"get_process_info\",\"pid\":" + std::to_string(pid) + "}\n";
+            break;
+        case CONTROL:
+            request += "\"command\":\"resume_process\",\"pid\":" + std::to_string(pid) + "}\n";
+            break;
+        case SUBSCRIBE:
+        default:
+            request += "\"command\":\"subscribe\",\"topic\":\"top\",\"k\":10}\n";
+            break;
+        }
+        return request;
+    }
+
+    // Integer value of a top-level member; responses are flat enough that the first match is the right one
+    bool findInt(const std::string &response, const char *member, long long &value)
+    {
+        std::string pattern = std::string("\"") + member + "\":";
+        size_t pos = response.find(pattern);
+        if (pos == std::string::npos)
+            return false;
+        const char *start = response.c_str() + pos + pattern.size();
+        char *end = nullptr;
+        value = std::strtoll(start, &end, 10);
+        return end != start;
+    }
+
+    // Read one line with a blocking receive; used only for the login exchange
+    bool readLine(int fd, std::string &buffer, std::string &line)
+    {
+        char chunk[4096];
+        size_t newline;
+        while ((newline = buffer.find('\n')) == std::string::npos)
+        {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+        line = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        return true;
+    }
+
+    bool login(int fd, const std::string &credentials, std::string &buffer)
+    {
+        size_t colon = credentials.find(':');
+        std::string request = "{\"command\":\"login\",\"username\":\"" + credentials.substr(0, colon) +
+                              "\",\"password\":\"" + (colon == std::string::npos ? "" : credentials.substr(colon + 1)) + "\"}\n";
+        std::string line;
+        return sendAll(fd, request) && readLine(fd, buffer, line) && line.find("\"status\":\"success\"") != std::string::npos;
+    }
+
+    /**
+     * One connection's send schedule and response bookkeeping. Requests are
+     * numbered so responses can be matched by their echoed "id"; lines
+     * without one are subscription pushes.
+     */
+    void runClient(const Options &options, int index, Clock::time_point start, Clock::time_point measure_from,
+                   Clock::time_point end, ClientStats &stats)
+    {
+        int fd = connectTo(options);
+        if (fd < 0)
+            return;
+        std::string buffer;
+        if (!options.login.empty() && !login(fd, options.login, buffer))
+        {
+            close(fd);
+            return;
+        }
+        stats.connected = true;
+
+        std::vector<int> cumulative;
+        int total_weight = 0;
+        for (int weight : options.weights)
+        {
+            total_weight += weight;
+            cumulative.push_back(total_weight);
+        }
+        std::mt19937 random(static_cast<unsigned>(index) * 2654435761u + 1);
+        std::uniform_int_distribution<int> pick(0, total_weight - 1);
+
+        // Spread the connections' schedules evenly over one interval
+        const bool open_loop = options.rate > 0.0;
+        const auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(open_loop ? options.connections / options.rate : 0.0));
+        Clock::time_point next_send = start + interval * index / std::max(1, options.connections);
+
+        std::unordered_map<long long, Pending> pending;
+        long long next_id = 1;
+        char chunk[65536];
+
+        while (!interrupted.load(std::memory_order_relaxed))
+        {
+            Clock::time_point now = Clock::now();
+            const bool sending = now < end;
+            if (!sending && pending.empty())
+                break;
+            if (!sending && now >= end + DRAIN_TIMEOUT)
+                break;
+
+            // Send everything due, up to the pipeline depth
+            while (sending && static_cast<int>(pending.size()) < options.depth && (!open_loop || now >= next_send))
+            {
+                const int choice = pick(random);
+                const Op op = static_cast<Op>(std::upper_bound(cumulative.begin(), cumulative.end(), choice) - cumulative.begin());
+                const Clock::time_point scheduled = open_loop ? next_send : now;
+                const bool measured = scheduled >= measure_from;
+                const long long id = next_id++;
+                if (!sendAll(fd, buildRequest(op, id, options.pid)))
+                {
+                    close(fd);
+                    return;
+                }
+                pending[id] = Pending{op, scheduled, measured};
+                if (measured)
+                    ++stats.ops[op].sent;
+                next_send += interval;
+            }
+
+            int timeout_ms = 10;
+            if (sending && open_loop && static_cast<int>(pending.size()) < options.depth)
+            {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_send - now).count();
+                timeout_ms = static_cast<int>(std::max<long long>(0, std::min<long long>(wait, 10)));
+            }
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, timeout_ms);
+            if (ready < 0 && errno != EINTR)
+                break;
+            if (ready <= 0)
+                continue;
+
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            buffer.append(chunk, static_cast<size_t>(n));
+            Clock::time_point received = Clock::now();
+
+            size_t line_start = 0;
+            size_t newline;
+            while ((newline = buffer.find('\n', line_start)) != std::string::npos)
+            {
+                const std::string line = buffer.substr(line_start, newline - line_start);
+                line_start = newline + 1;
+
+                long long id = 0;
+                auto it = findInt(line, "id", id) ? pending.find(id) : pending.end();
+                if (it == pending.end())
+                {
+                    ++stats.updates;
+                    continue;
+                }
+                const Pending request = it->second;
+                pending.erase(it);
+
+                long long subscription_id = 0;
+                if (request.op == SUBSCRIBE && findInt(line, "subscription_id", subscription_id))
+                {
+                    // Drop it again at once; the reply is matched and ignored
+                    const long long unsubscribe_id = next_id++;
+                    if (!sendAll(fd, "{\"id\":" + std::to_string(unsubscribe_id) +
+                                         ",\"command\":\"unsubscribe\",\"subscription_id\":" + std::to_string(subscription_id) + "}\n"))
+                        break;
+                    pending[unsubscribe_id] = Pending{SUBSCRIBE, received, false};
+                }
+
+                if (!request.measured)
+                    continue;
+                OpStats &op = stats.ops[request.op];
+                ++op.completed;
+                if (line.find("\"status\":\"success\"") == std::string::npos)
+                {
+                    ++op.errors;
+                    if (line.find("\"retry_after_ms\"") != std::string::npos)
+                        ++op.throttled;
+                }
+                op.latency_us.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(received - request.scheduled).count()));
+            }
+            buffer.erase(0, line_start);
+        }
+
+        for (const auto &request : pending)
+        {
+            if (request.second.measured)
+                ++stats.unanswered;
+        }
+        close(fd);
+    }
+
+    bool parseMix(const std::string &text, int weights[OP_COUNT])
+    {
+        std::fill(weights, weights + OP_COUNT, 0);
+        std::stringstream stream(text);
+        std::string item;
+        int total = 0;
+        while (std::getline(stream, item, ','))
+        {
+            size_t equals = item.find('=');
+            if (equals == std::string::npos)
+                return false;
+            const std::string name = item.substr(0, equals);
+            const int weight = std::atoi(item.c_str() + equals + 1);
+            const auto it = std::find_if(std::begin(OP_NAMES), std::end(OP_NAMES), [&](const char *op)
+                                         { return name == op; });
+            if (it == std::end(OP_NAMES) || weight < 0)
+                return false;
+            weights[it - std::begin(OP_NAMES)] = weight;
+            total += weight;
+        }
+        return total > 0;
+    }
+
+    void writeLatency(std::ostream &out, const LatencyHistogram &histogram, bool buckets, const std::string &indent)
+    {
+        static const double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+        out << "{\n"
+            << indent << "  \"count\": " << histogram.count() << ",\n"
+            << indent << "  \"min\": " << histogram.min() << ",\n"
+            << indent << "  \"mean\": " << std::fixed << std::setprecision(1) << histogram.mean() << ",\n"
+            << indent << "  \"max\": " << histogram.max() << ",\n"
+            << indent << "  \"percentiles\": {";
+        const char *separator = "";
+        for (double percent : PERCENTILES)
+        {
+            std::ostringstream key;
+            key << percent;
+            out << separator << "\"" << key.str() << "\": " << histogram.percentile(percent);
+            separator = ", ";
+        }
+        out << "}";
+        if (buckets)
+        {
+            // Non-empty buckets as [highest value, count], enough to rebuild the distribution
+            out << ",\n"
+                << indent << "  \"histogram\": [";
+            separator = "";
+            histogram.forEachBucket([&](uint64_t value, uint64_t count)
+                                    {
+                out << separator << "[" << value << ", " << count << "]";
+                separator = ", "; });
+            out << "]";
+        }
+        out << "\n"
+            << indent << "}";
+    }
+
+    void writeResults(std::ostream &out, const Options &options, const std::vector<ClientStats> &clients, double elapsed)
+    {
+        OpStats totals[OP_COUNT];
+        LatencyHistogram overall;
+        uint64_t updates = 0, unanswered = 0;
+        int connected = 0;
+        for (const auto &client : clients)
+        {
+            for (int i = 0; i < OP_COUNT; ++i)
+            {
+                totals[i].latency_us.merge(client.ops[i].latency_us);
+                totals[i].sent += client.ops[i].sent;
+                totals[i].completed += client.ops[i].completed;
+                totals[i].errors += client.ops[i].errors;
+                totals[i].throttled += client.ops[i].throttled;
+                overall.merge(client.ops[i].latency_us);
+            }
+            updates += client.updates;
+            unanswered += client.unanswered;
+            connected += client.connected ? 1 : 0;
+        }
+        uint64_t sent = 0, completed = 0, errors = 0, throttled = 0;
+        for (const auto &op : totals)
+        {
+            sent += op.sent;
+            completed += op.completed;
+            errors += op.errors;
+            throttled += op.throttled;
+        }
+
+        out << "{\n"
+            << "  \"target\": \"" << (options.unix_path.empty() ? options.host + ":" + std::to_string(options.port) : options.unix_path) << "\",\n"
+            << "  \"connections\": " << options.connections << ",\n"
+            << "  \"connected\": " << connected << ",\n"
+            << "  \"target_rate\": " << std::fixed << std::setprecision(1) << options.rate << ",\n"
+            << "  \"depth\": " << options.depth << ",\n"
+            << "  \"duration_s\": " << std::setprecision(3) << elapsed << ",\n"
+            << "  \"mix\": {";
+        const char *separator = "";
+        for (int i = 0; i < OP_COUNT; ++i)
+        {
+            out << separator << "\"" << OP_NAMES[i] << "\": " << options.weights[i];
+            separator = ", ";
+        }
+        out << "},\n"
+            << "  \"sent\": " << sent << ",\n"
+            << "  \"completed\": " << completed << ",\n"
+            << "  \"errors\": " << errors << ",\n"
+            << "  \"throttled\": " << throttled << ",\n"
+            << "  \"unanswered\": " << unanswered << ",\n"
+            << "  \"updates\": " << updates << ",\n"
+            << "  \"throughput\": " << std::setprecision(1) << (elapsed > 0 ? completed / elapsed : 0.0) << ",\n"
+            << "  \"latency_us\": ";
+        writeLatency(out, overall, true, "  ");
+        out << ",\n"
+            << "  \"commands\": {";
+        separator = "\n";
+        for (int i = 0; i < OP_COUNT; ++i)
+        {
+            if (options.weights[i] == 0)
+                continue;
+            out << separator << "    \"" << OP_NAMES[i] << "\": {\n"
+                << "      \"sent\": " << totals[i].sent << ",\n"
+                << "      \"completed\": " << totals[i].completed << ",\n"
+                << "      \"errors\": " << totals[i].errors << ",\n"
+                << "      \"throttled\": " << totals[i].throttled << ",\n"
+                << "      \"latency_us\": ";
+            writeLatency(out, totals[i].latency_us, false, "      ");
+            out << "\n    }";
+            separator = ",\n";
+        }
+        out << "\n  }\n"
+            << "}" << std::endl;
+    }
+
+    void printUsage(const char *program)
+    {
+        std::cerr << "Usage: " << program << " [-H host] [-p port] [-u unix_socket_path] [-c connections] [-r rate] [-d depth]\n"
+                  << "       [-t seconds] [-w warmup_seconds] [-m mix] [-P pid] [-l user:password] [-o output.json]\n"
+                  << "  -H host   Server address (default 127.0.0.1)\n"
+                  << "  -p port   Server TCP port (default 8080)\n"
+                  << "  -u path   Connect to a Unix domain socket instead\n"
+                  << "  -c count  Number of connections (default 8)\n"
+                  << "  -r rate   Requests per second over all connections, 0 to send as fast as answered (default 1000)\n"
+                  << "  -d depth  Outstanding requests allowed per connection (default 16)\n"
+                  << "  -t secs   Measured duration (default 10)\n"
+                  << "  -w secs   Warm-up before measuring (default 1)\n"
+                  << "  -m mix    Command weights (default list=70,info=20,control=5,subscribe=5)\n"
+                  << "  -P pid    Process queried by info and resumed by control (default 1)\n"
+                  << "  -l creds  Log every connection in as user:password\n"
+                  << "  -o file   Write the JSON results here instead of stdout\n"
+                  << "Note: the server rate-limits each connection (its -q option); raise that limit\n"
+                  << "or spread the load over more connections, or requests are counted as throttled." << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:u:c:r:d:t:w:m:P:l:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H':
+            options.host = optarg;
+            break;
+        case 'p':
+            options.port = std::atoi(optarg);
+            break;
+        case 'u':
+            options.unix_path = optarg;
+            break;
+        case 'c':
+            options.connections = std::atoi(optarg);
+            break;
+        case 'r':
+            options.rate = std::strtod(optarg, nullptr);
+            break;
+        case 'd':
+            options.depth = std::atoi(optarg);
+            break;
+        case 't':
+            options.seconds = std::strtod(optarg, nullptr);
+            break;
+        case 'w':
+            options.warmup = std::strtod(optarg, nullptr);
+            break;
+        case 'm':
+            if (!parseMix(optarg, options.weights))
+            {
+                std::cerr << "Invalid command mix: " << optarg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'P':
+            options.pid = std::atoi(optarg);
+            break;
+        case 'l':
+            options.login = optarg;
+            break;
+        case 'o':
+            options.output = optarg;
+            break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.connections <= 0 || options.depth <= 0 || options.seconds <= 0.0 || options.warmup < 0.0 || options.rate < 0.0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+    const Clock::time_point measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    const Clock::time_point end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+
+    std::vector<ClientStats> clients(static_cast<size_t>(options.connections));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.connections; ++i)
+    {
+        threads.emplace_back(runClient, std::cref(options), i, start, measure_from, end, std::ref(clients[i]));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    const double elapsed = std::max(0.0, std::chrono::duration<double>(std::min(Clock::now(), end) - measure_from).count());
+
+    if (std::none_of(clients.begin(), clients.end(), [](const ClientStats &client)
+                     { return client.connected; }))
+    {
+        std::cerr << "Could not connect to the server" << std::endl;
+        return 1;
+    }
+
+    if (options.output.empty())
+    {
+        writeResults(std::cout, options, clients, elapsed);
+    }
+    else
+    {
+        std::ofstream file(options.output);
+        if (!file)
+        {
+            std::cerr << "Cannot write " << options.output << std::endl;
+            return 1;
+        }
+        writeResults(file, options, clients, elapsed);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file schema_bench.cpp
+ * @brief Benchmark of the schema-driven record encoders
+ *
+ * Encodes a synthetic 5000-process listing in each wire format by adding
+ * the members by name, as the handlers used to, and through the
+ * ProcessInfoSchema table with its pre-encoded keys, first with every field
+ * and then projected to pid, name and cpu_usage as a client requesting
+ * "fields" would get it.
+ *
+ * Usage: schema_bench [processes] [iterations]
+ */
+
+#include "FieldSchema.hpp"
+#include "ResponseWriter.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char *const NAMES[] = {"procnto-smp-instr", "slogger2", "pipe", "devb-sdmmc", "io-sock", "devc-pty",
+                                 "mqueue", "random", "dumper", "qconn", "sshd", "ksh", "sh", "devc-ser8250"};
+
+    std::vector<qnx::ProcessInfo> makeProcesses(size_t count)
+    {
+        std::vector<qnx::ProcessInfo> processes(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            qnx::ProcessInfo &info = processes[i];
+            info.setPid(static_cast<pid_t>(1 + i * 4097 % 999983));
+            info.setName(NAMES[i % (sizeof(NAMES) / sizeof(NAMES[0]))]);
+            info.setCpuUsage(static_cast<double>((i * 7919) % 10000) / 137.0);
+            info.setMemoryUsage(1024 + (i * 104729) % (512 * 1024));
+            info.setNumThreads(1 + static_cast<int>(i % 24));
+            info.setPriority(10 + static_cast<int>(i % 3) * 5);
+            info.setPolicy(2);
+            info.setState(static_cast<int>(i % 4));
+        }
+        return processes;
+    }
+
+    // The listing as encodeProcessList() wrote it before the schema
+    void encodeByName(qnx::ResponseWriter &writer, const std::vector<qnx::ProcessInfo> &processes)
+    {
+        writer.startArray("processes");
+        for (const auto &info : processes)
+        {
+            writer.startObject(NULL);
+            writer.addInt("pid", info.getPid());
+            writer.addString("name", info.getName().c_str());
+            writer.addPercentage("cpu_usage", info.getCpuUsage());
+            writer.addInt("memory_usage", static_cast<long long>(info.getMemoryUsage()));
+            writer.addInt("num_threads", info.getNumThreads());
+            writer.addInt("priority", info.getPriority());
+            writer.addInt("policy", info.getPolicy());
+            writer.addInt("state", info.getState());
+            writer.endObject();
+        }
+        writer.endArray();
+    }
+
+    template <typename Encode>
+    size_t encodeListing(qnx::WireFormat format, Encode &&encode)
+    {
+        auto writer = qnx::ResponseWriter::acquire(format);
+        writer->startObject(NULL);
+        writer->addString("command", "get_processes");
+        writer->addString("status", "success");
+        encode(*writer);
+        writer->endObject();
+        return writer->finish().size();
+    }
+
+    template <typename Function>
+    double timePerCall(int iterations, Function &&function)
+    {
+        function(); // Warm-up
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    void printRow(const std::string &label, double us, size_t bytes, size_t records)
+    {
+        std::cout << std::left << std::setw(34) << label
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << us
+                  << std::setw(12) << us * 1000.0 / static_cast<double>(records)
+                  << std::setw(12) << bytes << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    const std::vector<qnx::ProcessInfo> processes = makeProcesses(count);
+    const qnx::FieldMask projection = (1u << 0) | (1u << 1) | (1u << 2); // pid, name, cpu_usage
+    volatile size_t sink = 0;
+
+    std::cout << "Encoding " << count << " processes, " << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(34) << "encoder"
+              << std::right << std::setw(12) << "us/listing"
+              << std::setw(12) << "ns/record"
+              << std::setw(12) << "bytes" << std::endl;
+
+    for (qnx::WireFormat format : {qnx::WireFormat::JSON, qnx::WireFormat::BINARY})
+    {
+        const std::string prefix = std::string(qnx::wireFormatName(format)) + " ";
+        auto by_name = [&](qnx::ResponseWriter &writer)
+        { encodeByName(writer, processes); };
+        auto by_schema = [&](qnx::ResponseWriter &writer)
+        { qnx::encodeRecords<qnx::ProcessInfoSchema>(writer, "processes", processes); };
+        auto projected = [&](qnx::ResponseWriter &writer)
+        { qnx::encodeRecords<qnx::ProcessInfoSchema>(writer, "processes", processes, projection); };
+
+        size_t bytes = encodeListing(format, by_name);
+        printRow(prefix + "members by name", timePerCall(iterations, [&]()
+                                                         { sink = sink + encodeListing(format, by_name); }),
+                 bytes, count);
+        bytes = encodeListing(format, by_schema);
+        printRow(prefix + "schema, all fields", timePerCall(iterations, [&]()
+                                                            { sink = sink + encodeListing(format, by_schema); }),
+                 bytes, count);
+        bytes = encodeListing(format, projected);
+        printRow(prefix + "schema, pid/name/cpu_usage", timePerCall(iterations, [&]()
+                                                                    { sink = sink + encodeListing(format, projected); }),
+                 bytes, count);
+    }
+
+    return 0;
+}
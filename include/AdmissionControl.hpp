@@ -0,0 +1,199 @@
+/**
+ * @file AdmissionControl.hpp
+ * @brief Request rate limiting for the QNX Remote Process Monitor
+ *
+ * This file defines the AdmissionControl class, which decides whether a
+ * request may run before its handler is invoked. Each connection and each
+ * authenticated user has a token bucket, and commands that read the process
+ * table or procfs are additionally limited in how many may run at once, so a
+ * single client looping on an expensive command cannot occupy every worker.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace qnx
+{
+    /**
+     * @struct AdmissionLimits
+     * @brief Configuration of AdmissionControl
+     *
+     * Rates are in tokens per second; a cheap command costs one token and an
+     * expensive command EXPENSIVE_COST tokens. A rate of 0 disables that bucket.
+     */
+    struct AdmissionLimits
+    {
+        double connection_rate = 100.0;  ///< Refill rate of each connection's bucket
+        double connection_burst = 200.0; ///< Capacity of each connection's bucket
+        double user_rate = 400.0;        ///< Refill rate of each user's bucket, shared by all their connections
+        double user_burst = 800.0;       ///< Capacity of each user's bucket
+        size_t max_expensive = 3;        ///< Expensive commands running at once, 0 for no limit
+    };
+
+    /**
+     * @enum Admission
+     * @brief Outcome of AdmissionControl::admit()
+     */
+    enum class Admission
+    {
+        ADMITTED,        ///< The request may run
+        CONNECTION_RATE, ///< The connection's bucket is empty
+        USER_RATE,       ///< The user's bucket is empty
+        BUSY             ///< Too many expensive commands are already running
+    };
+
+    /**
+     * @class AdmissionControl
+     * @brief Token-bucket and concurrency limits applied to every request
+     *
+     * Buckets refill lazily when a request is checked, so idle connections
+     * cost nothing. A rejected request consumes no tokens. Thread-safe.
+     */
+    class AdmissionControl
+    {
+    public:
+        /// Tokens taken by one expensive command
+        static constexpr double EXPENSIVE_COST = 5.0;
+
+        /// Share of its own cost each entry of a batch adds to the batch's one token
+        static constexpr double BATCH_ENTRY_SHARE = 0.1;
+
+        /**
+         * @brief Get the singleton instance of AdmissionControl
+         *
+         * @return Reference to the singleton instance
+         */
+        static AdmissionControl &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        AdmissionControl(const AdmissionControl &) = delete;
+        AdmissionControl &operator=(const AdmissionControl &) = delete;
+        AdmissionControl(AdmissionControl &&) = delete;
+        AdmissionControl &operator=(AdmissionControl &&) = delete;
+
+        /**
+         * @brief Replace the limits; existing buckets keep their current level
+         *
+         * @param limits The new limits
+         */
+        void configure(const AdmissionLimits &limits);
+
+        /**
+         * @brief Decide whether a request may run and take its tokens
+         *
+         * When an expensive request is admitted it holds one concurrency slot,
+         * which must be returned with finishExpensive(), best through an
+         * ExpensiveSlot.
+         *
+         * @param client_socket The client socket descriptor
+         * @param user The authenticated user, or empty for an anonymous connection
+         * @param expensive Whether the command is expensive, as declared in the command table
+         * @param retry_after_ms Set to a suggested delay when the request is rejected
+         * @return Admission::ADMITTED, or the limit that rejected the request
+         */
+        Admission admit(int client_socket, const std::string &user, bool expensive, int64_t &retry_after_ms);
+
+        /**
+         * @brief Decide whether a request of a given cost may run and take its tokens
+         *
+         * Like admit() above, for a request whose cost is not that of a single
+         * command, see batchCost(). A cost above a bucket's burst size is
+         * admitted once the bucket is full.
+         *
+         * @param client_socket The client socket descriptor
+         * @param user The authenticated user, or empty for an anonymous connection
+         * @param cost The tokens the request takes
+         * @param expensive Whether the request holds a concurrency slot while it runs
+         * @param retry_after_ms Set to a suggested delay when the request is rejected
+         * @return Admission::ADMITTED, or the limit that rejected the request
+         */
+        Admission admit(int client_socket, const std::string &user, double cost, bool expensive,
+                        int64_t &retry_after_ms);
+
+        /**
+         * @brief Get the cost of a batch, which is admitted as a whole
+         *
+         * The batch's one token plus BATCH_ENTRY_SHARE of each entry's own
+         * cost: the entries share one request's parsing and round trip, and a
+         * full batch must fit the default connection burst, so that it either
+         * runs completely or is refused as a whole.
+         *
+         * @param cheap The number of cheap entries
+         * @param expensive The number of expensive entries
+         * @return The tokens the batch takes
+         */
+        static double batchCost(size_t cheap, size_t expensive)
+        {
+            return 1.0 + BATCH_ENTRY_SHARE * (static_cast<double>(cheap) + static_cast<double>(expensive) * EXPENSIVE_COST);
+        }
+
+        /**
+         * @brief Return the concurrency slot of an admitted expensive request
+         */
+        void finishExpensive();
+
+        /**
+         * @class AdmissionControl::ExpensiveSlot
+         * @brief Returns an admitted expensive request's concurrency slot when it goes out of scope
+         *
+         * Created right after a successful admit(), so the slot comes back
+         * however the request ends, an exception included.
+         */
+        class ExpensiveSlot
+        {
+        public:
+            /**
+             * @param held Whether admit() took a slot, i.e. the request is expensive
+             */
+            explicit ExpensiveSlot(bool held) : held_(held) {}
+            ~ExpensiveSlot()
+            {
+                if (held_)
+                    AdmissionControl::getInstance().finishExpensive();
+            }
+
+            ExpensiveSlot(const ExpensiveSlot &) = delete;
+            ExpensiveSlot &operator=(const ExpensiveSlot &) = delete;
+
+        private:
+            bool held_;
+        };
+
+        /**
+         * @brief Forget a connection's bucket
+         *
+         * @param client_socket The client socket descriptor
+         */
+        void release(int client_socket);
+
+    private:
+        AdmissionControl() = default;
+        ~AdmissionControl() = default;
+
+        using Clock = std::chrono::steady_clock;
+
+        struct TokenBucket
+        {
+            double tokens = -1.0; ///< Tokens available, negative until first use
+            Clock::time_point updated;
+
+            /**
+             * @brief Add the tokens accrued since the last update, up to the burst size
+             */
+            void refill(Clock::time_point now, double rate, double burst);
+        };
+
+        static int64_t retryAfterMs(const TokenBucket &bucket, double cost, double rate);
+
+        AdmissionLimits limits_;
+        std::map<int, TokenBucket> connections_;
+        std::map<std::string, TokenBucket> users_;
+        size_t expensive_running_ = 0;
+        std::mutex mutex_;
+    };
+} // namespace qnx
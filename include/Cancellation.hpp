@@ -0,0 +1,114 @@
+/**
+ * @file Cancellation.hpp
+ * @brief Request deadlines and cooperative cancellation for the QNX Remote Process Monitor
+ *
+ * This file defines the CancellationToken class, which the socket server
+ * hands to the message handler with every request. Long-running handlers
+ * poll it and stop early when the client has disconnected or the request's
+ * deadline has passed, instead of keeping a worker thread busy with a
+ * response nobody will read.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+namespace qnx
+{
+    /**
+     * @class RequestCancelled
+     * @brief Thrown by CancellationToken::throwIfStopped() to abandon a request
+     */
+    class RequestCancelled : public std::runtime_error
+    {
+    public:
+        /**
+         * @param deadline true if the deadline passed, false if the request was cancelled
+         */
+        explicit RequestCancelled(bool deadline)
+            : std::runtime_error(deadline ? "Deadline exceeded" : "Request cancelled"), deadline_(deadline) {}
+
+        /**
+         * @brief Check whether the request ran out of time rather than being cancelled
+         */
+        bool deadlineExceeded() const { return deadline_; }
+
+    private:
+        bool deadline_;
+    };
+
+    /**
+     * @class CancellationToken
+     * @brief Cancellation flag and deadline of a request, polled by the code handling it
+     *
+     * Copies share the cancellation flag, so cancelling the token of a
+     * connection stops every request derived from it. A default-constructed
+     * token is never cancelled and has no deadline. Thread-safe.
+     */
+    class CancellationToken
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Create a token that is never cancelled and has no deadline
+         */
+        CancellationToken() = default;
+
+        /**
+         * @brief Create a token that can be cancelled with cancel()
+         *
+         * @return A new token with its own cancellation flag and no deadline
+         */
+        static CancellationToken create();
+
+        /**
+         * @brief Cancel this token and every copy of it; does nothing for a default token
+         */
+        void cancel();
+
+        /**
+         * @brief Derive the token of a request received now
+         *
+         * @param max_time Upper bound on how long the request may take
+         * @return A token sharing this token's flag, with a deadline of now + max_time
+         */
+        CancellationToken startRequest(std::chrono::milliseconds max_time) const;
+
+        /**
+         * @brief Derive a token with a tighter deadline
+         *
+         * @param timeout Time allowed from when the request was received (or from now for a token not made by startRequest())
+         * @return A token sharing this token's flag, with the earlier of the two deadlines
+         */
+        CancellationToken withTimeout(std::chrono::milliseconds timeout) const;
+
+        /**
+         * @brief Check whether the token was cancelled
+         */
+        bool isCancelled() const { return cancelled_ && cancelled_->load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Check whether the deadline has passed
+         */
+        bool isExpired() const { return deadline_ != Clock::time_point::max() && Clock::now() >= deadline_; }
+
+        /**
+         * @brief Check whether the work should stop, for either reason
+         */
+        bool stopRequested() const { return isCancelled() || isExpired(); }
+
+        /**
+         * @brief Throw RequestCancelled if the work should stop
+         */
+        void throwIfStopped() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool>> cancelled_; ///< Shared flag, or nullptr if the token cannot be cancelled
+        Clock::time_point received_;                   ///< When the request was received, or epoch if unknown
+        Clock::time_point deadline_ = Clock::time_point::max();
+    };
+} // namespace qnx
@@ -0,0 +1,90 @@
+/**
+ * @file Compression.hpp
+ * @brief Response compression for the QNX Remote Process Monitor
+ *
+ * This file declares the codecs a client can negotiate for large responses.
+ * The in-tree codec produces standard LZ4 block data, which any LZ4 library
+ * can decompress given the uncompressed size carried in the frame. When the
+ * server is built with RPM_HAVE_ZLIB, zlib (deflate) is offered as well.
+ *
+ * A compressed response is sent as a binary frame (see WireFormat.hpp) with
+ * the FLAG_COMPRESSED bit set and the codec ID in the last header byte. Its
+ * payload is the u32 little-endian uncompressed size followed by the
+ * compressed bytes, which decompress to the JSON text (encoding 0) or to the
+ * binary payload (encoding 1) of the original response.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace qnx
+{
+    constexpr size_t DEFAULT_COMPRESSION_THRESHOLD = 1024; ///< Default minimum response size to compress
+    constexpr size_t MIN_COMPRESSION_THRESHOLD = 64;       ///< Smaller responses never benefit from compression
+
+    /**
+     * @brief Compression codecs a client can negotiate
+     */
+    enum class CompressionCodec : uint8_t
+    {
+        NONE = 0, ///< Responses are never compressed (default)
+        LZ4 = 1,  ///< In-tree LZ4 block compressor
+        ZLIB = 2, ///< System zlib, only when built with RPM_HAVE_ZLIB
+    };
+
+    /**
+     * @brief Parse a codec name ("none", "lz4" or "zlib")
+     *
+     * @param name The codec name
+     * @param codec Receives the parsed codec on success
+     * @return true if the name is known and the codec is available in this build
+     */
+    bool parseCompressionCodec(std::string_view name, CompressionCodec &codec);
+
+    /**
+     * @brief Get the name of a codec
+     *
+     * @param codec The codec
+     * @return The codec name as accepted by parseCompressionCodec()
+     */
+    const char *compressionCodecName(CompressionCodec codec);
+
+    /**
+     * @brief Compress a block of data
+     *
+     * @param codec The codec to use (must not be NONE)
+     * @param data The data to compress
+     * @param out Receives the compressed bytes
+     * @return true on success, false if the codec is unavailable or failed
+     */
+    bool compressBlock(CompressionCodec codec, std::string_view data, std::string &out);
+
+    /**
+     * @brief Decompress a block of data
+     *
+     * @param codec The codec the data was compressed with (must not be NONE)
+     * @param data The compressed bytes
+     * @param uncompressed_size The exact size of the original data
+     * @param out Receives the decompressed bytes
+     * @return true on success, false if the data is malformed
+     */
+    bool decompressBlock(CompressionCodec codec, std::string_view data, size_t uncompressed_size, std::string &out);
+
+    /**
+     * @brief Compress an encoded response if it is large enough
+     *
+     * Responses smaller than the threshold, and responses that would not get
+     * smaller, are returned unchanged. Every compression attempt is recorded
+     * in ServerStats.
+     *
+     * @param frame The encoded response (JSON text or a binary frame)
+     * @param codec The client's negotiated codec
+     * @param threshold The minimum response size worth compressing
+     * @return The compressed frame, or the original response
+     */
+    std::string compressResponse(const std::string &frame, CompressionCodec codec, size_t threshold);
+} // namespace qnx
@@ -0,0 +1,377 @@
+/**
+ * @file FieldSchema.hpp
+ * @brief Compile-time field tables for the records sent to clients
+ *
+ * Each record type that appears in responses (ProcessInfo, Group and
+ * ProcessHistoryEntry) has a schema: a constexpr table naming its fields,
+ * their types and how to read them. The encoders are generated from the
+ * table, so a field is declared once and every wire format serializes it
+ * the same way:
+ *
+ * - The JSON form of each key ("name":) is built at compile time, and
+ *   writers append it without quoting or escaping it again per record.
+ * - A field mask selects the fields to send (the "fields" request member).
+ *   The encoder walks the set bits of the mask, so unselected fields cost
+ *   nothing and selected ones are not tested one by one.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include "JsonCodec.hpp"
+#include "ProcessCore.hpp"
+#include "ProcessGroup.hpp"
+#include "ProcessHistory.hpp"
+#include "ResponseWriter.hpp"
+
+namespace qnx
+{
+    /// Bit i selects field i of a schema
+    using FieldMask = uint32_t;
+
+    /// Selects every field of any schema
+    constexpr FieldMask ALL_FIELDS = ~FieldMask(0);
+
+    /**
+     * @brief How a field is read and encoded
+     */
+    enum class FieldType : uint8_t
+    {
+        INT,        ///< Read with Field::integer
+        DOUBLE,     ///< Read with Field::real
+        PERCENTAGE, ///< Read with Field::real, rounded like ResponseWriter::addPercentage()
+        STRING      ///< Read with Field::text
+    };
+
+    /**
+     * @struct Field
+     * @brief Descriptor of one field of a record type
+     *
+     * Only the accessor matching the type is set.
+     */
+    template <typename Record>
+    struct Field
+    {
+        const char *name;
+        FieldType type;
+        long long (*integer)(const Record &);
+        double (*real)(const Record &);
+        const char *(*text)(const Record &);
+    };
+
+    template <typename Record>
+    constexpr Field<Record> integerField(const char *name, long long (*get)(const Record &))
+    {
+        return Field<Record>{name, FieldType::INT, get, nullptr, nullptr};
+    }
+
+    template <typename Record>
+    constexpr Field<Record> doubleField(const char *name, double (*get)(const Record &))
+    {
+        return Field<Record>{name, FieldType::DOUBLE, nullptr, get, nullptr};
+    }
+
+    template <typename Record>
+    constexpr Field<Record> percentageField(const char *name, double (*get)(const Record &))
+    {
+        return Field<Record>{name, FieldType::PERCENTAGE, nullptr, get, nullptr};
+    }
+
+    template <typename Record>
+    constexpr Field<Record> stringField(const char *name, const char *(*get)(const Record &))
+    {
+        return Field<Record>{name, FieldType::STRING, nullptr, nullptr, get};
+    }
+
+    /**
+     * @brief Fields of a process in listings and subscription updates
+     */
+    struct ProcessInfoSchema
+    {
+        using Record = ProcessInfo;
+
+        static constexpr Field<Record> FIELDS[] = {
+            integerField<Record>("pid", [](const Record &r) -> long long { return r.getPid(); }),
+            stringField<Record>("name", [](const Record &r) { return r.getName().c_str(); }),
+            percentageField<Record>("cpu_usage", [](const Record &r) { return r.getCpuUsage(); }),
+            integerField<Record>("memory_usage", [](const Record &r) { return static_cast<long long>(r.getMemoryUsage()); }),
+            integerField<Record>("num_threads", [](const Record &r) -> long long { return r.getNumThreads(); }),
+            integerField<Record>("priority", [](const Record &r) -> long long { return r.getPriority(); }),
+            integerField<Record>("policy", [](const Record &r) -> long long { return r.getPolicy(); }),
+            integerField<Record>("state", [](const Record &r) -> long long { return r.getState(); }),
+        };
+    };
+
+    /**
+     * @brief Fields of a process group
+     */
+    struct GroupSchema
+    {
+        using Record = Group;
+
+        static constexpr Field<Record> FIELDS[] = {
+            integerField<Record>("id", [](const Record &r) -> long long { return r.id; }),
+            stringField<Record>("name", [](const Record &r) { return r.name.c_str(); }),
+            integerField<Record>("priority", [](const Record &r) -> long long { return r.priority; }),
+            stringField<Record>("description", [](const Record &r) { return r.description.c_str(); }),
+            integerField<Record>("process_count", [](const Record &r) { return static_cast<long long>(r.processes.size()); }),
+            percentageField<Record>("total_cpu_usage", [](const Record &r) { return r.total_cpu_usage; }),
+            integerField<Record>("total_memory_usage", [](const Record &r) -> long long { return r.total_memory_usage; }),
+        };
+    };
+
+    /**
+     * @brief Fields of a process history entry
+     */
+    struct HistoryEntrySchema
+    {
+        using Record = ProcessHistoryEntry;
+
+        static constexpr Field<Record> FIELDS[] = {
+            integerField<Record>("timestamp", [](const Record &r) { return static_cast<long long>(r.timestamp); }),
+            percentageField<Record>("cpu_usage", [](const Record &r) { return r.cpu_usage; }),
+            integerField<Record>("memory_usage", [](const Record &r) -> long long { return r.memory_usage; }),
+        };
+    };
+
+    namespace schema_detail
+    {
+        template <typename Schema>
+        constexpr size_t fieldCount()
+        {
+            return sizeof(Schema::FIELDS) / sizeof(Schema::FIELDS[0]);
+        }
+
+        // Length of a name that JSON can carry between quotes as it is, or 0 if it needs escaping
+        constexpr size_t plainLength(const char *name)
+        {
+            size_t length = 0;
+            for (; name[length]; ++length)
+            {
+                const unsigned char c = static_cast<unsigned char>(name[length]);
+                if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\')
+                    return 0;
+            }
+            return length;
+        }
+
+        /**
+         * @brief The JSON keys of a schema's fields, back to back
+         */
+        template <typename Schema>
+        struct KeyText
+        {
+            static constexpr size_t COUNT = fieldCount<Schema>();
+
+            static constexpr size_t size()
+            {
+                size_t total = 0;
+                for (const auto &field : Schema::FIELDS)
+                    total += plainLength(field.name) + 3; // Quotes and colon
+                return total;
+            }
+
+            char text[size()];
+            size_t offsets[COUNT + 1];
+
+            constexpr KeyText() : text{}, offsets{}
+            {
+                size_t at = 0;
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    offsets[i] = at;
+                    text[at++] = '"';
+                    for (const char *c = Schema::FIELDS[i].name; *c; ++c)
+                        text[at++] = *c;
+                    text[at++] = '"';
+                    text[at++] = ':';
+                }
+                offsets[COUNT] = at;
+            }
+        };
+
+        template <typename Schema>
+        inline constexpr KeyText<Schema> KEY_TEXT{};
+
+        template <typename Schema>
+        constexpr std::array<FieldKey, fieldCount<Schema>()> makeKeys()
+        {
+            static_assert(fieldCount<Schema>() <= sizeof(FieldMask) * 8, "Too many fields for a FieldMask");
+            std::array<FieldKey, fieldCount<Schema>()> keys{};
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                const size_t start = KEY_TEXT<Schema>.offsets[i];
+                keys[i] = FieldKey{Schema::FIELDS[i].name,
+                                   std::string_view(KEY_TEXT<Schema>.text + start, KEY_TEXT<Schema>.offsets[i + 1] - start)};
+            }
+            return keys;
+        }
+
+        template <typename Schema>
+        constexpr bool plainNames()
+        {
+            for (const auto &field : Schema::FIELDS)
+            {
+                if (plainLength(field.name) == 0)
+                    return false;
+            }
+            return true;
+        }
+    } // namespace schema_detail
+
+    /**
+     * @brief The pre-encoded keys of a schema's fields, in table order
+     *
+     * Writers may identify a key by its address, which is the same in every
+     * translation unit.
+     */
+    template <typename Schema>
+    inline constexpr std::array<FieldKey, schema_detail::fieldCount<Schema>()> FIELD_KEYS = schema_detail::makeKeys<Schema>();
+
+    /**
+     * @brief The mask selecting every field of a schema
+     */
+    template <typename Schema>
+    constexpr FieldMask fullMask()
+    {
+        constexpr size_t count = schema_detail::fieldCount<Schema>();
+        return count == sizeof(FieldMask) * 8 ? ALL_FIELDS : (FieldMask(1) << count) - 1;
+    }
+
+    /**
+     * @brief Add the selected fields of a record to the current object
+     *
+     * @param writer The response writer, inside the record's object
+     * @param record The record
+     * @param mask The fields to add, in table order
+     */
+    template <typename Schema>
+    void encodeFields(ResponseWriter &writer, const typename Schema::Record &record, FieldMask mask)
+    {
+        static_assert(schema_detail::plainNames<Schema>(), "Field names must not need JSON escaping");
+        const auto &keys = FIELD_KEYS<Schema>;
+        for (FieldMask pending = mask & fullMask<Schema>(); pending != 0; pending &= pending - 1)
+        {
+            const unsigned i = static_cast<unsigned>(__builtin_ctz(pending));
+            const Field<typename Schema::Record> &field = Schema::FIELDS[i];
+            switch (field.type)
+            {
+            case FieldType::INT:
+                writer.addField(keys[i], field.integer(record));
+                break;
+            case FieldType::DOUBLE:
+                writer.addField(keys[i], field.real(record));
+                break;
+            case FieldType::PERCENTAGE:
+                writer.addField(keys[i], ResponseWriter::roundPercentage(field.real(record)));
+                break;
+            case FieldType::STRING:
+                writer.addField(keys[i], field.text(record));
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Encode records as a named array of objects
+     *
+     * @param writer The response writer to append to
+     * @param name The name of the array member, or NULL inside an array
+     * @param records The records
+     * @param mask The fields of each record to add
+     */
+    template <typename Schema>
+    void encodeRecords(ResponseWriter &writer, const char *name, const std::vector<typename Schema::Record> &records,
+                       FieldMask mask = ALL_FIELDS)
+    {
+        writer.startArray(name);
+        for (const auto &record : records)
+        {
+            writer.startObject(NULL);
+            encodeFields<Schema>(writer, record, mask);
+            writer.endObject();
+        }
+        writer.endArray();
+    }
+
+    /**
+     * @brief Encode records held elsewhere as a named array of objects
+     *
+     * @param writer The response writer to append to
+     * @param name The name of the array member, or NULL inside an array
+     * @param records Pointers to the records
+     * @param mask The fields of each record to add
+     */
+    template <typename Schema>
+    void encodeRecords(ResponseWriter &writer, const char *name,
+                       const std::vector<const typename Schema::Record *> &records, FieldMask mask = ALL_FIELDS)
+    {
+        writer.startArray(name);
+        for (const auto *record : records)
+        {
+            writer.startObject(NULL);
+            encodeFields<Schema>(writer, *record, mask);
+            writer.endObject();
+        }
+        writer.endArray();
+    }
+
+    /**
+     * @brief Find a field of a schema by name
+     *
+     * @param name The field name
+     * @return The field's index, or -1 if the schema has no such field
+     */
+    template <typename Schema>
+    int findField(std::string_view name)
+    {
+        for (size_t i = 0; i < schema_detail::fieldCount<Schema>(); ++i)
+        {
+            if (name == Schema::FIELDS[i].name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Read the optional "fields" member of a request: the names of the fields to send
+     *
+     * @param decoder The request, with its object entered
+     * @param mask Receives the selected fields; every field if the member is missing
+     * @return nullptr on success, otherwise a static error message
+     */
+    template <typename Schema>
+    const char *decodeFieldMask(JsonDecoder &decoder, FieldMask &mask)
+    {
+        mask = fullMask<Schema>();
+        if (!decoder.pushArray("fields"))
+            return nullptr;
+
+        FieldMask selected = 0;
+        const char *error = nullptr;
+        std::string_view name;
+        while (decoder.getString(NULL, name))
+        {
+            const int index = findField<Schema>(name);
+            if (index < 0)
+            {
+                error = "Unknown field in 'fields'";
+                break;
+            }
+            selected |= FieldMask(1) << index;
+        }
+        decoder.pop();
+
+        if (error)
+            return error;
+        if (selected == 0)
+            return "Invalid 'fields'";
+        mask = selected;
+        return nullptr;
+    }
+} // namespace qnx
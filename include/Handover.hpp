@@ -0,0 +1,73 @@
+/**
+ * @file Handover.hpp
+ * @brief Zero-downtime restart of the QNX Remote Process Monitor
+ *
+ * A running server can hand its listening sockets, optionally its idle
+ * client connections, and its in-memory state to a newly started server
+ * process over a Unix domain socket. Descriptors are passed with
+ * SCM_RIGHTS, so connections waiting to be accepted are never refused;
+ * process history, process groups and the sessions and subscriptions of
+ * the passed connections travel as a compact binary image.
+ *
+ * The old process listens on the handover socket (openHandoverSocket() and
+ * serveHandover()); the new process is started with the same path and
+ * calls takeOverServer() before initializing its socket server. Both sides
+ * must speak the same HANDOVER_VERSION.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SocketServer.hpp"
+
+namespace qnx
+{
+    /// Version of the handover protocol and state image
+    constexpr uint32_t HANDOVER_VERSION = 1;
+
+    /**
+     * @brief Open the socket on which a running server waits for its successor
+     *
+     * A stale socket left at the path is replaced; only the owner may connect.
+     *
+     * @param path Path of the Unix domain socket
+     * @return The non-blocking listening socket, or -1 on error
+     */
+    int openHandoverSocket(const std::string &path);
+
+    /**
+     * @brief Hand the server over to a successor, if one connects
+     *
+     * Waits up to the given time for a successor on the handover socket. If
+     * one connects, the socket server is stopped with SocketServer::handOver()
+     * and its sockets and state are sent; the handover socket file is
+     * removed so the successor can bind its own. The caller should then
+     * exit without touching the sockets.
+     *
+     * @param listen_fd The socket returned by openHandoverSocket()
+     * @param path Path of the handover socket
+     * @param wait How long to wait for a successor
+     * @return true if the server was handed over
+     */
+    bool serveHandover(int listen_fd, const std::string &path, std::chrono::milliseconds wait);
+
+    /**
+     * @brief Take over from a server process waiting on the handover socket
+     *
+     * On success the history, process groups, sessions and subscriptions
+     * are restored, the listening sockets are ready to be passed to
+     * SocketServer::init() and the client sockets to
+     * SocketServer::adoptClient() once the server runs. If no server is
+     * listening on the path, nothing happens.
+     *
+     * @param path Path of the handover socket
+     * @param include_clients Whether to also take over idle client connections
+     * @param listeners Receives the listening sockets (see ServerOptions::inherited)
+     * @param clients Receives the client sockets
+     * @return true if a previous server handed over, false otherwise
+     */
+    bool takeOverServer(const std::string &path, bool include_clients, ListenerSockets &listeners, std::vector<int> &clients);
+} // namespace qnx
@@ -0,0 +1,167 @@
+/**
+ * @file IoUring.hpp
+ * @brief Minimal io_uring wrapper for the QNX Remote Process Monitor socket server
+ *
+ * This file defines the IoUring class, a thin layer over the io_uring system
+ * calls that provides just what the socket server's io_uring backend needs:
+ * a submission/completion ring pair and one ring of provided receive buffers.
+ * It talks to the kernel directly, so no liburing is required.
+ *
+ * io_uring only exists on Linux; RPM_HAVE_IO_URING is defined when the kernel
+ * headers are available. At run time, init() fails on kernels that lack the
+ * required features (5.19 or later is needed for provided buffer rings and
+ * multishot accept), and callers are expected to fall back to another backend.
+ */
+
+#pragma once
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RPM_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef RPM_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace qnx
+{
+    /**
+     * @class IoUring
+     * @brief One io_uring instance with a provided buffer ring
+     *
+     * Not thread-safe: each instance is owned and driven by a single thread.
+     */
+    class IoUring
+    {
+    public:
+        IoUring() = default;
+        ~IoUring();
+
+        // Delete copy/move constructors and assignment operators
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+        IoUring(IoUring &&) = delete;
+        IoUring &operator=(IoUring &&) = delete;
+
+        /**
+         * @brief Create the ring
+         *
+         * @param entries Number of submission queue entries (rounded up to a power of two)
+         * @return true on success, false if io_uring is unavailable or too old
+         */
+        bool init(unsigned entries);
+
+        /**
+         * @brief Register a ring of provided buffers for buffer-select receives
+         *
+         * @param group Buffer group ID used in SQEs with IOSQE_BUFFER_SELECT
+         * @param count Number of buffers (a power of two)
+         * @param size Size of each buffer in bytes
+         * @return true on success, false if the kernel does not support buffer rings
+         */
+        bool setupBufferRing(uint16_t group, unsigned count, unsigned size);
+
+        /**
+         * @brief Get a zeroed submission queue entry
+         *
+         * @return The entry, or nullptr if the submission queue is full
+         */
+        io_uring_sqe *getSqe();
+
+        /**
+         * @brief Submit all queued entries without waiting
+         *
+         * @return Number of entries submitted, or a negative errno value
+         */
+        int submit();
+
+        /**
+         * @brief Submit all queued entries and wait for at least one completion
+         *
+         * @param timeout_ms Maximum time to wait for a completion
+         * @return Number of entries submitted, or a negative errno value
+         */
+        int submitAndWait(int timeout_ms);
+
+        /**
+         * @brief Invoke a callback for every available completion and consume them
+         *
+         * The callback may queue new submissions.
+         *
+         * @param callback Called with each completion queue entry
+         * @return Number of completions processed
+         */
+        template <typename Callback>
+        unsigned forEachCompletion(Callback callback)
+        {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            unsigned count = 0;
+            while (head != tail)
+            {
+                callback(cqes_[head & cq_mask_]);
+                ++head;
+                ++count;
+                // Publish consumed entries as we go, so the CQ cannot overflow
+                // while the callback submits more work
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            }
+            return count;
+        }
+
+        /**
+         * @brief Get the data of a provided buffer
+         *
+         * @param id Buffer ID taken from a completion's flags
+         * @return Pointer to the buffer
+         */
+        const char *buffer(uint16_t id) const { return buffers_.data() + static_cast<size_t>(id) * buffer_size_; }
+
+        /**
+         * @brief Return a provided buffer to the kernel once its data has been consumed
+         *
+         * @param id Buffer ID taken from a completion's flags
+         */
+        void recycleBuffer(uint16_t id);
+
+    private:
+        /**
+         * @brief Make locally queued entries visible to the kernel
+         *
+         * @return Number of entries the kernel has not consumed yet
+         */
+        unsigned publishSubmissions();
+
+        int ring_fd_ = -1;
+        void *ring_ = nullptr;
+        size_t ring_size_ = 0;
+        io_uring_sqe *sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+
+        unsigned *sq_head_ = nullptr;
+        unsigned *sq_tail_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+        unsigned sq_local_tail_ = 0; ///< Tail including entries not yet published to the kernel
+
+        unsigned *cq_head_ = nullptr;
+        unsigned *cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        io_uring_cqe *cqes_ = nullptr;
+
+        io_uring_buf_ring *buf_ring_ = nullptr;
+        size_t buf_ring_size_ = 0;
+        unsigned buf_count_ = 0;
+        unsigned buffer_size_ = 0;
+        uint16_t buf_local_tail_ = 0;
+        std::vector<char> buffers_;
+    };
+} // namespace qnx
+
+#endif // RPM_HAVE_IO_URING
@@ -0,0 +1,325 @@
+/**
+ * @file JsonCodec.hpp
+ * @brief In-tree JSON decoder and encoder for the QNX Remote Process Monitor
+ *
+ * A small, portable replacement for the QNX JSON library (<sys/json.h>),
+ * shaped after its cursor-style API so that command handlers read the same
+ * on every platform:
+ *
+ * - JsonDecoder tokenizes a document in a single pass into a flat token
+ *   array. Strings are unescaped in place in a private copy of the input and
+ *   NUL-terminated there, so string values are returned as pointers without
+ *   allocating. A decoder that is reused keeps its buffers, and parsing then
+ *   does not allocate at all. String scanning uses SSE2 or NEON where the
+ *   target has them.
+ * - JsonEncoder appends to a buffer that is kept across reset() calls. A
+ *   large document can be handed out in chunks while it is being written.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qnx
+{
+    /// Characters formatInteger() and formatDouble() write at most
+    constexpr size_t MAX_NUMBER_LENGTH = 32;
+
+    /**
+     * @brief Write an integer in decimal
+     *
+     * Digits are produced two at a time from a lookup table, into a length
+     * computed up front, so there is no per-digit branch or reversal.
+     *
+     * @param out Buffer of at least MAX_NUMBER_LENGTH characters
+     * @param value The integer
+     * @return Pointer past the last character written
+     */
+    char *formatInteger(char *out, long long value);
+
+    /**
+     * @brief Write a finite double as the shortest text that reads back as the same value
+     *
+     * Uses std::to_chars (a Ryu-style shortest round-trip conversion) where
+     * the standard library provides it for floating point, and otherwise the
+     * shorter of %.15g and %.17g that round-trips.
+     *
+     * @param out Buffer of at least MAX_NUMBER_LENGTH characters
+     * @param value The value; JSON has no form for NaN or infinity
+     * @return Pointer past the last character written
+     */
+    char *formatDouble(char *out, double value);
+
+    /**
+     * @struct FieldKey
+     * @brief A member name together with its JSON form, encoded ahead of time
+     *
+     * Lets encoders write a key that is used for every record of a listing
+     * without quoting and escaping it each time (see FieldSchema.hpp).
+     */
+    struct FieldKey
+    {
+        const char *name;      ///< The member name
+        std::string_view json; ///< The name quoted, escaped and followed by a colon
+    };
+
+    /**
+     * @brief Append a value as a quoted, escaped JSON string
+     *
+     * @param out The buffer to append to
+     * @param value The string to append
+     */
+    void appendJsonString(std::string &out, std::string_view value);
+
+    /**
+     * @class JsonDecoder
+     * @brief Single-pass JSON tokenizer with a cursor for reading members
+     *
+     * After parse(), pushObject(NULL) enters the root object. Inside an
+     * object values are looked up by member name; inside an array a NULL
+     * name reads the next element. pushObject()/pushArray() enter a nested
+     * value and pop() returns to the enclosing one.
+     *
+     * Every getter returns false, leaving the value untouched, if the member
+     * is missing or has a different type; integers must be integral and in
+     * range. Strings returned by getString() stay valid until the next
+     * parse().
+     */
+    class JsonDecoder
+    {
+    public:
+        /// Deepest nesting accepted by parse()
+        static constexpr size_t MAX_DEPTH = 64;
+
+        JsonDecoder() = default;
+
+        JsonDecoder(const JsonDecoder &) = delete;
+        JsonDecoder &operator=(const JsonDecoder &) = delete;
+
+        /**
+         * @brief Tokenize a document, replacing any previous one
+         *
+         * @param text The JSON text
+         * @return true if the text is a single valid JSON value
+         */
+        bool parse(std::string_view text);
+
+        /**
+         * @brief Describe why the last parse() failed
+         *
+         * @param offset Receives the byte offset of the error in the input
+         * @return A static error message, or NULL if the last parse succeeded
+         */
+        const char *parseError(size_t *offset = nullptr) const;
+
+        /**
+         * @brief Enter an object
+         *
+         * @param name Member name, or NULL for the root or the next array element
+         * @return true if the value exists and is an object
+         */
+        bool pushObject(const char *name);
+
+        /**
+         * @brief Enter an array
+         *
+         * @param name Member name, or NULL for the root or the next array element
+         * @return true if the value exists and is an array
+         */
+        bool pushArray(const char *name);
+
+        /**
+         * @brief Leave the object or array entered last
+         */
+        void pop();
+
+        /**
+         * @brief Number of objects and arrays entered
+         */
+        size_t depth() const { return depth_; }
+
+        /**
+         * @brief Leave entered objects and arrays until depth() is at most the given depth
+         *
+         * Restores the cursor after a reader stopped half-way, e.g. because it threw.
+         */
+        void popTo(size_t depth);
+
+        /**
+         * @brief Move past the next element of the current array without reading it
+         *
+         * @return false at the end of the array, or if the current value is not an array
+         */
+        bool skip();
+
+        /**
+         * @brief Replace the document and cursor with those of another decoder
+         *
+         * Lets another thread read the same request, each with its own
+         * cursor. Buffers keep their capacity, as with parse().
+         *
+         * @param other The decoder to copy
+         */
+        void copyFrom(const JsonDecoder &other);
+
+        bool getString(const char *name, const char *&value);
+        bool getString(const char *name, std::string_view &value);
+        bool getInt(const char *name, int &value);
+        bool getInt64(const char *name, long long &value);
+        bool getDouble(const char *name, double &value);
+        bool getBool(const char *name, bool &value);
+
+    private:
+        enum class TokenType : uint8_t
+        {
+            OBJECT,
+            ARRAY,
+            STRING,
+            NUMBER,
+            TRUE_VALUE,
+            FALSE_VALUE,
+            NULL_VALUE
+        };
+
+        struct Token
+        {
+            TokenType type;
+            bool integral;  ///< NUMBER without fraction or exponent
+            uint32_t start; ///< Offset in buffer_ of the value (strings: first character)
+            uint32_t size;  ///< Strings and numbers: length; containers: number of members or elements
+            uint32_t next;  ///< Index of the token following this value and its children
+        };
+
+        struct Frame
+        {
+            uint32_t token;  ///< The container token
+            uint32_t cursor; ///< Arrays: token index of the next element to read
+            uint32_t read;   ///< Arrays: number of elements read
+        };
+
+        bool fail(const char *message, const char *at);
+        bool parseValue(char *&p, size_t depth);
+        bool parseString(char *&p, uint32_t &start, uint32_t &length);
+        bool parseNumber(char *&p);
+        bool parseLiteral(char *&p, const char *literal, size_t length, TokenType type);
+
+        /**
+         * @brief Find the value named in the current frame
+         *
+         * @return Index of the value token, or -1 if there is none
+         */
+        long find(const char *name);
+
+        /**
+         * @brief Move past a value that was read from the current array
+         */
+        void consume(long index);
+
+        bool push(const char *name, TokenType type);
+
+        std::string buffer_;              ///< Copy of the input, strings unescaped in place, plus padding
+        std::vector<Token> tokens_;       ///< Values in document order
+        size_t length_ = 0;               ///< Length of the input
+        Frame frames_[MAX_DEPTH];         ///< Entered containers
+        size_t depth_ = 0;                ///< Number of entered containers
+        const char *error_ = nullptr;     ///< Error of the last parse()
+        size_t error_offset_ = 0;         ///< Offset of that error
+    };
+
+    /**
+     * @class JsonEncoder
+     * @brief Append-only JSON writer
+     *
+     * Member names are required inside objects and must be NULL for array
+     * elements and the root value. Misuse, such as unbalanced containers,
+     * makes the document invalid instead of producing malformed JSON.
+     */
+    class JsonEncoder
+    {
+    public:
+        JsonEncoder() = default;
+
+        /**
+         * @brief Start a new document, keeping the buffer's capacity
+         */
+        void reset();
+
+        void startObject(const char *name);
+        void endObject();
+        void startArray(const char *name);
+        void endArray();
+        void addString(const char *name, std::string_view value);
+        void addInt(const char *name, long long value);
+        void addDouble(const char *name, double value);
+        void addBool(const char *name, bool value);
+        void addNull(const char *name);
+
+        /**
+         * @brief Add a value that is already JSON text, such as another encoder's document
+         *
+         * The text is not checked; it must be a single valid value.
+         */
+        void addRaw(const char *name, std::string_view json);
+
+        // Object members whose key was encoded ahead of time
+        void addInt(const FieldKey &key, long long value);
+        void addDouble(const FieldKey &key, double value);
+        void addString(const FieldKey &key, std::string_view value);
+
+        /**
+         * @brief Whether the document is complete and well-formed
+         */
+        bool valid() const { return !error_ && depth_ == 0 && size() != 0; }
+
+        /**
+         * @brief Bytes written to the document, including chunks already taken
+         */
+        size_t size() const { return taken_ + buffer_.size(); }
+
+        /**
+         * @brief The text written so far
+         */
+        const std::string &buffer() const { return buffer_; }
+
+        /**
+         * @brief Move the finished text out of the encoder
+         *
+         * @return The document (after takeChunk(), the rest of it), or an empty string if it is not valid()
+         */
+        std::string take();
+
+        /**
+         * @brief Move the text written so far out of the encoder, mid-document
+         *
+         * Writing continues where it left off, so the chunks taken followed
+         * by the rest of the document form the complete text. The encoder
+         * starts the next chunk with the same capacity.
+         *
+         * @return The text written since the last chunk was taken
+         */
+        std::string takeChunk();
+
+        /**
+         * @brief Put back the chunk last taken, ahead of what was written since
+         *
+         * @param chunk The text returned by the last takeChunk()
+         */
+        void returnChunk(std::string &&chunk);
+
+    private:
+        void beginValue(const char *name);
+        void beginMember(const FieldKey &key);
+        void appendDouble(double value);
+
+        std::string buffer_;
+        size_t taken_ = 0;        ///< Bytes handed out by takeChunk()
+        size_t depth_ = 0;
+        uint64_t arrays_ = 0;     ///< Bit per nesting level: set for arrays
+        bool need_comma_ = false; ///< A value was written at the current level
+        bool error_ = false;
+    };
+} // namespace qnx
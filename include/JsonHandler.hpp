@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
-#include <sys/json.h> // Include QNX JSON header
+#include <string_view>
+#include <vector>
+#include "JsonCodec.hpp"
+#include "ProcessCore.hpp" // For ProcessInfo
+#include "ResponseWriter.hpp"
+#include "FieldSchema.hpp"
 #include "SocketServer.hpp" // Included for client_socket type
 
 namespace qnx
@@ -11,16 +16,38 @@ namespace qnx
      * @brief Handles JSON messages received from clients
      * 
      * Processes incoming JSON messages, performs the requested operations,
-     * and generates appropriate JSON responses using QNX JSON library.
+     * and generates appropriate responses in the wire format the client
+     * negotiated (JSON by default).
      * 
+     * A request may carry "deadline_ms" to finish sooner than the server's
+     * maximum; a request that runs out of time, or whose connection closes,
+     * is answered with an error instead of its result.
+     *
      * @param client_socket The socket descriptor for the client connection
      * @param message The JSON message received from the client
-     * @return std::string JSON response to be sent back to the client
+     * @param cancel Cancellation token of the request, from the socket server
+     * @return std::string Encoded response to be sent back to the client
      */
-    std::string handleMessage(int client_socket, const std::string &message);
+    std::string handleMessage(int client_socket, const std::string &message,
+                              const CancellationToken &cancel = CancellationToken());
     
     /**
-     * @brief Validates that the input is properly formatted JSON using QNX JSON library
+     * @brief Assigns a request to a worker queue without decoding it
+     *
+     * Scans the top-level object of the request for its "command" member:
+     * process control commands are RequestClass::CONTROL, full process
+     * listings RequestClass::BULK and everything else, including requests
+     * that cannot be classified, RequestClass::POINT. Runs on the reactor
+     * thread, so it only looks at the raw text; a request that lands in
+     * the wrong queue is still handled normally.
+     *
+     * @param message The raw request
+     * @return The request's class
+     */
+    RequestClass classifyRequest(const std::string &message);
+
+    /**
+     * @brief Validates that the input is properly formatted JSON
      * 
      * @param json_str The JSON string to validate
      * @return bool True if valid JSON, false otherwise
@@ -28,7 +55,7 @@ namespace qnx
     bool validateJson(const std::string &json_str);
     
     /**
-     * @brief Converts internal data structures to JSON format using QNX JSON library
+     * @brief Converts internal data structures to JSON format
      * 
      * @param data The data to convert to JSON
      * @return std::string The JSON representation of the data
@@ -36,12 +63,46 @@ namespace qnx
     std::string toJson(const std::string &data);
     
     /**
-     * @brief Handles specific JSON command types using QNX JSON library
+     * @brief Encodes a list of processes as a named array of objects
+     *
+     * Shared by the listing command and by subscription updates so that both
+     * produce the same representation of a process in every wire format.
+     *
+     * @param writer The response writer to append to
+     * @param name The name of the array member, or NULL inside an array
+     * @param processes The processes to encode
+     * @param fields The fields of each process to encode (see ProcessInfoSchema)
+     */
+    void encodeProcessList(ResponseWriter &writer, const char *name, const std::vector<ProcessInfo> &processes,
+                           FieldMask fields = ALL_FIELDS);
+
+    /**
+     * @brief Encodes processes picked from a list, see ProcessQuery::select()
+     *
+     * @param writer The response writer to append to
+     * @param name The name of the array member, or NULL inside an array
+     * @param processes The processes to encode, pointing into the list they were picked from
+     * @param fields The fields of each process to encode (see ProcessInfoSchema)
+     */
+    void encodeProcessList(ResponseWriter &writer, const char *name, const std::vector<const ProcessInfo *> &processes,
+                           FieldMask fields = ALL_FIELDS);
+
+    /**
+     * @brief Handles specific JSON command types
+     *
+     * The handler reads its parameters from the request decoded by the
+     * caller, so a request is parsed only once; the response is built with
+     * the given writer, so it is produced in the client's wire format.
      * 
+     * @param client_socket The socket descriptor of the requesting client
      * @param command The command to process
-     * @param raw_params_json The raw JSON string containing the parameters
-     * @param encoder Pointer to the QNX JSON encoder for building the response
-     * @return std::string JSON response
+     * @param request The decoded request, with its object entered
+     * @param writer The response writer for building the response
+     * @param cancel Cancellation token checked by long-running handlers
+     * @param echo_id Whether to copy the request's "id" into the response
+     * @return std::string Encoded response
+     * @throws RequestCancelled if the token stopped the handler
      */
-    std::string processCommand(const std::string &command, const std::string &raw_params_json, json_encoder_t *encoder);
+    std::string processCommand(int client_socket, std::string_view command, JsonDecoder &request, ResponseWriter &writer,
+                               const CancellationToken &cancel = CancellationToken(), bool echo_id = true);
 } // namespace qnx 
\ No newline at end of file
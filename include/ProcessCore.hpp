@@ -15,6 +15,8 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 #include <chrono>
 #include <system_error>
 #include <unordered_set>
@@ -106,11 +108,14 @@ namespace qnx
 
         // Process information collection
         std::optional<int> collectInfo();
+        void loadSnapshot(std::vector<ProcessInfo> processes);
 
         // Process information retrieval
         size_t getCount() const noexcept;
         const std::vector<ProcessInfo> &getProcessList() const noexcept;
+        std::vector<ProcessInfo> getProcessListSnapshot() const;
         std::optional<ProcessInfo> getProcessById(pid_t pid) const noexcept;
+        uint64_t getGeneration() const noexcept;
 
         // Process control
         bool adjustPriority(pid_t pid, int priority, int policy);
@@ -129,6 +134,7 @@ namespace qnx
         bool readProcessStatus(pid_t pid, ProcessInfo &info);
 
         std::vector<ProcessInfo> process_list_;
+        std::atomic<uint64_t> generation_{0}; // Bumped whenever process_list_ is rebuilt
         mutable std::mutex mutex_;
         std::chrono::system_clock::time_point last_update_time_;
     };
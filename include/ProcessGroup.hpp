@@ -15,7 +15,10 @@
 #include <map>
 #include <set>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 #include <sys/types.h>
+#include "Cancellation.hpp"
 
 namespace qnx
 {
@@ -140,19 +143,58 @@ namespace qnx
          */
         std::set<pid_t> getProcessesInGroup(int group_id) const;
 
+        /**
+         * @brief Count the changes made to the groups so far
+         *
+         * Bumped whenever a group is created, deleted or renamed, or its
+         * members change, so a result derived from the groups can be
+         * reused for as long as the count stays the same.
+         *
+         * @return The number of changes, which only ever grows
+         */
+        uint64_t getModificationCount() const noexcept;
+
         /**
          * @brief Get all defined group IDs
          * @return A vector of group IDs
          */
         std::vector<int> getGroupIds() const; // snapshot of current group IDs
 
+        /**
+         * @brief Get a copy of every group with its latest statistics
+         * @return A vector of groups ordered by ID
+         */
+        std::vector<Group> getGroups() const;
+
+        /**
+         * @brief Copy every group with its latest statistics into a vector
+         *
+         * Assigns over the groups already in the vector, so a vector that is
+         * reused keeps the storage of their names and process sets.
+         *
+         * @param groups Receives the groups ordered by ID
+         */
+        void getGroups(std::vector<Group> &groups) const;
+
+        /**
+         * @brief Replace all groups, e.g. with the groups of a previous server process
+         *
+         * @param groups The groups with their member processes; new groups get IDs above theirs
+         */
+        void restoreGroups(const std::vector<Group> &groups);
+
         /**
          * @brief Update group statistics
          *
          * Recalculates CPU and memory usage totals for all groups
-         * based on current process information.
+         * based on current process information. The token is checked
+         * between processes; groups already recalculated keep their new
+         * totals and the rest keep their previous ones.
+         *
+         * @param cancel Cancellation token of the request asking for the update
+         * @return true if every group was updated, false if the token stopped it
          */
-        void updateGroupStats();
+        bool updateGroupStats(const CancellationToken &cancel = CancellationToken());
 
         /**
          * @brief Display group information to console
@@ -195,6 +237,11 @@ namespace qnx
          */
         std::map<pid_t, int> process_group_map_;
 
+        /**
+         * @brief Number of changes to the groups, see getModificationCount()
+         */
+        std::atomic<uint64_t> modification_count_{0};
+
         /**
          * @brief Mutex for thread-safe access to group data
          */
@@ -17,6 +17,7 @@
 #include <deque>
 #include <sys/types.h>
 #include "ProcessControl.hpp"
+#include "Cancellation.hpp"
 
 namespace qnx
 {
@@ -59,9 +60,16 @@ namespace qnx
 
         /**
          * @brief Retrieve historical entries for all processes.
+         * @param cancel Polled while copying; throws RequestCancelled once it stops the request.
          * @return A map containing historical entries for all processes.
          */
-        std::map<pid_t, std::vector<ProcessHistoryEntry>> getAllHistory() const;
+        std::map<pid_t, std::vector<ProcessHistoryEntry>> getAllHistory(const CancellationToken &cancel = CancellationToken()) const;
+
+        /**
+         * @brief Replace all historical data, e.g. with the history of a previous server process.
+         * @param history Entries per process, oldest first; trimmed to the usual limits.
+         */
+        void restoreHistory(const std::map<pid_t, std::vector<ProcessHistoryEntry>> &history);
 
         /**
          * @brief Clear all historical data for a specific process
@@ -0,0 +1,88 @@
+/**
+ * @file ProcessQuery.hpp
+ * @brief Process list selection for the QNX Remote Process Monitor
+ *
+ * This file defines the ProcessQuery structure, which describes a view over
+ * the collected process list (the full list, the top-K consumers, a fixed set
+ * of PIDs, or the members of a process group). The same query type backs
+ * both polled listing requests and push subscriptions, so both produce
+ * identical results for identical parameters.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+#include "ProcessCore.hpp"
+
+namespace qnx
+{
+    /**
+     * @struct ProcessQuery
+     * @brief Describes which processes a listing or subscription covers
+     */
+    struct ProcessQuery
+    {
+        /**
+         * @brief The kind of view selected by the query
+         */
+        enum class Kind
+        {
+            ALL,   ///< Every collected process
+            TOP,   ///< The top_k processes ordered by CPU usage
+            PIDS,  ///< An explicit set of process IDs
+            GROUP, ///< The members of a process group
+        };
+
+        static constexpr size_t MAX_TOP_K = 1000; ///< Upper bound accepted for top_k
+        static constexpr size_t MAX_PIDS = 256;   ///< Upper bound on the size of a PID set
+
+        Kind kind = Kind::ALL;   ///< Selected view
+        size_t top_k = 0;        ///< Number of processes for Kind::TOP
+        std::vector<pid_t> pids; ///< Sorted, de-duplicated PIDs for Kind::PIDS
+        int group_id = -1;       ///< Group ID for Kind::GROUP
+
+        /**
+         * @brief Parse a topic name ("all", "top", "pids" or "group")
+         *
+         * @param name The topic name to parse
+         * @param kind Receives the parsed kind on success
+         * @return true if the name is a known topic, false otherwise
+         */
+        static bool parseKind(const std::string &name, Kind &kind);
+
+        /**
+         * @brief Normalize the query and check its parameters
+         *
+         * Sorts and de-duplicates the PID set and verifies that every
+         * parameter required by the selected kind is present and in range.
+         *
+         * @return nullptr if the query is valid, otherwise a static error message
+         */
+        const char *normalize();
+
+        /**
+         * @brief Get a canonical key for the query
+         *
+         * Two queries that select the same processes produce the same key
+         * (e.g. "all", "top:10", "pids:1,7,42", "group:3"), which allows
+         * their encoded results to be shared.
+         *
+         * @return The canonical key string
+         */
+        std::string key() const;
+
+        /**
+         * @brief Apply the query to a process list
+         *
+         * The records are not copied: the result points into the list, which
+         * must outlive it.
+         *
+         * @param processes The collected process list to select from
+         * @return The selected processes, in collection order (or CPU order for Kind::TOP)
+         */
+        std::vector<const ProcessInfo *> select(const std::vector<ProcessInfo> &processes) const;
+    };
+} // namespace qnx
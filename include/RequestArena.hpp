@@ -0,0 +1,172 @@
+/**
+ * @file RequestArena.hpp
+ * @brief Per-thread arena for request-scoped memory in the QNX Remote Process Monitor
+ *
+ * This file defines the RequestArena class, a monotonic allocator that each
+ * worker thread owns. Memory that only lives while a request is handled
+ * (cache and coalescing keys, error messages and other temporary strings)
+ * is bumped out of the arena instead of coming from the global allocator,
+ * and is released all at once when the request ends. The arena keeps its
+ * blocks from one request to the next, so once it has grown to what the
+ * thread's requests need, handling them does not allocate at all.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+namespace qnx
+{
+    /**
+     * @class RequestArena
+     * @brief Monotonic bump allocator over blocks kept across requests
+     *
+     * Memory is taken from the arena inside a Scope and given back, all of
+     * it, when the scope ends; deallocating single allocations is a no-op,
+     * except that the most recent one can be taken back (which lets a string
+     * grow in place). Scopes nest, so a request run inside another one, like
+     * a batch entry, releases only its own memory; a string from an outer
+     * scope must therefore not grow inside an inner one. Memory must not
+     * outlive the outermost scope, which releases everything the thread
+     * allocated.
+     *
+     * Not thread-safe: each thread uses its own arena, see forThread().
+     */
+    class RequestArena
+    {
+        struct Block;
+
+    public:
+        /// Size of a block; larger allocations get a block of their own
+        static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+        /// Block memory kept when the outermost scope ends, beyond which blocks are freed
+        static constexpr size_t MAX_RETAINED = 256 * 1024;
+
+        /**
+         * @brief Get the calling thread's arena
+         *
+         * @return Reference to the arena of the calling thread
+         */
+        static RequestArena &forThread();
+
+        RequestArena() = default;
+        ~RequestArena();
+
+        // Allocations point into the arena's blocks, so it cannot be copied or moved
+        RequestArena(const RequestArena &) = delete;
+        RequestArena &operator=(const RequestArena &) = delete;
+
+        /**
+         * @brief Allocate memory that stays valid until the current scope ends
+         *
+         * @param size Number of bytes
+         * @param alignment Alignment, a power of two no greater than alignof(std::max_align_t)
+         * @return The memory
+         * @throws std::bad_alloc if a new block cannot be allocated
+         */
+        void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        /**
+         * @brief Give back an allocation if it is the most recent one
+         *
+         * @param pointer The allocation
+         * @param size Its size in bytes
+         */
+        void release(void *pointer, size_t size) noexcept;
+
+        /**
+         * @brief Bytes of block memory taken by the current scopes
+         */
+        size_t used() const noexcept;
+
+        /**
+         * @brief Bytes of block memory the arena holds
+         */
+        size_t capacity() const noexcept { return capacity_; }
+
+        /**
+         * @class RequestArena::Scope
+         * @brief Releases what the calling thread allocated from its arena while it exists
+         */
+        class Scope
+        {
+        public:
+            Scope();
+            ~Scope();
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            RequestArena &arena_;
+            Block *block_;  ///< Current block when the scope started
+            size_t offset_; ///< Offset in that block
+        };
+
+    private:
+        /**
+         * @brief Move on to a block with room for an allocation, adding one if needed
+         */
+        void grow(size_t size);
+
+        /**
+         * @brief Free the blocks beyond MAX_RETAINED (outermost scope ended)
+         */
+        void trim() noexcept;
+
+        Block *head_ = nullptr;    ///< First block; blocks after current_ are free
+        Block *current_ = nullptr; ///< Block allocations are bumped from
+        size_t offset_ = 0;        ///< Bytes of current_ in use
+        size_t capacity_ = 0;      ///< Size of all blocks
+        size_t depth_ = 0;         ///< Number of open scopes
+    };
+
+    /**
+     * @class ArenaAllocator
+     * @brief Standard allocator drawing from a RequestArena
+     *
+     * Lets standard containers keep request-scoped data in the arena. A
+     * default-constructed allocator uses the calling thread's arena.
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator() : arena_(&RequestArena::forThread()) {}
+        explicit ArenaAllocator(RequestArena &arena) noexcept : arena_(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena_(other.arena_) {}
+
+        T *allocate(size_t count)
+        {
+            if (count > static_cast<size_t>(-1) / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T *>(arena_->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *pointer, size_t count) noexcept
+        {
+            arena_->release(pointer, count * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &other) const noexcept { return arena_ == other.arena_; }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const noexcept { return arena_ != other.arena_; }
+
+    private:
+        template <typename U>
+        friend class ArenaAllocator;
+
+        RequestArena *arena_;
+    };
+
+    /// String kept in the calling thread's RequestArena
+    using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+} // namespace qnx
@@ -0,0 +1,106 @@
+/**
+ * @file RequestCoalescer.hpp
+ * @brief Single-flight execution of identical read requests for the QNX Remote Process Monitor
+ *
+ * This file defines the RequestCoalescer class. When several clients send
+ * the same read request at the same time (typically dashboards refreshing
+ * the same view), the first one computes and encodes the response and the
+ * others wait for it and share the encoded buffer instead of repeating the
+ * work.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace qnx
+{
+    /**
+     * @class RequestCoalescer
+     * @brief Runs at most one computation per key at a time and shares its result
+     *
+     * Keys must identify the result completely: the command, its normalized
+     * parameters, the response encoding and, for results derived from the
+     * process list, the snapshot generation. A key is only shared while its
+     * computation is running; nothing is kept once it completes.
+     *
+     * Completed computations and their table entries are recycled once no
+     * caller holds their result any more, so in the steady state starting
+     * a computation does not allocate.
+     */
+    class RequestCoalescer
+    {
+    public:
+        using Producer = std::function<std::string()>;
+
+        /**
+         * @brief Get the singleton instance of RequestCoalescer
+         *
+         * @return Reference to the singleton instance
+         */
+        static RequestCoalescer &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        RequestCoalescer(const RequestCoalescer &) = delete;
+        RequestCoalescer &operator=(const RequestCoalescer &) = delete;
+        RequestCoalescer(RequestCoalescer &&) = delete;
+        RequestCoalescer &operator=(RequestCoalescer &&) = delete;
+
+        /**
+         * @brief Compute a result, or wait for the identical computation already running
+         *
+         * If the producer throws, the exception is rethrown in every caller
+         * waiting for the same key.
+         *
+         * @param key The key identifying the result
+         * @param produce Computes the result when no computation for the key is running
+         * @param shared Set to true if the result was computed for another caller
+         * @return The result, shared by every caller of the same computation
+         */
+        std::shared_ptr<const std::string> run(std::string_view key, const Producer &produce, bool &shared);
+
+    private:
+        /// Finished flights and table nodes kept for reuse
+        static constexpr size_t MAX_IDLE = 16;
+
+        /// Largest result an idle flight may keep until it is reused
+        static constexpr size_t MAX_IDLE_RESULT = 64 * 1024;
+
+        RequestCoalescer();
+        ~RequestCoalescer() = default;
+
+        struct Flight
+        {
+            std::string key;
+            bool done = false;
+            std::string result;
+            std::exception_ptr error;
+        };
+
+        using FlightTable = std::unordered_map<std::string_view, std::shared_ptr<Flight>>;
+
+        /**
+         * @brief Register a computation for a key, reusing an idle flight (mutex_ held)
+         */
+        std::shared_ptr<Flight> startFlight(std::string_view key);
+
+        /**
+         * @brief Unregister a completed computation and keep it for reuse (mutex_ held)
+         */
+        void finishFlight(const std::shared_ptr<Flight> &flight);
+
+        FlightTable flights_;                       ///< Computations in progress, keyed by their own key
+        std::vector<std::shared_ptr<Flight>> idle_; ///< Completed flights, reused once nothing else holds them
+        std::vector<FlightTable::node_type> spare_; ///< Table nodes of completed flights
+        std::mutex mutex_;                          ///< Protects flights_, idle_, spare_ and every Flight
+        std::condition_variable done_;              ///< Signals completed computations
+    };
+} // namespace qnx
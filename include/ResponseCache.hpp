@@ -0,0 +1,116 @@
+/**
+ * @file ResponseCache.hpp
+ * @brief Cache of encoded read responses for the QNX Remote Process Monitor
+ *
+ * This file defines the ResponseCache class, which keeps encoded responses
+ * to read commands whose result only depends on their parameters and on the
+ * current process list snapshot. Repeated polls of the same view between two
+ * collections are answered from the cache without decoding the snapshot or
+ * encoding the response again.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace qnx
+{
+    /**
+     * @class ResponseCache
+     * @brief Snapshot-generation-scoped LRU cache of encoded responses
+     *
+     * Every entry belongs to the process list generation it was computed
+     * from (see ProcessCore::getGeneration()). The cache only ever holds one
+     * generation: the first lookup or insertion for a newer generation drops
+     * every entry, so a response is never served from an older snapshot once
+     * a newer one has been seen. Within a generation, least recently used
+     * entries are evicted to stay within the memory budget. Thread-safe.
+     */
+    class ResponseCache
+    {
+    public:
+        static constexpr size_t DEFAULT_BUDGET = 8 * 1024 * 1024; ///< Default memory budget in bytes
+
+        /**
+         * @brief Get the singleton instance of ResponseCache
+         *
+         * @return Reference to the singleton instance
+         */
+        static ResponseCache &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        ResponseCache(const ResponseCache &) = delete;
+        ResponseCache &operator=(const ResponseCache &) = delete;
+        ResponseCache(ResponseCache &&) = delete;
+        ResponseCache &operator=(ResponseCache &&) = delete;
+
+        /**
+         * @brief Set the memory budget, evicting entries if it shrinks
+         *
+         * @param bytes Budget for keys and encoded responses, 0 to disable the cache
+         */
+        void setBudget(size_t bytes);
+
+        /**
+         * @brief Look up a response
+         *
+         * @param key The key identifying the response (command, parameters and encoding)
+         * @param generation The current process list generation
+         * @return The encoded response, or nullptr on a miss
+         */
+        std::shared_ptr<const std::string> find(std::string_view key, uint64_t generation);
+
+        /**
+         * @brief Store a response
+         *
+         * Responses from a generation older than the cache's are ignored, as
+         * are responses larger than the whole budget.
+         *
+         * @param key The key identifying the response
+         * @param generation The process list generation the response was computed from
+         * @param response The encoded response
+         */
+        void insert(std::string_view key, uint64_t generation, std::shared_ptr<const std::string> response);
+
+    private:
+        ResponseCache() = default;
+        ~ResponseCache() = default;
+
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<const std::string> response;
+        };
+
+        /**
+         * @brief Drop every entry if the generation is newer than the cache's (mutex_ held)
+         */
+        void advance(uint64_t generation);
+
+        /**
+         * @brief Evict least recently used entries until within the budget (mutex_ held)
+         */
+        void evict();
+
+        /**
+         * @brief Publish the current size to ServerStats (mutex_ held)
+         */
+        void reportUsage() const;
+
+        static size_t entrySize(const Entry &entry) { return entry.key.size() + entry.response->size(); }
+
+        std::list<Entry> lru_;                                                   ///< Entries, most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index_; ///< Entry key to entry in lru_
+        size_t bytes_ = 0;                                                       ///< Size of all entries
+        size_t budget_ = DEFAULT_BUDGET;                                         ///< Upper bound for bytes_
+        uint64_t generation_ = 0;                                                ///< Generation of every entry
+        std::mutex mutex_;
+    };
+} // namespace qnx
@@ -0,0 +1,420 @@
+/**
+ * @file ResponseWriter.hpp
+ * @brief Response encoders for the QNX Remote Process Monitor wire protocol
+ *
+ * This file defines the ResponseWriter interface used by command handlers to
+ * build responses, and its implementations: JSON text (built with the in-tree
+ * JsonEncoder), a compact binary encoding and CBOR. Handlers are written once
+ * against the interface, so every encoding serves the same command set.
+ *
+ * The binary and CBOR formats and their framing are described in WireFormat.hpp.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include "JsonCodec.hpp"
+#include "WireFormat.hpp"
+
+namespace qnx
+{
+    class ResponseWriter;
+
+    /**
+     * @brief Deleter returning a writer to the calling thread's pool
+     */
+    struct ResponseWriterRelease
+    {
+        WireFormat format;
+        void operator()(ResponseWriter *writer) const;
+    };
+
+    /// A writer borrowed from the calling thread's pool, see ResponseWriter::acquire()
+    using PooledResponseWriter = std::unique_ptr<ResponseWriter, ResponseWriterRelease>;
+
+    /**
+     * @class ResponseWriter
+     * @brief Streaming interface for building one response document
+     *
+     * Member names are required inside objects and must be NULL for array
+     * elements and for the root object, mirroring the JSON encoder.
+     */
+    class ResponseWriter
+    {
+    public:
+        virtual ~ResponseWriter() = default;
+
+        virtual void startObject(const char *name) = 0;
+        virtual void endObject() = 0;
+        virtual void startArray(const char *name) = 0;
+        virtual void endArray() = 0;
+        virtual void addString(const char *name, const char *value) = 0;
+        virtual void addInt(const char *name, long long value) = 0;
+        virtual void addDouble(const char *name, double value) = 0;
+        virtual void addBool(const char *name, bool value) = 0;
+
+        /**
+         * @brief Add a value from a response finished by another writer of the same format
+         *
+         * Lets parts of a document be encoded separately, e.g. on other
+         * threads, and then put together.
+         *
+         * @param name Member name, or NULL inside arrays
+         * @param response The uncompressed response, as returned by finish()
+         * @return false if the response cannot be read; nothing is added then
+         */
+        virtual bool addEncoded(const char *name, const std::string &response) = 0;
+
+        /**
+         * @brief The wire format the writer encodes in
+         */
+        virtual WireFormat format() const = 0;
+
+        /**
+         * @brief Add a CPU usage percentage, rounded as set by setPercentageDecimals()
+         *
+         * Rounding happens before encoding, so every wire format carries the
+         * same value and JSON prints at most that many decimals.
+         *
+         * @param name Member name, or NULL inside arrays
+         * @param value The percentage
+         */
+        void addPercentage(const char *name, double value);
+
+        /**
+         * @brief Round a CPU usage percentage as addPercentage() does
+         *
+         * @param value The percentage
+         * @return The rounded value
+         */
+        static double roundPercentage(double value);
+
+        /**
+         * @brief Add an object member whose key was encoded ahead of time
+         *
+         * Used by the schema-driven record encoders (see FieldSchema.hpp).
+         * The defaults add the member by name; writers override them to skip
+         * the per-member key encoding.
+         *
+         * @param key The member key
+         * @param value The member value
+         */
+        virtual void addField(const FieldKey &key, long long value) { addInt(key.name, value); }
+        virtual void addField(const FieldKey &key, double value) { addDouble(key.name, value); }
+        virtual void addField(const FieldKey &key, const char *value) { addString(key.name, value); }
+
+        /**
+         * @brief Set the decimals kept by addPercentage() for all writers
+         *
+         * @param decimals Decimal places (at most 9), or a negative number to keep full precision
+         */
+        static void setPercentageDecimals(int decimals);
+
+        /**
+         * @brief Complete the document and return the encoded, framed response
+         *
+         * @return The encoded response, or an empty string if encoding failed
+         */
+        virtual std::string finish() = 0;
+
+        /**
+         * @brief Discard the document so the writer can start another one
+         *
+         * Buffers keep their capacity for the next document.
+         */
+        virtual void reset() = 0;
+
+        /**
+         * @brief Bytes of buffer capacity held by the writer
+         */
+        virtual size_t capacity() const = 0;
+
+        /// Writers holding more than this are freed rather than pooled
+        static constexpr size_t MAX_POOLED_CAPACITY = 256 * 1024;
+
+        /**
+         * @brief Create a writer for the given wire format
+         *
+         * @param format The wire format to encode in
+         * @return A new writer
+         */
+        static std::unique_ptr<ResponseWriter> create(WireFormat format);
+
+        /**
+         * @brief Take a writer for the given wire format from the calling thread's pool
+         *
+         * The writer is reset and goes back to the pool when the handle is
+         * destroyed, so responses on a worker thread reuse the buffers grown
+         * by earlier ones instead of allocating a writer each time.
+         *
+         * @param format The wire format to encode in
+         * @return A writer with an empty document
+         */
+        static PooledResponseWriter acquire(WireFormat format);
+
+        /**
+         * @brief Add a string member at the start of a finished response's root object
+         *
+         * Lets one encoded response be reused for several requests that only
+         * differ in a member such as the request id, without encoding it again.
+         * Works on uncompressed responses in any wire format, as returned by
+         * finish().
+         *
+         * @param response The encoded response
+         * @param name The member name
+         * @param value The member value
+         * @return The response with the member added, or an empty string if it cannot be added
+         */
+        static std::string prependMember(const std::string &response, const char *name, std::string_view value);
+
+        /**
+         * @brief Add an integer member at the start of a finished response's root object
+         *
+         * @param response The encoded response
+         * @param name The member name
+         * @param value The member value
+         * @return The response with the member added, or an empty string if it cannot be added
+         */
+        static std::string prependMember(const std::string &response, const char *name, long long value);
+    };
+
+    /**
+     * @brief Receives the chunks of a streamed response, see JsonResponseWriter::streamTo()
+     *
+     * Returns false to decline a chunk, which it must then leave untouched.
+     */
+    using ChunkSink = std::function<bool(std::string &&chunk)>;
+
+    /**
+     * @class JsonResponseWriter
+     * @brief ResponseWriter producing JSON text through the JSON encoder
+     *
+     * With a chunk sink set, the text is handed to the sink whenever
+     * STREAM_CHUNK_SIZE bytes have been written, so a large document never
+     * exists in one piece; finish() then returns only the rest of it. Once
+     * the sink declines a chunk, streaming stops and the rest, that chunk
+     * included, stays in the writer until finish().
+     */
+    class JsonResponseWriter : public ResponseWriter
+    {
+    public:
+        /// Bytes of text collected before they are handed to the chunk sink
+        static constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;
+
+        JsonResponseWriter() = default;
+
+        /**
+         * @brief Hand the document to a sink in chunks as it is written
+         *
+         * Applies to the current document; reset() removes the sink. Once the
+         * sink declines a chunk, no more are handed to it.
+         *
+         * @param sink The receiver of the chunks
+         */
+        void streamTo(ChunkSink sink);
+
+        /**
+         * @brief Whether part of the document has been handed to the chunk sink
+         */
+        bool streamed() const { return encoder_.size() != encoder_.buffer().size(); }
+
+        /**
+         * @brief Whether finish() found the streamed document invalid
+         *
+         * The chunks already handed out cannot be taken back, so the
+         * receiver must discard the document as a whole.
+         */
+        bool streamFailed() const { return stream_failed_; }
+
+        void startObject(const char *name) override;
+        void endObject() override;
+        void startArray(const char *name) override;
+        void endArray() override;
+        void addString(const char *name, const char *value) override;
+        void addInt(const char *name, long long value) override;
+        void addDouble(const char *name, double value) override;
+        void addBool(const char *name, bool value) override;
+        bool addEncoded(const char *name, const std::string &response) override;
+        WireFormat format() const override;
+        void addField(const FieldKey &key, long long value) override;
+        void addField(const FieldKey &key, double value) override;
+        void addField(const FieldKey &key, const char *value) override;
+        std::string finish() override;
+        void reset() override;
+        size_t capacity() const override;
+
+    private:
+        /**
+         * @brief Hand the text written so far to the sink once a chunk is full
+         */
+        void flushChunk()
+        {
+            if (sink_ && encoder_.buffer().size() >= STREAM_CHUNK_SIZE)
+                sendChunk();
+        }
+
+        void sendChunk();
+
+        JsonEncoder encoder_;        ///< Underlying JSON encoder
+        ChunkSink sink_;             ///< Receiver of streamed chunks, if any
+        bool stream_failed_ = false; ///< finish() found the streamed document invalid
+    };
+
+    /**
+     * @class BinaryResponseWriter
+     * @brief ResponseWriter producing the compact binary encoding
+     *
+     * Member names and string values are interned in a per-response
+     * dictionary, so repeated keys and process names cost two bytes each.
+     * The dictionary indices of field keys are cached by the key's address,
+     * so a listing looks each one up only once.
+     */
+    class BinaryResponseWriter : public ResponseWriter
+    {
+    public:
+        BinaryResponseWriter() = default;
+
+        void startObject(const char *name) override;
+        void endObject() override;
+        void startArray(const char *name) override;
+        void endArray() override;
+        void addString(const char *name, const char *value) override;
+        void addInt(const char *name, long long value) override;
+        void addDouble(const char *name, double value) override;
+        void addBool(const char *name, bool value) override;
+        bool addEncoded(const char *name, const std::string &response) override;
+        WireFormat format() const override;
+        void addField(const FieldKey &key, long long value) override;
+        void addField(const FieldKey &key, double value) override;
+        void addField(const FieldKey &key, const char *value) override;
+        std::string finish() override;
+        void reset() override;
+        size_t capacity() const override;
+
+    private:
+        static constexpr size_t MAX_DICTIONARY_SIZE = 0xFFFF;       ///< Entries addressable by a u16 index
+        static constexpr size_t MAX_VALUE_DICTIONARY_SIZE = 0xFF00; ///< Entries usable by string values
+        static constexpr size_t KEY_CACHE_SIZE = 64;                ///< Slots of the field key cache (power of two)
+
+        /**
+         * @brief A field key and its index in the current response's dictionary
+         */
+        struct KeySlot
+        {
+            const FieldKey *key;
+            uint16_t index;
+        };
+
+        /**
+         * @brief Slot of the hash table over the dictionary entries
+         */
+        struct IndexSlot
+        {
+            uint32_t stamp; ///< Response the slot was filled for; any other value means empty
+            uint16_t index; ///< Dictionary index
+        };
+
+        /**
+         * @brief Look up or add a dictionary entry
+         *
+         * @param value The string to intern
+         * @param limit Dictionary size at which no new entries are added
+         * @return The dictionary index, or -1 if the string is not interned and the dictionary is full
+         */
+        int intern(std::string_view value, size_t limit);
+
+        /**
+         * @brief The dictionary entry with the given index
+         */
+        std::string_view entry(size_t index) const;
+
+        /**
+         * @brief Double the hash table and re-insert the current entries
+         */
+        void growTable();
+
+        /**
+         * @brief Write the value tag and, inside objects, the member key
+         */
+        void writeKeyAndTag(const char *name, uint8_t tag);
+        void writeKeyAndTag(const FieldKey &key, uint8_t tag);
+
+        /**
+         * @brief Re-encode one value of another binary response, see addEncoded()
+         *
+         * @param response The other response
+         * @param offset Position after the value's tag (and key); moved past the value
+         * @param end End of the other response's payload
+         * @param dictionary The other response's dictionary
+         * @param tag The value's tag
+         * @param name Member name, or NULL inside arrays
+         * @param depth Nesting depth of the value
+         * @return false if the response is malformed
+         */
+        bool copyValue(const std::string &response, size_t &offset, size_t end, const std::vector<std::string> &dictionary,
+                       uint8_t tag, const char *name, size_t depth);
+
+        // Value encodings shared by named members and field keys
+        template <typename Key>
+        void writeString(const Key &key, const char *value);
+        template <typename Key>
+        void writeInt(const Key &key, long long value);
+        template <typename Key>
+        void writeDouble(const Key &key, double value);
+
+        void writeU16(uint16_t value);
+        void writeU32(uint32_t value);
+        void writeU64(uint64_t value);
+
+        // The dictionary lives in buffers that reset() keeps, so interning does not allocate
+        std::string body_;                       ///< Encoded root value
+        std::string dictionary_;                 ///< Interned strings back to back, in index order
+        std::vector<uint32_t> entry_ends_;       ///< End of each interned string in dictionary_
+        std::vector<IndexSlot> table_;           ///< Open-addressing table of the entries, a power of two in size
+        uint32_t stamp_ = 1;                     ///< Marks the table slots filled for the current response
+        size_t dictionary_bytes_ = 0;            ///< Encoded size of the dictionary
+        KeySlot key_cache_[KEY_CACHE_SIZE] = {}; ///< Field keys interned in this response
+    };
+
+    /**
+     * @class CborResponseWriter
+     * @brief ResponseWriter producing a CBOR data item in a binary frame
+     *
+     * Objects and arrays are written as indefinite-length maps and arrays,
+     * so the document is encoded front to back like the JSON text. The
+     * frame header is reserved at the start of the buffer and filled in by
+     * finish().
+     */
+    class CborResponseWriter : public ResponseWriter
+    {
+    public:
+        CborResponseWriter();
+
+        void startObject(const char *name) override;
+        void endObject() override;
+        void startArray(const char *name) override;
+        void endArray() override;
+        void addString(const char *name, const char *value) override;
+        void addInt(const char *name, long long value) override;
+        void addDouble(const char *name, double value) override;
+        void addBool(const char *name, bool value) override;
+        bool addEncoded(const char *name, const std::string &response) override;
+        WireFormat format() const override;
+        std::string finish() override;
+        void reset() override;
+        size_t capacity() const override;
+
+    private:
+        /**
+         * @brief Write the member key, inside objects
+         */
+        void writeKey(const char *name);
+
+        std::string frame_; ///< Frame header placeholder followed by the encoded root value
+    };
+} // namespace qnx
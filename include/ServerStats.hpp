@@ -0,0 +1,184 @@
+/**
+ * @file ServerStats.hpp
+ * @brief Server-wide counters for the QNX Remote Process Monitor
+ *
+ * This file defines the ServerStats class, which collects counters about the
+ * server itself (as opposed to the monitored processes) and reports them for
+ * the get_server_stats command. Counters are lock-free so that workers can
+ * update them on every request.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ResponseWriter.hpp"
+
+namespace qnx
+{
+    /**
+     * @enum ConnectionTimeout
+     * @brief Reasons for which the socket server closes a connection on a timer
+     */
+    enum class ConnectionTimeout
+    {
+        IDLE,    ///< Nothing sent or received for too long
+        REQUEST, ///< A request was not received completely in time
+        WRITE    ///< Queued responses were not read by the client in time
+    };
+
+    /**
+     * @enum ThrottleReason
+     * @brief Limits for which a request is rejected before it runs
+     */
+    enum class ThrottleReason
+    {
+        CONNECTION, ///< The connection exceeded its request rate
+        USER,       ///< The authenticated user exceeded their request rate
+        BUSY        ///< Too many expensive commands were already running
+    };
+
+    /**
+     * @class ServerStats
+     * @brief Collects and reports server-wide counters
+     */
+    class ServerStats
+    {
+    public:
+        /**
+         * @brief Get the singleton instance of ServerStats
+         *
+         * @return Reference to the singleton instance
+         */
+        static ServerStats &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        ServerStats(const ServerStats &) = delete;
+        ServerStats &operator=(const ServerStats &) = delete;
+        ServerStats(ServerStats &&) = delete;
+        ServerStats &operator=(ServerStats &&) = delete;
+
+        /**
+         * @brief Record one compression attempt
+         *
+         * @param bytes_in Size of the response before compression
+         * @param bytes_out Size of the response as sent
+         * @param cpu_ns Time spent compressing, in nanoseconds
+         * @param compressed false if the response was sent uncompressed because it did not shrink
+         */
+        void recordCompression(size_t bytes_in, size_t bytes_out, uint64_t cpu_ns, bool compressed);
+
+        /**
+         * @brief Record a connection closed by a timeout
+         *
+         * @param reason Which timeout expired
+         */
+        void recordTimeout(ConnectionTimeout reason);
+
+        /**
+         * @brief Record a request rejected by admission control
+         *
+         * @param reason Which limit rejected the request
+         */
+        void recordThrottle(ThrottleReason reason);
+
+        /**
+         * @brief Record a request served through the request coalescer
+         *
+         * @param shared true if the response was computed for another, identical request
+         */
+        void recordCoalescing(bool shared);
+
+        /**
+         * @brief Record a lookup in the response cache
+         *
+         * @param hit true if the response was found
+         */
+        void recordCacheLookup(bool hit);
+
+        /**
+         * @brief Record entries evicted from the response cache to stay within its budget
+         *
+         * @param count Number of entries evicted
+         */
+        void recordCacheEvictions(size_t count);
+
+        /**
+         * @brief Record the current size of the response cache
+         *
+         * @param entries Number of cached responses
+         * @param bytes Memory used by the cached responses
+         */
+        void recordCacheUsage(size_t entries, size_t bytes);
+
+        /**
+         * @brief Record a request abandoned before it completed
+         *
+         * @param deadline true if its deadline passed, false if its client disconnected
+         */
+        void recordCancellation(bool deadline);
+
+        /**
+         * @brief Write all counters as members of the current object
+         *
+         * @param writer The writer, positioned inside an object
+         */
+        void encode(ResponseWriter &writer) const;
+
+    private:
+        ServerStats() = default;
+        ~ServerStats() = default;
+
+        struct CompressionCounters
+        {
+            std::atomic<uint64_t> attempts{0};   ///< Responses that reached the compression threshold
+            std::atomic<uint64_t> compressed{0}; ///< Responses sent compressed
+            std::atomic<uint64_t> bytes_in{0};   ///< Bytes before compression
+            std::atomic<uint64_t> bytes_out{0};  ///< Bytes as sent
+            std::atomic<uint64_t> cpu_ns{0};     ///< Time spent compressing
+        };
+
+        struct TimeoutCounters
+        {
+            std::atomic<uint64_t> idle{0};    ///< Connections closed for inactivity
+            std::atomic<uint64_t> request{0}; ///< Connections closed mid-request
+            std::atomic<uint64_t> write{0};   ///< Connections closed with unread responses
+        };
+
+        struct ThrottleCounters
+        {
+            std::atomic<uint64_t> connection{0}; ///< Requests over a connection's rate limit
+            std::atomic<uint64_t> user{0};       ///< Requests over a user's rate limit
+            std::atomic<uint64_t> busy{0};       ///< Expensive requests over the concurrency limit
+        };
+
+        struct CoalescingCounters
+        {
+            std::atomic<uint64_t> computed{0}; ///< Coalescable requests that computed their response
+            std::atomic<uint64_t> shared{0};   ///< Requests answered with another request's response
+        };
+
+        struct CacheCounters
+        {
+            std::atomic<uint64_t> hits{0};      ///< Lookups answered from the cache
+            std::atomic<uint64_t> misses{0};    ///< Lookups that had to compute the response
+            std::atomic<uint64_t> evictions{0}; ///< Entries dropped for the memory budget
+            std::atomic<uint64_t> entries{0};   ///< Responses currently cached
+            std::atomic<uint64_t> bytes{0};     ///< Memory currently used by the cache
+        };
+
+        struct CancellationCounters
+        {
+            std::atomic<uint64_t> deadline{0};     ///< Requests that ran past their deadline
+            std::atomic<uint64_t> disconnected{0}; ///< Requests whose client went away while they ran
+        };
+
+        CompressionCounters compression_;
+        TimeoutCounters timeouts_;
+        ThrottleCounters throttled_;
+        CoalescingCounters coalescing_;
+        CacheCounters cache_;
+        CancellationCounters cancelled_;
+    };
+} // namespace qnx
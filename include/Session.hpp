@@ -0,0 +1,103 @@
+/**
+ * @file Session.hpp
+ * @brief Per-connection protocol state for the QNX Remote Process Monitor
+ *
+ * This file defines the SessionManager class, which keeps the options a
+ * client has negotiated for its connection (such as the response encoding
+ * and compression) and the user it has logged in as. Sessions are keyed by
+ * client socket and released when the client disconnects.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include "ResponseWriter.hpp"
+#include "Compression.hpp"
+
+namespace qnx
+{
+    /**
+     * @struct ClientSession
+     * @brief Options negotiated by one client connection
+     */
+    struct ClientSession
+    {
+        WireFormat format = WireFormat::JSON;                  ///< Encoding used for responses and pushed updates
+        CompressionCodec compression = CompressionCodec::NONE; ///< Codec for responses above the threshold
+        size_t compression_threshold = 0;                      ///< Minimum response size to compress
+        std::string user;                                      ///< User authenticated with login, or empty
+    };
+
+    /**
+     * @class SessionManager
+     * @brief Stores the negotiated session of each connected client
+     *
+     * Clients that never negotiate anything have no entry and get the
+     * default ClientSession.
+     */
+    class SessionManager
+    {
+    public:
+        /**
+         * @brief Get the singleton instance of SessionManager
+         *
+         * @return Reference to the singleton instance
+         */
+        static SessionManager &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        SessionManager(const SessionManager &) = delete;
+        SessionManager &operator=(const SessionManager &) = delete;
+        SessionManager(SessionManager &&) = delete;
+        SessionManager &operator=(SessionManager &&) = delete;
+
+        /**
+         * @brief Get a copy of a client's session
+         *
+         * @param client_socket The client socket descriptor
+         * @return The client's session, or the default session if none was negotiated
+         */
+        ClientSession get(int client_socket) const;
+
+        /**
+         * @brief Set the response encoding for a client
+         *
+         * @param client_socket The client socket descriptor
+         * @param format The encoding to use for subsequent responses
+         */
+        void setFormat(int client_socket, WireFormat format);
+
+        /**
+         * @brief Set the response compression for a client
+         *
+         * @param client_socket The client socket descriptor
+         * @param codec The codec to use, or CompressionCodec::NONE to disable compression
+         * @param threshold The minimum response size, in bytes, to compress
+         */
+        void setCompression(int client_socket, CompressionCodec codec, size_t threshold);
+
+        /**
+         * @brief Set the user a client has authenticated as
+         *
+         * @param client_socket The client socket descriptor
+         * @param user The user name
+         */
+        void setUser(int client_socket, const std::string &user);
+
+        /**
+         * @brief Forget a client's session
+         *
+         * @param client_socket The client socket descriptor
+         */
+        void release(int client_socket);
+
+    private:
+        SessionManager() = default;
+        ~SessionManager() = default;
+
+        std::map<int, ClientSession> sessions_;
+        mutable std::mutex mutex_;
+    };
+} // namespace qnx
@@ -4,22 +4,116 @@
  *
  * This file defines the SocketServer class that handles network connections and
  * processes client requests. It implements a TCP/IP socket server with support
- * for multiple clients and asynchronous message handling.
+ * for multiple clients and asynchronous message handling. On-box clients can
+ * connect through an optional Unix domain socket instead, which uses the same
+ * handler and framing.
+ *
+ * Requests are newline-delimited. Several requests may be in flight on one
+ * connection at a time; they are handled concurrently on a worker pool and
+ * their responses are written back in completion order.
+ *
+ * Socket readiness is multiplexed with select() by default, which works on
+ * every platform. On Linux, epoll or io_uring can be selected at startup.
  */
 
 #pragma once
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <functional>
+#include <chrono>
 #include <sys/socket.h>
+#include <sys/types.h>
 #include <netinet/in.h>
+#include "WorkerPool.hpp"
+#include "Cancellation.hpp"
 
 namespace qnx
 {
+    /**
+     * @enum IoBackend
+     * @brief How reactor threads wait for and perform socket I/O
+     */
+    enum class IoBackend
+    {
+        SELECT,  ///< select() readiness loop (portable, the default)
+        EPOLL,   ///< Edge-triggered epoll readiness loop (Linux)
+        IO_URING ///< io_uring completion loop with multishot accept and receive (Linux 5.19+)
+    };
+
+    /**
+     * @brief Parse an I/O backend name ("select", "epoll" or "io_uring")
+     *
+     * @param name The backend name
+     * @param backend Receives the backend on success
+     * @return true if the name is known, false otherwise
+     */
+    bool parseIoBackend(const std::string &name, IoBackend &backend);
+
+    /**
+     * @brief Get the name of an I/O backend
+     *
+     * @param backend The backend
+     * @return The backend name as accepted by parseIoBackend()
+     */
+    const char *ioBackendName(IoBackend backend);
+
+    /**
+     * @struct ListenerSockets
+     * @brief Listening sockets passed from a server process to its successor
+     *
+     * See SocketServer::handOver() and ServerOptions::inherited.
+     */
+    struct ListenerSockets
+    {
+        std::vector<int> tcp;  ///< TCP listening sockets, one per SO_REUSEPORT reactor
+        int unix_fd = -1;      ///< Unix domain listening socket, or -1
+        std::string unix_path; ///< Path the Unix domain socket is bound to
+    };
+
+    /**
+     * @struct ClientConnection
+     * @brief Names one client connection from outside the server
+     *
+     * A socket descriptor is reused as soon as its connection closes; the
+     * connection id never is, so the pair still names the same connection
+     * after the descriptor has moved on.
+     */
+    struct ClientConnection
+    {
+        int socket = -1;            ///< Client socket descriptor
+        uint64_t connection_id = 0; ///< See SocketServer::connectionId()
+    };
+
+    /**
+     * @struct ServerOptions
+     * @brief Optional settings for SocketServer::init()
+     */
+    struct ServerOptions
+    {
+        std::string unix_path;   ///< Path of the Unix domain socket, or empty for TCP only
+        mode_t unix_mode = 0660; ///< Permissions applied to the Unix domain socket file
+        size_t reactors = 1;     ///< Number of reactor threads, or 0 for one per CPU
+        IoBackend backend = IoBackend::SELECT; ///< Requested I/O backend, see SocketServer::init()
+
+        // Connection timeouts; zero disables a timeout
+        std::chrono::seconds idle_timeout{300};   ///< Close connections with no traffic for this long
+        std::chrono::seconds request_timeout{10}; ///< Close connections that take longer to send one request
+        std::chrono::seconds write_timeout{30};   ///< Close connections that leave responses unread for this long
+
+        /// Deadline of every request, counted from its arrival; the handler may shorten it
+        std::chrono::milliseconds max_request_time{30000};
+
+        /// Listening sockets taken over from a previous server process; used instead of
+        /// binding the port (and unix_path) when present
+        ListenerSockets inherited;
+    };
+
     /**
      * @class SocketServer
      * @brief Manages network connections and handles client requests.
@@ -30,8 +124,28 @@ namespace qnx
      * - Dispatches requests to appropriate handlers
      * - Sends responses back to clients
      *
-     * The server runs in its own thread and can handle multiple client
-     * connections simultaneously.
+     * Reactor threads own all socket I/O: each one accepts connections, reads
+     * and frames requests, and drains per-connection output queues for its
+     * own set of clients. With several reactors, each reactor has its own
+     * TCP listening socket bound with SO_REUSEPORT where the kernel balances
+     * connections across such sockets (Linux); elsewhere the first reactor
+     * accepts and hands connections to the reactors round-robin. Message
+     * handlers run on a shared worker pool, where process control requests
+     * are queued ahead of other requests and have a reserved worker (see
+     * setRequestClassifier()), so requests on the same connection can
+     * complete out of order; at most MAX_IN_FLIGHT_PER_CLIENT
+     * requests per connection are handled at once, and further requests wait
+     * in the connection's input buffer until a slot frees up.
+     *
+     * Each reactor tracks the deadlines of its connections in a timer wheel
+     * and closes connections that are idle, that trickle a request in more
+     * slowly than the request timeout allows, or that do not read their
+     * responses within the write timeout (see ServerOptions).
+     *
+     * With the io_uring backend, each reactor keeps multishot accept and
+     * receive requests armed (receives land in a ring of provided buffers)
+     * and collects the responses completed by workers so that they are
+     * submitted to the kernel in one batch per loop iteration.
      */
     class SocketServer
     {
@@ -42,8 +156,39 @@ namespace qnx
          * This function type is used to process incoming client messages.
          * It should parse the message, perform the requested operation,
          * and return a response to be sent back to the client.
+         *
+         * The handler is called from worker threads and may be invoked
+         * concurrently, including for the same client socket. The token
+         * carries the request's deadline (ServerOptions::max_request_time)
+         * and is cancelled when the connection closes; long-running
+         * handlers should poll it. Requests whose connection closed while
+         * they were queued are dropped without calling the handler.
+         *
+         * A handler may instead write a large response through a
+         * ResponseStream while producing it, and then returns an empty string.
          */
-        using MessageHandler = std::function<std::string(int /* client_socket */, const std::string & /* message */)>;
+        using MessageHandler = std::function<std::string(int /* client_socket */, const std::string & /* message */,
+                                                         const CancellationToken & /* cancel */)>;
+
+        /**
+         * @brief Callback function type for disconnect notification
+         *
+         * This function type is invoked with the socket descriptor of a client
+         * whose connection has been closed, so that per-client state (such as
+         * subscriptions) can be released. It is called once every request
+         * still in flight on the connection has finished, just before the
+         * socket descriptor is closed and may be reused.
+         */
+        using DisconnectHandler = std::function<void(int /* client_socket */)>;
+
+        /**
+         * @brief Callback function type for request classification
+         *
+         * This function type is invoked on the reactor thread with each
+         * complete request, before it is queued for a worker, to pick the
+         * worker queue it waits in. It must be cheap and must not block.
+         */
+        using RequestClassifier = std::function<RequestClass(const std::string & /* message */)>;
 
         /**
          * @brief Get the singleton instance of SocketServer
@@ -66,14 +211,24 @@ namespace qnx
          *
          * This method:
          * 1. Creates a socket and binds it to the specified port
-         * 2. Starts listening for incoming connections
-         * 3. Launches a server thread to accept and handle connections
+         * 2. Optionally binds a Unix domain stream socket (see ServerOptions)
+         * 3. Starts listening for incoming connections
+         * 4. Launches the reactor threads that accept and handle connections
+         *
+         * Clients on the Unix domain socket are served exactly like TCP
+         * clients. A stale socket file left at the path by a previous run is
+         * replaced; any other kind of file there makes initialization fail.
+         *
+         * If the requested I/O backend is not available on this platform or
+         * kernel, the server falls back from io_uring to epoll and from
+         * epoll to select.
          *
          * @param port The TCP port to listen on
          * @param handler The callback function to process incoming messages
+         * @param options Unix domain socket, reactor and I/O backend settings
          * @return true on successful initialization, false on error
          */
-        bool init(int port, MessageHandler handler);
+        bool init(int port, MessageHandler handler, const ServerOptions &options = ServerOptions());
 
         /**
          * @brief Shut down the socket server.
@@ -81,23 +236,62 @@ namespace qnx
          * This method:
          * 1. Sets the running state to false
          * 2. Closes all client connections
-         * 3. Closes the server socket
-         * 4. Joins the server thread to ensure clean shutdown
+         * 3. Closes the listening sockets
+         * 4. Joins the reactor threads to ensure clean shutdown
          */
         void shutdown();
 
+        /**
+         * @brief Stop serving and pass the sockets on to a successor process.
+         *
+         * Like shutdown(), but the listening sockets are not closed: they are
+         * returned to the caller, who passes them on, and the Unix domain
+         * socket file is left in place. Connections that are waiting in the
+         * kernel's accept queue are therefore served by the successor.
+         *
+         * With include_clients, connections that are idle once the requests
+         * in flight have finished (nothing buffered in either direction) are
+         * returned as well; the disconnect handler is not called for them, so
+         * their per-client state can still be looked up by descriptor. Busy
+         * connections are closed. The io_uring backend may hold received data
+         * in completions that are never reaped, so it never returns clients.
+         *
+         * @param listeners Receives the listening sockets, now owned by the caller
+         * @param clients Receives the client sockets, now owned by the caller
+         * @param include_clients Whether to return idle client connections
+         * @return true on success, false if the server is not running
+         */
+        bool handOver(ListenerSockets &listeners, std::vector<int> &clients, bool include_clients);
+
+        /**
+         * @brief Serve a connected client socket received from a previous server process.
+         *
+         * Must be called after init(). The connection is treated like a newly
+         * accepted one.
+         *
+         * @param client_socket The client socket descriptor, now owned by the server
+         * @return true if the client was added, false if the server is not running
+         */
+        bool adoptClient(int client_socket);
+
         /**
          * @brief Send a message to a specific client.
          *
          * This method sends a message to a specific client identified
-         * by their socket descriptor.
+         * by their socket descriptor. JSON messages are framed with a
+         * trailing newline, binary frames are sent unchanged (see
+         * WireFormat.hpp); whatever cannot be written immediately is
+         * queued and written by the connection's reactor thread, so the
+         * call never blocks on a slow client.
          *
          * @param client_socket The client socket descriptor
          * @param message The message to send
-         * @return true on successful send, false on error
+         * @return true if the message was sent or queued, false if the client is not connected
          */
         bool send(int client_socket, const std::string &message);
 
+        class ResponseStream;
+
         /**
          * @brief Broadcast a message to all connected clients.
          *
@@ -108,6 +302,60 @@ namespace qnx
          */
         void broadcast(const std::string &message);
 
+        /**
+         * @brief Broadcast a message to a subset of connected clients.
+         *
+         * This method sends the same message to each of the given
+         * connections that is still open. Connections that have closed in
+         * the meantime are skipped, even if their socket descriptor already
+         * serves a new client.
+         *
+         * @param clients The connections to send to
+         * @param message The message to broadcast
+         */
+        void broadcast(const std::vector<ClientConnection> &clients, const std::string &message);
+
+        /**
+         * @brief Get the id of the connection a client socket currently serves.
+         *
+         * Ids are assigned in order as connections are accepted or adopted
+         * and are never reused, unlike socket descriptors.
+         *
+         * @param client_socket The client socket descriptor
+         * @return The connection id, or 0 if the client is not connected
+         */
+        uint64_t connectionId(int client_socket);
+
+        /**
+         * @brief Set the callback invoked when a client disconnects.
+         *
+         * @param handler The callback function to notify of disconnections
+         */
+        void setDisconnectHandler(DisconnectHandler handler);
+
+        /**
+         * @brief Set the callback that assigns requests to worker queues.
+         *
+         * Must be called before init(). Without a classifier every request
+         * is queued as RequestClass::POINT.
+         *
+         * @param classifier The callback function classifying requests
+         */
+        void setRequestClassifier(RequestClassifier classifier);
+
+        /**
+         * @brief Run a task on the worker pool that runs the message handler.
+         *
+         * Lets a handler spread independent parts of one request over idle
+         * workers. The task may start late, when every worker is busy, so
+         * the handler must not wait for it to start.
+         *
+         * @param task The task to run
+         * @param request_class The queue to put the task in
+         * @return true if the task was queued, false if the server is not running
+         */
+        bool submitTask(WorkerPool::Task task, RequestClass request_class);
+
         /**
          * @brief Check if the server is running
          *
@@ -115,6 +363,15 @@ namespace qnx
          */
         bool isRunning() const { return running_.load(); }
 
+        /**
+         * @brief Get the I/O backend the server runs (or last ran) with
+         *
+         * This may differ from the requested backend when init() had to fall back.
+         *
+         * @return The I/O backend in use
+         */
+        IoBackend backend() const { return backend_; }
+
         /**
          * @brief Message type constants for client-server communication
          */
@@ -127,6 +384,17 @@ namespace qnx
         inline static const std::string AUTH_LOGIN = "Login";
 
     private:
+        /**
+         * @brief Per-connection state, defined in SocketServer.cpp
+         */
+        struct Connection;
+        using ConnectionPtr = std::shared_ptr<Connection>;
+
+        /**
+         * @brief Per-reactor state, defined in SocketServer.cpp
+         */
+        struct Reactor;
+
         /**
          * @brief Default constructor - private to enforce singleton pattern
          */
@@ -138,34 +406,367 @@ namespace qnx
         ~SocketServer(); // Ensure resources are cleaned up
 
         /**
-         * @brief Main server loop that accepts new connections
+         * @brief Event loop of one reactor thread
+         *
+         * This method runs in a separate thread per reactor and:
+         * 1. Accepts incoming client connections on the reactor's listeners
+         * 2. Reads request data and dispatches complete requests to the worker pool
+         * 3. Writes queued responses once sockets become writable
+         * 4. Continues until the server is shut down
          *
-         * This method runs in a separate thread and:
-         * 1. Accepts incoming client connections
-         * 2. Creates a client handler for each new connection
-         * 3. Continues until the server is shut down
+         * @param reactor The reactor to run
          */
-        void serverLoop();
+        void reactorLoop(Reactor &reactor);
 
         /**
-         * @brief Handles communication with a specific client
+         * @brief Reactor loop multiplexing sockets with select()
          *
-         * This method:
-         * 1. Receives messages from the client
-         * 2. Passes messages to the message handler
-         * 3. Sends responses back to the client
-         * 4. Handles disconnection and cleanup
-         *
-         * @param client_socket The socket descriptor for the client connection
-         */
-        void handleClient(int client_socket);
-
-        int server_fd_ = -1;                ///< Server socket file descriptor
-        std::vector<int> client_sockets_;   ///< List of connected client sockets
-        std::mutex clients_mutex_;          ///< Mutex to protect concurrent access to the client list
-        std::atomic<bool> running_{false};  ///< Flag indicating if the server is running
-        std::thread server_thread_;         ///< Thread that runs the server loop
-        MessageHandler message_handler_;    ///< Callback function for processing messages
-        struct sockaddr_in server_address_; ///< Server address configuration
+         * @param reactor The reactor to run
+         */
+        void selectLoop(Reactor &reactor);
+
+        /**
+         * @brief Reactor loop multiplexing sockets with edge-triggered epoll
+         *
+         * @param reactor The reactor to run
+         */
+        void epollLoop(Reactor &reactor);
+
+        /**
+         * @brief Reactor loop performing socket I/O through io_uring
+         *
+         * @param reactor The reactor to run
+         */
+        void uringLoop(Reactor &reactor);
+
+        /**
+         * @brief Create the per-reactor epoll instances
+         *
+         * @return true on success, false if epoll is unavailable
+         */
+        bool setupEpoll();
+
+        /**
+         * @brief Create the per-reactor io_uring instances and receive buffer rings
+         *
+         * @return true on success, false if io_uring is unavailable or too old
+         */
+        bool setupIoUring();
+
+        /**
+         * @brief Release the epoll or io_uring state of every reactor
+         */
+        void releaseBackend();
+
+        /**
+         * @brief Stop the reactor threads and let the worker pool finish
+         *
+         * @return false if the server was not running
+         */
+        bool stopThreads();
+
+        /**
+         * @brief Close every connection, listening socket and wake pipe
+         *
+         * Called once the threads have stopped. Removes the Unix domain socket
+         * file unless unix_path_ has been cleared.
+         */
+        void releaseResources();
+
+        /**
+         * @brief Create a non-blocking TCP listening socket
+         *
+         * @param port The TCP port to listen on
+         * @param reuse_port Whether to set SO_REUSEPORT so several sockets can share the port
+         * @return The socket descriptor, or -1 on error
+         */
+        int openTcpListener(int port, bool reuse_port);
+
+        /**
+         * @brief Create a non-blocking Unix domain listening socket
+         *
+         * @param path The socket path
+         * @param mode Permissions applied to the socket file
+         * @return The socket descriptor, or -1 on error
+         */
+        int openUnixListener(const std::string &path, mode_t mode);
+
+        /**
+         * @brief Accept pending connections on a listening socket
+         *
+         * @param reactor The reactor that owns the listening socket
+         * @param listen_fd The TCP or Unix domain listening socket
+         */
+        void acceptConnections(Reactor &reactor, int listen_fd);
+
+        /**
+         * @brief Register an accepted client socket with one of the reactors
+         *
+         * @param reactor The reactor that accepted the connection
+         * @param new_socket The accepted client socket
+         * @param address The peer address reported by accept()
+         */
+        void adoptConnection(Reactor &reactor, int new_socket, const struct sockaddr_storage &address);
+
+        /**
+         * @brief Read all available data from a client
+         *
+         * @param conn The connection to read from
+         * @return false if the client disconnected or an error occurred
+         */
+        bool readFromClient(const ConnectionPtr &conn);
+
+        /**
+         * @brief Write as much queued output to a client as the socket accepts
+         *
+         * @param conn The connection to write to
+         * @return false if an error occurred and the connection must be closed
+         */
+        bool writeToClient(const ConnectionPtr &conn);
+
+        /**
+         * @brief Split buffered input into requests and hand them to the worker pool
+         *
+         * Stops when no complete request is buffered or when the connection
+         * has MAX_IN_FLIGHT_PER_CLIENT requests in flight.
+         *
+         * @param conn The connection whose input buffer is processed
+         * @return true if the buffered input ends with an incomplete request
+         */
+        bool dispatchRequests(const ConnectionPtr &conn);
+
+        /**
+         * @brief Dispatch newly received input and enforce the request size limit
+         *
+         * @param conn The connection that received data
+         * @return false if the connection was closed
+         */
+        bool processInput(const ConnectionPtr &conn);
+
+        /**
+         * @brief Tell a connection's reactor that one of its in-flight slots freed up
+         *
+         * @param conn The connection that was at its in-flight limit
+         */
+        void resumeConnection(const ConnectionPtr &conn);
+
+        /**
+         * @brief Note that a connection's output queue became non-empty
+         *
+         * Called by the owning reactor for connections on its flush list;
+         * starts the write timeout.
+         *
+         * @param conn The connection with queued output
+         */
+        void noteOutputQueued(const ConnectionPtr &conn);
+
+        /**
+         * @brief Schedule a connection's timer for its earliest pending deadline
+         *
+         * Must be called from the owning reactor thread.
+         *
+         * @param conn The connection whose timer is updated
+         */
+        void armTimer(const ConnectionPtr &conn);
+
+        /**
+         * @brief Close the connections of a reactor whose timeouts have expired
+         *
+         * @param reactor The reactor whose timer wheel is advanced
+         */
+        void expireTimers(Reactor &reactor);
+
+        /**
+         * @brief Get how long a reactor may wait for I/O before its timers are due
+         *
+         * @param reactor The reactor about to wait
+         * @return The wait timeout in milliseconds
+         */
+        static int waitTimeout(Reactor &reactor);
+
+        /**
+         * @brief Frame a message and queue it on a connection
+         *
+         * Attempts to write the message immediately when nothing else is
+         * queued, and wakes the connection's reactor if output remains pending.
+         * With the io_uring backend the message is always left to the reactor,
+         * which submits all pending responses together.
+         *
+         * @param conn The connection to send to
+         * @param message The unframed message
+         * @return true if the message was sent or queued, false if the connection is closed
+         */
+        bool queueMessage(const ConnectionPtr &conn, const std::string &message);
+
+        /**
+         * @brief Queue a framed message, or hold it back while a response is streamed
+         *
+         * @param conn The connection to send to
+         * @param frame The framed message
+         * @return true if the message was sent or queued, false if the connection is closed
+         */
+        bool queueFrame(const ConnectionPtr &conn, std::string &&frame);
+
+        /**
+         * @brief Write bytes to a connection or append them to its output queue
+         *
+         * Called with the connection mutex held through lock, which is
+         * released before the reactor is woken.
+         *
+         * @param conn The connection to send to
+         * @param bytes The bytes to write
+         * @param lock Lock on the connection mutex
+         */
+        void pushOutput(const ConnectionPtr &conn, std::string &&bytes, std::unique_lock<std::mutex> &lock);
+
+        /**
+         * @brief Remove a connection from the server and shut its socket down
+         *
+         * The descriptor itself is closed once the last in-flight request on
+         * the connection releases its reference.
+         *
+         * @param conn The connection to close
+         */
+        void closeConnection(const ConnectionPtr &conn);
+
+        /**
+         * @brief Release a connection once it is no longer referenced
+         *
+         * Notifies the disconnect handler and closes the socket descriptor.
+         *
+         * @param conn The connection being destroyed
+         */
+        void releaseConnection(Connection *conn);
+
+        /**
+         * @brief Look up a connected client by socket descriptor
+         *
+         * @param client_socket The client socket descriptor
+         * @return The connection, or nullptr if the client is not connected
+         */
+        ConnectionPtr findConnection(int client_socket);
+
+        /**
+         * @brief Wake a reactor thread from its wait for I/O
+         *
+         * @param reactor The reactor to wake
+         */
+        static void wake(Reactor &reactor);
+
+        std::vector<std::unique_ptr<Reactor>> reactors_; ///< Reactor threads and their clients
+        std::atomic<size_t> next_reactor_{0};            ///< Round-robin cursor for handed-off connections
+        std::atomic<int> client_count_{0};               ///< Connected clients across all reactors
+        std::atomic<uint64_t> next_connection_id_{1};    ///< Id of the next connection, see connectionId()
+        bool reuse_port_ = false;                        ///< Whether each reactor has its own TCP listener
+        IoBackend backend_ = IoBackend::SELECT;          ///< I/O backend the reactors run
+        int64_t idle_timeout_ms_ = 0;                    ///< See ServerOptions::idle_timeout
+        int64_t request_timeout_ms_ = 0;                 ///< See ServerOptions::request_timeout
+        int64_t write_timeout_ms_ = 0;                   ///< See ServerOptions::write_timeout
+        std::chrono::milliseconds max_request_time_{0};  ///< See ServerOptions::max_request_time
+        std::string unix_path_;                          ///< Path the Unix domain socket is bound to
+        std::atomic<bool> running_{false};               ///< Flag indicating if the server is running
+        WorkerPool workers_;                             ///< Pool that runs the message handler
+        MessageHandler message_handler_;                 ///< Callback function for processing messages
+        DisconnectHandler disconnect_handler_;           ///< Callback function for disconnect notification
+        RequestClassifier request_classifier_;           ///< Callback function choosing a request's worker queue
+    };
+
+    /**
+     * @class SocketServer::ResponseStream
+     * @brief Writes one response to a client in chunks while it is produced
+     *
+     * Lets a message handler put a large response on the wire piece by
+     * piece instead of returning it whole. The first chunk claims the
+     * connection's output: responses of other requests that complete in the
+     * meantime are held back until the stream ends.
+     *
+     * A stream never blocks the worker on the client. While another stream
+     * owns the connection, or once the client is STREAM_BACKLOG chunks
+     * behind, write() declines the chunk; the producer then keeps the rest
+     * of the response and hands it to finish() in one piece, which leaves
+     * it to the reactor to write as the client reads. Memory then grows to
+     * what an unstreamed response takes, and a client that stops reading is
+     * closed by the write timeout.
+     *
+     * The chunks are written as they are; finish() adds the newline framing
+     * after the last one. A stream that is started but not finished leaves
+     * the client a truncated response, so it is aborted, which closes the
+     * connection.
+     */
+    class SocketServer::ResponseStream
+    {
+    public:
+        /// Chunks queued on a connection before a stream declines more
+        static constexpr size_t STREAM_BACKLOG = 4;
+
+        /**
+         * @brief Create a stream to a client; nothing is claimed until the first write()
+         *
+         * @param client_socket The client socket descriptor
+         */
+        explicit ResponseStream(int client_socket);
+
+        /**
+         * @brief Abort the stream if it was started but not finished
+         */
+        ~ResponseStream();
+
+        ResponseStream(const ResponseStream &) = delete;
+        ResponseStream &operator=(const ResponseStream &) = delete;
+
+        /**
+         * @brief Write the next chunk of the response without waiting
+         *
+         * Declines the chunk, leaving it untouched, while another stream
+         * holds the connection or the client is behind by STREAM_BACKLOG
+         * chunks; the caller then passes the rest of the response to finish().
+         *
+         * @param chunk The bytes to write
+         * @return false if the chunk was declined, the client is gone or the server is stopping
+         */
+        bool write(std::string &&chunk);
+
+        /**
+         * @brief Write the last chunk and the framing, and release the connection
+         *
+         * The rest of the response is queued whatever the client's backlog.
+         *
+         * @param tail The rest of the response
+         * @return false if the response could not be completed; the connection is then closed
+         */
+        bool finish(std::string &&tail);
+
+        /**
+         * @brief Give up on a started response and close the connection
+         */
+        void abort();
+
+        /**
+         * @brief Whether chunks have been written and the stream is not finished yet
+         */
+        bool started() const { return open_; }
+
+    private:
+        /**
+         * @brief Queue a chunk, claiming the connection's output with the first one
+         *
+         * @param chunk The bytes to write, left untouched if declined
+         * @param last Whether this is the rest of the response, which is never declined
+         * @return false if the chunk was declined or the connection is gone
+         */
+        bool push(std::string &&chunk, bool last);
+
+        /**
+         * @brief Release the connection's output and queue the responses held back
+         *
+         * @param deliver Whether the held back responses are still sent
+         */
+        void end(bool deliver);
+
+        SocketServer &server_;
+        int client_socket_;
+        ConnectionPtr conn_;  ///< Looked up by the first write()
+        bool open_ = false;   ///< Owns the connection's output
+        bool failed_ = false; ///< A write() failed
     };
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+/**
+ * @file Subscription.hpp
+ * @brief Push subscriptions for the QNX Remote Process Monitor
+ *
+ * This file defines the SubscriptionManager class, which lets clients
+ * register interest in a view of the process list and receive updates
+ * pushed over their existing connection after each collection cycle,
+ * instead of polling the server.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include "ProcessQuery.hpp"
+
+namespace qnx
+{
+    /**
+     * @struct Subscription
+     * @brief A single client's registration for pushed process updates
+     */
+    struct Subscription
+    {
+        int id = 0;                                       ///< Server-assigned subscription ID
+        int client_socket = -1;                           ///< Socket the updates are pushed to
+        uint64_t connection_id = 0;                       ///< Connection that subscribed on the socket, see SocketServer::connectionId()
+        ProcessQuery query;                               ///< View of the process list to push
+        std::chrono::milliseconds interval{0};            ///< Minimum time between two pushes
+        std::chrono::steady_clock::time_point last_push;  ///< Time of the most recent push
+    };
+
+    /**
+     * @class SubscriptionManager
+     * @brief Tracks client subscriptions and pushes updates to them
+     *
+     * This singleton class stores subscriptions keyed by ID. After each
+     * collection cycle, publish() encodes every distinct topic that is due
+     * exactly once and hands the result to SocketServer::broadcast() for all
+     * subscribers of that topic. Each subscriber is rate limited by its
+     * interval, which is clamped to [MIN_INTERVAL, MAX_INTERVAL], and each
+     * client may hold at most MAX_SUBSCRIPTIONS_PER_CLIENT subscriptions.
+     */
+    class SubscriptionManager
+    {
+    public:
+        static constexpr std::chrono::milliseconds MIN_INTERVAL{1000};    ///< Fastest allowed push rate
+        static constexpr std::chrono::milliseconds MAX_INTERVAL{3600000}; ///< Slowest allowed push rate
+        static constexpr size_t MAX_SUBSCRIPTIONS_PER_CLIENT = 8;         ///< Per-client subscription cap
+
+        /**
+         * @brief Get the singleton instance of SubscriptionManager
+         *
+         * @return Reference to the singleton instance
+         */
+        static SubscriptionManager &getInstance();
+
+        // Delete copy/move constructors and assignment operators
+        SubscriptionManager(const SubscriptionManager &) = delete;
+        SubscriptionManager &operator=(const SubscriptionManager &) = delete;
+        SubscriptionManager(SubscriptionManager &&) = delete;
+        SubscriptionManager &operator=(SubscriptionManager &&) = delete;
+
+        /**
+         * @brief Register a new subscription for a client
+         *
+         * @param client_socket The socket updates are pushed to
+         * @param query The (normalized) view of the process list to push
+         * @param interval Requested time between pushes, clamped to the allowed range
+         * @return The created subscription, or std::nullopt if the client reached its limit
+         */
+        std::optional<Subscription> subscribe(int client_socket, const ProcessQuery &query,
+                                              std::chrono::milliseconds interval);
+
+        /**
+         * @brief Remove a single subscription owned by a client
+         *
+         * @param client_socket The socket that owns the subscription
+         * @param subscription_id The ID returned by subscribe()
+         * @return true if the subscription existed and was removed, false otherwise
+         */
+        bool unsubscribe(int client_socket, int subscription_id);
+
+        /**
+         * @brief Get the subscriptions owned by a client
+         *
+         * @param client_socket The socket whose subscriptions are returned
+         * @return The client's subscriptions ordered by ID
+         */
+        std::vector<Subscription> getSubscriptions(int client_socket) const;
+
+        /**
+         * @brief Re-create a subscription taken over from a previous server process
+         *
+         * Keeps the subscription's ID, which the client uses to unsubscribe.
+         * Nothing is pushed to it until bindConnection() names the connection
+         * the socket is adopted as.
+         *
+         * @param subscription The subscription, owned by its client's socket in this process
+         * @return false if the ID is already in use
+         */
+        bool restore(const Subscription &subscription);
+
+        /**
+         * @brief Bind the subscriptions restored for a socket to the connection serving it
+         *
+         * @param client_socket The socket the subscriptions were restored for
+         * @param connection_id The id the socket was adopted with, see SocketServer::connectionId()
+         */
+        void bindConnection(int client_socket, uint64_t connection_id);
+
+        /**
+         * @brief Remove every subscription owned by a client
+         *
+         * Called when a client disconnects or unsubscribes from everything.
+         *
+         * @param client_socket The socket whose subscriptions are removed
+         * @return The number of subscriptions removed
+         */
+        size_t unsubscribeAll(int client_socket);
+
+        /**
+         * @brief Push updates to all subscribers that are due
+         *
+         * Intended to be called once after each collection cycle. Encodes each
+         * due topic once and broadcasts it to the connections subscribed to it.
+         */
+        void publish();
+
+    private:
+        SubscriptionManager() = default;
+        ~SubscriptionManager() = default;
+
+        int next_subscription_id_ = 1;
+        std::map<int, Subscription> subscriptions_;
+        mutable std::mutex mutex_;
+    };
+} // namespace qnx
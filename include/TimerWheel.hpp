@@ -0,0 +1,140 @@
+/**
+ * @file TimerWheel.hpp
+ * @brief Hashed timer wheel for the QNX Remote Process Monitor socket server
+ *
+ * This file defines the TimerWheel class, which tracks connection deadlines
+ * for a reactor thread. Timers are intrusive (the tracked object derives from
+ * TimerNode) and hashed into a fixed ring of slots by expiry tick, so
+ * scheduling, rescheduling and cancelling a timer are O(1) and advancing the
+ * wheel only touches the slots of the ticks that have passed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace qnx
+{
+    /**
+     * @struct TimerNode
+     * @brief Intrusive link of an object tracked by a TimerWheel
+     *
+     * A node belongs to at most one wheel at a time and must be cancelled
+     * before the object it is part of is destroyed.
+     */
+    struct TimerNode
+    {
+        TimerNode *timer_prev = nullptr; ///< Previous node in the slot, nullptr when not scheduled
+        TimerNode *timer_next = nullptr; ///< Next node in the slot
+        uint64_t timer_expiry = 0;       ///< Tick at which the timer expires
+
+        /**
+         * @brief Check whether the timer is scheduled
+         *
+         * @return true if the node is linked into a wheel
+         */
+        bool timerScheduled() const { return timer_prev != nullptr; }
+    };
+
+    /**
+     * @class TimerWheel
+     * @brief Single-level hashed timing wheel
+     *
+     * Time is given in milliseconds of a monotonic clock and rounded up to
+     * whole ticks, so a timer never fires early but may fire up to one tick
+     * late. Deadlines further away than one revolution simply stay in their
+     * slot until the wheel has come round often enough.
+     *
+     * Not thread-safe: each wheel is owned by one reactor thread.
+     */
+    class TimerWheel
+    {
+    public:
+        /**
+         * @brief Construct an empty wheel
+         *
+         * @param tick_ms Length of one tick in milliseconds
+         * @param slots Number of slots (rounded up to a power of two)
+         */
+        explicit TimerWheel(int64_t tick_ms = 1000, size_t slots = 256);
+
+        // The slot lists point into the wheel, so it cannot be copied or moved
+        TimerWheel(const TimerWheel &) = delete;
+        TimerWheel &operator=(const TimerWheel &) = delete;
+
+        /**
+         * @brief Drop all timers and set the current time
+         *
+         * @param now_ms Current time in milliseconds
+         */
+        void reset(int64_t now_ms);
+
+        /**
+         * @brief Schedule a timer, replacing any earlier schedule of the same node
+         *
+         * @param node The node to schedule
+         * @param deadline_ms Time at which the timer expires, in milliseconds
+         */
+        void schedule(TimerNode &node, int64_t deadline_ms);
+
+        /**
+         * @brief Cancel a timer; does nothing if it is not scheduled
+         *
+         * @param node The node to cancel
+         */
+        void cancel(TimerNode &node);
+
+        /**
+         * @brief Get the number of scheduled timers
+         *
+         * @return The number of scheduled timers
+         */
+        size_t size() const { return size_; }
+
+        /**
+         * @brief Get the time until the wheel next needs to be advanced
+         *
+         * @param now_ms Current time in milliseconds
+         * @return Milliseconds until the next tick
+         */
+        int64_t msUntilNextTick(int64_t now_ms) const;
+
+        /**
+         * @brief Advance to the current time and report expired timers
+         *
+         * Expired nodes are unscheduled before the callback runs, so the
+         * callback may reschedule them (or schedule and cancel other nodes).
+         * A node that is rescheduled by the callback of another node that
+         * expired in the same step is not reported.
+         *
+         * @param now_ms Current time in milliseconds
+         * @param expired Called with each expired node
+         */
+        template <typename Callback>
+        void advance(int64_t now_ms, Callback expired)
+        {
+            collectExpired(now_ms);
+            for (TimerNode *node : due_)
+            {
+                if (!node->timerScheduled())
+                {
+                    expired(*node);
+                }
+            }
+            due_.clear();
+        }
+
+    private:
+        void link(TimerNode &node);
+        void collectExpired(int64_t now_ms);
+
+        int64_t tick_ms_;
+        uint64_t mask_;
+        uint64_t current_tick_ = 0;     ///< Last tick whose slot has been processed
+        size_t size_ = 0;
+        std::vector<TimerNode> slots_;  ///< Sentinel of each slot's circular list
+        std::vector<TimerNode *> due_;  ///< Scratch list of nodes expiring in advance()
+    };
+} // namespace qnx
@@ -0,0 +1,125 @@
+/**
+ * @file WireFormat.hpp
+ * @brief Wire formats and framing for the QNX Remote Process Monitor protocol
+ *
+ * Requests are always newline-delimited JSON. Responses are encoded in the
+ * format the client negotiated for its connection:
+ *
+ * - JSON responses are terminated by a newline.
+ * - Binary and CBOR responses are self-delimiting frames. Because a JSON
+ *   response can never start with the magic byte, clients can tell JSON from
+ *   framed responses by the first byte of every response, and the frame's
+ *   encoding byte tells binary from CBOR.
+ *
+ * Binary frame layout (all integers little-endian):
+ *
+ *     header   u8 magic (0xB1), u8 encoding (0 = JSON text, 1 = binary, 2 = CBOR),
+ *              u8 flags, u8 codec, u32 payload length
+ *     payload  u16 dictionary size, then per entry: u16 length + UTF-8 bytes,
+ *              followed by a single root value
+ *     value    u8 tag followed by tag-specific data; inside an object the tag
+ *              is followed by the u16 dictionary index of the member name first:
+ *              0x01 object start ... 0x02 object end
+ *              0x03 array start ... 0x04 array end
+ *              0x10 int32, 0x11 int64, 0x12 float64 (IEEE 754)
+ *              0x13 false, 0x14 true
+ *              0x15 string (u16 dictionary index)
+ *              0x16 string literal (u32 length + bytes, used once the dictionary is full)
+ *
+ * A CBOR frame (RFC 8949) has the same header; its payload is a single CBOR
+ * data item holding the same document as the JSON form would. Objects and
+ * arrays are indefinite-length maps and arrays with text string keys,
+ * integers use the shortest encoding, and doubles are sent as single
+ * precision floats when that is exact, otherwise as double precision.
+ *
+ * When the FLAG_COMPRESSED bit is set, the codec byte names the compression
+ * codec (see Compression.hpp) and the payload is the u32 uncompressed size
+ * followed by the compressed bytes. Compressed JSON responses are also sent
+ * this way, with encoding 0 and without the trailing newline.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace qnx
+{
+    /**
+     * @brief Response encodings a client can negotiate
+     */
+    enum class WireFormat
+    {
+        JSON,   ///< Newline-terminated JSON text (default)
+        BINARY, ///< Length-prefixed binary frames with a string dictionary
+        CBOR,   ///< Length-prefixed frames holding a CBOR data item
+    };
+
+    /// Number of wire formats
+    constexpr size_t WIRE_FORMAT_COUNT = 3;
+
+    /**
+     * @brief Binary frame constants
+     */
+    namespace wire
+    {
+        constexpr uint8_t FRAME_MAGIC = 0xB1;      ///< First byte of every binary frame
+        constexpr size_t FRAME_HEADER_SIZE = 8;    ///< Size of the binary frame header
+        constexpr uint8_t ENCODING_JSON = 0;       ///< Header encoding value for (compressed) JSON text
+        constexpr uint8_t ENCODING_BINARY = 1;     ///< Header encoding value for binary payloads
+        constexpr uint8_t ENCODING_CBOR = 2;       ///< Header encoding value for CBOR payloads
+        constexpr uint8_t FLAG_COMPRESSED = 0x01;  ///< Header flag: the payload is compressed
+
+        constexpr uint8_t TAG_OBJECT_START = 0x01;
+        constexpr uint8_t TAG_OBJECT_END = 0x02;
+        constexpr uint8_t TAG_ARRAY_START = 0x03;
+        constexpr uint8_t TAG_ARRAY_END = 0x04;
+        constexpr uint8_t TAG_INT32 = 0x10;
+        constexpr uint8_t TAG_INT64 = 0x11;
+        constexpr uint8_t TAG_FLOAT64 = 0x12;
+        constexpr uint8_t TAG_FALSE = 0x13;
+        constexpr uint8_t TAG_TRUE = 0x14;
+        constexpr uint8_t TAG_STRING = 0x15;
+        constexpr uint8_t TAG_STRING_LITERAL = 0x16;
+    }
+
+    /**
+     * @brief Parse a wire format name ("json", "binary" or "cbor")
+     *
+     * @param name The format name
+     * @param format Receives the parsed format on success
+     * @return true if the name is a known format, false otherwise
+     */
+    inline bool parseWireFormat(std::string_view name, WireFormat &format)
+    {
+        if (name == "json")
+            format = WireFormat::JSON;
+        else if (name == "binary")
+            format = WireFormat::BINARY;
+        else if (name == "cbor")
+            format = WireFormat::CBOR;
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Get the name of a wire format
+     *
+     * @param format The format
+     * @return The format name as accepted by parseWireFormat()
+     */
+    inline const char *wireFormatName(WireFormat format)
+    {
+        switch (format)
+        {
+        case WireFormat::BINARY:
+            return "binary";
+        case WireFormat::CBOR:
+            return "cbor";
+        default:
+            return "json";
+        }
+    }
+} // namespace qnx
@@ -0,0 +1,110 @@
+/**
+ * @file WorkerPool.hpp
+ * @brief Fixed-size worker thread pool for the QNX Remote Process Monitor
+ *
+ * This file defines the WorkerPool class, which executes request handlers
+ * off the socket server thread so that slow requests do not delay the
+ * handling of other requests or other connections. Tasks are queued by
+ * request class so that process control commands overtake bulk reads.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace qnx
+{
+    /**
+     * @enum RequestClass
+     * @brief Scheduling class of a request, in order of priority
+     */
+    enum class RequestClass
+    {
+        CONTROL, ///< Commands that act on processes, such as terminating one
+        POINT,   ///< Small queries and session commands
+        BULK     ///< Requests that read or encode the whole process table
+    };
+
+    /**
+     * @class WorkerPool
+     * @brief Runs submitted tasks on a fixed set of worker threads
+     *
+     * Each request class has its own queue. A free worker takes the oldest
+     * task of the highest-priority class that has one, and some workers can
+     * be reserved for CONTROL tasks: POINT and BULK tasks never occupy more
+     * than the remaining workers, so a control command starts at once even
+     * when every other worker is busy with bulk requests.
+     *
+     * Tasks of one class start in submission order, but because several
+     * workers run concurrently they may complete in any order.
+     */
+    class WorkerPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        WorkerPool() = default;
+        ~WorkerPool();
+
+        // Delete copy/move constructors and assignment operators
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+        WorkerPool(WorkerPool &&) = delete;
+        WorkerPool &operator=(WorkerPool &&) = delete;
+
+        /**
+         * @brief Start the worker threads
+         *
+         * @param num_threads Number of worker threads to start (at least one)
+         * @param reserved_control Workers that only run CONTROL tasks (at most num_threads - 1)
+         */
+        void start(size_t num_threads, size_t reserved_control = 0);
+
+        /**
+         * @brief Queue a task for execution
+         *
+         * @param task The task to run on a worker thread
+         * @param request_class The queue to put the task in
+         * @return true if the task was queued, false if the pool is not running
+         */
+        bool submit(Task task, RequestClass request_class = RequestClass::POINT);
+
+        /**
+         * @brief Stop the pool
+         *
+         * Runs every task that is already queued, then joins the worker threads.
+         */
+        void shutdown();
+
+    private:
+        /**
+         * @brief Worker thread main loop
+         */
+        void workerLoop();
+
+        /**
+         * @brief Check whether a waiting worker can take a task (mutex_ held)
+         */
+        bool hasRunnableTask() const;
+
+        /**
+         * @brief Check whether every queue is empty (mutex_ held)
+         */
+        bool drained() const;
+
+        static constexpr size_t CLASS_COUNT = 3;
+
+        std::vector<std::thread> workers_;   ///< Worker threads
+        std::deque<Task> tasks_[CLASS_COUNT]; ///< Queued tasks, indexed by RequestClass
+        size_t shared_limit_ = 0;            ///< Workers that may run POINT and BULK tasks
+        size_t shared_running_ = 0;          ///< POINT and BULK tasks currently running
+        std::mutex mutex_;                   ///< Protects the queues, the counters and running_
+        std::condition_variable cv_;         ///< Signals queued tasks, freed workers and shutdown
+        bool running_ = false;               ///< Whether the pool accepts tasks
+    };
+} // namespace qnx
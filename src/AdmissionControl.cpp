@@ -0,0 +1,117 @@
+/**
+ * @file AdmissionControl.cpp
+ * @brief Implementation of request rate limiting for QNX Remote Process Monitor
+ */
+
+#include "AdmissionControl.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace qnx
+{
+    namespace
+    {
+        constexpr int64_t BUSY_RETRY_MS = 100; // Suggested delay when the concurrency limit is reached
+    }
+
+    AdmissionControl &AdmissionControl::getInstance()
+    {
+        static AdmissionControl instance;
+        return instance;
+    }
+
+    void AdmissionControl::configure(const AdmissionLimits &limits)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limits_ = limits;
+    }
+
+    void AdmissionControl::TokenBucket::refill(Clock::time_point now, double rate, double burst)
+    {
+        if (tokens < 0.0)
+        {
+            // New buckets start full so a client can issue its first burst at once
+            tokens = burst;
+        }
+        else
+        {
+            double elapsed = std::chrono::duration<double>(now - updated).count();
+            tokens = std::min(burst, tokens + elapsed * rate);
+        }
+        updated = now;
+    }
+
+    int64_t AdmissionControl::retryAfterMs(const TokenBucket &bucket, double cost, double rate)
+    {
+        double missing = cost - bucket.tokens;
+        return static_cast<int64_t>(std::ceil(missing / rate * 1000.0));
+    }
+
+    Admission AdmissionControl::admit(int client_socket, const std::string &user, bool expensive, int64_t &retry_after_ms)
+    {
+        return admit(client_socket, user, expensive ? EXPENSIVE_COST : 1.0, expensive, retry_after_ms);
+    }
+
+    Admission AdmissionControl::admit(int client_socket, const std::string &user, double cost, bool expensive,
+                                      int64_t &retry_after_ms)
+    {
+        const Clock::time_point now = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Check every limit before taking anything, so a rejection is free
+        TokenBucket *connection = nullptr;
+        if (limits_.connection_rate > 0.0)
+        {
+            connection = &connections_[client_socket];
+            connection->refill(now, limits_.connection_rate, std::max(limits_.connection_burst, cost));
+            if (connection->tokens < cost)
+            {
+                retry_after_ms = retryAfterMs(*connection, cost, limits_.connection_rate);
+                return Admission::CONNECTION_RATE;
+            }
+        }
+
+        TokenBucket *account = nullptr;
+        if (!user.empty() && limits_.user_rate > 0.0)
+        {
+            account = &users_[user];
+            account->refill(now, limits_.user_rate, std::max(limits_.user_burst, cost));
+            if (account->tokens < cost)
+            {
+                retry_after_ms = retryAfterMs(*account, cost, limits_.user_rate);
+                return Admission::USER_RATE;
+            }
+        }
+
+        if (expensive && limits_.max_expensive > 0 && expensive_running_ >= limits_.max_expensive)
+        {
+            retry_after_ms = BUSY_RETRY_MS;
+            return Admission::BUSY;
+        }
+
+        if (connection)
+            connection->tokens -= cost;
+        if (account)
+            account->tokens -= cost;
+        if (expensive)
+            ++expensive_running_;
+        return Admission::ADMITTED;
+    }
+
+    void AdmissionControl::finishExpensive()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (expensive_running_ > 0)
+        {
+            --expensive_running_;
+        }
+    }
+
+    void AdmissionControl::release(int client_socket)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.erase(client_socket);
+    }
+} // namespace qnx
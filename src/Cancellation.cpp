@@ -0,0 +1,54 @@
+/**
+ * @file Cancellation.cpp
+ * @brief Implementation of request deadlines and cancellation for QNX Remote Process Monitor
+ */
+
+#include "Cancellation.hpp"
+
+#include <algorithm>
+
+namespace qnx
+{
+    CancellationToken CancellationToken::create()
+    {
+        CancellationToken token;
+        token.cancelled_ = std::make_shared<std::atomic<bool>>(false);
+        return token;
+    }
+
+    void CancellationToken::cancel()
+    {
+        if (cancelled_)
+        {
+            cancelled_->store(true, std::memory_order_relaxed);
+        }
+    }
+
+    CancellationToken CancellationToken::startRequest(std::chrono::milliseconds max_time) const
+    {
+        CancellationToken token(*this);
+        token.received_ = Clock::now();
+        token.deadline_ = token.received_ + max_time;
+        return token;
+    }
+
+    CancellationToken CancellationToken::withTimeout(std::chrono::milliseconds timeout) const
+    {
+        CancellationToken token(*this);
+        Clock::time_point start = received_ != Clock::time_point() ? received_ : Clock::now();
+        token.deadline_ = std::min(deadline_, start + timeout);
+        return token;
+    }
+
+    void CancellationToken::throwIfStopped() const
+    {
+        if (isCancelled())
+        {
+            throw RequestCancelled(false);
+        }
+        if (isExpired())
+        {
+            throw RequestCancelled(true);
+        }
+    }
+} // namespace qnx
@@ -0,0 +1,303 @@
+/**
+ * @file Compression.cpp
+ * @brief Implementation of response compression for QNX Remote Process Monitor
+ *
+ * This file implements a single-pass LZ4 block compressor (greedy matching
+ * with a 4K-entry hash table, in the spirit of LZ4's fast mode), the matching
+ * decompressor, the optional zlib codec, and the framing of compressed
+ * responses.
+ */
+
+#include "Compression.hpp"
+#include "WireFormat.hpp"
+#include "ServerStats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#ifdef RPM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace qnx
+{
+    namespace
+    {
+        constexpr int LZ4_HASH_LOG = 12;
+        constexpr size_t LZ4_MIN_MATCH = 4;
+        constexpr size_t LZ4_LAST_LITERALS = 5; // The block must end with at least 5 literals
+        constexpr size_t LZ4_MF_LIMIT = 12;     // The last match must start 12 bytes before the end
+        constexpr size_t LZ4_MAX_OFFSET = 65535;
+
+        inline uint32_t read32(const uint8_t *p)
+        {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t hash32(uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+        }
+
+        void writeLength(std::string &out, size_t length)
+        {
+            while (length >= 255)
+            {
+                out.push_back(static_cast<char>(255));
+                length -= 255;
+            }
+            out.push_back(static_cast<char>(length));
+        }
+
+        void writeSequence(std::string &out, const uint8_t *literals, size_t literal_length,
+                           size_t offset, size_t match_length)
+        {
+            size_t match_code = match_length - LZ4_MIN_MATCH;
+            uint8_t token = static_cast<uint8_t>((std::min<size_t>(literal_length, 15) << 4) |
+                                                 std::min<size_t>(match_code, 15));
+            out.push_back(static_cast<char>(token));
+            if (literal_length >= 15)
+                writeLength(out, literal_length - 15);
+            out.append(reinterpret_cast<const char *>(literals), literal_length);
+            out.push_back(static_cast<char>(offset & 0xFF));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (match_code >= 15)
+                writeLength(out, match_code - 15);
+        }
+
+        void lz4Compress(const uint8_t *src, size_t size, std::string &out)
+        {
+            out.clear();
+            out.reserve(size + size / 255 + 16);
+
+            size_t anchor = 0;
+            if (size > LZ4_MF_LIMIT)
+            {
+                std::vector<uint32_t> table(size_t(1) << LZ4_HASH_LOG, 0);
+                const size_t match_start_limit = size - LZ4_MF_LIMIT;
+                const size_t match_end_limit = size - LZ4_LAST_LITERALS;
+                size_t ip = 0;
+
+                while (ip < match_start_limit)
+                {
+                    uint32_t sequence = read32(src + ip);
+                    uint32_t &slot = table[hash32(sequence)];
+                    size_t ref = slot;
+                    slot = static_cast<uint32_t>(ip);
+
+                    if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != sequence)
+                    {
+                        // Skip ahead faster through data that does not compress
+                        ip += 1 + ((ip - anchor) >> 6);
+                        continue;
+                    }
+
+                    size_t length = LZ4_MIN_MATCH;
+                    while (ip + length < match_end_limit && src[ref + length] == src[ip + length])
+                        ++length;
+
+                    writeSequence(out, src + anchor, ip - anchor, ip - ref, length);
+                    ip += length;
+                    anchor = ip;
+                }
+            }
+
+            // Final sequence: literals only
+            size_t literal_length = size - anchor;
+            out.push_back(static_cast<char>(std::min<size_t>(literal_length, 15) << 4));
+            if (literal_length >= 15)
+                writeLength(out, literal_length - 15);
+            out.append(reinterpret_cast<const char *>(src + anchor), literal_length);
+        }
+
+        bool readLength(const uint8_t *src, size_t size, size_t &ip, size_t &length)
+        {
+            uint8_t byte;
+            do
+            {
+                if (ip >= size)
+                    return false;
+                byte = src[ip++];
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        bool lz4Decompress(const uint8_t *src, size_t size, size_t uncompressed_size, std::string &out)
+        {
+            out.clear();
+            out.reserve(uncompressed_size);
+            size_t ip = 0;
+
+            while (ip < size)
+            {
+                uint8_t token = src[ip++];
+
+                size_t literal_length = token >> 4;
+                if (literal_length == 15 && !readLength(src, size, ip, literal_length))
+                    return false;
+                if (literal_length > size - ip || out.size() + literal_length > uncompressed_size)
+                    return false;
+                out.append(reinterpret_cast<const char *>(src + ip), literal_length);
+                ip += literal_length;
+
+                if (ip == size)
+                    break; // The last sequence has no match
+
+                if (size - ip < 2)
+                    return false;
+                size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+                ip += 2;
+                if (offset == 0 || offset > out.size())
+                    return false;
+
+                size_t match_length = token & 0x0F;
+                if (match_length == 15 && !readLength(src, size, ip, match_length))
+                    return false;
+                match_length += LZ4_MIN_MATCH;
+                if (out.size() + match_length > uncompressed_size)
+                    return false;
+
+                // Byte by byte: the match may overlap the bytes it produces
+                size_t from = out.size() - offset;
+                for (size_t i = 0; i < match_length; ++i)
+                    out.push_back(out[from + i]);
+            }
+
+            return out.size() == uncompressed_size;
+        }
+    }
+
+    bool parseCompressionCodec(std::string_view name, CompressionCodec &codec)
+    {
+        if (name == "none")
+            codec = CompressionCodec::NONE;
+        else if (name == "lz4")
+            codec = CompressionCodec::LZ4;
+#ifdef RPM_HAVE_ZLIB
+        else if (name == "zlib")
+            codec = CompressionCodec::ZLIB;
+#endif
+        else
+            return false;
+        return true;
+    }
+
+    const char *compressionCodecName(CompressionCodec codec)
+    {
+        switch (codec)
+        {
+        case CompressionCodec::LZ4:
+            return "lz4";
+        case CompressionCodec::ZLIB:
+            return "zlib";
+        case CompressionCodec::NONE:
+        default:
+            return "none";
+        }
+    }
+
+    bool compressBlock(CompressionCodec codec, std::string_view data, std::string &out)
+    {
+        switch (codec)
+        {
+        case CompressionCodec::LZ4:
+            lz4Compress(reinterpret_cast<const uint8_t *>(data.data()), data.size(), out);
+            return true;
+#ifdef RPM_HAVE_ZLIB
+        case CompressionCodec::ZLIB:
+        {
+            uLongf length = compressBound(static_cast<uLong>(data.size()));
+            out.resize(length);
+            if (compress2(reinterpret_cast<Bytef *>(&out[0]), &length,
+                          reinterpret_cast<const Bytef *>(data.data()), static_cast<uLong>(data.size()),
+                          Z_BEST_SPEED) != Z_OK)
+            {
+                return false;
+            }
+            out.resize(length);
+            return true;
+        }
+#endif
+        default:
+            return false;
+        }
+    }
+
+    bool decompressBlock(CompressionCodec codec, std::string_view data, size_t uncompressed_size, std::string &out)
+    {
+        switch (codec)
+        {
+        case CompressionCodec::LZ4:
+            return lz4Decompress(reinterpret_cast<const uint8_t *>(data.data()), data.size(), uncompressed_size, out);
+#ifdef RPM_HAVE_ZLIB
+        case CompressionCodec::ZLIB:
+        {
+            out.resize(uncompressed_size);
+            uLongf length = static_cast<uLongf>(uncompressed_size);
+            if (uncompress(reinterpret_cast<Bytef *>(&out[0]), &length,
+                           reinterpret_cast<const Bytef *>(data.data()), static_cast<uLong>(data.size())) != Z_OK)
+            {
+                return false;
+            }
+            return length == uncompressed_size;
+        }
+#endif
+        default:
+            return false;
+        }
+    }
+
+    std::string compressResponse(const std::string &frame, CompressionCodec codec, size_t threshold)
+    {
+        if (codec == CompressionCodec::NONE || frame.size() < threshold)
+        {
+            return frame;
+        }
+
+        // Binary and CBOR frames keep their encoding byte; only the payload is compressed
+        const bool is_framed = !frame.empty() && static_cast<uint8_t>(frame[0]) == wire::FRAME_MAGIC;
+        std::string_view payload(frame);
+        if (is_framed)
+        {
+            payload.remove_prefix(std::min(frame.size(), wire::FRAME_HEADER_SIZE));
+        }
+        if (payload.size() > std::numeric_limits<uint32_t>::max())
+        {
+            return frame;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::string compressed;
+        bool ok = compressBlock(codec, payload, compressed);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        const size_t framed_size = wire::FRAME_HEADER_SIZE + 4 + compressed.size();
+        const bool worthwhile = ok && framed_size < frame.size();
+        ServerStats::getInstance().recordCompression(frame.size(), worthwhile ? framed_size : frame.size(),
+                                                     static_cast<uint64_t>(elapsed.count()), worthwhile);
+        if (!worthwhile)
+        {
+            return frame;
+        }
+
+        const uint32_t payload_size = static_cast<uint32_t>(4 + compressed.size());
+        const uint32_t original_size = static_cast<uint32_t>(payload.size());
+        std::string out;
+        out.reserve(framed_size);
+        out.push_back(static_cast<char>(wire::FRAME_MAGIC));
+        out.push_back(is_framed && frame.size() > 1 ? frame[1] : static_cast<char>(wire::ENCODING_JSON));
+        out.push_back(static_cast<char>(wire::FLAG_COMPRESSED));
+        out.push_back(static_cast<char>(codec));
+        for (int shift = 0; shift < 32; shift += 8)
+            out.push_back(static_cast<char>((payload_size >> shift) & 0xFF));
+        for (int shift = 0; shift < 32; shift += 8)
+            out.push_back(static_cast<char>((original_size >> shift) & 0xFF));
+        out.append(compressed);
+        return out;
+    }
+} // namespace qnx
@@ -0,0 +1,618 @@
+/**
+ * @file Handover.cpp
+ * @brief Implementation of zero-downtime restart for the QNX Remote Process Monitor
+ *
+ * Protocol on the handover socket, all integers in host byte order (both
+ * processes run on the same machine):
+ *
+ * 1. The successor sends a request: magic, version, flags.
+ * 2. The predecessor answers with: magic, version, status, descriptor
+ *    count and image size. Unless the status is HANDOVER_OK nothing follows.
+ * 3. The descriptors follow in messages of one byte carrying up to
+ *    FD_CHUNK descriptors each (SCM_RIGHTS): TCP listeners, the Unix
+ *    domain listener if any, then the client connections.
+ * 4. The state image follows (see writeImage()).
+ */
+
+#include "Handover.hpp"
+#include "ProcessHistory.hpp"
+#include "ProcessGroup.hpp"
+#include "Session.hpp"
+#include "Subscription.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace qnx
+{
+    namespace
+    {
+        constexpr uint32_t HANDOVER_MAGIC = 0x484d5052;      // "RPMH"
+        constexpr uint32_t FLAG_INCLUDE_CLIENTS = 1;         // Request flag: pass idle client connections too
+        constexpr size_t FD_CHUNK = 32;                      // Descriptors per SCM_RIGHTS message
+        constexpr uint64_t MAX_IMAGE_SIZE = 256 * 1024 * 1024; // Refuse anything larger
+        constexpr int IO_TIMEOUT_SECONDS = 10;               // Give up on a peer that stops talking
+
+        enum HandoverStatus : uint32_t
+        {
+            HANDOVER_OK = 0,
+            HANDOVER_VERSION_MISMATCH = 1,
+            HANDOVER_NOT_RUNNING = 2,
+        };
+
+        struct Request
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t flags;
+        };
+
+        struct Reply
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t status;
+            uint32_t fd_count;
+            uint64_t image_size;
+        };
+
+        // Appends fixed-width values and length-prefixed strings to a byte buffer
+        class ImageWriter
+        {
+        public:
+            template <typename T>
+            void put(T value)
+            {
+                buffer_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+            }
+
+            void putString(const std::string &value)
+            {
+                put<uint32_t>(static_cast<uint32_t>(value.size()));
+                buffer_.append(value);
+            }
+
+            const std::string &data() const { return buffer_; }
+
+        private:
+            std::string buffer_;
+        };
+
+        // Reads what ImageWriter wrote; once a read runs past the end or finds a bad value, ok() stays false
+        class ImageReader
+        {
+        public:
+            explicit ImageReader(const std::string &data) : data_(data) {}
+
+            template <typename T>
+            T get()
+            {
+                T value{};
+                if (!ok_ || data_.size() - offset_ < sizeof(value))
+                {
+                    ok_ = false;
+                    return value;
+                }
+                memcpy(&value, data_.data() + offset_, sizeof(value));
+                offset_ += sizeof(value);
+                return value;
+            }
+
+            std::string getString()
+            {
+                uint32_t size = get<uint32_t>();
+                if (!ok_ || data_.size() - offset_ < size)
+                {
+                    ok_ = false;
+                    return std::string();
+                }
+                std::string value = data_.substr(offset_, size);
+                offset_ += size;
+                return value;
+            }
+
+            // Read an enumerator stored in a byte; a byte past the last enumerator fails the image
+            template <typename E>
+            E getEnum(E last)
+            {
+                uint8_t value = get<uint8_t>();
+                if (ok_ && value > static_cast<uint8_t>(last))
+                    ok_ = false;
+                return ok_ ? static_cast<E>(value) : E{};
+            }
+
+            // Read a count of items that take at least min_size bytes each
+            uint32_t getCount(size_t min_size)
+            {
+                uint32_t count = get<uint32_t>();
+                if (ok_ && count > (data_.size() - offset_) / min_size)
+                    ok_ = false;
+                return ok_ ? count : 0;
+            }
+
+            bool ok() const { return ok_; }
+
+        private:
+            const std::string &data_;
+            size_t offset_ = 0;
+            bool ok_ = true;
+        };
+
+        bool readAll(int fd, void *data, size_t size)
+        {
+            char *out = static_cast<char *>(data);
+            while (size > 0)
+            {
+                ssize_t n = read(fd, out, size);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return false;
+                out += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool writeAll(int fd, const void *data, size_t size)
+        {
+            const char *in = static_cast<const char *>(data);
+            while (size > 0)
+            {
+                ssize_t n = write(fd, in, size);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return false;
+                in += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool sendDescriptors(int fd, const std::vector<int> &descriptors)
+        {
+            for (size_t start = 0; start < descriptors.size(); start += FD_CHUNK)
+            {
+                const size_t count = std::min(FD_CHUNK, descriptors.size() - start);
+                char byte = 0;
+                struct iovec iov = {&byte, 1};
+                char control[CMSG_SPACE(sizeof(int) * FD_CHUNK)];
+                memset(control, 0, sizeof(control));
+
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = &iov;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+                struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+                header->cmsg_level = SOL_SOCKET;
+                header->cmsg_type = SCM_RIGHTS;
+                header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+                memcpy(CMSG_DATA(header), descriptors.data() + start, sizeof(int) * count);
+
+                ssize_t n;
+                do
+                {
+                    n = sendmsg(fd, &message, 0);
+                } while (n < 0 && errno == EINTR);
+                if (n != 1)
+                    return false;
+            }
+            return true;
+        }
+
+        bool receiveDescriptors(int fd, size_t expected, std::vector<int> &descriptors)
+        {
+            while (descriptors.size() < expected)
+            {
+                char byte = 0;
+                struct iovec iov = {&byte, 1};
+                char control[CMSG_SPACE(sizeof(int) * FD_CHUNK)];
+
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = &iov;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+
+                ssize_t n;
+                do
+                {
+                    n = recvmsg(fd, &message, 0);
+                } while (n < 0 && errno == EINTR);
+                if (n != 1 || (message.msg_flags & MSG_CTRUNC))
+                    return false;
+
+                for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+                {
+                    if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+                        continue;
+                    const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        int received;
+                        memcpy(&received, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                        descriptors.push_back(received);
+                    }
+                }
+            }
+            return descriptors.size() == expected;
+        }
+
+        void setTimeouts(int fd)
+        {
+            struct timeval timeout = {IO_TIMEOUT_SECONDS, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        }
+
+        void closeAll(const std::vector<int> &descriptors)
+        {
+            for (int fd : descriptors)
+                close(fd);
+        }
+
+        void logError(const char *what)
+        {
+            std::error_code ec(errno, std::system_category());
+            std::cerr << "Handover: " << what << ": " << ec.message() << std::endl;
+        }
+
+        /**
+         * Image layout: listener description, then per client connection its
+         * session and subscriptions, then the process history and groups.
+         * Clients are written under their descriptor in this process and
+         * identified by position in the successor.
+         */
+        std::string writeImage(const ListenerSockets &listeners, const std::vector<int> &clients)
+        {
+            ImageWriter image;
+            image.put<uint32_t>(static_cast<uint32_t>(listeners.tcp.size()));
+            image.put<uint8_t>(listeners.unix_fd != -1 ? 1 : 0);
+            image.putString(listeners.unix_path);
+
+            image.put<uint32_t>(static_cast<uint32_t>(clients.size()));
+            for (int client_socket : clients)
+            {
+                const ClientSession session = SessionManager::getInstance().get(client_socket);
+                image.put<uint8_t>(static_cast<uint8_t>(session.format));
+                image.put<uint8_t>(static_cast<uint8_t>(session.compression));
+                image.put<uint64_t>(session.compression_threshold);
+                image.putString(session.user);
+
+                const std::vector<Subscription> subscriptions = SubscriptionManager::getInstance().getSubscriptions(client_socket);
+                image.put<uint32_t>(static_cast<uint32_t>(subscriptions.size()));
+                for (const auto &subscription : subscriptions)
+                {
+                    image.put<int32_t>(subscription.id);
+                    image.put<uint8_t>(static_cast<uint8_t>(subscription.query.kind));
+                    image.put<uint64_t>(subscription.query.top_k);
+                    image.put<int32_t>(subscription.query.group_id);
+                    image.put<uint32_t>(static_cast<uint32_t>(subscription.query.pids.size()));
+                    for (pid_t pid : subscription.query.pids)
+                        image.put<int32_t>(pid);
+                    image.put<int64_t>(subscription.interval.count());
+                }
+            }
+
+            const auto history = ProcessHistory::getInstance().getAllHistory();
+            image.put<uint32_t>(static_cast<uint32_t>(history.size()));
+            for (const auto &process : history)
+            {
+                image.put<int32_t>(process.first);
+                image.put<uint32_t>(static_cast<uint32_t>(process.second.size()));
+                for (const auto &entry : process.second)
+                {
+                    image.put<double>(entry.cpu_usage);
+                    image.put<int64_t>(entry.memory_usage);
+                    image.put<int64_t>(entry.timestamp);
+                }
+            }
+
+            const std::vector<Group> groups = ProcessGroup::getInstance().getGroups();
+            image.put<uint32_t>(static_cast<uint32_t>(groups.size()));
+            for (const auto &group : groups)
+            {
+                image.put<int32_t>(group.id);
+                image.putString(group.name);
+                image.put<int32_t>(group.priority);
+                image.putString(group.description);
+                image.put<uint32_t>(static_cast<uint32_t>(group.processes.size()));
+                for (pid_t pid : group.processes)
+                    image.put<int32_t>(pid);
+                image.put<double>(group.total_cpu_usage);
+                image.put<int64_t>(group.total_memory_usage);
+            }
+            return image.data();
+        }
+
+        struct ClientState
+        {
+            ClientSession session;
+            std::vector<Subscription> subscriptions;
+        };
+
+        // Decode the image into its parts without applying anything, so a bad image changes nothing
+        bool readImage(const std::string &data, size_t &tcp_count, bool &has_unix, std::string &unix_path,
+                       std::vector<ClientState> &clients, std::map<pid_t, std::vector<ProcessHistoryEntry>> &history,
+                       std::vector<Group> &groups)
+        {
+            ImageReader image(data);
+            tcp_count = image.get<uint32_t>();
+            has_unix = image.get<uint8_t>() != 0;
+            unix_path = image.getString();
+
+            clients.resize(image.getCount(14));
+            for (auto &client : clients)
+            {
+                client.session.format = image.getEnum(WireFormat::CBOR);
+                client.session.compression = image.getEnum(CompressionCodec::ZLIB);
+                client.session.compression_threshold = static_cast<size_t>(image.get<uint64_t>());
+                client.session.user = image.getString();
+
+                client.subscriptions.resize(image.getCount(29));
+                for (auto &subscription : client.subscriptions)
+                {
+                    subscription.id = image.get<int32_t>();
+                    subscription.query.kind = image.getEnum(ProcessQuery::Kind::GROUP);
+                    subscription.query.top_k = static_cast<size_t>(image.get<uint64_t>());
+                    subscription.query.group_id = image.get<int32_t>();
+                    subscription.query.pids.resize(image.getCount(sizeof(int32_t)));
+                    for (pid_t &pid : subscription.query.pids)
+                        pid = image.get<int32_t>();
+                    subscription.interval = std::chrono::milliseconds(image.get<int64_t>());
+                }
+            }
+
+            uint32_t processes = image.getCount(8);
+            for (uint32_t i = 0; i < processes && image.ok(); ++i)
+            {
+                auto &entries = history[image.get<int32_t>()];
+                entries.resize(image.getCount(24));
+                for (auto &entry : entries)
+                {
+                    entry.cpu_usage = image.get<double>();
+                    entry.memory_usage = static_cast<long>(image.get<int64_t>());
+                    entry.timestamp = static_cast<time_t>(image.get<int64_t>());
+                }
+            }
+
+            groups.resize(image.getCount(32));
+            for (auto &group : groups)
+            {
+                group.id = image.get<int32_t>();
+                group.name = image.getString();
+                group.priority = image.get<int32_t>();
+                group.description = image.getString();
+                uint32_t members = image.getCount(sizeof(int32_t));
+                for (uint32_t i = 0; i < members; ++i)
+                    group.processes.insert(image.get<int32_t>());
+                group.total_cpu_usage = image.get<double>();
+                group.total_memory_usage = static_cast<long>(image.get<int64_t>());
+            }
+            return image.ok();
+        }
+    }
+
+    int openHandoverSocket(const std::string &path)
+    {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "Handover socket path is too long: " << path << std::endl;
+            return -1;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        // Only ever remove a stale socket, never a regular file that happens to be there
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0)
+        {
+            if (!S_ISSOCK(st.st_mode))
+            {
+                std::cerr << "Refusing to replace " << path << ": not a socket" << std::endl;
+                return -1;
+            }
+            unlink(path.c_str());
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+        {
+            logError("failed to create socket");
+            return -1;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || chmod(path.c_str(), 0600) < 0 ||
+            listen(fd, 1) < 0 || flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        {
+            logError(("failed to listen on " + path).c_str());
+            close(fd);
+            unlink(path.c_str());
+            return -1;
+        }
+        return fd;
+    }
+
+    bool serveHandover(int listen_fd, const std::string &path, std::chrono::milliseconds wait)
+    {
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(wait.count())) <= 0)
+        {
+            return false;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return false;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags != -1)
+            fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+        setTimeouts(fd);
+
+        Request request;
+        if (!readAll(fd, &request, sizeof(request)) || request.magic != HANDOVER_MAGIC)
+        {
+            std::cerr << "Handover: ignoring an invalid request" << std::endl;
+            close(fd);
+            return false;
+        }
+
+        Reply reply = {HANDOVER_MAGIC, HANDOVER_VERSION, HANDOVER_OK, 0, 0};
+        ListenerSockets listeners;
+        std::vector<int> clients;
+        if (request.version != HANDOVER_VERSION)
+        {
+            std::cerr << "Handover: successor speaks version " << request.version << ", not " << HANDOVER_VERSION
+                      << "; still serving" << std::endl;
+            reply.status = HANDOVER_VERSION_MISMATCH;
+        }
+        else if (!SocketServer::getInstance().handOver(listeners, clients, (request.flags & FLAG_INCLUDE_CLIENTS) != 0))
+        {
+            reply.status = HANDOVER_NOT_RUNNING;
+        }
+        if (reply.status != HANDOVER_OK)
+        {
+            writeAll(fd, &reply, sizeof(reply));
+            close(fd);
+            return false;
+        }
+
+        // From here on the successor owns the sockets, even if sending fails
+        unlink(path.c_str());
+
+        std::vector<int> descriptors = listeners.tcp;
+        if (listeners.unix_fd != -1)
+            descriptors.push_back(listeners.unix_fd);
+        descriptors.insert(descriptors.end(), clients.begin(), clients.end());
+        const std::string image = writeImage(listeners, clients);
+
+        reply.fd_count = static_cast<uint32_t>(descriptors.size());
+        reply.image_size = image.size();
+        if (!writeAll(fd, &reply, sizeof(reply)) || !sendDescriptors(fd, descriptors) ||
+            !writeAll(fd, image.data(), image.size()))
+        {
+            logError("failed to send the server state; its connections are lost");
+        }
+        else
+        {
+            std::cout << "Handed over to the new server process (" << image.size() << " bytes of state)" << std::endl;
+        }
+        closeAll(descriptors);
+        close(fd);
+        return true;
+    }
+
+    bool takeOverServer(const std::string &path, bool include_clients, ListenerSockets &listeners, std::vector<int> &clients)
+    {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+        {
+            return false;
+        }
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            // No server running (or a stale socket): start normally
+            close(fd);
+            return false;
+        }
+        setTimeouts(fd);
+
+        Request request = {HANDOVER_MAGIC, HANDOVER_VERSION, include_clients ? FLAG_INCLUDE_CLIENTS : 0};
+        Reply reply;
+        if (!writeAll(fd, &request, sizeof(request)) || !readAll(fd, &reply, sizeof(reply)) || reply.magic != HANDOVER_MAGIC)
+        {
+            logError("no valid answer from the running server");
+            close(fd);
+            return false;
+        }
+        if (reply.status != HANDOVER_OK)
+        {
+            std::cerr << "Handover: the running server refused (" << (reply.status == HANDOVER_VERSION_MISMATCH ? "version mismatch" : "not running")
+                      << ")" << std::endl;
+            close(fd);
+            return false;
+        }
+
+        std::vector<int> descriptors;
+        std::string data;
+        bool received = reply.image_size <= MAX_IMAGE_SIZE && receiveDescriptors(fd, reply.fd_count, descriptors);
+        if (received)
+        {
+            data.resize(static_cast<size_t>(reply.image_size));
+            received = readAll(fd, &data[0], data.size());
+        }
+        close(fd);
+
+        size_t tcp_count = 0;
+        bool has_unix = false;
+        std::string unix_path;
+        std::vector<ClientState> states;
+        std::map<pid_t, std::vector<ProcessHistoryEntry>> history;
+        std::vector<Group> groups;
+        if (!received || !readImage(data, tcp_count, has_unix, unix_path, states, history, groups) ||
+            tcp_count + (has_unix ? 1 : 0) + states.size() != descriptors.size())
+        {
+            std::cerr << "Handover: incomplete or invalid state from the running server" << std::endl;
+            closeAll(descriptors);
+            return false;
+        }
+
+        // Descriptors arrive in image order: TCP listeners, Unix listener, clients
+        listeners.tcp.assign(descriptors.begin(), descriptors.begin() + tcp_count);
+        listeners.unix_fd = has_unix ? descriptors[tcp_count] : -1;
+        listeners.unix_path = unix_path;
+
+        auto &sessions = SessionManager::getInstance();
+        const size_t first_client = tcp_count + (has_unix ? 1 : 0);
+        for (size_t i = 0; i < states.size(); ++i)
+        {
+            const int client_socket = descriptors[first_client + i];
+            const ClientState &state = states[i];
+            sessions.setFormat(client_socket, state.session.format);
+            sessions.setCompression(client_socket, state.session.compression, state.session.compression_threshold);
+            if (!state.session.user.empty())
+                sessions.setUser(client_socket, state.session.user);
+            for (Subscription subscription : state.subscriptions)
+            {
+                subscription.client_socket = client_socket;
+                subscription.connection_id = 0; // Bound once the server has adopted the socket
+                SubscriptionManager::getInstance().restore(subscription);
+            }
+            clients.push_back(client_socket);
+        }
+
+        ProcessHistory::getInstance().restoreHistory(history);
+        ProcessGroup::getInstance().restoreGroups(groups);
+
+        std::cout << "Took over " << descriptors.size() - states.size() << " listening sockets, " << states.size()
+                  << " connections and the history of " << history.size() << " processes" << std::endl;
+        return true;
+    }
+} // namespace qnx
@@ -0,0 +1,223 @@
+/**
+ * @file IoUring.cpp
+ * @brief Implementation of the minimal io_uring wrapper for QNX Remote Process Monitor
+ *
+ * Ring setup follows the layout documented in io_uring_setup(2): one shared
+ * mapping for the submission and completion rings (IORING_FEAT_SINGLE_MMAP)
+ * and one for the submission queue entries. Ring indices are published with
+ * release stores and read with acquire loads, as the kernel expects.
+ */
+
+#include "IoUring.hpp"
+
+#ifdef RPM_HAVE_IO_URING
+
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace qnx
+{
+    namespace
+    {
+        int ioUringSetup(unsigned entries, io_uring_params *params)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+        }
+
+        int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned nr_args)
+        {
+            return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        }
+
+        // Kernel timespec layout expected by io_uring_getevents_arg::ts
+        struct KernelTimespec
+        {
+            int64_t tv_sec;
+            long long tv_nsec;
+        };
+    }
+
+    IoUring::~IoUring()
+    {
+        if (buf_ring_)
+            munmap(buf_ring_, buf_ring_size_);
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (ring_)
+            munmap(ring_, ring_size_);
+        if (ring_fd_ != -1)
+            close(ring_fd_);
+    }
+
+    bool IoUring::init(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd_ = ioUringSetup(entries, &params);
+        if (ring_fd_ < 0)
+        {
+            ring_fd_ = -1;
+            return false;
+        }
+
+        // Timed waits need EXT_ARG (5.11); a single ring mapping needs SINGLE_MMAP (5.4)
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG))
+        {
+            return false;
+        }
+
+        size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+        void *ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                          IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED)
+        {
+            return false;
+        }
+        ring_ = ring;
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        char *base = static_cast<char *>(ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_local_tail_ = *sq_tail_;
+
+        // Submission entries are used in ring order, so the index array is the identity
+        unsigned *array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i)
+        {
+            array[i] = i;
+        }
+
+        cq_head_ = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+        return true;
+    }
+
+    bool IoUring::setupBufferRing(uint16_t group, unsigned count, unsigned size)
+    {
+        if (count == 0 || (count & (count - 1)) != 0 || count > 32768)
+        {
+            return false;
+        }
+
+        buf_ring_size_ = count * sizeof(io_uring_buf);
+        void *memory = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            return false;
+        }
+        buf_ring_ = static_cast<io_uring_buf_ring *>(memory);
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (ioUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            munmap(buf_ring_, buf_ring_size_);
+            buf_ring_ = nullptr;
+            return false;
+        }
+
+        buf_count_ = count;
+        buffer_size_ = size;
+        buffers_.resize(static_cast<size_t>(count) * size);
+        buf_local_tail_ = 0;
+        for (unsigned id = 0; id < count; ++id)
+        {
+            recycleBuffer(static_cast<uint16_t>(id));
+        }
+        return true;
+    }
+
+    io_uring_sqe *IoUring::getSqe()
+    {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sq_local_tail_ - head >= sq_entries_)
+        {
+            return nullptr;
+        }
+        io_uring_sqe *sqe = &sqes_[sq_local_tail_ & sq_mask_];
+        ++sq_local_tail_;
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    unsigned IoUring::publishSubmissions()
+    {
+        __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+        return sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    int IoUring::submit()
+    {
+        unsigned to_submit = publishSubmissions();
+        if (to_submit == 0)
+        {
+            return 0;
+        }
+        int ret = ioUringEnter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+        return ret < 0 ? -errno : ret;
+    }
+
+    int IoUring::submitAndWait(int timeout_ms)
+    {
+        unsigned to_submit = publishSubmissions();
+
+        KernelTimespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+        int ret = ioUringEnter(ring_fd_, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                               sizeof(arg));
+        if (ret < 0)
+        {
+            // A timeout or signal just means there is nothing to process yet
+            return (errno == ETIME || errno == EINTR) ? 0 : -errno;
+        }
+        return ret;
+    }
+
+    void IoUring::recycleBuffer(uint16_t id)
+    {
+        // Index from the ring base rather than through io_uring_buf_ring::bufs:
+        // compiled as C++, the header's flexible-array wrapper puts bufs at
+        // offset 8 instead of overlaying the tail, which shifts every slot
+        io_uring_buf *slots = reinterpret_cast<io_uring_buf *>(buf_ring_);
+        io_uring_buf &slot = slots[buf_local_tail_ & (buf_count_ - 1)];
+        slot.addr = reinterpret_cast<uint64_t>(buffers_.data() + static_cast<size_t>(id) * buffer_size_);
+        slot.len = buffer_size_;
+        slot.bid = id;
+        ++buf_local_tail_;
+        __atomic_store_n(&buf_ring_->tail, buf_local_tail_, __ATOMIC_RELEASE);
+    }
+} // namespace qnx
+
+#endif // RPM_HAVE_IO_URING
@@ -0,0 +1,841 @@
+/**
+ * @file JsonCodec.cpp
+ * @brief Implementation of the in-tree JSON decoder and encoder
+ *
+ * The decoder copies the input into a buffer followed by NUL padding, so the
+ * tokenizer can read ahead in 16-byte blocks and stops at the terminating
+ * NUL without bounds checks. Containers record the index of the token
+ * following them, which lets member lookups skip nested values in one step.
+ */
+
+#include "JsonCodec.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace qnx
+{
+    namespace
+    {
+        constexpr size_t PADDING = 16;     // Readable bytes after the input, at least one SIMD block
+        constexpr size_t MAX_NESTING = 64; // Encoder nesting, one bit of the array mask per level
+
+        inline char *skipWhitespace(char *p)
+        {
+            while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+                ++p;
+            return p;
+        }
+
+        // Find the first quote, backslash or control character at or after p.
+        // The terminating NUL is a control character, so the scan always stops.
+        inline char *scanString(char *p)
+        {
+#if defined(__SSE2__)
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            for (;; p += 16)
+            {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                                  _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+                const int mask = _mm_movemask_epi8(hits);
+                if (mask != 0)
+                    return p + __builtin_ctz(static_cast<unsigned>(mask));
+            }
+#elif defined(__ARM_NEON)
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t backslash = vdupq_n_u8('\\');
+            const uint8x16_t control = vdupq_n_u8(0x1F);
+            for (;; p += 16)
+            {
+                const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+                const uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)),
+                                                 vcleq_u8(chunk, control));
+                // Narrow to four bits per byte so the mask fits in 64 bits
+                const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+                if (mask != 0)
+                    return p + (__builtin_ctzll(mask) >> 2);
+            }
+#else
+            while (*p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+                ++p;
+            return p;
+#endif
+        }
+
+        inline int hexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+        // Read the four hex digits of a \u escape; -1 if they are not hex
+        inline long readHex4(const char *p)
+        {
+            long value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                const int digit = hexValue(p[i]);
+                if (digit < 0)
+                    return -1;
+                value = value << 4 | digit;
+            }
+            return value;
+        }
+
+        inline char *appendUtf8(char *out, unsigned long code_point)
+        {
+            if (code_point < 0x80)
+            {
+                *out++ = static_cast<char>(code_point);
+            }
+            else if (code_point < 0x800)
+            {
+                *out++ = static_cast<char>(0xC0 | code_point >> 6);
+                *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else if (code_point < 0x10000)
+            {
+                *out++ = static_cast<char>(0xE0 | code_point >> 12);
+                *out++ = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+                *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else
+            {
+                *out++ = static_cast<char>(0xF0 | code_point >> 18);
+                *out++ = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+                *out++ = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+                *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            return out;
+        }
+
+        inline bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+    }
+
+    namespace
+    {
+        const char DIGIT_PAIRS[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        const uint64_t POWERS_OF_10[] = {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+            1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+            100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+            1000000000000000000ULL, 10000000000000000000ULL};
+
+        // Number of decimal digits, from the position of the highest set bit:
+        // log10(x) is about log2(x) * 1233 / 4096, corrected by one comparison.
+        // Powers of ten above 1 are even, so or-ing in the low bit changes
+        // nothing but lets 0 count as one digit.
+        inline unsigned decimalDigits(uint64_t value)
+        {
+            const uint64_t v = value | 1;
+            const unsigned log2 = 63 - static_cast<unsigned>(__builtin_clzll(v));
+            const unsigned log10 = ((log2 + 1) * 1233) >> 12;
+            return log10 + 1 - (v < POWERS_OF_10[log10]);
+        }
+    }
+
+    char *formatInteger(char *out, long long value)
+    {
+        uint64_t magnitude = static_cast<uint64_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';
+            magnitude = 0 - magnitude;
+        }
+
+        char *const end = out + decimalDigits(magnitude);
+        char *p = end;
+        while (magnitude >= 100)
+        {
+            const size_t pair = static_cast<size_t>(magnitude % 100) * 2;
+            magnitude /= 100;
+            p -= 2;
+            std::memcpy(p, DIGIT_PAIRS + pair, 2);
+        }
+        if (magnitude >= 10)
+            std::memcpy(p - 2, DIGIT_PAIRS + magnitude * 2, 2);
+        else
+            p[-1] = static_cast<char>('0' + magnitude);
+        return end;
+    }
+
+    char *formatDouble(char *out, double value)
+    {
+#if defined(__cpp_lib_to_chars)
+        return std::to_chars(out, out + MAX_NUMBER_LENGTH, value).ptr;
+#else
+        int length = snprintf(out, MAX_NUMBER_LENGTH, "%.15g", value);
+        if (std::strtod(out, nullptr) != value)
+            length = snprintf(out, MAX_NUMBER_LENGTH, "%.17g", value);
+        return out + length;
+#endif
+    }
+
+    void appendJsonString(std::string &out, std::string_view value)
+    {
+        static const char HEX[] = "0123456789abcdef";
+        out.push_back('"');
+        size_t run = 0; // Start of the characters not yet copied
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            const unsigned char c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out.append(value.data() + run, i - run);
+            run = i + 1;
+            switch (c)
+            {
+            case '"':
+                out.append("\\\"", 2);
+                break;
+            case '\\':
+                out.append("\\\\", 2);
+                break;
+            case '\n':
+                out.append("\\n", 2);
+                break;
+            case '\r':
+                out.append("\\r", 2);
+                break;
+            case '\t':
+                out.append("\\t", 2);
+                break;
+            default:
+            {
+                const char escaped[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+            }
+        }
+        out.append(value.data() + run, value.size() - run);
+        out.push_back('"');
+    }
+
+    // ---------------------------------------------------------------------
+    // JsonDecoder
+    // ---------------------------------------------------------------------
+
+    bool JsonDecoder::parse(std::string_view text)
+    {
+        tokens_.clear();
+        depth_ = 0;
+        error_ = nullptr;
+        error_offset_ = 0;
+        length_ = text.size();
+        if (text.size() > std::numeric_limits<uint32_t>::max() - PADDING)
+        {
+            buffer_.clear();
+            error_ = "Document too large";
+            return false;
+        }
+
+        // Capacity is kept from earlier documents, so this only allocates to grow
+        buffer_.assign(text.data(), text.size());
+        buffer_.append(PADDING, '\0');
+
+        char *p = &buffer_[0];
+        if (!parseValue(p, 0))
+            return false;
+        p = skipWhitespace(p);
+        if (p != buffer_.data() + length_)
+            return fail("Unexpected data after the value", p);
+        return true;
+    }
+
+    const char *JsonDecoder::parseError(size_t *offset) const
+    {
+        if (offset)
+            *offset = error_offset_;
+        return error_;
+    }
+
+    bool JsonDecoder::fail(const char *message, const char *at)
+    {
+        error_offset_ = static_cast<size_t>(at - buffer_.data());
+        error_ = error_offset_ >= length_ ? "Unexpected end of input" : message;
+        tokens_.clear();
+        return false;
+    }
+
+    bool JsonDecoder::parseValue(char *&p, size_t depth)
+    {
+        p = skipWhitespace(p);
+        const uint32_t offset = static_cast<uint32_t>(p - buffer_.data());
+        switch (*p)
+        {
+        case '{':
+        case '[':
+        {
+            if (depth == MAX_DEPTH)
+                return fail("Nesting too deep", p);
+            const bool object = *p == '{';
+            const char close = object ? '}' : ']';
+            const size_t index = tokens_.size();
+            tokens_.push_back({object ? TokenType::OBJECT : TokenType::ARRAY, false, offset, 0, 0});
+
+            uint32_t count = 0;
+            p = skipWhitespace(p + 1);
+            if (*p == close)
+            {
+                ++p;
+            }
+            else
+            {
+                for (;;)
+                {
+                    if (object)
+                    {
+                        if (*p != '"')
+                            return fail("Expected a member name", p);
+                        const size_t key = tokens_.size();
+                        tokens_.push_back({TokenType::STRING, false, 0, 0, static_cast<uint32_t>(key + 1)});
+                        if (!parseString(p, tokens_[key].start, tokens_[key].size))
+                            return false;
+                        p = skipWhitespace(p);
+                        if (*p != ':')
+                            return fail("Expected ':' after a member name", p);
+                        ++p;
+                    }
+                    if (!parseValue(p, depth + 1))
+                        return false;
+                    ++count;
+
+                    p = skipWhitespace(p);
+                    if (*p == ',')
+                    {
+                        p = skipWhitespace(p + 1);
+                        continue;
+                    }
+                    if (*p == close)
+                    {
+                        ++p;
+                        break;
+                    }
+                    return fail(object ? "Expected ',' or '}'" : "Expected ',' or ']'", p);
+                }
+            }
+            tokens_[index].size = count;
+            tokens_[index].next = static_cast<uint32_t>(tokens_.size());
+            return true;
+        }
+        case '"':
+        {
+            const size_t index = tokens_.size();
+            tokens_.push_back({TokenType::STRING, false, 0, 0, static_cast<uint32_t>(index + 1)});
+            return parseString(p, tokens_[index].start, tokens_[index].size);
+        }
+        case 't':
+            return parseLiteral(p, "true", 4, TokenType::TRUE_VALUE);
+        case 'f':
+            return parseLiteral(p, "false", 5, TokenType::FALSE_VALUE);
+        case 'n':
+            return parseLiteral(p, "null", 4, TokenType::NULL_VALUE);
+        default:
+            if (*p == '-' || isDigit(*p))
+                return parseNumber(p);
+            return fail("Expected a value", p);
+        }
+    }
+
+    // Unescape the string at p in place: the result is never longer than the
+    // escaped text, so it can be written behind the read position
+    bool JsonDecoder::parseString(char *&p, uint32_t &start, uint32_t &length)
+    {
+        char *read = p + 1;
+        char *write = read;
+        start = static_cast<uint32_t>(read - buffer_.data());
+        for (;;)
+        {
+            char *stop = scanString(read);
+            if (write != read)
+                std::memmove(write, read, static_cast<size_t>(stop - read));
+            write += stop - read;
+            read = stop;
+
+            if (*read == '"')
+                break;
+            if (*read != '\\')
+                return fail("Control character in a string", read);
+
+            switch (read[1])
+            {
+            case '"':
+            case '\\':
+            case '/':
+                *write++ = read[1];
+                break;
+            case 'b':
+                *write++ = '\b';
+                break;
+            case 'f':
+                *write++ = '\f';
+                break;
+            case 'n':
+                *write++ = '\n';
+                break;
+            case 'r':
+                *write++ = '\r';
+                break;
+            case 't':
+                *write++ = '\t';
+                break;
+            case 'u':
+            {
+                long code_point = readHex4(read + 2);
+                if (code_point < 0)
+                    return fail("Invalid \\u escape", read);
+                if (code_point >= 0xD800 && code_point <= 0xDBFF)
+                {
+                    // High surrogate: must be followed by an escaped low surrogate
+                    const long low = read[6] == '\\' && read[7] == 'u' ? readHex4(read + 8) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return fail("Invalid surrogate pair", read);
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    read += 6;
+                }
+                else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+                {
+                    return fail("Invalid surrogate pair", read);
+                }
+                write = appendUtf8(write, static_cast<unsigned long>(code_point));
+                read += 4;
+                break;
+            }
+            default:
+                return fail("Invalid escape in a string", read);
+            }
+            read += 2;
+        }
+
+        length = static_cast<uint32_t>(write - (buffer_.data() + start));
+        p = read + 1;
+        *write = '\0';
+        return true;
+    }
+
+    bool JsonDecoder::parseNumber(char *&p)
+    {
+        char *begin = p;
+        bool integral = true;
+        if (*p == '-')
+            ++p;
+        if (*p == '0')
+            ++p;
+        else if (isDigit(*p))
+            while (isDigit(*p))
+                ++p;
+        else
+            return fail("Invalid number", p);
+
+        if (*p == '.')
+        {
+            integral = false;
+            if (!isDigit(*++p))
+                return fail("Invalid number", p);
+            while (isDigit(*p))
+                ++p;
+        }
+        if (*p == 'e' || *p == 'E')
+        {
+            integral = false;
+            ++p;
+            if (*p == '+' || *p == '-')
+                ++p;
+            if (!isDigit(*p))
+                return fail("Invalid number", p);
+            while (isDigit(*p))
+                ++p;
+        }
+
+        const size_t index = tokens_.size();
+        tokens_.push_back({TokenType::NUMBER, integral, static_cast<uint32_t>(begin - buffer_.data()),
+                           static_cast<uint32_t>(p - begin), static_cast<uint32_t>(index + 1)});
+        return true;
+    }
+
+    bool JsonDecoder::parseLiteral(char *&p, const char *literal, size_t length, TokenType type)
+    {
+        // The padding makes reading past a truncated literal safe
+        if (std::memcmp(p, literal, length) != 0)
+            return fail("Expected a value", p);
+        const size_t index = tokens_.size();
+        tokens_.push_back({type, false, static_cast<uint32_t>(p - buffer_.data()), 0, static_cast<uint32_t>(index + 1)});
+        p += length;
+        return true;
+    }
+
+    long JsonDecoder::find(const char *name)
+    {
+        if (tokens_.empty())
+            return -1;
+        if (depth_ == 0)
+            return name == nullptr ? 0 : -1;
+
+        const Frame &frame = frames_[depth_ - 1];
+        const Token &container = tokens_[frame.token];
+        if (container.type == TokenType::ARRAY)
+            return name == nullptr && frame.read < container.size ? static_cast<long>(frame.cursor) : -1;
+        if (name == nullptr)
+            return -1;
+
+        const size_t name_length = std::strlen(name);
+        uint32_t key = frame.token + 1;
+        for (uint32_t member = 0; member < container.size; ++member)
+        {
+            const Token &token = tokens_[key];
+            if (token.size == name_length && std::memcmp(buffer_.data() + token.start, name, name_length) == 0)
+                return static_cast<long>(key) + 1;
+            key = tokens_[key + 1].next;
+        }
+        return -1;
+    }
+
+    void JsonDecoder::consume(long index)
+    {
+        if (depth_ == 0)
+            return;
+        Frame &frame = frames_[depth_ - 1];
+        if (tokens_[frame.token].type == TokenType::ARRAY)
+        {
+            frame.cursor = tokens_[index].next;
+            ++frame.read;
+        }
+    }
+
+    bool JsonDecoder::push(const char *name, TokenType type)
+    {
+        const long index = find(name);
+        if (index < 0 || tokens_[index].type != type || depth_ == MAX_DEPTH)
+            return false;
+        consume(index);
+        frames_[depth_++] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index + 1), 0};
+        return true;
+    }
+
+    bool JsonDecoder::pushObject(const char *name)
+    {
+        return push(name, TokenType::OBJECT);
+    }
+
+    bool JsonDecoder::pushArray(const char *name)
+    {
+        return push(name, TokenType::ARRAY);
+    }
+
+    void JsonDecoder::pop()
+    {
+        if (depth_ > 0)
+            --depth_;
+    }
+
+    void JsonDecoder::popTo(size_t depth)
+    {
+        if (depth_ > depth)
+            depth_ = depth;
+    }
+
+    bool JsonDecoder::skip()
+    {
+        if (depth_ == 0 || tokens_[frames_[depth_ - 1].token].type != TokenType::ARRAY)
+            return false;
+        const long index = find(nullptr);
+        if (index < 0)
+            return false;
+        consume(index);
+        return true;
+    }
+
+    void JsonDecoder::copyFrom(const JsonDecoder &other)
+    {
+        buffer_ = other.buffer_;
+        tokens_ = other.tokens_;
+        length_ = other.length_;
+        std::copy(other.frames_, other.frames_ + other.depth_, frames_);
+        depth_ = other.depth_;
+        error_ = other.error_;
+        error_offset_ = other.error_offset_;
+    }
+
+    bool JsonDecoder::getString(const char *name, std::string_view &value)
+    {
+        const long index = find(name);
+        if (index < 0 || tokens_[index].type != TokenType::STRING)
+            return false;
+        value = std::string_view(buffer_.data() + tokens_[index].start, tokens_[index].size);
+        consume(index);
+        return true;
+    }
+
+    bool JsonDecoder::getString(const char *name, const char *&value)
+    {
+        std::string_view view;
+        if (!getString(name, view))
+            return false;
+        value = view.data(); // NUL-terminated in place
+        return true;
+    }
+
+    bool JsonDecoder::getInt64(const char *name, long long &value)
+    {
+        const long index = find(name);
+        if (index < 0 || tokens_[index].type != TokenType::NUMBER || !tokens_[index].integral)
+            return false;
+        const char *begin = buffer_.data() + tokens_[index].start;
+        long long parsed = 0;
+        const auto result = std::from_chars(begin, begin + tokens_[index].size, parsed);
+        if (result.ec != std::errc())
+            return false;
+        value = parsed;
+        consume(index);
+        return true;
+    }
+
+    bool JsonDecoder::getInt(const char *name, int &value)
+    {
+        const long index = find(name);
+        if (index < 0 || tokens_[index].type != TokenType::NUMBER || !tokens_[index].integral)
+            return false;
+        const char *begin = buffer_.data() + tokens_[index].start;
+        int parsed = 0;
+        const auto result = std::from_chars(begin, begin + tokens_[index].size, parsed);
+        if (result.ec != std::errc())
+            return false;
+        value = parsed;
+        consume(index);
+        return true;
+    }
+
+    bool JsonDecoder::getDouble(const char *name, double &value)
+    {
+        const long index = find(name);
+        if (index < 0 || tokens_[index].type != TokenType::NUMBER)
+            return false;
+        // The number is followed by a character strtod() does not accept
+        value = std::strtod(buffer_.data() + tokens_[index].start, nullptr);
+        consume(index);
+        return true;
+    }
+
+    bool JsonDecoder::getBool(const char *name, bool &value)
+    {
+        const long index = find(name);
+        if (index < 0 || (tokens_[index].type != TokenType::TRUE_VALUE && tokens_[index].type != TokenType::FALSE_VALUE))
+            return false;
+        value = tokens_[index].type == TokenType::TRUE_VALUE;
+        consume(index);
+        return true;
+    }
+
+    // ---------------------------------------------------------------------
+    // JsonEncoder
+    // ---------------------------------------------------------------------
+
+    void JsonEncoder::reset()
+    {
+        buffer_.clear();
+        taken_ = 0;
+        depth_ = 0;
+        arrays_ = 0;
+        need_comma_ = false;
+        error_ = false;
+    }
+
+    void JsonEncoder::beginValue(const char *name)
+    {
+        const bool in_object = depth_ > 0 && !(arrays_ >> (depth_ - 1) & 1);
+        if (in_object != (name != nullptr) || (depth_ == 0 && size() != 0))
+            error_ = true;
+        if (need_comma_)
+            buffer_.push_back(',');
+        if (name)
+        {
+            appendJsonString(buffer_, name);
+            buffer_.push_back(':');
+        }
+        need_comma_ = true;
+    }
+
+    void JsonEncoder::beginMember(const FieldKey &key)
+    {
+        if (depth_ == 0 || (arrays_ >> (depth_ - 1) & 1))
+            error_ = true;
+        if (need_comma_)
+            buffer_.push_back(',');
+        buffer_.append(key.json);
+        need_comma_ = true;
+    }
+
+    void JsonEncoder::startObject(const char *name)
+    {
+        if (depth_ == MAX_NESTING)
+        {
+            error_ = true;
+            return;
+        }
+        beginValue(name);
+        buffer_.push_back('{');
+        arrays_ &= ~(uint64_t(1) << depth_);
+        ++depth_;
+        need_comma_ = false;
+    }
+
+    void JsonEncoder::endObject()
+    {
+        if (depth_ == 0 || (arrays_ >> (depth_ - 1) & 1))
+        {
+            error_ = true;
+            return;
+        }
+        --depth_;
+        buffer_.push_back('}');
+        need_comma_ = true;
+    }
+
+    void JsonEncoder::startArray(const char *name)
+    {
+        if (depth_ == MAX_NESTING)
+        {
+            error_ = true;
+            return;
+        }
+        beginValue(name);
+        buffer_.push_back('[');
+        arrays_ |= uint64_t(1) << depth_;
+        ++depth_;
+        need_comma_ = false;
+    }
+
+    void JsonEncoder::endArray()
+    {
+        if (depth_ == 0 || !(arrays_ >> (depth_ - 1) & 1))
+        {
+            error_ = true;
+            return;
+        }
+        --depth_;
+        buffer_.push_back(']');
+        need_comma_ = true;
+    }
+
+    void JsonEncoder::addString(const char *name, std::string_view value)
+    {
+        beginValue(name);
+        appendJsonString(buffer_, value);
+    }
+
+    void JsonEncoder::addInt(const char *name, long long value)
+    {
+        beginValue(name);
+        char digits[MAX_NUMBER_LENGTH];
+        buffer_.append(digits, static_cast<size_t>(formatInteger(digits, value) - digits));
+    }
+
+    void JsonEncoder::addDouble(const char *name, double value)
+    {
+        beginValue(name);
+        appendDouble(value);
+    }
+
+    void JsonEncoder::addInt(const FieldKey &key, long long value)
+    {
+        beginMember(key);
+        char digits[MAX_NUMBER_LENGTH];
+        buffer_.append(digits, static_cast<size_t>(formatInteger(digits, value) - digits));
+    }
+
+    void JsonEncoder::addDouble(const FieldKey &key, double value)
+    {
+        beginMember(key);
+        appendDouble(value);
+    }
+
+    void JsonEncoder::addString(const FieldKey &key, std::string_view value)
+    {
+        beginMember(key);
+        appendJsonString(buffer_, value);
+    }
+
+    void JsonEncoder::appendDouble(double value)
+    {
+        if (!std::isfinite(value))
+        {
+            // JSON has no representation for NaN or infinity
+            buffer_.append("null", 4);
+            return;
+        }
+        char digits[MAX_NUMBER_LENGTH];
+        buffer_.append(digits, static_cast<size_t>(formatDouble(digits, value) - digits));
+    }
+
+    void JsonEncoder::addBool(const char *name, bool value)
+    {
+        beginValue(name);
+        if (value)
+            buffer_.append("true", 4);
+        else
+            buffer_.append("false", 5);
+    }
+
+    void JsonEncoder::addNull(const char *name)
+    {
+        beginValue(name);
+        buffer_.append("null", 4);
+    }
+
+    void JsonEncoder::addRaw(const char *name, std::string_view json)
+    {
+        beginValue(name);
+        buffer_.append(json.data(), json.size());
+    }
+
+    std::string JsonEncoder::take()
+    {
+        std::string document;
+        if (valid())
+            document.swap(buffer_);
+        reset();
+        return document;
+    }
+
+    std::string JsonEncoder::takeChunk()
+    {
+        std::string chunk;
+        chunk.swap(buffer_);
+        taken_ += chunk.size();
+        buffer_.reserve(chunk.capacity());
+        return chunk;
+    }
+
+    void JsonEncoder::returnChunk(std::string &&chunk)
+    {
+        taken_ -= chunk.size();
+        chunk.append(buffer_);
+        buffer_.swap(chunk);
+    }
+} // namespace qnx
@@ -3,203 +3,1104 @@
 #include "ProcessGroup.hpp"
 #include "ProcessHistory.hpp"
 #include "Authenticator.hpp"
+#include "ProcessQuery.hpp"
+#include "Subscription.hpp"
+#include "Session.hpp"
+#include "ServerStats.hpp"
+#include "Compression.hpp"
+#include "AdmissionControl.hpp"
+#include "RequestCoalescer.hpp"
+#include "ResponseCache.hpp"
+#include "FieldSchema.hpp"
+#include "RequestArena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
-#include <sys/json.h>       // QNX native JSON library
+#include "JsonCodec.hpp"
 #include "SocketServer.hpp" // Include for message type constants
-#include <functional>
 #include <map>
+#include <optional>
+#include <string_view>
 
 namespace qnx
 {
-    using CommandHandler = std::function<void(json_decoder_t *, json_encoder_t *)>;
+    using CommandHandler = void (*)(int, JsonDecoder &, ResponseWriter &, const CancellationToken &);
 
-    // Global map of command handlers
-    static const std::map<std::string, CommandHandler> commandHandlers = {
-        {"get_processes", [](json_decoder_t *decoder, json_encoder_t *encoder)
+    struct CommandEntry
+    {
+        std::string_view name;
+        RequestClass lane; ///< Worker queue; commands that act on processes must not wait behind listings
+        bool expensive;    ///< Reads the process table or procfs: costs more tokens and takes a concurrency slot
+        CommandHandler handler;
+    };
+
+    // Requests a batch may carry
+    static constexpr size_t MAX_BATCH_SIZE = 256;
+
+    // Worker threads that may help a parallel batch along, besides the one running it
+    static constexpr size_t MAX_BATCH_HELPERS = 3;
+
+    // Response sent when the writer could not encode one
+    static constexpr const char *ENCODER_ERROR = "{\"status\":\"error\",\"message\":\"Encoder error\"}";
+
+    // Append an integer in decimal to a request-scoped string
+    static void appendInteger(ArenaString &out, long long value)
+    {
+        char digits[MAX_NUMBER_LENGTH];
+        out.append(digits, formatInteger(digits, value));
+    }
+
+    // Process list shared by the entries of a batch, taken when the first one needs it
+    struct BatchSnapshot
+    {
+        std::once_flag taken;
+        std::vector<ProcessInfo> processes;
+    };
+
+    // The batch whose entries the calling thread is running, if any
+    static thread_local BatchSnapshot *batch_snapshot = nullptr;
+
+    // Makes a batch's snapshot the one its entries use on the calling thread
+    class BatchScope
+    {
+    public:
+        explicit BatchScope(BatchSnapshot *snapshot) : previous_(batch_snapshot) { batch_snapshot = snapshot; }
+        ~BatchScope() { batch_snapshot = previous_; }
+        BatchScope(const BatchScope &) = delete;
+        BatchScope &operator=(const BatchScope &) = delete;
+
+    private:
+        BatchSnapshot *previous_;
+    };
+
+    // The collected process list: the batch's, or else a fresh copy in own
+    static const std::vector<ProcessInfo> &processSnapshot(std::vector<ProcessInfo> &own)
+    {
+        if (BatchSnapshot *batch = batch_snapshot)
+        {
+            std::call_once(batch->taken, [batch]()
+                           { batch->processes = ProcessCore::getInstance().getProcessListSnapshot(); });
+            return batch->processes;
+        }
+        own = ProcessCore::getInstance().getProcessListSnapshot();
+        return own;
+    }
+
+    static void encodeCommand(int client_socket, std::string_view command, JsonDecoder &request, ResponseWriter &writer,
+                              const CancellationToken &cancel, bool echo_id);
+    static void runBatch(int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel);
+
+    // Decode the optional topic parameters shared by get_processes and subscribe.
+    // Returns nullptr on success, otherwise a static error message.
+    static const char *decodeProcessQuery(JsonDecoder &decoder, ProcessQuery &query)
+    {
+        const char *topic = NULL;
+        if (decoder.getString("topic", topic))
+        {
+            if (!ProcessQuery::parseKind(topic, query.kind))
+                return "Invalid 'topic'";
+        }
+
+        int k = 0;
+        if (decoder.getInt("k", k))
+            query.top_k = k > 0 ? static_cast<size_t>(k) : 0;
+
+        int group_id = -1;
+        if (decoder.getInt("group_id", group_id))
+            query.group_id = group_id;
+
+        if (decoder.pushArray("pids"))
+        {
+            int pid = 0;
+            while (query.pids.size() <= ProcessQuery::MAX_PIDS &&
+                   decoder.getInt(NULL, pid))
+            {
+                query.pids.push_back(pid);
+            }
+            decoder.pop();
+        }
+
+        return query.normalize();
+    }
+
+    // Command table, indexed at compile time by the perfect hash below
+    static constexpr CommandEntry COMMANDS[] = {
+        {"get_processes", RequestClass::BULK, true, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
          {
-             json_encoder_add_string(encoder, "status", "success");
-             json_encoder_start_array(encoder, "pids");
-             json_encoder_end_array(encoder);
+             ProcessQuery query;
+             FieldMask fields = ALL_FIELDS;
+             const char *error = decodeProcessQuery(decoder, query);
+             if (!error)
+                 error = decodeFieldMask<ProcessInfoSchema>(decoder, fields);
+             if (error)
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", error);
+                 return;
+             }
+             writer.addString("status", "success");
+             writer.addString("topic", query.key().c_str());
+             std::vector<ProcessInfo> snapshot;
+             encodeProcessList(writer, "processes", query.select(processSnapshot(snapshot)), fields);
+         }},
+        {"subscribe", RequestClass::POINT, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             ProcessQuery query;
+             if (const char *error = decodeProcessQuery(decoder, query))
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", error);
+                 return;
+             }
+             int interval_ms = static_cast<int>(SubscriptionManager::MIN_INTERVAL.count());
+             decoder.getInt("interval_ms", interval_ms);
+
+             auto subscription = SubscriptionManager::getInstance().subscribe(
+                 client_socket, query, std::chrono::milliseconds(interval_ms));
+             if (!subscription)
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", "Subscription limit reached");
+                 return;
+             }
+             writer.addString("status", "success");
+             writer.addInt("subscription_id", subscription->id);
+             writer.addString("topic", subscription->query.key().c_str());
+             writer.addInt("interval_ms", static_cast<long long>(subscription->interval.count()));
+         }},
+        {"unsubscribe", RequestClass::POINT, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             int subscription_id = 0;
+             if (!decoder.getInt("subscription_id", subscription_id))
+             {
+                 // No ID given: drop every subscription held by this client
+                 size_t removed = SubscriptionManager::getInstance().unsubscribeAll(client_socket);
+                 writer.addString("status", "success");
+                 writer.addInt("removed", static_cast<int>(removed));
+                 return;
+             }
+             writer.addInt("subscription_id", subscription_id);
+             bool result = SubscriptionManager::getInstance().unsubscribe(client_socket, subscription_id);
+             writer.addString("status", result ? "success" : "error");
+             if (!result)
+                 writer.addString("message", "Subscription not found");
+         }},
+        {"negotiate", RequestClass::POINT, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             // The response to this request still uses the previous encoding and compression
+             const ClientSession session = SessionManager::getInstance().get(client_socket);
+             WireFormat format = session.format;
+             CompressionCodec codec = session.compression;
+             size_t threshold = session.compression_threshold;
+
+             const char *encoding = NULL;
+             if (decoder.getString("encoding", encoding) &&
+                 !parseWireFormat(encoding, format))
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", "Unsupported 'encoding'");
+                 return;
+             }
+
+             const char *compression = NULL;
+             if (decoder.getString("compression", compression))
+             {
+                 if (!parseCompressionCodec(compression, codec))
+                 {
+                     writer.addString("status", "error");
+                     writer.addString("message", "Unsupported 'compression'");
+                     return;
+                 }
+                 if (threshold == 0)
+                     threshold = DEFAULT_COMPRESSION_THRESHOLD;
+             }
+             int requested_threshold = 0;
+             if (decoder.getInt("compression_threshold", requested_threshold))
+                 threshold = std::max(static_cast<size_t>(std::max(requested_threshold, 0)), MIN_COMPRESSION_THRESHOLD);
+
+             SessionManager::getInstance().setFormat(client_socket, format);
+             SessionManager::getInstance().setCompression(client_socket, codec, threshold);
+             writer.addString("status", "success");
+             writer.addString("encoding", wireFormatName(format));
+             writer.addString("compression", compressionCodecName(codec));
+             if (codec != CompressionCodec::NONE)
+                 writer.addInt("compression_threshold", static_cast<long long>(threshold));
          }},
-        {"get_process_info", [](json_decoder_t *decoder, json_encoder_t *encoder)
+        {"login", RequestClass::POINT, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             const char *username = NULL;
+             const char *password = NULL;
+             if (!decoder.getString("username", username) || !decoder.getString("password", password))
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", "Missing or invalid 'username' or 'password'");
+                 return;
+             }
+             auto user_type = ValidateLogin(username, password);
+             if (!user_type)
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", "Invalid username or password");
+                 return;
+             }
+             // Requests on this connection now also count against the user's rate limit
+             SessionManager::getInstance().setUser(client_socket, username);
+             writer.addString("status", "success");
+             writer.addString("user", username);
+             writer.addString("user_type", *user_type == ADMIN ? "admin" : "viewer");
+         }},
+        // Admitted as a whole at a cost that covers its entries, see AdmissionControl::batchCost()
+        {"batch", RequestClass::BULK, false, runBatch},
+        {"get_server_stats", RequestClass::POINT, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             writer.addString("status", "success");
+             ServerStats::getInstance().encode(writer);
+         }},
+        {"get_process_history", RequestClass::BULK, true, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             // Optional "pid" restricts the result to one process, optional "since"
+             // (seconds since the epoch) drops older entries
+             int pid = 0;
+             const bool single = decoder.getInt("pid", pid);
+             long long since = 0;
+             decoder.getInt64("since", since);
+             FieldMask fields = ALL_FIELDS;
+             if (const char *error = decodeFieldMask<HistoryEntrySchema>(decoder, fields))
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", error);
+                 return;
+             }
+
+             std::map<pid_t, std::vector<ProcessHistoryEntry>> history;
+             if (single)
+                 history.emplace(pid, ProcessHistory::getInstance().getHistory(pid));
+             else
+                 history = ProcessHistory::getInstance().getAllHistory(cancel);
+
+             writer.addString("status", "success");
+             writer.startArray("history");
+             for (const auto &process : history)
+             {
+                 cancel.throwIfStopped();
+                 writer.startObject(NULL);
+                 writer.addInt("pid", process.first);
+                 writer.startArray("entries");
+                 for (const auto &entry : process.second)
+                 {
+                     if (entry.timestamp < since)
+                         continue;
+                     writer.startObject(NULL);
+                     encodeFields<HistoryEntrySchema>(writer, entry, fields);
+                     writer.endObject();
+                 }
+                 writer.endArray();
+                 writer.endObject();
+             }
+             writer.endArray();
+         }},
+        {"get_process_groups", RequestClass::POINT, true, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+         {
+             // "refresh": true recomputes the totals instead of using the last collection's
+             bool refresh = false;
+             decoder.getBool("refresh", refresh);
+             FieldMask fields = ALL_FIELDS;
+             if (const char *error = decodeFieldMask<GroupSchema>(decoder, fields))
+             {
+                 writer.addString("status", "error");
+                 writer.addString("message", error);
+                 return;
+             }
+             if (refresh && !ProcessGroup::getInstance().updateGroupStats(cancel))
+                 cancel.throwIfStopped();
+
+             // Reused by every request on this worker, so copying the groups reuses their storage
+             thread_local std::vector<Group> groups;
+             ProcessGroup::getInstance().getGroups(groups);
+             writer.addString("status", "success");
+             encodeRecords<GroupSchema>(writer, "groups", groups, fields);
+         }},
+        {"get_process_info", RequestClass::POINT, true, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
          {
              int pid = 0;
-             if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK)
+             if (!decoder.getInt("pid", pid))
              {
-                 json_encoder_add_string(encoder, "status", "error");
-                 json_encoder_add_string(encoder, "message", "Missing or invalid 'pid'");
+                 writer.addString("status", "error");
+                 writer.addString("message", "Missing or invalid 'pid'");
                  return;
              }
-             json_encoder_add_int(encoder, "pid", pid);
+             writer.addInt("pid", pid);
              if (auto info = getProcessInfo(pid))
              {
-                 json_encoder_add_string(encoder, "status", "success");
-                 json_encoder_start_object(encoder, "info");
-                 json_encoder_add_double(encoder, "cpu_usage", info->cpu_usage);
-                 json_encoder_add_int_ll(encoder, "memory_usage", info->memory_usage);
-                 json_encoder_end_object(encoder);
+                 writer.addString("status", "success");
+                 writer.startObject("info");
+                 writer.addPercentage("cpu_usage", info->cpu_usage);
+                 writer.addInt("memory_usage", info->memory_usage);
+                 writer.endObject();
              }
              else
              {
-                 json_encoder_add_string(encoder, "status", "error");
-                 json_encoder_add_string(encoder, "message", "Process not found");
+                 writer.addString("status", "error");
+                 writer.addString("message", "Process not found");
              }
          }},
-        {"suspend_process", [](json_decoder_t *decoder, json_encoder_t *encoder)
+        {"suspend_process", RequestClass::CONTROL, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
          {
              int pid = 0;
-             if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK)
+             if (!decoder.getInt("pid", pid))
              {
-                 json_encoder_add_string(encoder, "status", "error");
-                 json_encoder_add_string(encoder, "message", "Missing or invalid 'pid'");
+                 writer.addString("status", "error");
+                 writer.addString("message", "Missing or invalid 'pid'");
                  return;
              }
-             json_encoder_add_int(encoder, "pid", pid);
+             writer.addInt("pid", pid);
              bool result = suspend(pid);
-             json_encoder_add_string(encoder, "status", result ? "success" : "error");
+             writer.addString("status", result ? "success" : "error");
              if (!result)
-                 json_encoder_add_string(encoder, "message", "Failed to suspend process");
+                 writer.addString("message", "Failed to suspend process");
          }},
-        {"resume_process", [](json_decoder_t *decoder, json_encoder_t *encoder)
+        {"resume_process", RequestClass::CONTROL, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
          {
              int pid = 0;
-             if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK)
+             if (!decoder.getInt("pid", pid))
              {
-                 json_encoder_add_string(encoder, "status", "error");
-                 json_encoder_add_string(encoder, "message", "Missing or invalid 'pid'");
+                 writer.addString("status", "error");
+                 writer.addString("message", "Missing or invalid 'pid'");
                  return;
              }
-             json_encoder_add_int(encoder, "pid", pid);
+             writer.addInt("pid", pid);
              bool result = resume(pid);
-             json_encoder_add_string(encoder, "status", result ? "success" : "error");
+             writer.addString("status", result ? "success" : "error");
              if (!result)
-                 json_encoder_add_string(encoder, "message", "Failed to resume process");
+                 writer.addString("message", "Failed to resume process");
          }},
-        {"terminate_process", [](json_decoder_t *decoder, json_encoder_t *encoder)
+        {"terminate_process", RequestClass::CONTROL, false, [](int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
          {
              int pid = 0;
-             if (json_decoder_get_int(decoder, "pid", &pid, false) != JSON_DECODER_OK)
+             if (!decoder.getInt("pid", pid))
              {
-                 json_encoder_add_string(encoder, "status", "error");
-                 json_encoder_add_string(encoder, "message", "Missing or invalid 'pid'");
+                 writer.addString("status", "error");
+                 writer.addString("message", "Missing or invalid 'pid'");
                  return;
              }
-             json_encoder_add_int(encoder, "pid", pid);
+             writer.addInt("pid", pid);
              bool result = terminate(pid);
-             json_encoder_add_string(encoder, "status", result ? "success" : "error");
+             writer.addString("status", result ? "success" : "error");
              if (!result)
-                 json_encoder_add_string(encoder, "message", "Failed to terminate process");
+                 writer.addString("message", "Failed to terminate process");
          }}};
 
-    // Helper function to create a JSON error response using QNX JSON library
-    std::string createJsonError(const std::string &error, const std::string &details)
+    namespace dispatch
     {
-        json_encoder_t *enc = json_encoder_create();
-        json_encoder_start_object(enc, NULL);
-        json_encoder_add_string(enc, "status", "error");
-        json_encoder_add_string(enc, "message", error.c_str());
-        if (!details.empty())
+        constexpr size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+        // Smallest power of two with four slots per command, which makes a
+        // collision-free seed quick to find even for a few dozen commands
+        constexpr size_t tableSize()
         {
-            json_encoder_add_string(enc, "details", details.c_str());
+            size_t size = 1;
+            while (size < 4 * COMMAND_COUNT)
+                size *= 2;
+            return size;
         }
-        json_encoder_end_object(enc);
-        const char *json_str = json_encoder_buffer(enc);
-        std::string response(json_str ? json_str : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
-        json_encoder_destroy(enc);
-        return response;
+        constexpr size_t TABLE_SIZE = tableSize();
+        static_assert(COMMAND_COUNT < 255, "Command indices must fit in a slot");
+
+        // Seeded FNV-1a
+        constexpr uint32_t hash(std::string_view name, uint32_t seed)
+        {
+            uint32_t h = 2166136261u ^ seed;
+            for (char c : name)
+            {
+                h ^= static_cast<uint8_t>(c);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        constexpr bool isPerfect(uint32_t seed)
+        {
+            bool used[TABLE_SIZE] = {};
+            for (const CommandEntry &entry : COMMANDS)
+            {
+                const size_t slot = hash(entry.name, seed) & (TABLE_SIZE - 1);
+                if (used[slot])
+                    return false;
+                used[slot] = true;
+            }
+            return true;
+        }
+
+        constexpr uint32_t findSeed()
+        {
+            for (uint32_t seed = 1; seed < 100000; ++seed)
+            {
+                if (isPerfect(seed))
+                    return seed;
+            }
+            return 0;
+        }
+        constexpr uint32_t SEED = findSeed();
+        static_assert(SEED != 0, "No collision-free hash seed for the command names");
+
+        struct Table
+        {
+            uint8_t slots[TABLE_SIZE]; ///< Index into COMMANDS plus one, or 0 for no command
+        };
+
+        constexpr Table buildTable()
+        {
+            Table table = {};
+            for (size_t i = 0; i < COMMAND_COUNT; ++i)
+                table.slots[hash(COMMANDS[i].name, SEED) & (TABLE_SIZE - 1)] = static_cast<uint8_t>(i + 1);
+            return table;
+        }
+        constexpr Table TABLE = buildTable();
+    }
+
+    // Constant-time command lookup; unknown names hash to an empty slot or fail the comparison
+    static const CommandEntry *findCommand(std::string_view name)
+    {
+        const uint8_t slot = dispatch::TABLE.slots[dispatch::hash(name, dispatch::SEED) & (dispatch::TABLE_SIZE - 1)];
+        if (slot == 0 || COMMANDS[slot - 1].name != name)
+            return nullptr;
+        return &COMMANDS[slot - 1];
     }
 
-    // Main message handler using QNX JSON library
-    std::string handleMessage(int client_socket, const std::string &message)
+    // Encode a list of processes as a named array of objects
+    void encodeProcessList(ResponseWriter &writer, const char *name, const std::vector<ProcessInfo> &processes, FieldMask fields)
     {
-        json_decoder_t *decoder = json_decoder_create();
-        json_decoder_error_t status = json_decoder_parse_json_str(decoder, message.c_str());
+        encodeRecords<ProcessInfoSchema>(writer, name, processes, fields);
+    }
+
+    void encodeProcessList(ResponseWriter &writer, const char *name, const std::vector<const ProcessInfo *> &processes,
+                           FieldMask fields)
+    {
+        encodeRecords<ProcessInfoSchema>(writer, name, processes, fields);
+    }
 
-        if (status != JSON_DECODER_OK)
+    // Echo the optional request correlation "id" (string or integer) into the response
+    static void encodeRequestId(JsonDecoder &decoder, ResponseWriter &writer)
+    {
+        const char *id_str = NULL;
+        long long id_num = 0;
+        if (decoder.getString("id", id_str))
+            writer.addString("id", id_str);
+        else if (decoder.getInt64("id", id_num))
+            writer.addInt("id", id_num);
+    }
+
+    // Record a rejected request under the limit that rejected it
+    static void recordThrottle(Admission admission)
+    {
+        switch (admission)
         {
-            int err_pos;
-            const char *err_str;
-            json_decoder_get_parse_error(decoder, &err_pos, &err_str);
-            json_decoder_destroy(decoder);
-            return createJsonError("Invalid JSON format", err_str);
+        case Admission::CONNECTION_RATE:
+            ServerStats::getInstance().recordThrottle(ThrottleReason::CONNECTION);
+            break;
+        case Admission::USER_RATE:
+            ServerStats::getInstance().recordThrottle(ThrottleReason::USER);
+            break;
+        case Admission::BUSY:
+            ServerStats::getInstance().recordThrottle(ThrottleReason::BUSY);
+            break;
+        case Admission::ADMITTED:
+            break;
         }
+    }
 
-        json_decoder_push_object(decoder, NULL, false);
+    // Encode the response to the next entry of a batch's "requests" array as an array element
+    static void runBatchEntry(int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+    {
+        if (!decoder.pushObject(NULL))
+        {
+            decoder.skip();
+            writer.startObject(NULL);
+            writer.addString("status", "error");
+            writer.addString("message", "Batch entry must be an object");
+            writer.endObject();
+            return;
+        }
 
-        const char *req_type_ptr = NULL;
-        if (json_decoder_get_string(decoder, "command", &req_type_ptr, false) != JSON_DECODER_OK || req_type_ptr == NULL)
+        const char *command = NULL;
+        if (decoder.getString("command", command) && std::string_view(command) != "batch")
         {
-            json_decoder_destroy(decoder);
-            return createJsonError("Missing or invalid 'command'", "Command must be a string");
+            // Admitted with the batch, see countBatchEntries()
+            encodeCommand(client_socket, command, decoder, writer, cancel, true);
         }
-        std::string command(req_type_ptr);
+        else
+        {
+            writer.startObject(NULL);
+            encodeRequestId(decoder, writer);
+            writer.addString("status", "error");
+            writer.addString("message", command ? "Batches cannot be nested" : "Missing or invalid 'command'");
+            writer.endObject();
+        }
+        decoder.pop();
+    }
 
-        json_encoder_t *encoder = json_encoder_create();
-        std::string response = processCommand(command, message, encoder);
+    // State of a parallel batch, shared with the workers that help run it
+    struct ParallelBatch
+    {
+        JsonDecoder requests;             ///< The request, positioned at the first entry; only copied
+        BatchSnapshot snapshot;           ///< Process list shared by the entries
+        int client_socket;
+        CancellationToken cancel;
+        std::vector<std::string> results; ///< Encoded response to each entry
+        std::atomic<size_t> next{0};      ///< Index of the next entry to claim
+        std::mutex mutex;                 ///< Protects done and error
+        std::condition_variable finished; ///< Signals that every entry is done
+        size_t done = 0;                  ///< Entries claimed and run (or abandoned after an error)
+        std::exception_ptr error;         ///< First exception thrown by an entry
 
-        json_decoder_destroy(decoder);
-        json_encoder_destroy(encoder);
+        ParallelBatch(int socket, const CancellationToken &token, size_t count)
+            : client_socket(socket), cancel(token), results(count) {}
+    };
 
+    // Claim entries of a parallel batch until none are left. The decoder is the calling
+    // thread's copy of the request, positioned at the first entry.
+    static void runBatchEntries(ParallelBatch &batch, JsonDecoder &decoder, WireFormat format)
+    {
+        BatchScope scope(&batch.snapshot);
+        size_t position = 0;
+        for (size_t index; (index = batch.next.fetch_add(1)) < batch.results.size();)
+        {
+            bool failed;
+            {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                failed = batch.error != nullptr;
+            }
+            if (!failed)
+            {
+                // Claims only increase, so the entry is ahead of the cursor
+                for (; position < index; ++position)
+                    decoder.skip();
+                const size_t depth = decoder.depth();
+                try
+                {
+                    auto writer = ResponseWriter::acquire(format);
+                    runBatchEntry(batch.client_socket, decoder, *writer, batch.cancel);
+                    batch.results[index] = writer->finish();
+                }
+                catch (...)
+                {
+                    decoder.popTo(depth);
+                    std::lock_guard<std::mutex> lock(batch.mutex);
+                    if (!batch.error)
+                        batch.error = std::current_exception();
+                }
+                position = index + 1;
+            }
+
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (++batch.done == batch.results.size())
+                batch.finished.notify_all();
+        }
+    }
+
+    // Run the entries of a batch on this thread and on idle workers, then add the
+    // responses in request order. Workers that only start once every entry is
+    // claimed find nothing to do, so this never waits for a busy pool.
+    static void runParallelBatch(int client_socket, JsonDecoder &decoder, ResponseWriter &writer,
+                                 const CancellationToken &cancel, size_t count)
+    {
+        auto batch = std::make_shared<ParallelBatch>(client_socket, cancel, count);
+        batch->requests.copyFrom(decoder);
+        const WireFormat format = writer.format();
+
+        const size_t helpers = std::min(count - 1, MAX_BATCH_HELPERS);
+        for (size_t i = 0; i < helpers; ++i)
+        {
+            SocketServer::getInstance().submitTask([batch, format]()
+                                                   {
+                if (batch->next.load() >= batch->results.size())
+                    return;
+                RequestArena::Scope arena_scope;
+                thread_local JsonDecoder decoder;
+                decoder.copyFrom(batch->requests);
+                runBatchEntries(*batch, decoder, format); },
+                                                   RequestClass::POINT);
+        }
+        runBatchEntries(*batch, decoder, format);
+
+        {
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->finished.wait(lock, [&batch]()
+                                 { return batch->done == batch->results.size(); });
+            if (batch->error)
+                std::rethrow_exception(batch->error);
+        }
+        for (const std::string &result : batch->results)
+        {
+            if (!writer.addEncoded(NULL, result))
+            {
+                writer.startObject(NULL);
+                writer.addString("status", "error");
+                writer.addString("message", "Encoder error");
+                writer.endObject();
+            }
+        }
+    }
+
+    // Run the requests of a batch: one parse, one admission and one process list for
+    // all of them, and one response listing their responses in request order
+    static void runBatch(int client_socket, JsonDecoder &decoder, ResponseWriter &writer, const CancellationToken &cancel)
+    {
+        // "parallel": true spreads the entries over idle workers; they then must not depend
+        // on each other, e.g. a login followed by commands that need it
+        bool parallel = false;
+        decoder.getBool("parallel", parallel);
+
+        size_t count = 0;
+        if (decoder.pushArray("requests"))
+        {
+            while (decoder.skip())
+                ++count;
+            decoder.pop();
+        }
+        if (count == 0 || count > MAX_BATCH_SIZE)
+        {
+            writer.addString("status", "error");
+            writer.addString("message", count == 0 ? "Missing or invalid 'requests'" : "Too many requests in batch");
+            return;
+        }
+
+        decoder.pushArray("requests"); // Back at the first entry
+        writer.addString("status", "success");
+        writer.startArray("results");
+        if (parallel && count > 1)
+        {
+            runParallelBatch(client_socket, decoder, writer, cancel, count);
+        }
+        else
+        {
+            BatchSnapshot snapshot;
+            BatchScope scope(&snapshot);
+            for (size_t i = 0; i < count; ++i)
+            {
+                cancel.throwIfStopped();
+                runBatchEntry(client_socket, decoder, writer, cancel);
+            }
+        }
+        writer.endArray();
+        decoder.pop();
+    }
+
+    // Count the entries of a batch by cost, so the batch is admitted once for all of them.
+    // Entries that are not objects, name no known command or nest a batch are cheap.
+    static void countBatchEntries(JsonDecoder &decoder, size_t &cheap, size_t &expensive)
+    {
+        cheap = 0;
+        expensive = 0;
+        if (!decoder.pushArray("requests"))
+            return;
+        while (true)
+        {
+            if (decoder.pushObject(NULL))
+            {
+                const char *command = NULL;
+                const CommandEntry *entry = decoder.getString("command", command) ? findCommand(command) : nullptr;
+                if (entry && entry->expensive)
+                    ++expensive;
+                else
+                    ++cheap;
+                decoder.pop();
+            }
+            else if (decoder.skip())
+            {
+                ++cheap;
+            }
+            else
+            {
+                break;
+            }
+        }
+        decoder.pop();
+    }
+
+    // Helper function to create an error response in the client's wire format
+    std::string createErrorResponse(WireFormat format, const char *error, const char *details, JsonDecoder *request = nullptr)
+    {
+        auto writer = ResponseWriter::acquire(format);
+        writer->startObject(NULL);
+        if (request)
+            encodeRequestId(*request, *writer);
+        writer->addString("status", "error");
+        writer->addString("message", error);
+        if (*details)
+        {
+            writer->addString("details", details);
+        }
+        writer->endObject();
+        std::string response = writer->finish();
+        if (response.empty())
+            response = ENCODER_ERROR;
+        return response;
+    }
+
+    // Cheap response for a request rejected by admission control; the handler never runs
+    static std::string createThrottledResponse(WireFormat format, const char *command, Admission admission,
+                                               int64_t retry_after_ms, JsonDecoder &request)
+    {
+        auto writer = ResponseWriter::acquire(format);
+        writer->startObject(NULL);
+        encodeRequestId(request, *writer);
+        writer->addString("command", command);
+        writer->addString("status", "error");
+        writer->addString("message", admission == Admission::BUSY ? "Server busy, retry later" : "Rate limit exceeded, retry later");
+        writer->addInt("retry_after_ms", static_cast<long long>(retry_after_ms));
+        writer->endObject();
+        std::string response = writer->finish();
+        if (response.empty())
+            response = ENCODER_ERROR;
+        return response;
+    }
+
+    // Key under which identical requests share one response, or empty if the command's
+    // response is always computed. Sets the snapshot generation for responses that are
+    // derived from the process list (and the group members) alone, which makes them cacheable.
+    static ArenaString sharedResponseKey(std::string_view command, JsonDecoder &decoder, WireFormat format,
+                                         std::optional<uint64_t> &generation)
+    {
+        ArenaString key(command);
+        if (command == "get_processes")
+        {
+            ProcessQuery query;
+            FieldMask fields = ALL_FIELDS;
+            if (decodeProcessQuery(decoder, query) || decodeFieldMask<ProcessInfoSchema>(decoder, fields))
+                return ArenaString(); // Invalid: the handler reports the error
+            key += '|';
+            key += query.key();
+            if (query.kind == ProcessQuery::Kind::GROUP)
+            {
+                // Membership changes between snapshots, so it is part of the key
+                key += "|groups=";
+                appendInteger(key, static_cast<long long>(ProcessGroup::getInstance().getModificationCount()));
+            }
+            if (fields != fullMask<ProcessInfoSchema>())
+            {
+                key += "|fields=";
+                appendInteger(key, fields);
+            }
+            generation = ProcessCore::getInstance().getGeneration();
+        }
+        else if (command == "get_process_info")
+        {
+            // Read from procfs on demand, so only concurrent requests can share it
+            int pid = 0;
+            if (!decoder.getInt("pid", pid))
+                return ArenaString();
+            key += '|';
+            appendInteger(key, pid);
+        }
+        else
+        {
+            return ArenaString();
+        }
+        key += '|';
+        key += wireFormatName(format);
+        return key;
+    }
+
+    // Add the request's correlation "id" to a response encoded without one.
+    // Returns an empty string if the id cannot be added.
+    static std::string addRequestId(const std::string &response, JsonDecoder &request)
+    {
+        const char *id_str = NULL;
+        long long id_num = 0;
+        if (request.getString("id", id_str))
+            return ResponseWriter::prependMember(response, "id", id_str);
+        if (request.getInt64("id", id_num))
+            return ResponseWriter::prependMember(response, "id", id_num);
         return response;
     }
 
+    // Serve a response from the cache, or compute it once for all identical
+    // concurrent requests; each caller gets a copy with its own request id
+    static std::string processShared(int client_socket, std::string_view command, std::string_view key,
+                                     std::optional<uint64_t> generation, WireFormat format, JsonDecoder &request)
+    {
+        if (generation)
+        {
+            if (auto cached = ResponseCache::getInstance().find(key, *generation))
+                return addRequestId(*cached, request);
+        }
+
+        ArenaString flight_key(key);
+        if (generation)
+        {
+            flight_key += '|';
+            appendInteger(flight_key, static_cast<long long>(*generation));
+        }
+        auto produce = [&]()
+        {
+            // Shared work outlives any one caller, so it runs without the caller's token
+            auto writer = ResponseWriter::acquire(format);
+            return processCommand(client_socket, command, request, *writer, CancellationToken(), false);
+        };
+        bool shared = false;
+        // Passed by reference, so wrapping it in a RequestCoalescer::Producer does not allocate
+        std::shared_ptr<const std::string> response = RequestCoalescer::getInstance().run(flight_key, std::cref(produce), shared);
+        ServerStats::getInstance().recordCoalescing(shared);
+        if (generation && !shared)
+            ResponseCache::getInstance().insert(key, *generation, response);
+        return addRequestId(*response, request);
+    }
+
+    // Main message handler. Runs on a worker thread, so
+    // large responses are compressed here rather than on the reactor.
+    std::string handleMessage(int client_socket, const std::string &message, const CancellationToken &cancel)
+    {
+        const ClientSession session = SessionManager::getInstance().get(client_socket);
+        const WireFormat format = session.format;
+        std::string response;
+
+        // Temporary strings of the request are taken from the worker's arena
+        // and released together when the request is done
+        RequestArena::Scope arena_scope;
+
+        // Reused by every request on this worker, so decoding does not allocate. The
+        // parsed request is handed down to the command handler rather than parsed again.
+        thread_local JsonDecoder decoder;
+
+        if (!decoder.parse(message))
+        {
+            size_t err_pos = 0;
+            const char *err_str = decoder.parseError(&err_pos);
+            ArenaString details(err_str);
+            details += " at offset ";
+            appendInteger(details, static_cast<long long>(err_pos));
+            response = createErrorResponse(format, "Invalid JSON format", details.c_str());
+        }
+        else
+        {
+            decoder.pushObject(NULL);
+
+            // Optional "deadline_ms" shortens the server's maximum, counted from receipt
+            CancellationToken request_cancel = cancel;
+            int deadline_ms = 0;
+            if (decoder.getInt("deadline_ms", deadline_ms) && deadline_ms > 0)
+                request_cancel = cancel.withTimeout(std::chrono::milliseconds(deadline_ms));
+
+            const char *req_type_ptr = NULL;
+            if (!decoder.getString("command", req_type_ptr))
+            {
+                response = createErrorResponse(format, "Missing or invalid 'command'", "Command must be a string", &decoder);
+            }
+            else if (request_cancel.isExpired())
+            {
+                // Spent its whole deadline waiting for a worker
+                ServerStats::getInstance().recordCancellation(true);
+                response = createErrorResponse(format, RequestCancelled(true).what(), "", &decoder);
+            }
+            else
+            {
+                const std::string_view command(req_type_ptr);
+                const CommandEntry *entry = findCommand(command);
+                bool expensive = entry && entry->expensive;
+                double cost = expensive ? AdmissionControl::EXPENSIVE_COST : 1.0;
+                if (command == "batch")
+                {
+                    // Runs completely or not at all; one concurrency slot covers its expensive entries
+                    size_t cheap_entries = 0;
+                    size_t expensive_entries = 0;
+                    countBatchEntries(decoder, cheap_entries, expensive_entries);
+                    expensive = expensive_entries > 0;
+                    cost = AdmissionControl::batchCost(cheap_entries, expensive_entries);
+                }
+                int64_t retry_after_ms = 0;
+                Admission admission = AdmissionControl::getInstance().admit(client_socket, session.user, cost, expensive, retry_after_ms);
+                if (admission != Admission::ADMITTED)
+                {
+                    recordThrottle(admission);
+                    response = createThrottledResponse(format, req_type_ptr, admission, retry_after_ms, decoder);
+                }
+                else
+                {
+                    const AdmissionControl::ExpensiveSlot slot(expensive);
+
+                    // Uncompressed JSON goes out in chunks as it is encoded, so a large
+                    // listing is never held whole; compression needs the whole document
+                    SocketServer::ResponseStream stream(client_socket);
+                    try
+                    {
+                        std::optional<uint64_t> generation;
+                        const ArenaString key = sharedResponseKey(command, decoder, format, generation);
+                        if (!key.empty())
+                            response = processShared(client_socket, command, key, generation, format, decoder);
+                        if (response.empty())
+                        {
+                            auto writer = ResponseWriter::acquire(format);
+                            JsonResponseWriter *json_writer = nullptr;
+                            if (format == WireFormat::JSON && session.compression == CompressionCodec::NONE)
+                            {
+                                json_writer = static_cast<JsonResponseWriter *>(writer.get());
+                                json_writer->streamTo([&stream](std::string &&chunk)
+                                                      { return stream.write(std::move(chunk)); });
+                            }
+                            response = processCommand(client_socket, command, decoder, *writer, request_cancel);
+                            if (stream.started() && !json_writer->streamFailed())
+                            {
+                                stream.finish(std::move(response));
+                                response.clear();
+                            }
+                        }
+                    }
+                    catch (const RequestCancelled &e)
+                    {
+                        // Nobody reads the response of a closed connection, but it is still well-formed
+                        ServerStats::getInstance().recordCancellation(e.deadlineExceeded());
+                        response = createErrorResponse(format, e.what(), "", &decoder);
+                    }
+                    if (stream.started())
+                    {
+                        // The client has the head of a response whose rest is lost
+                        stream.abort();
+                        response.clear();
+                    }
+                }
+            }
+        }
+
+        if (session.compression == CompressionCodec::NONE)
+            return response; // Moved out rather than copied
+        return compressResponse(response, session.compression, session.compression_threshold);
+    }
+
+    // Worker queue of a command, from the command table
+    static RequestClass classifyCommand(std::string_view command)
+    {
+        const CommandEntry *entry = findCommand(command);
+        return entry ? entry->lane : RequestClass::POINT;
+    }
+
+    // Find the top-level "command" member by tracking nesting and skipping strings
+    RequestClass classifyRequest(const std::string &message)
+    {
+        int depth = 0;
+        bool key_expected = false;
+        for (size_t i = 0; i < message.size(); ++i)
+        {
+            const char c = message[i];
+            if (c == '{' || c == '[')
+            {
+                ++depth;
+                key_expected = c == '{' && depth == 1;
+            }
+            else if (c == '}' || c == ']')
+            {
+                --depth;
+            }
+            else if (c == ',')
+            {
+                key_expected = depth == 1;
+            }
+            else if (c == '"')
+            {
+                size_t end = i + 1;
+                while (end < message.size() && message[end] != '"')
+                    end += message[end] == '\\' ? 2 : 1;
+                if (end >= message.size())
+                    break;
+
+                const bool is_key = key_expected;
+                key_expected = false;
+                if (is_key && std::string_view(message).substr(i + 1, end - i - 1) == "command")
+                {
+                    size_t value = message.find_first_not_of(" \t\r\n", end + 1);
+                    if (value == std::string::npos || message[value] != ':')
+                        break;
+                    value = message.find_first_not_of(" \t\r\n", value + 1);
+                    if (value == std::string::npos || message[value] != '"')
+                        break;
+                    size_t value_end = message.find('"', value + 1);
+                    if (value_end == std::string::npos)
+                        break;
+                    return classifyCommand(std::string_view(message).substr(value + 1, value_end - value - 1));
+                }
+                i = end;
+            }
+        }
+        return RequestClass::POINT;
+    }
+
     // Validation function (simple parse check)
     bool validateJson(const std::string &json_str)
     {
-        json_decoder_t *decoder = json_decoder_create();
-        bool success = (json_decoder_parse_json_str(decoder, json_str.c_str()) == JSON_DECODER_OK);
-        json_decoder_destroy(decoder);
-        return success;
+        JsonDecoder decoder;
+        return decoder.parse(json_str);
     }
 
     // toJson (less relevant now, but kept for potential internal use)
     std::string toJson(const std::string &data)
     {
-        json_encoder_t *enc = json_encoder_create();
-        json_encoder_start_object(enc, NULL);
-        json_encoder_add_string(enc, "data", data.c_str());
-        json_encoder_end_object(enc);
-        const char *json_str = json_encoder_buffer(enc);
-        std::string response(json_str ? json_str : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
-        json_encoder_destroy(enc);
-        return response;
+        JsonEncoder encoder;
+        encoder.startObject(NULL);
+        encoder.addString("data", data);
+        encoder.endObject();
+        return encoder.take();
     }
 
-    // Command processing using QNX JSON library
-    std::string processCommand(const std::string &command, const std::string &raw_params_json, json_encoder_t *encoder)
+    // Encode the response to an already decoded request as an object, the root or an array element
+    static void encodeCommand(int client_socket, std::string_view command, JsonDecoder &request, ResponseWriter &writer,
+                              const CancellationToken &cancel, bool echo_id)
     {
-        json_decoder_t *decoder = json_decoder_create();
-        json_decoder_parse_json_str(decoder, raw_params_json.c_str()); // Parse again to access params
-        json_decoder_push_object(decoder, NULL, false);
+        const CommandEntry *entry = findCommand(command);
+        writer.startObject(NULL);
+        if (echo_id)
+            encodeRequestId(request, writer);
+        // Table names are NUL-terminated literals
+        writer.addString("command", entry ? entry->name.data() : ArenaString(command).c_str());
 
-        json_encoder_start_object(encoder, NULL);
-        json_encoder_add_string(encoder, "command", command.c_str());
+        // A handler that throws may leave the cursor inside a nested value
+        const size_t depth = request.depth();
 
         try
         {
-            // Dispatch using global commandHandlers map
-            auto it = commandHandlers.find(command);
-            if (it != commandHandlers.end())
+            if (entry)
             {
-                it->second(decoder, encoder);
+                entry->handler(client_socket, request, writer, cancel);
             }
             else
             {
-                json_encoder_add_string(encoder, "status", "error");
-                json_encoder_add_string(encoder, "message", (std::string("Unknown command: ") + command).c_str());
+                writer.addString("status", "error");
+                ArenaString message("Unknown command: ");
+                message += command;
+                writer.addString("message", message.c_str());
             }
         }
+        catch (const RequestCancelled &)
+        {
+            // The partial response is discarded; the caller reports the cancellation
+            request.popTo(depth);
+            throw;
+        }
         catch (const std::exception &e)
         {
-            json_encoder_add_string(encoder, "status", "error");
-            json_encoder_add_string(encoder, "message", (std::string("Error processing command: ") + e.what()).c_str());
+            request.popTo(depth);
+            writer.addString("status", "error");
+            ArenaString message("Error processing command: ");
+            message += e.what();
+            writer.addString("message", message.c_str());
         }
 
-        json_decoder_destroy(decoder);
-        json_encoder_end_object(encoder); // End main response object
-        const char *json_response = json_encoder_buffer(encoder);
-        return std::string(json_response ? json_response : "{\"status\":\"error\",\"message\":\"Encoder error\"}");
+        writer.endObject(); // End main response object
+    }
+
+    // Command processing on the already decoded request, with the given writer for the response
+    std::string processCommand(int client_socket, std::string_view command, JsonDecoder &request, ResponseWriter &writer,
+                               const CancellationToken &cancel, bool echo_id)
+    {
+        encodeCommand(client_socket, command, request, writer, cancel, echo_id);
+        std::string response = writer.finish();
+        if (response.empty())
+            response = ENCODER_ERROR;
+        return response;
     }
 }
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include <filesystem>
 #include <iostream>
 #include <system_error>
+#include <cstdio>
+#include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
 #ifdef __QNXNTO__
@@ -326,54 +328,49 @@ namespace qnx
         BasicProcessInfo info{0.0, 0};
 
 #ifdef __QNXNTO__
-        try
+        // Plain reads into stack buffers: this serves every get_process_info
+        // request, and streams would allocate each time
+        char path[64];
+
+        // Get memory usage from status
+        snprintf(path, sizeof(path), "/proc/%d/status", static_cast<int>(pid));
+        int fd = ::open(path, O_RDONLY);
+        if (fd >= 0)
         {
-            // Get memory usage from status
-            std::stringstream status_path;
-            status_path << "/proc/" << pid << "/status";
-
-            std::ifstream status_file(status_path.str());
-            if (status_file)
+            procfs_status pstatus;
+            if (::read(fd, &pstatus, sizeof(pstatus)) == static_cast<ssize_t>(sizeof(pstatus)))
             {
-                procfs_status pstatus;
-                if (status_file.read(reinterpret_cast<char *>(&pstatus), sizeof(pstatus)) && status_file.good())
-                {
-                    info.memory_usage = pstatus.stksize;
-                }
-                else
-                {
-                    std::cerr << "Failed to read /proc/" << pid << "/status for memory info." << std::endl;
-                }
+                info.memory_usage = pstatus.stksize;
             }
             else
             {
-                std::cerr << "Failed to open /proc/" << pid << "/status for memory info." << std::endl;
+                std::cerr << "Failed to read /proc/" << pid << "/status for memory info." << std::endl;
             }
+            ::close(fd);
+        }
+        else
+        {
+            std::cerr << "Failed to open /proc/" << pid << "/status for memory info." << std::endl;
+        }
 
-            // CPU usage is more complex and would require sampling over time
-            // This implementation provides a simplified version
-            std::stringstream stat_path;
-            stat_path << "/proc/" << pid << "/stat";
-
-            std::ifstream stat_file(stat_path.str());
-            if (stat_file)
+        // CPU usage is more complex and would require sampling over time
+        // This implementation provides a simplified version
+        snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+        fd = ::open(path, O_RDONLY);
+        if (fd >= 0)
+        {
+            char first = '\n';
+            if (::read(fd, &first, 1) == 1 && first != '\n')
             {
-                std::string line;
-                if (std::getline(stat_file, line) && !line.empty())
-                {
-                    // Parse CPU statistics (this is a simplified approach)
-                    // In a real implementation, we'd need to track usage over time
-                    // and calculate percentage based on total system CPU time
-                    info.cpu_usage = 0.5; // Placeholder value
-                }
+                // Parse CPU statistics (this is a simplified approach)
+                // In a real implementation, we'd need to track usage over time
+                // and calculate percentage based on total system CPU time
+                info.cpu_usage = 0.5; // Placeholder value
             }
-
-            return info;
-        }
-        catch (const std::exception &e)
-        {
-            std::cerr << "Error getting process info: " << e.what() << std::endl;
+            ::close(fd);
         }
+
+        return info;
 #endif
 
         return std::nullopt;
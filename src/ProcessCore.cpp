@@ -66,6 +66,7 @@ namespace qnx
     {
         std::lock_guard<std::mutex> lock(mutex_);
         process_list_.clear();
+        generation_.fetch_add(1, std::memory_order_release);
         std::unordered_set<pid_t> current_pids;
 
         try
@@ -113,6 +114,22 @@ namespace qnx
         }
     }
 
+    /**
+     * @brief Replace the process list with a given one
+     *
+     * Installs a list that was not read from /proc, as collectInfo() would
+     * install a collected one, and starts a new generation. Lets requests be
+     * replayed against a fixed, reproducible list (see bench/handler_bench.cpp).
+     *
+     * @param processes The new process list
+     */
+    void ProcessCore::loadSnapshot(std::vector<ProcessInfo> processes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        process_list_ = std::move(processes);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
     /**
      * @brief Get the count of currently tracked processes
      *
@@ -128,6 +145,20 @@ namespace qnx
         return process_list_.size();
     }
 
+    /**
+     * @brief Get the generation of the process list
+     *
+     * The generation changes every time collectInfo() rebuilds the list, so
+     * results computed from a snapshot can be tagged with the generation they
+     * were computed from and reused until it changes.
+     *
+     * @return The current generation
+     */
+    uint64_t ProcessCore::getGeneration() const noexcept
+    {
+        return generation_.load(std::memory_order_acquire);
+    }
+
     /**
      * @brief Get the list of all currently tracked processes
      *
@@ -145,6 +176,21 @@ namespace qnx
         return process_list_;
     }
 
+    /**
+     * @brief Get a copy of the list of all currently tracked processes
+     *
+     * Unlike getProcessList(), the copy is taken while holding the process list
+     * lock, so it is safe to call from threads other than the collector (e.g.
+     * request handlers) while collectInfo() may be running.
+     *
+     * @return A copy of the internal vector of ProcessInfo objects
+     */
+    std::vector<ProcessInfo> ProcessCore::getProcessListSnapshot() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return process_list_;
+    }
+
     /**
      * @brief Find a specific process by its PID
      *
@@ -18,6 +18,7 @@ namespace qnx
 
         int group_id = next_group_id_++;
         groups_[group_id] = Group(group_id, name, priority, description);
+        ++modification_count_;
 
         return group_id;
     }
@@ -39,7 +40,9 @@ namespace qnx
         }
 
         // Remove the group
-        return groups_.erase(group_id) > 0;
+        groups_.erase(it);
+        ++modification_count_;
+        return true;
     }
 
     bool ProcessGroup::renameGroup(int group_id, std::string_view new_name)
@@ -53,6 +56,7 @@ namespace qnx
         }
 
         it->second.name = new_name;
+        ++modification_count_;
         return true;
     }
 
@@ -86,6 +90,7 @@ namespace qnx
         // Add to new group
         it->second.processes.insert(pid);
         process_group_map_[pid] = group_id;
+        ++modification_count_;
 
         return true;
     }
@@ -106,6 +111,7 @@ namespace qnx
         if (erase_count > 0)
         {
             process_group_map_.erase(pid);
+            ++modification_count_;
             return true;
         }
 
@@ -125,6 +131,11 @@ namespace qnx
         return -1;
     }
 
+    uint64_t ProcessGroup::getModificationCount() const noexcept
+    {
+        return modification_count_.load();
+    }
+
     std::set<pid_t> ProcessGroup::getProcessesInGroup(int group_id) const
     {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -138,45 +149,99 @@ namespace qnx
         return std::set<pid_t>();
     }
 
-    void ProcessGroup::updateGroupStats()
+    std::vector<Group> ProcessGroup::getGroups() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<Group> result;
+        result.reserve(groups_.size());
+        for (const auto &group_pair : groups_)
+        {
+            result.push_back(group_pair.second);
+        }
+        return result;
+    }
+
+    void ProcessGroup::getGroups(std::vector<Group> &groups) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        groups.resize(groups_.size());
+        size_t index = 0;
+        for (const auto &group_pair : groups_)
+        {
+            groups[index++] = group_pair.second;
+        }
+    }
+
+    void ProcessGroup::restoreGroups(const std::vector<Group> &groups)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        groups_.clear();
+        process_group_map_.clear();
+        next_group_id_ = 1;
+        for (const auto &group : groups)
+        {
+            groups_[group.id] = group;
+            for (pid_t pid : group.processes)
+            {
+                process_group_map_[pid] = group.id;
+            }
+            next_group_id_ = std::max(next_group_id_, group.id + 1);
+        }
+        ++modification_count_;
+    }
+
+    bool ProcessGroup::updateGroupStats(const CancellationToken &cancel)
     {
         std::lock_guard<std::mutex> lock(mutex_);
 
-        // Reset all group stats
         for (auto &group_pair : groups_)
         {
             Group &group = group_pair.second;
-            group.total_cpu_usage = 0.0;
-            group.total_memory_usage = 0;
+
+            // Total into locals so a cancelled update leaves this group as it was
+            double total_cpu_usage = 0.0;
+            long total_memory_usage = 0;
 
             // Remove any processes that no longer exist
             std::set<pid_t> to_remove;
             for (pid_t pid : group.processes)
             {
-                // Use correct namespace
+                if (cancel.stopRequested())
+                {
+                    return false;
+                }
+
                 if (!qnx::exists(pid))
                 {
                     to_remove.insert(pid);
-                    process_group_map_.erase(pid);
                 }
                 else
                 {
                     // Add current process stats to group totals
-                    // Use correct namespace
                     auto proc_info = qnx::getProcessInfo(pid);
                     if (proc_info)
                     {
-                        group.total_cpu_usage += proc_info->cpu_usage;
-                        group.total_memory_usage += proc_info->memory_usage;
+                        total_cpu_usage += proc_info->cpu_usage;
+                        total_memory_usage += proc_info->memory_usage;
                     }
                 }
             }
 
+            group.total_cpu_usage = total_cpu_usage;
+            group.total_memory_usage = total_memory_usage;
+
             // Remove dead processes
             for (pid_t pid : to_remove)
             {
                 group.processes.erase(pid);
+                process_group_map_.erase(pid);
             }
+            if (!to_remove.empty())
+                ++modification_count_;
         }
+        return true;
     }
 }
\ No newline at end of file
@@ -113,6 +113,31 @@ namespace qnx
         history_data_.erase(pid);
     }
 
+    /**
+     * @brief Replace all historical data
+     *
+     * Used when taking over from a previous server process. Only the newest
+     * max_entries_per_process_ entries of at most max_tracked_processes_
+     * processes are kept, as addEntry() would have.
+     *
+     * @param history Entries per process, oldest first
+     */
+    void ProcessHistory::restoreHistory(const std::map<pid_t, std::vector<ProcessHistoryEntry>> &history)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        history_data_.clear();
+        for (const auto &pair : history)
+        {
+            if (history_data_.size() >= max_tracked_processes_)
+            {
+                break;
+            }
+            const auto &entries = pair.second;
+            size_t skip = entries.size() > max_entries_per_process_ ? entries.size() - max_entries_per_process_ : 0;
+            history_data_[pair.first].assign(entries.begin() + skip, entries.end());
+        }
+    }
+
     /**
      * @brief Clear all historical data for all processes
      *
@@ -133,16 +158,20 @@ namespace qnx
      * Returns a map containing all historical entries for all tracked processes.
      * The map is keyed by process ID, and the value is a vector of ProcessHistoryEntry objects.
      *
-     * Thread-safe through mutex locking of the history data.
+     * Thread-safe through mutex locking of the history data. The copy holds
+     * the lock, so it checks the cancellation token between processes and
+     * gives up (throwing RequestCancelled) instead of delaying the collector.
      *
+     * @param cancel Cancellation token of the request asking for the history
      * @return A map of process ID to vector of ProcessHistoryEntry objects
      */
-    std::map<pid_t, std::vector<ProcessHistoryEntry>> ProcessHistory::getAllHistory() const
+    std::map<pid_t, std::vector<ProcessHistoryEntry>> ProcessHistory::getAllHistory(const CancellationToken &cancel) const
     {
         std::lock_guard<std::mutex> lock(mutex_);
         std::map<pid_t, std::vector<ProcessHistoryEntry>> result;
         for (const auto &pair : history_data_)
         {
+            cancel.throwIfStopped();
             result.emplace(pair.first, std::vector<ProcessHistoryEntry>(pair.second.begin(), pair.second.end()));
         }
         return result;
@@ -0,0 +1,125 @@
+/**
+ * @file ProcessQuery.cpp
+ * @brief Implementation of process list selection for QNX Remote Process Monitor
+ *
+ * This file implements the ProcessQuery helpers used by the listing command
+ * and by push subscriptions to select a view of the collected process list.
+ */
+
+#include "ProcessQuery.hpp"
+#include "ProcessGroup.hpp"
+#include <algorithm>
+#include <set>
+
+namespace qnx
+{
+    bool ProcessQuery::parseKind(const std::string &name, Kind &kind)
+    {
+        if (name == "all")
+            kind = Kind::ALL;
+        else if (name == "top")
+            kind = Kind::TOP;
+        else if (name == "pids")
+            kind = Kind::PIDS;
+        else if (name == "group")
+            kind = Kind::GROUP;
+        else
+            return false;
+        return true;
+    }
+
+    const char *ProcessQuery::normalize()
+    {
+        switch (kind)
+        {
+        case Kind::ALL:
+            return nullptr;
+        case Kind::TOP:
+            if (top_k == 0 || top_k > MAX_TOP_K)
+                return "Missing or invalid 'k'";
+            return nullptr;
+        case Kind::PIDS:
+            std::sort(pids.begin(), pids.end());
+            pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+            if (pids.empty() || pids.size() > MAX_PIDS)
+                return "Missing or invalid 'pids'";
+            return nullptr;
+        case Kind::GROUP:
+            if (group_id < 0)
+                return "Missing or invalid 'group_id'";
+            return nullptr;
+        }
+        return "Unknown topic";
+    }
+
+    std::string ProcessQuery::key() const
+    {
+        switch (kind)
+        {
+        case Kind::TOP:
+            return "top:" + std::to_string(top_k);
+        case Kind::PIDS:
+        {
+            std::string key = "pids:";
+            for (size_t i = 0; i < pids.size(); ++i)
+            {
+                if (i > 0)
+                    key += ',';
+                key += std::to_string(pids[i]);
+            }
+            return key;
+        }
+        case Kind::GROUP:
+            return "group:" + std::to_string(group_id);
+        case Kind::ALL:
+        default:
+            return "all";
+        }
+    }
+
+    std::vector<const ProcessInfo *> ProcessQuery::select(const std::vector<ProcessInfo> &processes) const
+    {
+        std::vector<const ProcessInfo *> selected;
+
+        switch (kind)
+        {
+        case Kind::ALL:
+            selected.reserve(processes.size());
+            for (const auto &info : processes)
+                selected.push_back(&info);
+            break;
+        case Kind::TOP:
+        {
+            // Only pointers are ordered, and only the first k of them
+            selected.reserve(processes.size());
+            for (const auto &info : processes)
+                selected.push_back(&info);
+            size_t k = std::min(top_k, selected.size());
+            std::partial_sort(selected.begin(), selected.begin() + k, selected.end(),
+                              [](const ProcessInfo *a, const ProcessInfo *b)
+                              { return a->getCpuUsage() > b->getCpuUsage(); });
+            selected.resize(k);
+            break;
+        }
+        case Kind::PIDS:
+            for (const auto &info : processes)
+            {
+                if (std::binary_search(pids.begin(), pids.end(), info.getPid()))
+                    selected.push_back(&info);
+            }
+            break;
+        case Kind::GROUP:
+        {
+            std::set<pid_t> members = ProcessGroup::getInstance().getProcessesInGroup(group_id);
+            for (const auto &info : processes)
+            {
+                if (members.count(info.getPid()) > 0)
+                    selected.push_back(&info);
+            }
+            break;
+        }
+        }
+
+        return selected;
+    }
+} // namespace qnx
@@ -0,0 +1,141 @@
+/**
+ * @file RequestArena.cpp
+ * @brief Implementation of the per-thread request arena for QNX Remote Process Monitor
+ *
+ * The blocks form a singly-linked list. Allocations are bumped from the
+ * current block; the blocks after it are free and are reused, in order,
+ * before a new one is added. A scope remembers the current block and
+ * offset when it starts and restores them when it ends.
+ */
+
+#include "RequestArena.hpp"
+#include <algorithm>
+
+namespace qnx
+{
+    struct alignas(std::max_align_t) RequestArena::Block
+    {
+        Block *next;
+        size_t size; ///< Bytes of memory following the header
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+    RequestArena &RequestArena::forThread()
+    {
+        thread_local RequestArena arena;
+        return arena;
+    }
+
+    RequestArena::~RequestArena()
+    {
+        while (head_)
+        {
+            Block *next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+    }
+
+    void *RequestArena::allocate(size_t size, size_t alignment)
+    {
+        if (current_)
+        {
+            const size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+            if (start <= current_->size && size <= current_->size - start)
+            {
+                offset_ = start + size;
+                return current_->data() + start;
+            }
+        }
+        // A block starts out aligned for any type
+        grow(size);
+        offset_ = size;
+        return current_->data();
+    }
+
+    void RequestArena::release(void *pointer, size_t size) noexcept
+    {
+        char *end = static_cast<char *>(pointer) + size;
+        if (current_ && end == current_->data() + offset_ && size <= offset_)
+        {
+            offset_ -= size;
+        }
+    }
+
+    size_t RequestArena::used() const noexcept
+    {
+        if (!current_)
+            return 0;
+        size_t total = offset_;
+        for (const Block *block = head_; block != current_; block = block->next)
+        {
+            total += block->size;
+        }
+        return total;
+    }
+
+    void RequestArena::grow(size_t size)
+    {
+        Block *next = current_ ? current_->next : head_;
+        if (next && next->size >= size)
+        {
+            current_ = next;
+            offset_ = 0;
+            return;
+        }
+
+        // Too small free blocks stay where they are, for smaller allocations later
+        const size_t block_size = std::max(size, BLOCK_SIZE);
+        Block *block = static_cast<Block *>(::operator new(sizeof(Block) + block_size));
+        block->next = next;
+        block->size = block_size;
+        if (current_)
+            current_->next = block;
+        else
+            head_ = block;
+        current_ = block;
+        offset_ = 0;
+        capacity_ += block_size;
+    }
+
+    void RequestArena::trim() noexcept
+    {
+        size_t retained = 0;
+        Block **link = &head_;
+        while (*link)
+        {
+            Block *block = *link;
+            if (retained + block->size <= MAX_RETAINED)
+            {
+                retained += block->size;
+                link = &block->next;
+                continue;
+            }
+            // Grown for an unusually large request
+            *link = block->next;
+            capacity_ -= block->size;
+            ::operator delete(block);
+        }
+    }
+
+    RequestArena::Scope::Scope()
+        : arena_(RequestArena::forThread()), block_(arena_.current_), offset_(arena_.offset_)
+    {
+        ++arena_.depth_;
+    }
+
+    RequestArena::Scope::~Scope()
+    {
+        if (--arena_.depth_ == 0)
+        {
+            // Also takes back anything allocated outside a scope
+            arena_.current_ = nullptr;
+            arena_.offset_ = 0;
+            arena_.trim();
+            return;
+        }
+        arena_.current_ = block_;
+        arena_.offset_ = offset_;
+    }
+} // namespace qnx
@@ -0,0 +1,123 @@
+/**
+ * @file RequestCoalescer.cpp
+ * @brief Implementation of single-flight request execution for QNX Remote Process Monitor
+ */
+
+#include "RequestCoalescer.hpp"
+#include <algorithm>
+
+namespace qnx
+{
+    RequestCoalescer &RequestCoalescer::getInstance()
+    {
+        static RequestCoalescer instance;
+        return instance;
+    }
+
+    RequestCoalescer::RequestCoalescer()
+    {
+        idle_.reserve(MAX_IDLE);
+        spare_.reserve(MAX_IDLE);
+    }
+
+    std::shared_ptr<const std::string> RequestCoalescer::run(std::string_view key, const Producer &produce, bool &shared)
+    {
+        std::shared_ptr<Flight> flight;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto it = flights_.find(key);
+            if (it != flights_.end())
+            {
+                // Another worker is computing the same result: wait for it
+                flight = it->second;
+                done_.wait(lock, [&flight]
+                           { return flight->done; });
+                shared = true;
+                if (flight->error)
+                {
+                    std::rethrow_exception(flight->error);
+                }
+                // Owns the flight, which is not reused while the result is held
+                return std::shared_ptr<const std::string>(flight, &flight->result);
+            }
+            flight = startFlight(key);
+        }
+
+        shared = false;
+        std::string result;
+        std::exception_ptr error;
+        try
+        {
+            result = produce();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flight->done = true;
+            flight->result = std::move(result);
+            flight->error = error;
+            finishFlight(flight);
+        }
+        done_.notify_all();
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return std::shared_ptr<const std::string>(flight, &flight->result);
+    }
+
+    std::shared_ptr<RequestCoalescer::Flight> RequestCoalescer::startFlight(std::string_view key)
+    {
+        // References to a flight are only taken under the mutex, from flights_,
+        // so an idle flight that nothing else holds stays unused
+        std::shared_ptr<Flight> flight;
+        auto idle = std::find_if(idle_.begin(), idle_.end(), [](const std::shared_ptr<Flight> &candidate)
+                                 { return candidate.use_count() == 1; });
+        if (idle != idle_.end())
+        {
+            flight = std::move(*idle);
+            *idle = std::move(idle_.back());
+            idle_.pop_back();
+            flight->done = false;
+            flight->error = nullptr;
+        }
+        else
+        {
+            flight = std::make_shared<Flight>();
+        }
+        flight->key.assign(key.data(), key.size());
+
+        if (spare_.empty())
+        {
+            flights_.emplace(flight->key, flight);
+        }
+        else
+        {
+            FlightTable::node_type node = std::move(spare_.back());
+            spare_.pop_back();
+            node.key() = flight->key;
+            node.mapped() = flight;
+            flights_.insert(std::move(node));
+        }
+        return flight;
+    }
+
+    void RequestCoalescer::finishFlight(const std::shared_ptr<Flight> &flight)
+    {
+        FlightTable::node_type node = flights_.extract(flight->key);
+        node.mapped().reset();
+        if (spare_.size() < MAX_IDLE)
+        {
+            spare_.push_back(std::move(node));
+        }
+        if (idle_.size() < MAX_IDLE && flight->result.capacity() <= MAX_IDLE_RESULT)
+        {
+            idle_.push_back(flight);
+        }
+    }
+} // namespace qnx
@@ -0,0 +1,102 @@
+/**
+ * @file ResponseCache.cpp
+ * @brief Implementation of the encoded response cache for QNX Remote Process Monitor
+ */
+
+#include "ResponseCache.hpp"
+#include "ServerStats.hpp"
+
+namespace qnx
+{
+    ResponseCache &ResponseCache::getInstance()
+    {
+        static ResponseCache instance;
+        return instance;
+    }
+
+    void ResponseCache::setBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = bytes;
+        evict();
+        reportUsage();
+    }
+
+    std::shared_ptr<const std::string> ResponseCache::find(std::string_view key, uint64_t generation)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        advance(generation);
+
+        auto it = index_.find(key);
+        if (it == index_.end() || generation < generation_)
+        {
+            ServerStats::getInstance().recordCacheLookup(false);
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        ServerStats::getInstance().recordCacheLookup(true);
+        return it->second->response;
+    }
+
+    void ResponseCache::insert(std::string_view key, uint64_t generation, std::shared_ptr<const std::string> response)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        advance(generation);
+        if (generation < generation_ || !response || key.size() + response->size() > budget_)
+        {
+            return;
+        }
+
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            // The index key points into the entry, so it goes first
+            const auto entry = it->second;
+            bytes_ -= entrySize(*entry);
+            index_.erase(it);
+            lru_.erase(entry);
+        }
+
+        // The index refers to the entry's copy of the key, which list nodes keep in place
+        lru_.push_front(Entry{std::string(key), std::move(response)});
+        index_.emplace(lru_.front().key, lru_.begin());
+        bytes_ += entrySize(lru_.front());
+        evict();
+        reportUsage();
+    }
+
+    void ResponseCache::advance(uint64_t generation)
+    {
+        if (generation <= generation_)
+        {
+            return;
+        }
+        // A new snapshot was published: everything cached so far is stale
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+        generation_ = generation;
+        reportUsage();
+    }
+
+    void ResponseCache::evict()
+    {
+        size_t evicted = 0;
+        while (bytes_ > budget_ && !lru_.empty())
+        {
+            bytes_ -= entrySize(lru_.back());
+            index_.erase(lru_.back().key);
+            lru_.pop_back();
+            ++evicted;
+        }
+        if (evicted > 0)
+        {
+            ServerStats::getInstance().recordCacheEvictions(evicted);
+        }
+    }
+
+    void ResponseCache::reportUsage() const
+    {
+        ServerStats::getInstance().recordCacheUsage(lru_.size(), bytes_);
+    }
+} // namespace qnx
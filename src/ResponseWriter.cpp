@@ -0,0 +1,982 @@
+/**
+ * @file ResponseWriter.cpp
+ * @brief Implementation of the response encoders for QNX Remote Process Monitor
+ *
+ * This file implements the JSON, binary and CBOR ResponseWriter classes. The
+ * JSON writer is a thin adapter over the in-tree JsonEncoder; the binary
+ * writer encodes fixed-width little-endian fields into a body buffer while
+ * building the string dictionary, and prepends the frame header and
+ * dictionary when the response is finished; the CBOR writer appends CBOR
+ * items behind a reserved frame header.
+ */
+
+#include "ResponseWriter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace qnx
+{
+    namespace
+    {
+        void appendLittleEndian(std::string &out, uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+
+        uint64_t readLittleEndian(const std::string &in, size_t offset, int bytes)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i)
+                value |= static_cast<uint64_t>(static_cast<uint8_t>(in[offset + i])) << (8 * i);
+            return value;
+        }
+
+        // CBOR major types and simple values (RFC 8949)
+        namespace cbor
+        {
+            constexpr uint8_t UNSIGNED = 0;
+            constexpr uint8_t NEGATIVE = 1;
+            constexpr uint8_t TEXT = 3;
+            constexpr uint8_t FALSE_VALUE = 0xF4;
+            constexpr uint8_t TRUE_VALUE = 0xF5;
+            constexpr uint8_t FLOAT32 = 0xFA;
+            constexpr uint8_t FLOAT64 = 0xFB;
+            constexpr uint8_t MAP_START = 0xBF;   ///< Indefinite-length map
+            constexpr uint8_t ARRAY_START = 0x9F; ///< Indefinite-length array
+            constexpr uint8_t BREAK = 0xFF;       ///< End of an indefinite-length item
+        }
+
+        // Item head: major type and argument in the shortest form, big-endian
+        void appendCborHead(std::string &out, uint8_t major, uint64_t argument)
+        {
+            const uint8_t type = static_cast<uint8_t>(major << 5);
+            if (argument < 24)
+            {
+                out.push_back(static_cast<char>(type | argument));
+                return;
+            }
+            const int bytes = argument <= 0xFF ? 1 : argument <= 0xFFFF ? 2 : argument <= 0xFFFFFFFF ? 4 : 8;
+            char head[9];
+            head[0] = static_cast<char>(type | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27));
+            for (int i = 0; i < bytes; ++i)
+                head[1 + i] = static_cast<char>((argument >> (8 * (bytes - 1 - i))) & 0xFF);
+            out.append(head, static_cast<size_t>(1 + bytes));
+        }
+
+        void appendCborText(std::string &out, std::string_view text)
+        {
+            appendCborHead(out, cbor::TEXT, text.size());
+            out.append(text.data(), text.size());
+        }
+
+        void appendCborInt(std::string &out, long long value)
+        {
+            if (value >= 0)
+                appendCborHead(out, cbor::UNSIGNED, static_cast<uint64_t>(value));
+            else
+                appendCborHead(out, cbor::NEGATIVE, ~static_cast<uint64_t>(value)); // -1 - value
+        }
+
+        void storeLittleEndian(std::string &out, size_t offset, uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+                out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+
+        // Insert a member whose value append_value(out, format) encodes in the
+        // response's format; a binary value is the bytes following the tag.
+        // The member is written straight into the result, which value_size
+        // (an estimate of the encoded value's size) lets be reserved once.
+        template <typename AppendValue>
+        std::string prependEncodedMember(const std::string &response, const char *name, uint8_t tag,
+                                         size_t value_size, AppendValue append_value)
+        {
+            if (response.empty())
+            {
+                return std::string();
+            }
+
+            const std::string_view key(name);
+            // Member name, its framing and value
+            const size_t member_size = 2 * key.size() + value_size + 16;
+
+            if (static_cast<uint8_t>(response[0]) != wire::FRAME_MAGIC)
+            {
+                size_t open = response.find_first_not_of(" \t\r\n");
+                if (open == std::string::npos || response[open] != '{')
+                {
+                    return std::string();
+                }
+                size_t next = response.find_first_not_of(" \t\r\n", open + 1);
+                std::string result;
+                result.reserve(response.size() + member_size);
+                result.append(response, 0, open + 1);
+                appendJsonString(result, key);
+                result.push_back(':');
+                append_value(result, WireFormat::JSON);
+                if (next != std::string::npos && response[next] != '}')
+                {
+                    result.push_back(',');
+                }
+                result.append(response, open + 1, std::string::npos);
+                return result;
+            }
+
+            // Only plain (uncompressed) frames can be edited
+            if (response.size() < wire::FRAME_HEADER_SIZE + 2 || response[2] != 0)
+            {
+                return std::string();
+            }
+
+            if (static_cast<uint8_t>(response[1]) == wire::ENCODING_CBOR)
+            {
+                if (static_cast<uint8_t>(response[wire::FRAME_HEADER_SIZE]) != cbor::MAP_START)
+                    return std::string();
+                std::string result;
+                result.reserve(response.size() + member_size);
+                result.append(response, 0, wire::FRAME_HEADER_SIZE + 1);
+                appendCborText(result, key);
+                append_value(result, WireFormat::CBOR);
+                result.append(response, wire::FRAME_HEADER_SIZE + 1, std::string::npos);
+
+                const uint64_t payload_size = result.size() - wire::FRAME_HEADER_SIZE;
+                if (payload_size > std::numeric_limits<uint32_t>::max())
+                    return std::string();
+                storeLittleEndian(result, 4, payload_size, 4);
+                return result;
+            }
+            if (static_cast<uint8_t>(response[1]) != wire::ENCODING_BINARY)
+            {
+                return std::string();
+            }
+
+            // Walk the dictionary to find the member name, or append it as a new entry
+            const size_t count = readLittleEndian(response, wire::FRAME_HEADER_SIZE, 2);
+            size_t offset = wire::FRAME_HEADER_SIZE + 2;
+            long index = -1;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (offset + 2 > response.size())
+                    return std::string();
+                size_t length = readLittleEndian(response, offset, 2);
+                if (offset + 2 + length > response.size())
+                    return std::string();
+                if (index < 0 && std::string_view(response).substr(offset + 2, length) == key)
+                    index = static_cast<long>(i);
+                offset += 2 + length;
+            }
+            const size_t body = offset;
+            if (body >= response.size() || static_cast<uint8_t>(response[body]) != wire::TAG_OBJECT_START)
+            {
+                return std::string();
+            }
+            const bool new_entry = index < 0;
+            if (new_entry)
+            {
+                if (count >= 0xFFFF || key.size() > 0xFFFF)
+                    return std::string();
+                index = static_cast<long>(count);
+            }
+
+            std::string result;
+            result.reserve(response.size() + member_size);
+            result.append(response, 0, wire::FRAME_HEADER_SIZE);
+            appendLittleEndian(result, count + (new_entry ? 1 : 0), 2);
+            result.append(response, wire::FRAME_HEADER_SIZE + 2, body - wire::FRAME_HEADER_SIZE - 2);
+            if (new_entry)
+            {
+                appendLittleEndian(result, key.size(), 2);
+                result.append(key);
+            }
+            result.push_back(static_cast<char>(wire::TAG_OBJECT_START));
+            result.push_back(static_cast<char>(tag));
+            appendLittleEndian(result, static_cast<uint64_t>(index), 2);
+            append_value(result, WireFormat::BINARY);
+            result.append(response, body + 1, std::string::npos);
+
+            const uint64_t payload_size = result.size() - wire::FRAME_HEADER_SIZE;
+            if (payload_size > std::numeric_limits<uint32_t>::max())
+            {
+                return std::string();
+            }
+            storeLittleEndian(result, 4, payload_size, 4);
+            return result;
+        }
+    }
+
+    std::unique_ptr<ResponseWriter> ResponseWriter::create(WireFormat format)
+    {
+        if (format == WireFormat::BINARY)
+        {
+            return std::make_unique<BinaryResponseWriter>();
+        }
+        if (format == WireFormat::CBOR)
+        {
+            return std::make_unique<CborResponseWriter>();
+        }
+        return std::make_unique<JsonResponseWriter>();
+    }
+
+    namespace
+    {
+        constexpr size_t POOL_SIZE = 4; // Idle writers kept per thread and wire format
+
+        // Nested responses (an error reply while a shared one is built) need a few at once
+        thread_local std::vector<std::unique_ptr<ResponseWriter>> writer_pool[WIRE_FORMAT_COUNT];
+
+        std::vector<std::unique_ptr<ResponseWriter>> &poolFor(WireFormat format)
+        {
+            return writer_pool[static_cast<size_t>(format)];
+        }
+    }
+
+    PooledResponseWriter ResponseWriter::acquire(WireFormat format)
+    {
+        auto &pool = poolFor(format);
+        if (pool.empty())
+            return PooledResponseWriter(create(format).release(), ResponseWriterRelease{format});
+        PooledResponseWriter writer(pool.back().release(), ResponseWriterRelease{format});
+        pool.pop_back();
+        return writer;
+    }
+
+    void ResponseWriterRelease::operator()(ResponseWriter *writer) const
+    {
+        std::unique_ptr<ResponseWriter> owned(writer);
+        auto &pool = poolFor(format);
+        if (pool.size() < POOL_SIZE && owned->capacity() <= ResponseWriter::MAX_POOLED_CAPACITY)
+        {
+            owned->reset();
+            pool.push_back(std::move(owned));
+        }
+    }
+
+    namespace
+    {
+        constexpr int MAX_PERCENTAGE_DECIMALS = 9;
+
+        std::atomic<int> percentage_decimals{-1}; // Negative: full precision
+    }
+
+    void ResponseWriter::setPercentageDecimals(int decimals)
+    {
+        percentage_decimals.store(std::min(decimals, MAX_PERCENTAGE_DECIMALS), std::memory_order_relaxed);
+    }
+
+    void ResponseWriter::addPercentage(const char *name, double value)
+    {
+        addDouble(name, roundPercentage(value));
+    }
+
+    double ResponseWriter::roundPercentage(double value)
+    {
+        const int decimals = percentage_decimals.load(std::memory_order_relaxed);
+        if (decimals >= 0 && std::isfinite(value))
+        {
+            // The nearest double to the rounded decimal, which prints as exactly that decimal
+            static const double SCALES[MAX_PERCENTAGE_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+            const double scale = SCALES[decimals];
+            if (std::fabs(value) < 1e15 / scale)
+                value = std::round(value * scale) / scale;
+        }
+        return value;
+    }
+
+    std::string ResponseWriter::prependMember(const std::string &response, const char *name, std::string_view value)
+    {
+        // A literal keeps the dictionary unchanged apart from the member name
+        return prependEncodedMember(response, name, wire::TAG_STRING_LITERAL, value.size(),
+                                    [value](std::string &out, WireFormat format)
+                                    {
+                                        if (format == WireFormat::JSON)
+                                        {
+                                            appendJsonString(out, value);
+                                        }
+                                        else if (format == WireFormat::CBOR)
+                                        {
+                                            appendCborText(out, value);
+                                        }
+                                        else
+                                        {
+                                            appendLittleEndian(out, value.size(), 4);
+                                            out.append(value.data(), value.size());
+                                        }
+                                    });
+    }
+
+    std::string ResponseWriter::prependMember(const std::string &response, const char *name, long long value)
+    {
+        const bool int32 = value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max();
+        return prependEncodedMember(response, name, int32 ? wire::TAG_INT32 : wire::TAG_INT64, MAX_NUMBER_LENGTH,
+                                    [value, int32](std::string &out, WireFormat format)
+                                    {
+                                        if (format == WireFormat::JSON)
+                                        {
+                                            char digits[MAX_NUMBER_LENGTH];
+                                            out.append(digits, static_cast<size_t>(formatInteger(digits, value) - digits));
+                                        }
+                                        else if (format == WireFormat::CBOR)
+                                        {
+                                            appendCborInt(out, value);
+                                        }
+                                        else if (int32)
+                                        {
+                                            appendLittleEndian(out, static_cast<uint32_t>(static_cast<int32_t>(value)), 4);
+                                        }
+                                        else
+                                        {
+                                            appendLittleEndian(out, static_cast<uint64_t>(value), 8);
+                                        }
+                                    });
+    }
+
+    // ---------------------------------------------------------------------
+    // JsonResponseWriter
+    // ---------------------------------------------------------------------
+
+    void JsonResponseWriter::startObject(const char *name)
+    {
+        encoder_.startObject(name);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::endObject()
+    {
+        encoder_.endObject();
+        flushChunk();
+    }
+
+    void JsonResponseWriter::startArray(const char *name)
+    {
+        encoder_.startArray(name);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::endArray()
+    {
+        encoder_.endArray();
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addString(const char *name, const char *value)
+    {
+        encoder_.addString(name, value ? value : "");
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addInt(const char *name, long long value)
+    {
+        encoder_.addInt(name, value);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addDouble(const char *name, double value)
+    {
+        encoder_.addDouble(name, value);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addBool(const char *name, bool value)
+    {
+        encoder_.addBool(name, value);
+        flushChunk();
+    }
+
+    bool JsonResponseWriter::addEncoded(const char *name, const std::string &response)
+    {
+        if (response.empty())
+            return false;
+        encoder_.addRaw(name, response);
+        flushChunk();
+        return true;
+    }
+
+    WireFormat JsonResponseWriter::format() const
+    {
+        return WireFormat::JSON;
+    }
+
+    void JsonResponseWriter::addField(const FieldKey &key, long long value)
+    {
+        encoder_.addInt(key, value);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addField(const FieldKey &key, double value)
+    {
+        encoder_.addDouble(key, value);
+        flushChunk();
+    }
+
+    void JsonResponseWriter::addField(const FieldKey &key, const char *value)
+    {
+        encoder_.addString(key, value ? value : "");
+        flushChunk();
+    }
+
+    std::string JsonResponseWriter::finish()
+    {
+        if (streamed() && !encoder_.valid())
+            stream_failed_ = true;
+        // A writer too large to be pooled gives its buffer away instead of copying it
+        if (capacity() > MAX_POOLED_CAPACITY || !encoder_.valid())
+            return encoder_.take();
+        return encoder_.buffer();
+    }
+
+    void JsonResponseWriter::reset()
+    {
+        encoder_.reset();
+        sink_ = nullptr;
+        stream_failed_ = false;
+    }
+
+    void JsonResponseWriter::streamTo(ChunkSink sink)
+    {
+        sink_ = std::move(sink);
+    }
+
+    void JsonResponseWriter::sendChunk()
+    {
+        // The chunk is moved on, not copied
+        std::string chunk = encoder_.takeChunk();
+        if (sink_(std::move(chunk)))
+            return;
+        // Declined: the rest of the document is kept whole for finish()
+        encoder_.returnChunk(std::move(chunk));
+        sink_ = nullptr;
+    }
+
+    size_t JsonResponseWriter::capacity() const
+    {
+        return encoder_.buffer().capacity();
+    }
+
+    // ---------------------------------------------------------------------
+    // BinaryResponseWriter
+    // ---------------------------------------------------------------------
+
+    void BinaryResponseWriter::startObject(const char *name)
+    {
+        writeKeyAndTag(name, wire::TAG_OBJECT_START);
+    }
+
+    void BinaryResponseWriter::endObject()
+    {
+        body_.push_back(static_cast<char>(wire::TAG_OBJECT_END));
+    }
+
+    void BinaryResponseWriter::startArray(const char *name)
+    {
+        writeKeyAndTag(name, wire::TAG_ARRAY_START);
+    }
+
+    void BinaryResponseWriter::endArray()
+    {
+        body_.push_back(static_cast<char>(wire::TAG_ARRAY_END));
+    }
+
+    template <typename Key>
+    void BinaryResponseWriter::writeString(const Key &key, const char *value)
+    {
+        std::string_view text(value ? value : "");
+        int index = intern(text, MAX_VALUE_DICTIONARY_SIZE);
+        if (index >= 0)
+        {
+            writeKeyAndTag(key, wire::TAG_STRING);
+            writeU16(static_cast<uint16_t>(index));
+        }
+        else
+        {
+            writeKeyAndTag(key, wire::TAG_STRING_LITERAL);
+            writeU32(static_cast<uint32_t>(text.size()));
+            body_.append(text.data(), text.size());
+        }
+    }
+
+    template <typename Key>
+    void BinaryResponseWriter::writeInt(const Key &key, long long value)
+    {
+        if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max())
+        {
+            writeKeyAndTag(key, wire::TAG_INT32);
+            writeU32(static_cast<uint32_t>(static_cast<int32_t>(value)));
+        }
+        else
+        {
+            writeKeyAndTag(key, wire::TAG_INT64);
+            writeU64(static_cast<uint64_t>(value));
+        }
+    }
+
+    template <typename Key>
+    void BinaryResponseWriter::writeDouble(const Key &key, double value)
+    {
+        uint64_t bits;
+        static_assert(sizeof(bits) == sizeof(value), "double must be 64 bits");
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeKeyAndTag(key, wire::TAG_FLOAT64);
+        writeU64(bits);
+    }
+
+    void BinaryResponseWriter::addString(const char *name, const char *value)
+    {
+        writeString(name, value);
+    }
+
+    void BinaryResponseWriter::addInt(const char *name, long long value)
+    {
+        writeInt(name, value);
+    }
+
+    void BinaryResponseWriter::addDouble(const char *name, double value)
+    {
+        writeDouble(name, value);
+    }
+
+    void BinaryResponseWriter::addField(const FieldKey &key, long long value)
+    {
+        writeInt(key, value);
+    }
+
+    void BinaryResponseWriter::addField(const FieldKey &key, double value)
+    {
+        writeDouble(key, value);
+    }
+
+    void BinaryResponseWriter::addField(const FieldKey &key, const char *value)
+    {
+        writeString(key, value);
+    }
+
+    void BinaryResponseWriter::addBool(const char *name, bool value)
+    {
+        writeKeyAndTag(name, value ? wire::TAG_TRUE : wire::TAG_FALSE);
+    }
+
+    bool BinaryResponseWriter::addEncoded(const char *name, const std::string &response)
+    {
+        if (response.size() < wire::FRAME_HEADER_SIZE + 3 ||
+            static_cast<uint8_t>(response[0]) != wire::FRAME_MAGIC ||
+            static_cast<uint8_t>(response[1]) != wire::ENCODING_BINARY || response[2] != 0 ||
+            readLittleEndian(response, 4, 4) != response.size() - wire::FRAME_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        const size_t end = response.size();
+        size_t offset = wire::FRAME_HEADER_SIZE;
+        std::vector<std::string> dictionary(readLittleEndian(response, offset, 2));
+        offset += 2;
+        for (std::string &entry : dictionary)
+        {
+            if (offset + 2 > end)
+                return false;
+            const size_t length = readLittleEndian(response, offset, 2);
+            offset += 2;
+            if (offset + length > end)
+                return false;
+            entry.assign(response, offset, length);
+            offset += length;
+        }
+
+        if (offset >= end)
+            return false;
+        const uint8_t tag = static_cast<uint8_t>(response[offset++]);
+
+        // Strings interned along the way stay in the dictionary, which is harmless
+        const size_t body_size = body_.size();
+        if (!copyValue(response, offset, end, dictionary, tag, name, 0) || offset != end)
+        {
+            body_.resize(body_size);
+            return false;
+        }
+        return true;
+    }
+
+    WireFormat BinaryResponseWriter::format() const
+    {
+        return WireFormat::BINARY;
+    }
+
+    std::string BinaryResponseWriter::finish()
+    {
+        size_t payload_size = 2 + dictionary_bytes_ + body_.size();
+        if (payload_size > std::numeric_limits<uint32_t>::max())
+        {
+            return std::string();
+        }
+
+        std::string frame;
+        frame.reserve(wire::FRAME_HEADER_SIZE + payload_size);
+        frame.push_back(static_cast<char>(wire::FRAME_MAGIC));
+        frame.push_back(static_cast<char>(wire::ENCODING_BINARY));
+        frame.push_back(0); // flags
+        frame.push_back(0); // codec (uncompressed)
+        for (int shift = 0; shift < 32; shift += 8)
+            frame.push_back(static_cast<char>((payload_size >> shift) & 0xFF));
+
+        uint16_t count = static_cast<uint16_t>(entry_ends_.size());
+        frame.push_back(static_cast<char>(count & 0xFF));
+        frame.push_back(static_cast<char>(count >> 8));
+        for (size_t index = 0; index < entry_ends_.size(); ++index)
+        {
+            const std::string_view value = entry(index);
+            uint16_t length = static_cast<uint16_t>(value.size());
+            frame.push_back(static_cast<char>(length & 0xFF));
+            frame.push_back(static_cast<char>(length >> 8));
+            frame.append(value.data(), value.size());
+        }
+        frame.append(body_);
+        return frame;
+    }
+
+    void BinaryResponseWriter::reset()
+    {
+        body_.clear();
+        dictionary_.clear();
+        entry_ends_.clear();
+        dictionary_bytes_ = 0;
+        // A new stamp empties the hash table without touching it
+        if (++stamp_ == 0)
+        {
+            std::fill(table_.begin(), table_.end(), IndexSlot{0, 0});
+            stamp_ = 1;
+        }
+        std::fill(std::begin(key_cache_), std::end(key_cache_), KeySlot{});
+    }
+
+    size_t BinaryResponseWriter::capacity() const
+    {
+        return body_.capacity() + dictionary_.capacity() + entry_ends_.capacity() * sizeof(uint32_t) +
+               table_.capacity() * sizeof(IndexSlot);
+    }
+
+    int BinaryResponseWriter::intern(std::string_view value, size_t limit)
+    {
+        // At most half full, so probe sequences stay short
+        if ((entry_ends_.size() + 1) * 2 > table_.size())
+        {
+            growTable();
+        }
+
+        const size_t mask = table_.size() - 1;
+        for (size_t slot = std::hash<std::string_view>()(value) & mask;; slot = (slot + 1) & mask)
+        {
+            IndexSlot &candidate = table_[slot];
+            if (candidate.stamp == stamp_)
+            {
+                if (entry(candidate.index) == value)
+                    return candidate.index;
+                continue;
+            }
+
+            if (entry_ends_.size() >= limit || value.size() > 0xFFFF)
+            {
+                return -1;
+            }
+            uint16_t index = static_cast<uint16_t>(entry_ends_.size());
+            dictionary_.append(value.data(), value.size());
+            entry_ends_.push_back(static_cast<uint32_t>(dictionary_.size()));
+            candidate = IndexSlot{stamp_, index};
+            dictionary_bytes_ += 2 + value.size();
+            return index;
+        }
+    }
+
+    std::string_view BinaryResponseWriter::entry(size_t index) const
+    {
+        const size_t begin = index == 0 ? 0 : entry_ends_[index - 1];
+        return std::string_view(dictionary_.data() + begin, entry_ends_[index] - begin);
+    }
+
+    void BinaryResponseWriter::growTable()
+    {
+        std::vector<IndexSlot> table(std::max<size_t>(table_.size() * 2, 64), IndexSlot{0, 0});
+        const size_t mask = table.size() - 1;
+        for (size_t index = 0; index < entry_ends_.size(); ++index)
+        {
+            size_t slot = std::hash<std::string_view>()(entry(index)) & mask;
+            while (table[slot].stamp == stamp_)
+                slot = (slot + 1) & mask;
+            table[slot] = IndexSlot{stamp_, static_cast<uint16_t>(index)};
+        }
+        table_.swap(table);
+    }
+
+    void BinaryResponseWriter::writeKeyAndTag(const char *name, uint8_t tag)
+    {
+        // The tag comes first so that a reader can tell an object end marker
+        // apart from the key of the next member.
+        body_.push_back(static_cast<char>(tag));
+        if (name)
+        {
+            // String values stop being interned below the dictionary limit, so
+            // member names (a small fixed set) always find room.
+            int index = intern(name, MAX_DICTIONARY_SIZE);
+            writeU16(static_cast<uint16_t>(index < 0 ? 0 : index));
+        }
+    }
+
+    void BinaryResponseWriter::writeKeyAndTag(const FieldKey &key, uint8_t tag)
+    {
+        KeySlot &slot = key_cache_[(reinterpret_cast<uintptr_t>(&key) / sizeof(FieldKey)) & (KEY_CACHE_SIZE - 1)];
+        if (slot.key != &key)
+        {
+            int index = intern(key.name, MAX_DICTIONARY_SIZE);
+            slot = KeySlot{&key, static_cast<uint16_t>(index < 0 ? 0 : index)};
+        }
+        body_.push_back(static_cast<char>(tag));
+        writeU16(slot.index);
+    }
+
+    bool BinaryResponseWriter::copyValue(const std::string &response, size_t &offset, size_t end,
+                                         const std::vector<std::string> &dictionary, uint8_t tag, const char *name, size_t depth)
+    {
+        auto fits = [&](size_t bytes)
+        { return end - offset >= bytes; };
+
+        switch (tag)
+        {
+        case wire::TAG_OBJECT_START:
+        case wire::TAG_ARRAY_START:
+        {
+            const bool object = tag == wire::TAG_OBJECT_START;
+            if (depth >= JsonDecoder::MAX_DEPTH)
+                return false;
+            object ? startObject(name) : startArray(name);
+            while (fits(1))
+            {
+                const uint8_t member = static_cast<uint8_t>(response[offset++]);
+                if (member == (object ? wire::TAG_OBJECT_END : wire::TAG_ARRAY_END))
+                {
+                    object ? endObject() : endArray();
+                    return true;
+                }
+                const char *key = nullptr;
+                if (object)
+                {
+                    if (!fits(2))
+                        return false;
+                    const size_t index = readLittleEndian(response, offset, 2);
+                    offset += 2;
+                    if (index >= dictionary.size())
+                        return false;
+                    key = dictionary[index].c_str();
+                }
+                if (!copyValue(response, offset, end, dictionary, member, key, depth + 1))
+                    return false;
+            }
+            return false;
+        }
+        case wire::TAG_INT32:
+            if (!fits(4))
+                return false;
+            addInt(name, static_cast<int32_t>(readLittleEndian(response, offset, 4)));
+            offset += 4;
+            return true;
+        case wire::TAG_INT64:
+            if (!fits(8))
+                return false;
+            addInt(name, static_cast<long long>(readLittleEndian(response, offset, 8)));
+            offset += 8;
+            return true;
+        case wire::TAG_FLOAT64:
+        {
+            if (!fits(8))
+                return false;
+            const uint64_t bits = readLittleEndian(response, offset, 8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            addDouble(name, value);
+            offset += 8;
+            return true;
+        }
+        case wire::TAG_FALSE:
+        case wire::TAG_TRUE:
+            addBool(name, tag == wire::TAG_TRUE);
+            return true;
+        case wire::TAG_STRING:
+        {
+            if (!fits(2))
+                return false;
+            const size_t index = readLittleEndian(response, offset, 2);
+            offset += 2;
+            if (index >= dictionary.size())
+                return false;
+            addString(name, dictionary[index].c_str());
+            return true;
+        }
+        case wire::TAG_STRING_LITERAL:
+        {
+            if (!fits(4))
+                return false;
+            const size_t length = readLittleEndian(response, offset, 4);
+            offset += 4;
+            if (!fits(length))
+                return false;
+            addString(name, response.substr(offset, length).c_str());
+            offset += length;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    void BinaryResponseWriter::writeU16(uint16_t value)
+    {
+        body_.push_back(static_cast<char>(value & 0xFF));
+        body_.push_back(static_cast<char>(value >> 8));
+    }
+
+    void BinaryResponseWriter::writeU32(uint32_t value)
+    {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i)
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        body_.append(bytes, sizeof(bytes));
+    }
+
+    void BinaryResponseWriter::writeU64(uint64_t value)
+    {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        body_.append(bytes, sizeof(bytes));
+    }
+
+    // ---------------------------------------------------------------------
+    // CborResponseWriter
+    // ---------------------------------------------------------------------
+
+    CborResponseWriter::CborResponseWriter()
+    {
+        reset();
+    }
+
+    void CborResponseWriter::startObject(const char *name)
+    {
+        writeKey(name);
+        frame_.push_back(static_cast<char>(cbor::MAP_START));
+    }
+
+    void CborResponseWriter::endObject()
+    {
+        frame_.push_back(static_cast<char>(cbor::BREAK));
+    }
+
+    void CborResponseWriter::startArray(const char *name)
+    {
+        writeKey(name);
+        frame_.push_back(static_cast<char>(cbor::ARRAY_START));
+    }
+
+    void CborResponseWriter::endArray()
+    {
+        frame_.push_back(static_cast<char>(cbor::BREAK));
+    }
+
+    void CborResponseWriter::addString(const char *name, const char *value)
+    {
+        writeKey(name);
+        appendCborText(frame_, value ? value : "");
+    }
+
+    void CborResponseWriter::addInt(const char *name, long long value)
+    {
+        writeKey(name);
+        appendCborInt(frame_, value);
+    }
+
+    void CborResponseWriter::addDouble(const char *name, double value)
+    {
+        writeKey(name);
+        // Single precision when it holds the value exactly; NaN always takes double precision
+        const float narrow = static_cast<float>(value);
+        uint64_t bits;
+        int bytes;
+        if (static_cast<double>(narrow) == value)
+        {
+            uint32_t narrow_bits;
+            std::memcpy(&narrow_bits, &narrow, sizeof(narrow_bits));
+            frame_.push_back(static_cast<char>(cbor::FLOAT32));
+            bits = narrow_bits;
+            bytes = 4;
+        }
+        else
+        {
+            std::memcpy(&bits, &value, sizeof(bits));
+            frame_.push_back(static_cast<char>(cbor::FLOAT64));
+            bytes = 8;
+        }
+        for (int i = bytes - 1; i >= 0; --i)
+            frame_.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+
+    void CborResponseWriter::addBool(const char *name, bool value)
+    {
+        writeKey(name);
+        frame_.push_back(static_cast<char>(value ? cbor::TRUE_VALUE : cbor::FALSE_VALUE));
+    }
+
+    bool CborResponseWriter::addEncoded(const char *name, const std::string &response)
+    {
+        // A CBOR item is self-delimiting, so the other response's payload is used as it is
+        if (response.size() <= wire::FRAME_HEADER_SIZE ||
+            static_cast<uint8_t>(response[0]) != wire::FRAME_MAGIC ||
+            static_cast<uint8_t>(response[1]) != wire::ENCODING_CBOR || response[2] != 0 ||
+            readLittleEndian(response, 4, 4) != response.size() - wire::FRAME_HEADER_SIZE)
+        {
+            return false;
+        }
+        writeKey(name);
+        frame_.append(response, wire::FRAME_HEADER_SIZE, std::string::npos);
+        return true;
+    }
+
+    WireFormat CborResponseWriter::format() const
+    {
+        return WireFormat::CBOR;
+    }
+
+    std::string CborResponseWriter::finish()
+    {
+        const size_t payload_size = frame_.size() - wire::FRAME_HEADER_SIZE;
+        if (payload_size == 0 || payload_size > std::numeric_limits<uint32_t>::max())
+        {
+            return std::string();
+        }
+        frame_[0] = static_cast<char>(wire::FRAME_MAGIC);
+        frame_[1] = static_cast<char>(wire::ENCODING_CBOR);
+        frame_[2] = 0; // flags
+        frame_[3] = 0; // codec (uncompressed)
+        for (int i = 0; i < 4; ++i)
+            frame_[4 + i] = static_cast<char>((payload_size >> (8 * i)) & 0xFF);
+
+        // A writer too large to be pooled gives its buffer away instead of copying it
+        if (capacity() > MAX_POOLED_CAPACITY)
+            return std::move(frame_);
+        return frame_;
+    }
+
+    void CborResponseWriter::reset()
+    {
+        frame_.assign(wire::FRAME_HEADER_SIZE, '\0');
+    }
+
+    size_t CborResponseWriter::capacity() const
+    {
+        return frame_.capacity();
+    }
+
+    void CborResponseWriter::writeKey(const char *name)
+    {
+        if (name)
+            appendCborText(frame_, name);
+    }
+} // namespace qnx
@@ -0,0 +1,149 @@
+/**
+ * @file ServerStats.cpp
+ * @brief Implementation of server-wide counters for QNX Remote Process Monitor
+ */
+
+#include "ServerStats.hpp"
+
+namespace qnx
+{
+    ServerStats &ServerStats::getInstance()
+    {
+        static ServerStats instance;
+        return instance;
+    }
+
+    void ServerStats::recordCompression(size_t bytes_in, size_t bytes_out, uint64_t cpu_ns, bool compressed)
+    {
+        compression_.attempts.fetch_add(1, std::memory_order_relaxed);
+        if (compressed)
+        {
+            compression_.compressed.fetch_add(1, std::memory_order_relaxed);
+        }
+        compression_.bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+        compression_.bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+        compression_.cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+    }
+
+    void ServerStats::recordTimeout(ConnectionTimeout reason)
+    {
+        switch (reason)
+        {
+        case ConnectionTimeout::IDLE:
+            timeouts_.idle.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ConnectionTimeout::REQUEST:
+            timeouts_.request.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ConnectionTimeout::WRITE:
+            timeouts_.write.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    void ServerStats::recordThrottle(ThrottleReason reason)
+    {
+        switch (reason)
+        {
+        case ThrottleReason::CONNECTION:
+            throttled_.connection.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ThrottleReason::USER:
+            throttled_.user.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ThrottleReason::BUSY:
+            throttled_.busy.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    void ServerStats::recordCoalescing(bool shared)
+    {
+        if (shared)
+            coalescing_.shared.fetch_add(1, std::memory_order_relaxed);
+        else
+            coalescing_.computed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ServerStats::recordCacheLookup(bool hit)
+    {
+        if (hit)
+            cache_.hits.fetch_add(1, std::memory_order_relaxed);
+        else
+            cache_.misses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ServerStats::recordCacheEvictions(size_t count)
+    {
+        cache_.evictions.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void ServerStats::recordCacheUsage(size_t entries, size_t bytes)
+    {
+        cache_.entries.store(entries, std::memory_order_relaxed);
+        cache_.bytes.store(bytes, std::memory_order_relaxed);
+    }
+
+    void ServerStats::recordCancellation(bool deadline)
+    {
+        if (deadline)
+            cancelled_.deadline.fetch_add(1, std::memory_order_relaxed);
+        else
+            cancelled_.disconnected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ServerStats::encode(ResponseWriter &writer) const
+    {
+        const uint64_t bytes_in = compression_.bytes_in.load(std::memory_order_relaxed);
+        const uint64_t bytes_out = compression_.bytes_out.load(std::memory_order_relaxed);
+        const uint64_t cpu_ns = compression_.cpu_ns.load(std::memory_order_relaxed);
+
+        writer.startObject("compression");
+        writer.addInt("attempts", static_cast<long long>(compression_.attempts.load(std::memory_order_relaxed)));
+        writer.addInt("compressed", static_cast<long long>(compression_.compressed.load(std::memory_order_relaxed)));
+        writer.addInt("bytes_in", static_cast<long long>(bytes_in));
+        writer.addInt("bytes_out", static_cast<long long>(bytes_out));
+        // Ratio of sent to original size; 1.0 when nothing was compressed
+        writer.addDouble("ratio", bytes_in > 0 ? static_cast<double>(bytes_out) / bytes_in : 1.0);
+        writer.addDouble("cpu_ms", cpu_ns / 1e6);
+        writer.addDouble("cpu_ns_per_kb", bytes_in > 0 ? cpu_ns * 1024.0 / bytes_in : 0.0);
+        writer.endObject();
+
+        writer.startObject("timeouts");
+        writer.addInt("idle", static_cast<long long>(timeouts_.idle.load(std::memory_order_relaxed)));
+        writer.addInt("request", static_cast<long long>(timeouts_.request.load(std::memory_order_relaxed)));
+        writer.addInt("write", static_cast<long long>(timeouts_.write.load(std::memory_order_relaxed)));
+        writer.endObject();
+
+        writer.startObject("throttled");
+        writer.addInt("connection", static_cast<long long>(throttled_.connection.load(std::memory_order_relaxed)));
+        writer.addInt("user", static_cast<long long>(throttled_.user.load(std::memory_order_relaxed)));
+        writer.addInt("busy", static_cast<long long>(throttled_.busy.load(std::memory_order_relaxed)));
+        writer.endObject();
+
+        const uint64_t computed = coalescing_.computed.load(std::memory_order_relaxed);
+        const uint64_t shared = coalescing_.shared.load(std::memory_order_relaxed);
+        writer.startObject("coalescing");
+        writer.addInt("computed", static_cast<long long>(computed));
+        writer.addInt("shared", static_cast<long long>(shared));
+        // Fraction of coalescable requests that did not compute their own response
+        writer.addDouble("hit_rate", computed + shared > 0 ? static_cast<double>(shared) / (computed + shared) : 0.0);
+        writer.endObject();
+
+        const uint64_t hits = cache_.hits.load(std::memory_order_relaxed);
+        const uint64_t misses = cache_.misses.load(std::memory_order_relaxed);
+        writer.startObject("response_cache");
+        writer.addInt("hits", static_cast<long long>(hits));
+        writer.addInt("misses", static_cast<long long>(misses));
+        writer.addDouble("hit_rate", hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0);
+        writer.addInt("evictions", static_cast<long long>(cache_.evictions.load(std::memory_order_relaxed)));
+        writer.addInt("entries", static_cast<long long>(cache_.entries.load(std::memory_order_relaxed)));
+        writer.addInt("bytes", static_cast<long long>(cache_.bytes.load(std::memory_order_relaxed)));
+        writer.endObject();
+
+        writer.startObject("cancelled");
+        writer.addInt("deadline", static_cast<long long>(cancelled_.deadline.load(std::memory_order_relaxed)));
+        writer.addInt("disconnected", static_cast<long long>(cancelled_.disconnected.load(std::memory_order_relaxed)));
+        writer.endObject();
+    }
+} // namespace qnx
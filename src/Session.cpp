@@ -0,0 +1,53 @@
+/**
+ * @file Session.cpp
+ * @brief Implementation of per-connection protocol state for QNX Remote Process Monitor
+ */
+
+#include "Session.hpp"
+
+namespace qnx
+{
+    SessionManager &SessionManager::getInstance()
+    {
+        static SessionManager instance;
+        return instance;
+    }
+
+    ClientSession SessionManager::get(int client_socket) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = sessions_.find(client_socket);
+        if (it != sessions_.end())
+        {
+            return it->second;
+        }
+        return ClientSession();
+    }
+
+    void SessionManager::setFormat(int client_socket, WireFormat format)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_[client_socket].format = format;
+    }
+
+    void SessionManager::setCompression(int client_socket, CompressionCodec codec, size_t threshold)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ClientSession &session = sessions_[client_socket];
+        session.compression = codec;
+        session.compression_threshold = threshold;
+    }
+
+    void SessionManager::setUser(int client_socket, const std::string &user)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_[client_socket].user = user;
+    }
+
+    void SessionManager::release(int client_socket)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.erase(client_socket);
+    }
+} // namespace qnx
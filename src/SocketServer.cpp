@@ -4,28 +4,53 @@
  *
  * This file implements a TCP/IP socket server that facilitates network communication
  * for the QNX Process Monitor application. It provides functionality for:
- * - Creating and managing a server socket
+ * - Creating and managing a server socket, and optionally a Unix domain socket
  * - Accepting and handling multiple client connections
  * - Processing client messages through a message handler callback
  * - Sending responses to clients and broadcasting messages
  *
  * The implementation is thread-safe and handles socket operations in an asynchronous
- * manner using a dedicated server thread and non-blocking I/O operations.
+ * manner using one or more reactor threads and non-blocking I/O operations. Each
+ * connection belongs to exactly one reactor for its whole lifetime. Message
+ * handlers run on a worker pool; completed responses are queued on their
+ * connection and written by whichever thread finds the socket writable first.
+ *
+ * Reactors wait for I/O with select(), edge-triggered epoll or io_uring. The
+ * io_uring loop is completion based: the kernel accepts, receives into
+ * provided buffers and sends on the reactor's behalf, and the reactor only
+ * submits new requests and consumes completions, in batches.
  */
 
 #include "SocketServer.hpp"
+#include "WireFormat.hpp"
+#include "IoUring.hpp"
+#include "TimerWheel.hpp"
+#include "ServerStats.hpp"
 #include <iostream>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/time.h>
 #include <cstring>
 #include <system_error>
 #include <arpa/inet.h>
 #include <algorithm>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #include <vector>
+#include <deque>
+#include <unordered_set>
+#include <chrono>
+#include <climits>
+#include <poll.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#define RPM_HAVE_EPOLL 1
+#endif
 
 // QNX 8.0 compatibility helpers
 #ifdef __QNXNTO__
@@ -44,6 +69,209 @@ namespace qnx
 {
     constexpr int MAX_CLIENTS = 30;
     constexpr int BUFFER_SIZE = 4096;
+    constexpr int MAX_IN_FLIGHT_PER_CLIENT = 16;      // Requests handled concurrently per connection
+    constexpr size_t MAX_REQUEST_SIZE = 64 * 1024;    // Largest accepted request, in bytes
+    constexpr size_t WORKER_THREADS = 4;              // Threads running the message handler
+    constexpr size_t CONTROL_WORKERS = 1;             // Of those, threads kept free for RequestClass::CONTROL
+    constexpr size_t MAX_REACTORS = 64;               // Upper bound for ServerOptions::reactors
+    constexpr int ACCEPT_BATCH = 64;                  // Connections accepted per wake-up of a listener
+    constexpr int EPOLL_EVENTS = 64;                  // Events fetched per epoll_wait()
+    constexpr unsigned URING_ENTRIES = 256;           // Submission queue size of each reactor's ring
+    constexpr unsigned URING_BUFFERS = 256;           // Provided receive buffers per ring (power of two)
+    constexpr uint16_t URING_BUFFER_GROUP = 0;        // Buffer group ID of the receive buffer ring
+    constexpr int64_t TIMER_TICK_MS = 1000;           // Resolution of connection timeouts
+    constexpr size_t TIMER_SLOTS = 512;               // Slots of each reactor's timer wheel
+
+#ifdef MSG_NOSIGNAL
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL | MSG_DONTWAIT;
+#else
+    constexpr int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+    // Sharding accepts over several listening sockets only helps when the
+    // kernel balances new connections across them. Linux does so for
+    // SO_REUSEPORT; BSD-derived stacks (including io-sock) only with
+    // SO_REUSEPORT_LB, and otherwise deliver everything to one socket.
+#if defined(SO_REUSEPORT_LB)
+    constexpr int REUSE_PORT_OPTION = SO_REUSEPORT_LB;
+#elif defined(SO_REUSEPORT) && defined(__linux__)
+    constexpr int REUSE_PORT_OPTION = SO_REUSEPORT;
+#else
+    constexpr int REUSE_PORT_OPTION = 0; // Hand connections off from one acceptor instead
+#endif
+
+    /**
+     * @brief State of one client connection
+     *
+     * The input buffer and the timer state are only touched by the owning
+     * reactor thread. The output queue and in-flight counter are shared with
+     * worker threads and protected by the connection mutex.
+     */
+    struct SocketServer::Connection : TimerNode
+    {
+        int fd = -1;                    ///< Client socket descriptor
+        uint64_t id = 0;                ///< Never reused, unlike fd; see SocketServer::connectionId()
+        std::string peer;               ///< Printable peer address for logging
+        Reactor *reactor = nullptr;     ///< Reactor that owns the connection
+        std::string input;              ///< Received bytes not yet dispatched
+        bool drained = false;           ///< Whether the last read emptied the socket
+        bool framed = false;            ///< Has ended a request with a newline, so never sends one unterminated
+        int64_t request_since = 0;      ///< When the incomplete request at the end of input started, or 0
+        int64_t output_since = 0;       ///< When the output queue became non-empty, or 0
+        std::atomic<int64_t> last_activity{0}; ///< When data was last received or sent
+        CancellationToken cancel = CancellationToken::create(); ///< Cancelled when the connection closes
+
+        std::mutex mutex;               ///< Protects the members below
+        std::deque<std::string> output; ///< Framed messages waiting to be written
+        size_t output_offset = 0;       ///< Bytes of output.front() already written
+        int in_flight = 0;              ///< Requests currently being handled
+        bool closed = false;            ///< Set once the connection has been closed
+        bool handed_over = false;       ///< Passed to a successor process: neither reported nor closed on release
+        bool streaming = false;         ///< A ResponseStream owns the output
+        std::deque<std::string> held;   ///< Framed messages completed during the stream, queued when it ends
+
+        // io_uring backend only, touched by the owning reactor thread
+        bool recv_armed = false;        ///< Whether a multishot receive is pending
+        uint64_t recv_op = 0;           ///< User data of the pending receive, 0 once cancelled
+        bool send_armed = false;        ///< Whether a send is pending
+        std::string sending;            ///< Bytes of the pending send
+        size_t sending_offset = 0;      ///< Bytes of sending already written
+    };
+
+    /**
+     * @brief State of one reactor thread
+     *
+     * Reactors are kept (with an empty client set) after shutdown, so that
+     * send() and broadcast() calls racing with shutdown find no clients
+     * instead of touching freed state.
+     */
+    struct SocketServer::Reactor
+    {
+        size_t index = 0;                         ///< Position in SocketServer::reactors_
+        std::vector<int> listeners;               ///< Listening sockets this reactor accepts on
+        int wake_fds[2] = {-1, -1};               ///< Self-pipe used to wake the reactor thread
+        std::map<int, ConnectionPtr> connections; ///< Clients owned by this reactor
+        std::vector<ConnectionPtr> adopted;       ///< New clients the loop has not started watching yet
+        std::vector<ConnectionPtr> resumed;       ///< Clients that dropped below the in-flight limit
+        std::vector<ConnectionPtr> flush;         ///< Clients with responses to submit (io_uring)
+        std::mutex mutex;                         ///< Protects connections and the lists above
+        std::thread thread;                       ///< Thread running reactorLoop()
+        TimerWheel timers{TIMER_TICK_MS, TIMER_SLOTS}; ///< Connection deadlines
+        int64_t now_ms = 0;                       ///< Time of the current loop iteration
+#ifdef RPM_HAVE_EPOLL
+        int epoll_fd = -1;                        ///< epoll instance (epoll backend)
+#endif
+#ifdef RPM_HAVE_IO_URING
+        std::unique_ptr<IoUring> ring;            ///< Submission/completion rings (io_uring backend)
+#endif
+    };
+
+    namespace
+    {
+        // Unterminated data is accepted as a request only when the socket has
+        // been drained, the client has never terminated a request with a newline
+        // and the data is a whole JSON object or array: every brace and bracket
+        // outside strings is closed again. This keeps clients written against the
+        // original one-read-per-request protocol working while still letting
+        // newline-delimited requests be pipelined and split across reads.
+        bool isCompleteRequest(const std::string &input, size_t start)
+        {
+            int depth = 0;
+            bool opened = false;
+            bool in_string = false;
+            bool escaped = false;
+            for (size_t i = start; i < input.size(); ++i)
+            {
+                const char c = input[i];
+                if (in_string)
+                {
+                    if (escaped)
+                        escaped = false;
+                    else if (c == '\\')
+                        escaped = true;
+                    else if (c == '"')
+                        in_string = false;
+                    continue;
+                }
+                switch (c)
+                {
+                case '"':
+                    in_string = true;
+                    break;
+                case '{':
+                case '[':
+                    ++depth;
+                    opened = true;
+                    break;
+                case '}':
+                case ']':
+                    if (--depth < 0)
+                        return false;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return opened && depth == 0 && !in_string;
+        }
+
+        bool setNonBlocking(int fd)
+        {
+            int flags = fcntl(fd, F_GETFL, 0);
+            return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+        }
+
+        void closeFd(int &fd)
+        {
+            if (fd != -1)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        // Milliseconds on the monotonic clock
+        int64_t nowMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        void drainPipe(int fd)
+        {
+            char drain[64];
+            while (read(fd, drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+    }
+
+    bool parseIoBackend(const std::string &name, IoBackend &backend)
+    {
+        if (name == "select")
+            backend = IoBackend::SELECT;
+        else if (name == "epoll")
+            backend = IoBackend::EPOLL;
+        else if (name == "io_uring")
+            backend = IoBackend::IO_URING;
+        else
+            return false;
+        return true;
+    }
+
+    const char *ioBackendName(IoBackend backend)
+    {
+        switch (backend)
+        {
+        case IoBackend::EPOLL:
+            return "epoll";
+        case IoBackend::IO_URING:
+            return "io_uring";
+        default:
+            return "select";
+        }
+    }
 
     /**
      * @brief Get the singleton instance of the SocketServer class
@@ -75,14 +303,25 @@ namespace qnx
      * @brief Initialize and start the socket server
      *
      * Creates a TCP/IP socket, binds it to the specified port, and starts
-     * listening for incoming connections. Launches a server thread to handle
-     * client connections and messages asynchronously.
+     * listening for incoming connections; if a path is given, does the same
+     * for a Unix domain socket. Launches the reactor threads that handle
+     * client connections and messages asynchronously, and the worker pool
+     * that runs the message handler.
+     *
+     * With more than one reactor, every reactor gets its own TCP listening
+     * socket if the platform balances connections across SO_REUSEPORT
+     * sockets. Otherwise (and for the Unix domain socket) the first reactor
+     * accepts and distributes connections round-robin.
+     *
+     * The requested I/O backend is set up for all reactors at once; if that
+     * fails, io_uring falls back to epoll and epoll to select.
      *
      * @param port The TCP port to listen on
      * @param handler The callback function to process incoming messages
+     * @param options Unix domain socket, reactor and I/O backend settings
      * @return true if initialization was successful, false otherwise
      */
-    bool SocketServer::init(int port, MessageHandler handler)
+    bool SocketServer::init(int port, MessageHandler handler, const ServerOptions &options)
     {
         if (running_.load())
         {
@@ -91,346 +330,2132 @@ namespace qnx
         }
 
         message_handler_ = handler;
+        idle_timeout_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(options.idle_timeout).count();
+        request_timeout_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(options.request_timeout).count();
+        write_timeout_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(options.write_timeout).count();
+        max_request_time_ = options.max_request_time;
+
+        size_t reactor_count = options.reactors;
+        if (reactor_count == 0)
+        {
+            reactor_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        reactor_count = std::min(reactor_count, MAX_REACTORS);
+
+        reactors_.clear();
+        for (size_t i = 0; i < reactor_count; ++i)
+        {
+            reactors_.push_back(std::make_unique<Reactor>());
+            reactors_.back()->index = i;
+        }
+
+        auto cleanup = [this]()
+        {
+            for (auto &reactor : reactors_)
+            {
+                for (int &fd : reactor->listeners)
+                    closeFd(fd);
+                reactor->listeners.clear();
+                closeFd(reactor->wake_fds[0]);
+                closeFd(reactor->wake_fds[1]);
+            }
+            if (!unix_path_.empty())
+            {
+                unlink(unix_path_.c_str());
+                unix_path_.clear();
+            }
+        };
+
+        const ListenerSockets &inherited = options.inherited;
+        if (!inherited.tcp.empty())
+        {
+            // Keep the predecessor's sharding only if it matches the reactor count;
+            // otherwise the first reactor accepts on all of them and hands off
+            reuse_port_ = reactor_count > 1 && inherited.tcp.size() == reactor_count;
+            for (size_t i = 0; i < inherited.tcp.size(); ++i)
+            {
+                setNonBlocking(inherited.tcp[i]);
+                reactors_[reuse_port_ ? i : 0]->listeners.push_back(inherited.tcp[i]);
+            }
+        }
+
+        // Shard the TCP port across reactors where the kernel balances it
+        if (inherited.tcp.empty())
+            reuse_port_ = reactor_count > 1 && REUSE_PORT_OPTION != 0;
+        for (auto &reactor : reactors_)
+        {
+            if (!inherited.tcp.empty())
+                break;
+
+            if (reactor->index > 0 && !reuse_port_)
+                break;
+
+            int fd = openTcpListener(port, reuse_port_);
+            if (fd == -1 && reactor->index == 0 && reuse_port_)
+            {
+                // Port sharing unavailable: fall back to a single acceptor
+                reuse_port_ = false;
+                fd = openTcpListener(port, false);
+            }
+            if (fd == -1)
+            {
+                cleanup();
+                return false;
+            }
+            reactor->listeners.push_back(fd);
+        }
+
+        // Optionally listen on a Unix domain socket for on-box clients
+        if (inherited.unix_fd != -1)
+        {
+            setNonBlocking(inherited.unix_fd);
+            unix_path_ = inherited.unix_path;
+            reactors_[0]->listeners.push_back(inherited.unix_fd);
+        }
+        else if (!options.unix_path.empty())
+        {
+            int fd = openUnixListener(options.unix_path, options.unix_mode);
+            if (fd == -1)
+            {
+                cleanup();
+                return false;
+            }
+            unix_path_ = options.unix_path;
+            reactors_[0]->listeners.push_back(fd);
+        }
+
+        // Create the self-pipes used to wake reactor threads when output is queued
+        for (auto &reactor : reactors_)
+        {
+            if (pipe(reactor->wake_fds) < 0 || !setNonBlocking(reactor->wake_fds[0]) ||
+                !setNonBlocking(reactor->wake_fds[1]))
+            {
+                std::error_code ec(errno, std::system_category());
+                std::cerr << "Failed to create wake pipe: " << ec.message() << std::endl;
+                cleanup();
+                return false;
+            }
+        }
+
+        // Set up the I/O backend, falling back to what this kernel supports
+        backend_ = options.backend;
+        if (backend_ == IoBackend::IO_URING && !setupIoUring())
+        {
+            std::cerr << "io_uring is not available, falling back to epoll." << std::endl;
+            backend_ = IoBackend::EPOLL;
+        }
+        if (backend_ == IoBackend::EPOLL && !setupEpoll())
+        {
+            std::cerr << "epoll is not available, falling back to select." << std::endl;
+            backend_ = IoBackend::SELECT;
+        }
+
+        // Start worker pool and reactor threads
+        running_ = true;
+        client_count_ = 0;
+        workers_.start(WORKER_THREADS, CONTROL_WORKERS);
+        for (auto &reactor : reactors_)
+        {
+            reactor->thread = std::thread(&SocketServer::reactorLoop, this, std::ref(*reactor));
+        }
+
+        std::cout << "Socket server initialized on " << (inherited.tcp.empty() ? "" : "inherited ") << "port " << port << " with " << reactor_count
+                  << (reactor_count == 1 ? " reactor" : " reactors")
+                  << (reactor_count > 1 ? (reuse_port_ ? " (SO_REUSEPORT)" : " (round-robin hand-off)") : "")
+                  << " using " << ioBackendName(backend_) << std::endl;
+        if (!unix_path_.empty())
+        {
+            std::cout << "Socket server listening on " << unix_path_ << std::endl;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Create the per-reactor epoll instances
+     *
+     * Listening sockets and wake pipes are registered level-triggered here;
+     * client sockets are added edge-triggered by the reactor that owns them.
+     *
+     * @return true on success, false if epoll is unavailable
+     */
+    bool SocketServer::setupEpoll()
+    {
+#ifdef RPM_HAVE_EPOLL
+        for (auto &reactor : reactors_)
+        {
+            reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            bool ok = reactor->epoll_fd != -1;
 
+            std::vector<int> fds = reactor->listeners;
+            fds.push_back(reactor->wake_fds[0]);
+            for (size_t i = 0; ok && i < fds.size(); ++i)
+            {
+                struct epoll_event event;
+                memset(&event, 0, sizeof(event));
+                event.events = EPOLLIN;
+                event.data.fd = fds[i];
+                ok = epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fds[i], &event) == 0;
+            }
+
+            if (!ok)
+            {
+                std::error_code ec(errno, std::system_category());
+                std::cerr << "Failed to set up epoll: " << ec.message() << std::endl;
+                releaseBackend();
+                return false;
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Create the per-reactor io_uring instances
+     *
+     * Every reactor gets its own ring and its own ring of provided receive
+     * buffers. Fails if the kernel lacks any feature the io_uring loop
+     * relies on (provided buffer rings being the most recent, Linux 5.19).
+     *
+     * @return true on success, false if io_uring is unavailable or too old
+     */
+    bool SocketServer::setupIoUring()
+    {
+#ifdef RPM_HAVE_IO_URING
+        for (auto &reactor : reactors_)
+        {
+            reactor->ring = std::make_unique<IoUring>();
+            if (!reactor->ring->init(URING_ENTRIES) ||
+                !reactor->ring->setupBufferRing(URING_BUFFER_GROUP, URING_BUFFERS, BUFFER_SIZE))
+            {
+                releaseBackend();
+                return false;
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Release the epoll or io_uring state of every reactor
+     */
+    void SocketServer::releaseBackend()
+    {
+        for (auto &reactor : reactors_)
+        {
+#ifdef RPM_HAVE_EPOLL
+            closeFd(reactor->epoll_fd);
+#endif
+#ifdef RPM_HAVE_IO_URING
+            reactor->ring.reset();
+#endif
+            (void)reactor;
+        }
+    }
+
+    /**
+     * @brief Create a non-blocking TCP listening socket
+     *
+     * @param port The TCP port to listen on
+     * @param reuse_port Whether to join the port's load-balancing group
+     * @return The socket descriptor, or -1 on error
+     */
+    int SocketServer::openTcpListener(int port, bool reuse_port)
+    {
         // Create socket
-        server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd_ == -1)
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1)
         {
             std::error_code ec(errno, std::system_category());
             std::cerr << "Failed to create socket: " << ec.message() << std::endl;
-            return false;
+            return -1;
         }
 
         // Set socket options for reuse
         int opt = 1;
-        if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+            (reuse_port && setsockopt(fd, SOL_SOCKET, REUSE_PORT_OPTION, &opt, sizeof(opt)) < 0))
         {
             std::error_code ec(errno, std::system_category());
             std::cerr << "Failed to set socket options: " << ec.message() << std::endl;
-            close(server_fd_);
-            server_fd_ = -1;
-            return false;
+            close(fd);
+            return -1;
         }
 
         // Prepare the server address
-        memset(&server_address_, 0, sizeof(server_address_));
-        server_address_.sin_family = AF_INET;
-        server_address_.sin_addr.s_addr = INADDR_ANY;
-        server_address_.sin_port = htons(port);
+        struct sockaddr_in server_address;
+        memset(&server_address, 0, sizeof(server_address));
+        server_address.sin_family = AF_INET;
+        server_address.sin_addr.s_addr = INADDR_ANY;
+        server_address.sin_port = htons(port);
 
         // Bind socket to port
-        if (bind(server_fd_, (struct sockaddr *)&server_address_, sizeof(server_address_)) < 0)
+        if (bind(fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0)
         {
             std::error_code ec(errno, std::system_category());
             std::cerr << "Failed to bind socket to port " << port << ": " << ec.message() << std::endl;
-            close(server_fd_);
-            server_fd_ = -1;
-            return false;
+            close(fd);
+            return -1;
         }
 
-        // Start listening for connections
-        if (listen(server_fd_, MAX_CLIENTS) < 0)
+        // Start listening for connections; accept() must not block once the queue is drained
+        if (listen(fd, MAX_CLIENTS) < 0 || !setNonBlocking(fd))
         {
             std::error_code ec(errno, std::system_category());
             std::cerr << "Failed to listen on socket: " << ec.message() << std::endl;
-            close(server_fd_);
-            server_fd_ = -1;
-            return false;
+            close(fd);
+            return -1;
         }
 
-        // Start server thread
-        running_ = true;
-        server_thread_ = std::thread(&SocketServer::serverLoop, this);
-
-        std::cout << "Socket server initialized on port " << port << std::endl;
-        return true;
+        return fd;
     }
 
     /**
-     * @brief Shut down the socket server
+     * @brief Create the Unix domain listening socket
      *
-     * Performs a clean shutdown of the server by:
-     * 1. Setting the running flag to false
-     * 2. Closing the server socket to unblock any blocking operations
-     * 3. Closing all client connections
-     * 4. Joining the server thread to ensure proper termination
+     * Binds a stream socket at the given path and applies the requested
+     * permissions before listening, so no client can connect while the socket
+     * still has the default (umask-derived) permissions. A socket file left
+     * behind by a previous run is removed first.
+     *
+     * @param path The socket path
+     * @param mode Permissions applied to the socket file
+     * @return The socket descriptor, or -1 on error
      */
-    void SocketServer::shutdown()
+    int SocketServer::openUnixListener(const std::string &path, mode_t mode)
     {
-        if (!running_.exchange(false))
-        {
-            return; // Already shut down or not running
-        }
-
-        // Close server socket to unblock accept()
-        if (server_fd_ != -1)
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
         {
-            close(server_fd_);
-            server_fd_ = -1;
+            std::cerr << "Unix socket path is too long: " << path << std::endl;
+            return -1;
         }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
 
-        // Close all client sockets
+        // Only ever remove a stale socket, never a regular file that happens to be there
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0)
         {
-            std::lock_guard<std::mutex> lock(clients_mutex_);
-            for (int client_socket : client_sockets_)
+            if (!S_ISSOCK(st.st_mode))
             {
-                close(client_socket);
+                std::cerr << "Refusing to replace " << path << ": not a socket" << std::endl;
+                return -1;
             }
-            client_sockets_.clear();
+            unlink(path.c_str());
         }
 
-        // Join the server thread
-        if (server_thread_.joinable())
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
         {
-            server_thread_.join();
+            std::error_code ec(errno, std::system_category());
+            std::cerr << "Failed to create Unix socket: " << ec.message() << std::endl;
+            return -1;
         }
 
-        std::cout << "Socket server shut down." << std::endl;
-    }
+        const char *failed = nullptr;
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+            failed = "bind";
+        else if (chmod(path.c_str(), mode) < 0)
+            failed = "set permissions on";
+        else if (listen(fd, MAX_CLIENTS) < 0 || !setNonBlocking(fd))
+            failed = "listen on";
 
-    /**
-     * @brief Send a message to a specific client with length prefix
-     *
-     * Prepends a 4-byte network-order length header to the message before sending.
-     *
-     * @param client_socket The client socket descriptor
-     * @param message The message string to send
-     * @return true if the message was sent successfully, false otherwise
-     */
-    bool SocketServer::send(int client_socket, const std::string &message)
-    {
-        if (::send(client_socket, message.c_str(), message.length(), 0) < 0)
+        if (failed)
         {
             std::error_code ec(errno, std::system_category());
-            // Don't print error for broken pipe, it happens normally when client disconnects
-            if (ec.value() != EPIPE)
-            {
-                std::cerr << "Failed to send message to client " << client_socket << ": " << ec.message() << std::endl;
-            }
-            return false;
+            std::cerr << "Failed to " << failed << " Unix socket " << path << ": " << ec.message() << std::endl;
+            close(fd);
+            unlink(path.c_str());
+            return -1;
         }
-        return true;
+
+        return fd;
     }
 
     /**
-     * @brief Broadcast a message to all connected clients
-     *
-     * Sends the same message to all currently connected clients.
-     * Uses thread-safe access to the client list.
+     * @brief Shut down the socket server
      *
-     * @param message The message to broadcast
+     * Performs a clean shutdown of the server by:
+     * 1. Setting the running flag to false and waking every reactor
+     * 2. Joining the reactor threads to ensure proper termination
+     * 3. Letting the worker pool finish the requests already in flight
+     * 4. Closing all client connections and the listening sockets
      */
-    void SocketServer::broadcast(const std::string &message)
+    void SocketServer::shutdown()
     {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        for (int client_socket : client_sockets_)
+        if (!stopThreads())
         {
-            send(client_socket, message);
+            return; // Already shut down or not running
         }
+        releaseResources();
+
+        std::cout << "Socket server shut down." << std::endl;
     }
 
     /**
-     * @brief Main server loop that handles connections and messages
+     * @brief Stop serving and pass the sockets on to a successor process
      *
-     * This method runs in a separate thread and:
-     * 1. Uses select() to monitor multiple socket file descriptors
-     * 2. Accepts new client connections
-     * 3. Receives and processes messages from existing clients
-     * 4. Handles client disconnections
+     * Stops the threads like shutdown(), then takes the listening sockets
+     * (and, if requested, the idle client connections) out of the reactors
+     * before the remaining resources are released. A connection is idle if
+     * its input buffer, output queue and pending io_uring send are empty
+     * and no request is in flight; anything else would lose data or a
+     * response in the move.
      *
-     * The loop continues until the server is shut down.
+     * @param listeners Receives the listening sockets
+     * @param clients Receives the idle client sockets
+     * @param include_clients Whether to return idle client connections
+     * @return true on success, false if the server is not running
      */
-    void SocketServer::serverLoop()
+    bool SocketServer::handOver(ListenerSockets &listeners, std::vector<int> &clients, bool include_clients)
     {
-        fd_set read_fds;
-        int max_sd;
-        struct timeval tv = {1, 0}; // 1 second timeout for select
-
-        while (running_.load())
+        if (!stopThreads())
         {
-            FD_ZERO(&read_fds);
-            if (server_fd_ == -1)
-            { // Server socket closed during shutdown
-                break;
-            }
-            FD_SET(server_fd_, &read_fds);
-            max_sd = server_fd_;
+            return false;
+        }
 
-            // Add client sockets to set
+        // Data received by a multishot receive may be waiting in completions nobody reaps any more
+        include_clients = include_clients && backend_ != IoBackend::IO_URING;
+
+        for (auto &reactor : reactors_)
+        {
+            std::vector<ConnectionPtr> connections;
+            if (include_clients)
             {
-                std::lock_guard<std::mutex> lock(clients_mutex_);
-                for (int sd : client_sockets_)
+                std::lock_guard<std::mutex> lock(reactor->mutex);
+                for (auto &entry : reactor->connections)
                 {
-                    FD_SET(sd, &read_fds);
-                    if (sd > max_sd)
-                        max_sd = sd;
+                    connections.push_back(entry.second);
                 }
             }
-
-            // Reset timeout
-            tv.tv_sec = 1;
-            tv.tv_usec = 0;
-
-            // Wait for activity on any of the sockets
-            int activity = select(max_sd + 1, &read_fds, nullptr, nullptr, &tv);
-
-            if (!running_.load())
-                break; // Check again after select
-
-            if (activity < 0)
+            for (auto &conn : connections)
             {
-                // select error (e.g., EINTR)
-                if (errno == EINTR)
+                if (!conn->input.empty() || !conn->sending.empty())
                     continue;
-                std::error_code ec(errno, std::system_category());
-                std::cerr << "Select error: " << ec.message() << std::endl;
-                // Consider more robust error handling, maybe break the loop
-                continue;
+                {
+                    std::lock_guard<std::mutex> lock(conn->mutex);
+                    if (conn->closed || !conn->output.empty() || conn->in_flight > 0)
+                        continue;
+                    conn->closed = true;
+                    conn->handed_over = true;
+                }
+                reactor->timers.cancel(*conn);
+                {
+                    std::lock_guard<std::mutex> lock(reactor->mutex);
+                    reactor->connections.erase(conn->fd);
+                }
+                client_count_.fetch_sub(1);
+                clients.push_back(conn->fd);
             }
 
-            if (activity == 0)
+            for (int fd : reactor->listeners)
             {
-                // Timeout - useful for periodic tasks if needed
-                continue;
+                struct sockaddr_storage address;
+                socklen_t length = sizeof(address);
+                if (getsockname(fd, (struct sockaddr *)&address, &length) == 0 && address.ss_family == AF_UNIX)
+                    listeners.unix_fd = fd;
+                else
+                    listeners.tcp.push_back(fd);
             }
+            reactor->listeners.clear();
+        }
 
-            // Check for incoming connections
-            if (FD_ISSET(server_fd_, &read_fds))
-            {
-                struct sockaddr_in client_address;
-                socklen_t client_len = sizeof(client_address);
-                int new_socket = accept(server_fd_, (struct sockaddr *)&client_address, &client_len);
-
-                if (!running_.load())
-                { // Check if shutdown was initiated during accept
-                    if (new_socket >= 0)
-                        close(new_socket);
-                    break;
-                }
-
-                if (new_socket < 0)
-                {
-                    // Accept can fail if server_fd_ was closed
-                    if (errno == EBADF)
-                        break;
-                    std::error_code ec(errno, std::system_category());
-                    std::cerr << "Failed to accept new connection: " << ec.message() << std::endl;
-                    continue;
-                }
+        // The successor serves the socket file now; don't unlink it
+        listeners.unix_path = unix_path_;
+        unix_path_.clear();
 
-                // Get client IP and port
-                char client_ip[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &client_address.sin_addr, client_ip, INET_ADDRSTRLEN);
-                int client_port = ntohs(client_address.sin_port);
+        releaseResources();
 
-                std::cout << "New connection from " << client_ip << ":" << client_port
-                          << ", socket fd is " << new_socket << std::endl;
+        std::cout << "Socket server handed over " << listeners.tcp.size() + (listeners.unix_fd != -1 ? 1 : 0)
+                  << " listening sockets and " << clients.size() << " connections." << std::endl;
+        return true;
+    }
 
-                // Add new client socket to list if there's room
-                {
-                    std::lock_guard<std::mutex> lock(clients_mutex_);
-                    if (client_sockets_.size() < MAX_CLIENTS)
+    /**
+     * @brief Serve a connected client socket received from a previous server process
+     *
+     * The connection is assigned to a reactor like an accepted one. Every
+     * reactor is woken, since this is not called from a reactor thread.
+     *
+     * @param client_socket The client socket descriptor
+     * @return true if the client was added, false if the server is not running
+     */
+    bool SocketServer::adoptClient(int client_socket)
+    {
+        if (!running_.load())
+        {
+            return false;
+        }
+
+        struct sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        memset(&address, 0, sizeof(address));
+        if (getpeername(client_socket, (struct sockaddr *)&address, &length) < 0)
+        {
+            std::error_code ec(errno, std::system_category());
+            std::cerr << "Dropping inherited socket " << client_socket << ": " << ec.message() << std::endl;
+            close(client_socket);
+            return false;
+        }
+
+        adoptConnection(*reactors_[0], client_socket, address);
+        for (auto &reactor : reactors_)
+        {
+            wake(*reactor);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Stop the reactor threads and let the worker pool finish
+     *
+     * @return false if the server was not running
+     */
+    bool SocketServer::stopThreads()
+    {
+        if (!running_.exchange(false))
+        {
+            return false;
+        }
+
+        // Wake and join the reactor threads
+        for (auto &reactor : reactors_)
+        {
+            wake(*reactor);
+        }
+        for (auto &reactor : reactors_)
+        {
+            if (reactor->thread.joinable())
+            {
+                reactor->thread.join();
+            }
+        }
+
+        // Finish in-flight requests; their responses are discarded by releaseResources()
+        workers_.shutdown();
+        return true;
+    }
+
+    /**
+     * @brief Close every connection, listening socket and wake pipe
+     *
+     * Called once the reactor threads and the worker pool have stopped.
+     */
+    void SocketServer::releaseResources()
+    {
+        for (auto &reactor : reactors_)
+        {
+            // Close all client connections
+            std::map<int, ConnectionPtr> connections;
+            {
+                std::lock_guard<std::mutex> lock(reactor->mutex);
+                connections.swap(reactor->connections);
+            }
+            for (auto &entry : connections)
+            {
+                closeConnection(entry.second);
+            }
+            connections.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(reactor->mutex);
+                reactor->adopted.clear();
+                reactor->resumed.clear();
+                reactor->flush.clear();
+            }
+
+            // Close listening sockets and wake pipe
+            for (int &fd : reactor->listeners)
+                closeFd(fd);
+            reactor->listeners.clear();
+            closeFd(reactor->wake_fds[0]);
+            closeFd(reactor->wake_fds[1]);
+        }
+        releaseBackend();
+        client_count_ = 0;
+
+        if (!unix_path_.empty())
+        {
+            unlink(unix_path_.c_str());
+            unix_path_.clear();
+        }
+    }
+
+    /**
+     * @brief Send a message to a specific client
+     *
+     * Frames the message (see queueMessage()) and queues it on the
+     * client's connection. The message is written immediately if the socket
+     * accepts it, otherwise the owning reactor writes it once the socket
+     * becomes writable.
+     *
+     * @param client_socket The client socket descriptor
+     * @param message The message string to send
+     * @return true if the message was sent or queued, false otherwise
+     */
+    bool SocketServer::send(int client_socket, const std::string &message)
+    {
+        ConnectionPtr conn = findConnection(client_socket);
+        if (!conn)
+        {
+            return false;
+        }
+        return queueMessage(conn, message);
+    }
+
+    /**
+     * @brief Broadcast a message to all connected clients
+     *
+     * Sends the same message to all currently connected clients.
+     * Uses thread-safe access to each reactor's client list.
+     *
+     * @param message The message to broadcast
+     */
+    void SocketServer::broadcast(const std::string &message)
+    {
+        std::vector<ConnectionPtr> targets;
+        for (auto &reactor : reactors_)
+        {
+            std::lock_guard<std::mutex> lock(reactor->mutex);
+            for (auto &entry : reactor->connections)
+            {
+                targets.push_back(entry.second);
+            }
+        }
+        for (const auto &conn : targets)
+        {
+            queueMessage(conn, message);
+        }
+    }
+
+    /**
+     * @brief Broadcast a message to a subset of connected clients
+     *
+     * Sends the same message to every listed connection that is still in
+     * the connected client list. Used to push subscription updates, where
+     * one encoded message is shared by all subscribers of a topic. A socket
+     * now serving another connection than the listed one is skipped: its
+     * subscriber is gone and the new client never asked for the message.
+     *
+     * @param clients The connections to send to
+     * @param message The message to broadcast
+     */
+    void SocketServer::broadcast(const std::vector<ClientConnection> &clients, const std::string &message)
+    {
+        for (const ClientConnection &client : clients)
+        {
+            ConnectionPtr conn = findConnection(client.socket);
+            if (conn && conn->id == client.connection_id)
+            {
+                queueMessage(conn, message);
+            }
+        }
+    }
+
+    /**
+     * @brief Get the id of the connection a client socket currently serves
+     *
+     * @param client_socket The client socket descriptor
+     * @return The connection id, or 0 if the client is not connected
+     */
+    uint64_t SocketServer::connectionId(int client_socket)
+    {
+        ConnectionPtr conn = findConnection(client_socket);
+        return conn ? conn->id : 0;
+    }
+
+    /**
+     * @brief Set the callback invoked when a client disconnects
+     *
+     * Must be called before init(); the handler is invoked once all requests
+     * in flight on the connection have finished, just before the client
+     * socket is closed.
+     *
+     * @param handler The callback function to notify of disconnections
+     */
+    void SocketServer::setDisconnectHandler(DisconnectHandler handler)
+    {
+        disconnect_handler_ = handler;
+    }
+
+    void SocketServer::setRequestClassifier(RequestClassifier classifier)
+    {
+        request_classifier_ = classifier;
+    }
+
+    bool SocketServer::submitTask(WorkerPool::Task task, RequestClass request_class)
+    {
+        return workers_.submit(std::move(task), request_class);
+    }
+
+    /**
+     * @brief Event loop of one reactor
+     *
+     * Runs the loop of the configured I/O backend until the server is shut
+     * down.
+     *
+     * @param reactor The reactor to run
+     */
+    void SocketServer::reactorLoop(Reactor &reactor)
+    {
+        reactor.now_ms = nowMs();
+        reactor.timers.reset(reactor.now_ms);
+
+        switch (backend_)
+        {
+#ifdef RPM_HAVE_IO_URING
+        case IoBackend::IO_URING:
+            uringLoop(reactor);
+            break;
+#endif
+#ifdef RPM_HAVE_EPOLL
+        case IoBackend::EPOLL:
+            epollLoop(reactor);
+            break;
+#endif
+        default:
+            selectLoop(reactor);
+            break;
+        }
+    }
+
+    /**
+     * @brief Reactor loop multiplexing sockets with select()
+     *
+     * This loop:
+     * 1. Uses select() to monitor the reactor's listening sockets, its wake
+     *    pipe and every client socket it owns (for reading while below the
+     *    in-flight limit, for writing while output is queued)
+     * 2. Accepts new client connections
+     * 3. Reads request data and dispatches complete requests to the worker pool
+     * 4. Writes queued responses and handles client disconnections
+     *
+     * The client set is rebuilt on every iteration, so the resumed list is
+     * only cleared here.
+     *
+     * @param reactor The reactor to run
+     */
+    void SocketServer::selectLoop(Reactor &reactor)
+    {
+        fd_set read_fds;
+        fd_set write_fds;
+        int max_sd;
+        struct timeval tv = {1, 0}; // 1 second timeout for select
+        std::vector<ConnectionPtr> active;
+        std::vector<ConnectionPtr> adopted;
+        std::vector<ConnectionPtr> flush;
+
+        while (running_.load())
+        {
+            FD_ZERO(&read_fds);
+            FD_ZERO(&write_fds);
+            FD_SET(reactor.wake_fds[0], &read_fds);
+            max_sd = reactor.wake_fds[0];
+            for (int fd : reactor.listeners)
+            {
+                FD_SET(fd, &read_fds);
+                max_sd = std::max(max_sd, fd);
+            }
+
+            // Add client sockets to the sets
+            active.clear();
+            {
+                std::lock_guard<std::mutex> lock(reactor.mutex);
+                adopted.swap(reactor.adopted);
+                flush.swap(reactor.flush);
+                reactor.resumed.clear();
+                for (auto &entry : reactor.connections)
+                {
+                    active.push_back(entry.second);
+                }
+            }
+            for (const auto &conn : adopted)
+            {
+                armTimer(conn);
+            }
+            for (const auto &conn : flush)
+            {
+                noteOutputQueued(conn);
+            }
+            adopted.clear();
+            flush.clear();
+            for (const auto &conn : active)
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->in_flight < MAX_IN_FLIGHT_PER_CLIENT)
+                    FD_SET(conn->fd, &read_fds);
+                if (!conn->output.empty())
+                    FD_SET(conn->fd, &write_fds);
+                max_sd = std::max(max_sd, conn->fd);
+            }
+
+            // Wait at most until the next timer tick
+            int timeout = waitTimeout(reactor);
+            tv.tv_sec = timeout / 1000;
+            tv.tv_usec = (timeout % 1000) * 1000;
+
+            // Wait for activity on any of the sockets
+            int activity = select(max_sd + 1, &read_fds, &write_fds, nullptr, &tv);
+            reactor.now_ms = nowMs();
+
+            if (!running_.load())
+                break; // Check again after select
+
+            if (activity < 0)
+            {
+                // select error (e.g., EINTR)
+                if (errno == EINTR)
+                    continue;
+                std::error_code ec(errno, std::system_category());
+                std::cerr << "Select error: " << ec.message() << std::endl;
+                continue;
+            }
+
+            // Drain wake-ups; completed requests may have freed in-flight slots
+            // and connections may have been handed to this reactor
+            if (FD_ISSET(reactor.wake_fds[0], &read_fds))
+            {
+                drainPipe(reactor.wake_fds[0]);
+            }
+
+            // Check for incoming connections
+            for (int fd : reactor.listeners)
+            {
+                if (FD_ISSET(fd, &read_fds))
+                {
+                    acceptConnections(reactor, fd);
+                }
+            }
+
+            // Check for activity on client sockets
+            for (const auto &conn : active)
+            {
+                if (FD_ISSET(conn->fd, &write_fds) && !writeToClient(conn))
+                {
+                    closeConnection(conn);
+                    continue;
+                }
+                if (FD_ISSET(conn->fd, &read_fds) && !readFromClient(conn))
+                {
+                    closeConnection(conn);
+                    continue;
+                }
+                processInput(conn);
+            }
+
+            expireTimers(reactor);
+        }
+    }
+
+#ifdef RPM_HAVE_EPOLL
+    /**
+     * @brief Reactor loop multiplexing sockets with edge-triggered epoll
+     *
+     * Each client socket is registered once, for input and output, when the
+     * reactor adopts it. Edge-triggered events only report new readiness, so
+     * a socket is read until it would block, except while the connection is
+     * at its in-flight limit: then the data stays in the kernel (pushing back
+     * on the client) until the connection is resumed and read again.
+     *
+     * @param reactor The reactor to run
+     */
+    void SocketServer::epollLoop(Reactor &reactor)
+    {
+        struct epoll_event events[EPOLL_EVENTS];
+        std::vector<ConnectionPtr> adopted;
+        std::vector<ConnectionPtr> resumed;
+        std::vector<ConnectionPtr> flush;
+
+        // Read and dispatch until the socket is drained or the connection is full
+        auto service = [this](const ConnectionPtr &conn)
+        {
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(conn->mutex);
+                    if (conn->closed || conn->in_flight >= MAX_IN_FLIGHT_PER_CLIENT)
+                        return;
+                }
+                if (!readFromClient(conn))
+                {
+                    closeConnection(conn);
+                    return;
+                }
+                if (!processInput(conn) || conn->drained)
+                    return;
+            }
+        };
+
+        while (running_.load())
+        {
+            int count = epoll_wait(reactor.epoll_fd, events, EPOLL_EVENTS, waitTimeout(reactor));
+            reactor.now_ms = nowMs();
+
+            if (!running_.load())
+                break;
+
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::error_code ec(errno, std::system_category());
+                std::cerr << "epoll_wait error: " << ec.message() << std::endl;
+                continue;
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                int fd = events[i].data.fd;
+                uint32_t ready = events[i].events;
+                if (fd == reactor.wake_fds[0])
+                {
+                    drainPipe(fd);
+                    continue;
+                }
+                if (std::find(reactor.listeners.begin(), reactor.listeners.end(), fd) != reactor.listeners.end())
+                {
+                    acceptConnections(reactor, fd);
+                    continue;
+                }
+
+                ConnectionPtr conn;
+                {
+                    std::lock_guard<std::mutex> lock(reactor.mutex);
+                    auto it = reactor.connections.find(fd);
+                    if (it == reactor.connections.end())
+                        continue; // Closed since the event was queued
+                    conn = it->second;
+                }
+                if ((ready & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && !writeToClient(conn))
+                {
+                    closeConnection(conn);
+                    continue;
+                }
+                if (ready & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))
+                {
+                    service(conn);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(reactor.mutex);
+                adopted.swap(reactor.adopted);
+                resumed.swap(reactor.resumed);
+                flush.swap(reactor.flush);
+            }
+
+            // Start watching new clients; data already waiting is reported by the first wait
+            for (const auto &conn : adopted)
+            {
+                struct epoll_event event;
+                memset(&event, 0, sizeof(event));
+                event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                event.data.fd = conn->fd;
+                if (epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, conn->fd, &event) < 0)
+                {
+                    std::error_code ec(errno, std::system_category());
+                    std::cerr << "Failed to watch client " << conn->fd << ": " << ec.message() << std::endl;
+                    closeConnection(conn);
+                    continue;
+                }
+                armTimer(conn);
+            }
+
+            // Requests buffered (or left in the kernel) while a connection was full
+            for (const auto &conn : resumed)
+            {
+                service(conn);
+            }
+            for (const auto &conn : flush)
+            {
+                noteOutputQueued(conn);
+            }
+            adopted.clear();
+            resumed.clear();
+            flush.clear();
+
+            expireTimers(reactor);
+        }
+    }
+#endif
+
+#ifdef RPM_HAVE_IO_URING
+    /**
+     * @brief Reactor loop performing socket I/O through io_uring
+     *
+     * The ring keeps a multishot accept armed on every listener, a multishot
+     * poll on the wake pipe and a multishot receive, drawing from the
+     * reactor's provided buffer ring, on every client. A receive is cancelled
+     * while its connection is at the in-flight limit and re-armed once the
+     * connection is resumed.
+     *
+     * Responses are not written by the workers: they are queued on the
+     * connection, which is put on the reactor's flush list. Each iteration
+     * turns everything queued per connection into one send, so responses
+     * completed since the last iteration are submitted with a single
+     * io_uring_enter() together with any re-armed requests. At most one send
+     * per connection is in flight, which keeps responses in queue order.
+     *
+     * Every pending request holds an Op record whose address is the
+     * request's user data; records of client requests keep their connection
+     * (and so its descriptor and send buffer) alive until the kernel is done.
+     *
+     * @param reactor The reactor to run
+     */
+    void SocketServer::uringLoop(Reactor &reactor)
+    {
+        enum class OpKind
+        {
+            ACCEPT,
+            WAKE,
+            RECV,
+            SEND
+        };
+        struct Op
+        {
+            OpKind kind;
+            int fd;
+            ConnectionPtr conn;
+        };
+
+        IoUring &ring = *reactor.ring;
+        std::unordered_set<Op *> pending;
+        std::vector<ConnectionPtr> adopted;
+        std::vector<ConnectionPtr> resumed;
+        std::vector<ConnectionPtr> flush;
+
+        // Get a submission entry for a new request, submitting queued ones if the queue is full
+        auto prepare = [&](OpKind kind, int fd, ConnectionPtr conn) -> io_uring_sqe *
+        {
+            io_uring_sqe *sqe = ring.getSqe();
+            while (!sqe)
+            {
+                ring.submit();
+                sqe = ring.getSqe();
+            }
+            Op *op = new Op{kind, fd, std::move(conn)};
+            pending.insert(op);
+            sqe->fd = fd;
+            sqe->user_data = reinterpret_cast<uint64_t>(op);
+            return sqe;
+        };
+
+        auto armAccept = [&](int listen_fd)
+        {
+            io_uring_sqe *sqe = prepare(OpKind::ACCEPT, listen_fd, nullptr);
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        };
+
+        auto armWake = [&]()
+        {
+            io_uring_sqe *sqe = prepare(OpKind::WAKE, reactor.wake_fds[0], nullptr);
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLIN;
+            sqe->len = IORING_POLL_ADD_MULTI;
+        };
+
+        auto isOpen = [](const ConnectionPtr &conn, bool below_limit)
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            return !conn->closed && (!below_limit || conn->in_flight < MAX_IN_FLIGHT_PER_CLIENT);
+        };
+
+        auto armRecv = [&](const ConnectionPtr &conn)
+        {
+            if (conn->recv_armed || !running_.load() || !isOpen(conn, true))
+                return;
+            io_uring_sqe *sqe = prepare(OpKind::RECV, conn->fd, conn);
+            sqe->opcode = IORING_OP_RECV;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = URING_BUFFER_GROUP;
+            conn->recv_armed = true;
+            conn->recv_op = sqe->user_data;
+        };
+
+        // Stop receiving while the connection is full; the kernel buffers (and
+        // eventually pushes back on) whatever the client sends meanwhile
+        auto pauseRecv = [&](const ConnectionPtr &conn)
+        {
+            if (!conn->recv_op || isOpen(conn, true))
+                return;
+            io_uring_sqe *sqe = ring.getSqe();
+            while (!sqe)
+            {
+                ring.submit();
+                sqe = ring.getSqe();
+            }
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = conn->recv_op;
+            sqe->user_data = 0;
+            conn->recv_op = 0;
+        };
+
+        auto submitSend = [&](const ConnectionPtr &conn)
+        {
+            io_uring_sqe *sqe = prepare(OpKind::SEND, conn->fd, conn);
+            sqe->opcode = IORING_OP_SEND;
+            sqe->addr = reinterpret_cast<uint64_t>(conn->sending.data() + conn->sending_offset);
+            sqe->len = static_cast<uint32_t>(conn->sending.size() - conn->sending_offset);
+            sqe->msg_flags = MSG_NOSIGNAL;
+            conn->send_armed = true;
+        };
+
+        // Gather everything queued on the connection into one send
+        auto startSend = [&](const ConnectionPtr &conn)
+        {
+            if (conn->send_armed || !running_.load())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->closed || conn->output.empty())
+                    return;
+                conn->sending.clear();
+                conn->sending_offset = 0;
+                for (const std::string &frame : conn->output)
+                {
+                    conn->sending.append(frame);
+                }
+                conn->output.clear();
+            }
+            submitSend(conn);
+        };
+
+        auto complete = [&](const io_uring_cqe &cqe)
+        {
+            Op *op = reinterpret_cast<Op *>(cqe.user_data);
+            if (!op)
+                return; // Cancellation request
+            const bool more = cqe.flags & IORING_CQE_F_MORE;
+            const ConnectionPtr conn = op->conn;
+
+            switch (op->kind)
+            {
+            case OpKind::ACCEPT:
+                if (cqe.res >= 0)
+                {
+                    struct sockaddr_storage address;
+                    socklen_t address_len = sizeof(address);
+                    memset(&address, 0, sizeof(address));
+                    getpeername(cqe.res, (struct sockaddr *)&address, &address_len);
+                    adoptConnection(reactor, cqe.res, address);
+                }
+                else if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR)
+                {
+                    std::error_code ec(-cqe.res, std::system_category());
+                    std::cerr << "Failed to accept new connection: " << ec.message() << std::endl;
+                }
+                if (!more && running_.load())
+                    armAccept(op->fd);
+                break;
+
+            case OpKind::WAKE:
+                drainPipe(reactor.wake_fds[0]);
+                if (!more && running_.load())
+                    armWake();
+                break;
+
+            case OpKind::RECV:
+                if (cqe.res > 0)
+                {
+                    uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    if (isOpen(conn, false))
                     {
-                        client_sockets_.push_back(new_socket);
+                        // A completion says nothing about what is still in flight, so the
+                        // connection never counts as drained and requests need their newline
+                        conn->input.append(ring.buffer(id), static_cast<size_t>(cqe.res));
+                        conn->last_activity.store(reactor.now_ms, std::memory_order_relaxed);
                     }
-                    else
+                    ring.recycleBuffer(id);
+                    if (isOpen(conn, false) && processInput(conn))
+                        pauseRecv(conn);
+                }
+                else if (cqe.res == 0 || cqe.res == -ECONNRESET)
+                {
+                    std::cout << "Client disconnected: " << conn->peer
+                              << " on socket fd " << conn->fd << std::endl;
+                    closeConnection(conn);
+                }
+                else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+                {
+                    std::error_code ec(-cqe.res, std::system_category());
+                    std::cerr << "Error reading from client " << conn->fd << ": " << ec.message() << std::endl;
+                    closeConnection(conn);
+                }
+                if (!more)
+                {
+                    // Ended by cancellation, exhausted buffers or a disconnect;
+                    // re-armed only if the connection can take requests again
+                    conn->recv_armed = false;
+                    conn->recv_op = 0;
+                    armRecv(conn);
+                }
+                break;
+
+            case OpKind::SEND:
+                conn->send_armed = false;
+                if (cqe.res < 0)
+                {
+                    if (cqe.res != -EPIPE && cqe.res != -ECONNRESET && cqe.res != -ECANCELED)
                     {
-                        std::cerr << "Maximum clients reached. Rejecting connection from " << client_ip << std::endl;
-                        close(new_socket);
-                        continue;
+                        std::error_code ec(-cqe.res, std::system_category());
+                        std::cerr << "Failed to send message to client " << conn->fd << ": " << ec.message() << std::endl;
+                    }
+                    closeConnection(conn);
+                    break;
+                }
+                conn->sending_offset += static_cast<size_t>(cqe.res);
+                conn->last_activity.store(reactor.now_ms, std::memory_order_relaxed);
+                if (conn->sending_offset < conn->sending.size())
+                {
+                    submitSend(conn); // Short send: continue with the rest
+                }
+                else
+                {
+                    conn->sending.clear();
+                    startSend(conn); // Responses queued while this send was pending
+                    if (!conn->send_armed)
+                    {
+                        conn->output_since = 0; // Everything written
                     }
                 }
+                break;
+            }
+
+            if (!more)
+            {
+                pending.erase(op);
+                delete op;
+            }
+        };
+
+        for (int fd : reactor.listeners)
+        {
+            armAccept(fd);
+        }
+        armWake();
+
+        while (running_.load())
+        {
+            int ret = ring.submitAndWait(waitTimeout(reactor));
+            reactor.now_ms = nowMs();
+            if (!running_.load())
+                break;
+            if (ret < 0 && ret != -EBUSY)
+            {
+                std::error_code ec(-ret, std::system_category());
+                std::cerr << "io_uring_enter error: " << ec.message() << std::endl;
+            }
+
+            ring.forEachCompletion(complete);
+
+            {
+                std::lock_guard<std::mutex> lock(reactor.mutex);
+                adopted.swap(reactor.adopted);
+                resumed.swap(reactor.resumed);
+                flush.swap(reactor.flush);
+            }
+            for (const auto &conn : adopted)
+            {
+                armRecv(conn);
+                armTimer(conn);
+            }
+            for (const auto &conn : resumed)
+            {
+                // Dispatch requests buffered while the connection was full, then receive again
+                if (isOpen(conn, false) && processInput(conn))
+                {
+                    armRecv(conn);
+                }
+            }
+            for (const auto &conn : flush)
+            {
+                noteOutputQueued(conn);
+                startSend(conn);
+            }
+            adopted.clear();
+            resumed.clear();
+            flush.clear();
+
+            expireTimers(reactor);
+        }
+
+        // Cancel everything still pending and collect the completions, so the
+        // kernel no longer references any connection or buffer released below
+        io_uring_sqe *sqe = ring.getSqe();
+        if (!sqe)
+        {
+            ring.submit();
+            sqe = ring.getSqe();
+        }
+        if (sqe)
+        {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            sqe->user_data = 0;
+        }
+        for (int attempt = 0; attempt < 10 && !pending.empty(); ++attempt)
+        {
+            ring.submitAndWait(100);
+            ring.forEachCompletion(complete);
+        }
+        for (Op *op : pending)
+        {
+            delete op;
+        }
+    }
+#endif
+
+    /**
+     * @brief Accept pending connections on a listening socket
+     *
+     * Accepts up to ACCEPT_BATCH connections per call so that a reconnect
+     * storm is drained quickly without starving the reactor's clients.
+     *
+     * @param reactor The reactor that owns the listening socket
+     * @param listen_fd The TCP or Unix domain listening socket
+     */
+    void SocketServer::acceptConnections(Reactor &reactor, int listen_fd)
+    {
+        for (int accepted = 0; accepted < ACCEPT_BATCH; ++accepted)
+        {
+            struct sockaddr_storage client_address;
+            socklen_t client_len = sizeof(client_address);
+            int new_socket = accept(listen_fd, (struct sockaddr *)&client_address, &client_len);
+
+            if (new_socket < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    std::error_code ec(errno, std::system_category());
+                    std::cerr << "Failed to accept new connection: " << ec.message() << std::endl;
+                }
+                return;
+            }
+
+            adoptConnection(reactor, new_socket, client_address);
+        }
+    }
+
+    /**
+     * @brief Register an accepted client socket with one of the reactors
+     *
+     * Client sockets are switched to non-blocking mode so neither the
+     * reactors nor the workers can stall on a slow peer. Connections arriving
+     * on a per-reactor (SO_REUSEPORT) listener stay on that reactor; all
+     * others are assigned to the reactors round-robin.
+     *
+     * @param reactor The reactor that accepted the connection
+     * @param new_socket The accepted client socket
+     * @param address The peer address reported by accept()
+     */
+    void SocketServer::adoptConnection(Reactor &reactor, int new_socket, const struct sockaddr_storage &address)
+    {
+        // Describe the peer for logging: IP and port, or the local socket path
+        const bool is_unix = address.ss_family == AF_UNIX;
+        std::string peer;
+        if (is_unix)
+        {
+            peer = "unix:" + unix_path_;
+        }
+        else
+        {
+            const struct sockaddr_in *inet_address = (const struct sockaddr_in *)&address;
+            char client_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &inet_address->sin_addr, client_ip, INET_ADDRSTRLEN);
+            peer = std::string(client_ip) + ":" + std::to_string(ntohs(inet_address->sin_port));
+        }
+
+        std::cout << "New connection from " << peer << ", socket fd is " << new_socket << std::endl;
+
+        if (!setNonBlocking(new_socket))
+        {
+            std::error_code ec(errno, std::system_category());
+            std::cerr << "Failed to make socket " << new_socket << " non-blocking: " << ec.message() << std::endl;
+            close(new_socket);
+            return;
+        }
+
+        // Responses are written as soon as they complete; don't let Nagle
+        // hold one back waiting for the client's delayed ACK
+        if (!is_unix)
+        {
+            int one = 1;
+            setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        // The descriptor is closed by releaseConnection() once no in-flight
+        // request references the connection any more.
+        ConnectionPtr conn(new Connection, [this](Connection *c)
+                           { releaseConnection(c); });
+        conn->fd = new_socket;
+        conn->id = next_connection_id_.fetch_add(1);
+        conn->peer = peer;
+        conn->last_activity.store(nowMs(), std::memory_order_relaxed);
+
+        // Add new client to the list if there's room
+        if (client_count_.fetch_add(1) >= MAX_CLIENTS)
+        {
+            client_count_.fetch_sub(1);
+            std::cerr << "Maximum clients reached. Rejecting connection from " << peer << std::endl;
+            conn->closed = true;
+            return; // Released (and closed) when conn goes out of scope
+        }
+
+        Reactor &owner = (reuse_port_ && !is_unix)
+                             ? reactor
+                             : *reactors_[next_reactor_.fetch_add(1) % reactors_.size()];
+        conn->reactor = &owner;
+        {
+            std::lock_guard<std::mutex> lock(owner.mutex);
+            owner.connections[new_socket] = conn;
+            owner.adopted.push_back(std::move(conn));
+        }
+        if (&owner != &reactor)
+        {
+            wake(owner); // Let the owner start watching the new socket
+        }
+    }
+
+    /**
+     * @brief Read all available data from a client
+     *
+     * Appends everything the socket currently holds to the connection's input
+     * buffer without blocking.
+     *
+     * @param conn The connection to read from
+     * @return false if the client disconnected or an error occurred
+     */
+    bool SocketServer::readFromClient(const ConnectionPtr &conn)
+    {
+        char buffer[BUFFER_SIZE];
+
+        while (conn->input.size() <= MAX_REQUEST_SIZE)
+        {
+            ssize_t valread = recv(conn->fd, buffer, BUFFER_SIZE, 0);
+            if (valread > 0)
+            {
+                conn->input.append(buffer, static_cast<size_t>(valread));
+                conn->last_activity.store(conn->reactor->now_ms, std::memory_order_relaxed);
+                continue;
+            }
+            if (valread == 0 || errno == ECONNRESET)
+            {
+                std::cout << "Client disconnected: " << conn->peer
+                          << " on socket fd " << conn->fd << std::endl;
+                return false;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                conn->drained = true;
+                return true;
+            }
+
+            std::error_code ec(errno, std::system_category());
+            std::cerr << "Error reading from client " << conn->fd << ": " << ec.message() << std::endl;
+            return false;
+        }
+
+        conn->drained = false;
+        return true;
+    }
+
+    /**
+     * @brief Write queued output to a client
+     *
+     * Writes queued messages in order until the queue is empty or the socket
+     * would block.
+     *
+     * @param conn The connection to write to
+     * @return false if an error occurred and the connection must be closed
+     */
+    bool SocketServer::writeToClient(const ConnectionPtr &conn)
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+
+        while (!conn->output.empty())
+        {
+            const std::string &front = conn->output.front();
+            ssize_t sent = ::send(conn->fd, front.data() + conn->output_offset,
+                                  front.size() - conn->output_offset, SEND_FLAGS);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return true;
+
+                std::error_code ec(errno, std::system_category());
+                // Don't print error for broken pipe or reset, it happens normally when client disconnects
+                if (ec.value() != EPIPE && ec.value() != ECONNRESET)
+                {
+                    std::cerr << "Failed to send message to client " << conn->fd << ": " << ec.message() << std::endl;
+                }
+                return false;
+            }
+
+            conn->output_offset += static_cast<size_t>(sent);
+            conn->last_activity.store(conn->reactor->now_ms, std::memory_order_relaxed);
+            if (conn->output_offset == front.size())
+            {
+                conn->output.pop_front();
+                conn->output_offset = 0;
+            }
+        }
+        conn->output_since = 0; // Everything written
+        return true;
+    }
+
+    /**
+     * @brief Dispatch buffered requests to the worker pool
+     *
+     * Requests are delimited by '\n' (a trailing '\r' is ignored). A client that
+     * never sends a newline may send one request per read instead, see
+     * isCompleteRequest(); this needs a drained socket, so not with io_uring.
+     * Each request is handled on a worker thread; its response is queued on the connection
+     * when the handler returns, so responses may be written in a different
+     * order than the requests arrived.
+     *
+     * @param conn The connection whose input buffer is processed
+     * @return true if the buffered input ends with an incomplete request
+     */
+    bool SocketServer::dispatchRequests(const ConnectionPtr &conn)
+    {
+        std::string &input = conn->input;
+        size_t start = 0;
+        bool incomplete = false;
+
+        while (start < input.size())
+        {
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->in_flight >= MAX_IN_FLIGHT_PER_CLIENT)
+                    break;
             }
 
-            // Check for activity on client sockets
-            std::vector<int> clients_to_remove;
+            std::string message;
+            size_t newline = input.find('\n', start);
+            if (newline != std::string::npos)
+            {
+                message = input.substr(start, newline - start);
+                start = newline + 1;
+                conn->framed = true;
+            }
+            else if (conn->drained && !conn->framed && isCompleteRequest(input, start))
+            {
+                message = input.substr(start);
+                start = input.size();
+            }
+            else
+            {
+                incomplete = true;
+                break; // Wait for the rest of the request
+            }
+
+            if (!message.empty() && message.back() == '\r')
+                message.pop_back();
+            if (message.find_first_not_of(" \t\r") == std::string::npos)
+                continue; // Ignore blank lines
+
             {
-                std::lock_guard<std::mutex> lock(clients_mutex_);
-                for (int sd : client_sockets_)
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                ++conn->in_flight;
+            }
+
+            const RequestClass request_class = request_classifier_ ? request_classifier_(message) : RequestClass::POINT;
+            CancellationToken cancel = conn->cancel.startRequest(max_request_time_);
+            bool queued = workers_.submit([this, conn, message = std::move(message), cancel]()
+                                          {
+                std::string response;
+                if (message_handler_ && !cancel.isCancelled())
                 {
-                    if (FD_ISSET(sd, &read_fds))
+                    try
+                    {
+                        response = message_handler_(conn->fd, message, cancel);
+                    }
+                    catch (const std::exception &e)
                     {
-                        // Use handleClient to process this client's communication
-                        handleClient(sd);
-
-                        // Check if client is still connected after handling
-                        char buffer[1];
-                        if (recv(sd, buffer, 1, MSG_PEEK | MSG_DONTWAIT) <= 0 && errno != EAGAIN && errno != EWOULDBLOCK)
-                        {
-                            // Connection closed or error
-                            clients_to_remove.push_back(sd);
-                        }
+                        std::cerr << "Error processing message from client " << conn->fd << ": " << e.what() << std::endl;
                     }
                 }
+                if (!response.empty())
+                {
+                    queueMessage(conn, response);
+                }
 
-                // Remove disconnected clients
-                for (int sd_to_remove : clients_to_remove)
+                bool was_full;
                 {
-                    client_sockets_.erase(
-                        std::remove(client_sockets_.begin(), client_sockets_.end(), sd_to_remove),
-                        client_sockets_.end());
+                    std::lock_guard<std::mutex> lock(conn->mutex);
+                    was_full = conn->in_flight-- == MAX_IN_FLIGHT_PER_CLIENT;
                 }
+                // Buffered requests on a connection at its limit wait for this slot
+                if (was_full)
+                {
+                    resumeConnection(conn);
+                } }, request_class);
+
+            if (!queued)
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                --conn->in_flight;
+                break;
             }
         }
-        std::cout << "Server loop terminated." << std::endl;
+
+        input.erase(0, start);
+        return incomplete;
+    }
+
+    /**
+     * @brief Dispatch newly received input and enforce the request size limit
+     *
+     * @param conn The connection that received data
+     * @return false if the connection was closed
+     */
+    bool SocketServer::processInput(const ConnectionPtr &conn)
+    {
+        // The request timeout runs from the first byte of an incomplete
+        // request; receiving more of it does not extend the deadline
+        if (!dispatchRequests(conn))
+        {
+            conn->request_since = 0;
+        }
+        else if (conn->request_since == 0)
+        {
+            conn->request_since = conn->reactor->now_ms;
+            armTimer(conn);
+        }
+
+        // Many pipelined requests may be buffered, but a single one may not exceed the limit
+        if (conn->input.size() > MAX_REQUEST_SIZE && conn->input.find('\n') == std::string::npos)
+        {
+            std::cerr << "Request from " << conn->peer << " exceeds " << MAX_REQUEST_SIZE
+                      << " bytes, closing connection." << std::endl;
+            closeConnection(conn);
+            return false;
+        }
+        return true;
     }
 
     /**
-     * @brief Handle communication with a specific client
+     * @brief Tell a connection's reactor that one of its in-flight slots freed up
      *
-     * Receives messages from the client, processes them through the message handler,
-     * and sends back any responses. Handles errors and client disconnections.
+     * Called from worker threads. The reactor dispatches requests that were
+     * buffered while the connection was full and resumes reading from it.
      *
-     * @param client_socket The socket descriptor for the client connection
+     * @param conn The connection that was at its in-flight limit
      */
-    void SocketServer::handleClient(int client_socket)
+    void SocketServer::resumeConnection(const ConnectionPtr &conn)
     {
-        char buffer[BUFFER_SIZE];
-        memset(buffer, 0, BUFFER_SIZE);
-        ssize_t valread = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
+        {
+            std::lock_guard<std::mutex> lock(conn->reactor->mutex);
+            conn->reactor->resumed.push_back(conn);
+        }
+        wake(*conn->reactor);
+    }
+
+    /**
+     * @brief Note that a connection's output queue became non-empty
+     *
+     * Starts the write timeout unless it is already running. The output may
+     * have been written in the meantime; the timeout is then stopped again by
+     * the next write or simply finds nothing left to wait for.
+     *
+     * @param conn The connection with queued output
+     */
+    void SocketServer::noteOutputQueued(const ConnectionPtr &conn)
+    {
+        if (conn->output_since == 0)
+        {
+            conn->output_since = conn->reactor->now_ms;
+            armTimer(conn);
+        }
+    }
 
-        if (valread > 0)
+    /**
+     * @brief Schedule a connection's timer for its earliest pending deadline
+     *
+     * One timer per connection covers all three timeouts. It is set for the
+     * earliest deadline that may apply and re-evaluated when it fires, so
+     * ordinary traffic (which only ever moves the idle deadline later) never
+     * touches the timer wheel.
+     *
+     * @param conn The connection whose timer is updated
+     */
+    void SocketServer::armTimer(const ConnectionPtr &conn)
+    {
+        Reactor &reactor = *conn->reactor;
+        int64_t deadline = INT64_MAX;
+        if (idle_timeout_ms_ > 0)
+        {
+            // A busy connection is not idle; check again a full period from now
+            deadline = conn->last_activity.load(std::memory_order_relaxed) + idle_timeout_ms_;
+            if (deadline <= reactor.now_ms)
+                deadline = reactor.now_ms + idle_timeout_ms_;
+        }
+        if (request_timeout_ms_ > 0 && conn->request_since != 0)
+        {
+            deadline = std::min(deadline, conn->request_since + request_timeout_ms_);
+        }
+        if (write_timeout_ms_ > 0 && conn->output_since != 0)
         {
-            // Process message
-            buffer[valread] = '\0';
-            std::string message(buffer);
+            deadline = std::min(deadline, conn->output_since + write_timeout_ms_);
+        }
+
+        if (deadline == INT64_MAX)
+            reactor.timers.cancel(*conn);
+        else
+            reactor.timers.schedule(*conn, deadline);
+    }
+
+    /**
+     * @brief Close the connections of a reactor whose timeouts have expired
+     *
+     * Checked in order of severity: responses left unread for the write
+     * timeout, a request incomplete for the request timeout, and finally no
+     * traffic at all for the idle timeout while nothing is in flight. A
+     * connection that has not timed out is rescheduled.
+     *
+     * @param reactor The reactor whose timer wheel is advanced
+     */
+    void SocketServer::expireTimers(Reactor &reactor)
+    {
+        reactor.timers.advance(reactor.now_ms, [this, &reactor](TimerNode &node)
+                               {
+            Connection &expired = static_cast<Connection &>(node);
+            ConnectionPtr conn;
+            {
+                std::lock_guard<std::mutex> lock(reactor.mutex);
+                auto it = reactor.connections.find(expired.fd);
+                if (it != reactor.connections.end() && it->second.get() == &expired)
+                    conn = it->second;
+            }
+            if (!conn)
+                return;
 
-            // Call the message handler (could be in a separate thread for complex processing)
-            if (message_handler_)
+            const int64_t now = reactor.now_ms;
+            const char *what = nullptr; // Completed by " within <limit>"
+            ConnectionTimeout reason = ConnectionTimeout::IDLE;
+            int64_t limit_ms = 0;
+            if (write_timeout_ms_ > 0 && conn->output_since != 0 && now - conn->output_since >= write_timeout_ms_)
             {
-                try
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (!conn->output.empty() || !conn->sending.empty())
                 {
-                    std::string response = message_handler_(client_socket, message);
-                    if (!response.empty())
-                    {
-                        send(client_socket, response);
-                    }
+                    what = "responses not read";
+                    reason = ConnectionTimeout::WRITE;
+                    limit_ms = write_timeout_ms_;
                 }
-                catch (const std::exception &e)
+            }
+            if (!what && request_timeout_ms_ > 0 && conn->request_since != 0 &&
+                now - conn->request_since >= request_timeout_ms_)
+            {
+                what = "request not completed";
+                reason = ConnectionTimeout::REQUEST;
+                limit_ms = request_timeout_ms_;
+            }
+            if (!what && idle_timeout_ms_ > 0 &&
+                now - conn->last_activity.load(std::memory_order_relaxed) >= idle_timeout_ms_)
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (conn->in_flight == 0 && conn->output.empty() && conn->input.empty())
                 {
-                    std::cerr << "Error processing message from client " << client_socket << ": " << e.what() << std::endl;
+                    what = "no traffic";
+                    reason = ConnectionTimeout::IDLE;
+                    limit_ms = idle_timeout_ms_;
                 }
             }
+
+            if (!what)
+            {
+                armTimer(conn);
+                return;
+            }
+            std::cout << "Closing connection from " << conn->peer << " on socket fd " << conn->fd << ": "
+                      << what << " within " << limit_ms / 1000 << " s" << std::endl;
+            ServerStats::getInstance().recordTimeout(reason);
+            closeConnection(conn); });
+    }
+
+    /**
+     * @brief Get how long a reactor may wait for I/O before its timers are due
+     *
+     * @param reactor The reactor about to wait
+     * @return The wait timeout in milliseconds, at most one second
+     */
+    int SocketServer::waitTimeout(Reactor &reactor)
+    {
+        int64_t until_tick = reactor.timers.msUntilNextTick(nowMs());
+        return static_cast<int>(std::min<int64_t>(until_tick, 1000));
+    }
+
+    /**
+     * @brief Frame a message and queue it on a connection
+     *
+     * JSON messages are terminated with a newline; binary frames (see
+     * WireFormat.hpp) are already self-delimiting and are sent unchanged.
+     * If nothing is queued yet, the message is written straight away from the
+     * calling thread; only what the socket does not accept is queued for the
+     * owning reactor, which is woken to wait for writability.
+     *
+     * Whenever a connection's queue becomes non-empty it is put on its
+     * reactor's flush list, and the reactor is only woken for the first
+     * connection on the list. With the io_uring backend nothing is written
+     * here, so responses completing close together share one wake-up and
+     * one submit.
+     *
+     * @param conn The connection to send to
+     * @param message The unframed message
+     * @return true if the message was sent or queued, false if the connection is closed
+     */
+    bool SocketServer::queueMessage(const ConnectionPtr &conn, const std::string &message)
+    {
+        // Binary frames carry their own length; JSON messages end with a newline
+        std::string frame;
+        frame.reserve(message.size() + 1);
+        frame.append(message);
+        if (static_cast<uint8_t>(message[0]) != wire::FRAME_MAGIC)
+            frame.push_back('\n');
+        return queueFrame(conn, std::move(frame));
+    }
+
+    /**
+     * @brief Queue a framed message, or hold it back while a response is streamed
+     *
+     * A streamed response must reach the client in one piece, so messages
+     * completed in the meantime wait until the stream ends.
+     *
+     * @param conn The connection to send to
+     * @param frame The framed message
+     * @return true if the message was sent or queued, false if the connection is closed
+     */
+    bool SocketServer::queueFrame(const ConnectionPtr &conn, std::string &&frame)
+    {
+        std::unique_lock<std::mutex> lock(conn->mutex);
+        if (conn->closed)
+        {
+            return false;
         }
-        else
+        if (conn->streaming)
         {
-            // Client disconnected or error
-            char client_ip[INET_ADDRSTRLEN];
-            struct sockaddr_in addr;
-            socklen_t addr_len = sizeof(addr);
+            conn->held.push_back(std::move(frame));
+            return true;
+        }
+        pushOutput(conn, std::move(frame), lock);
+        return true;
+    }
 
-            if (getpeername(client_socket, (struct sockaddr *)&addr, &addr_len) == 0)
+    /**
+     * @brief Write bytes to a connection or append them to its output queue
+     *
+     * If nothing is queued yet, the bytes are written straight away from the
+     * calling thread (except with io_uring); what the socket does not accept
+     * is queued, and the connection is put on its reactor's flush list when
+     * its queue becomes non-empty.
+     *
+     * @param conn The connection to send to
+     * @param bytes The bytes to write
+     * @param lock Lock on the connection mutex, released on return
+     */
+    void SocketServer::pushOutput(const ConnectionPtr &conn, std::string &&bytes, std::unique_lock<std::mutex> &lock)
+    {
+        size_t offset = 0;
+        if (conn->output.empty() && backend_ != IoBackend::IO_URING)
+        {
+            while (offset < bytes.size())
             {
-                inet_ntop(AF_INET, &addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-                std::cout << "Client disconnected: " << client_ip
-                          << " on socket fd " << client_socket << std::endl;
+                ssize_t sent = ::send(conn->fd, bytes.data() + offset, bytes.size() - offset, SEND_FLAGS);
+                if (sent < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    break; // Would block or failed; the reactor deals with it
+                }
+                offset += static_cast<size_t>(sent);
             }
-            else
+            if (offset == bytes.size())
             {
-                std::error_code ec(errno, std::system_category());
-                std::cerr << "Error reading from client " << client_socket << ": " << ec.message() << std::endl;
+                conn->last_activity.store(nowMs(), std::memory_order_relaxed);
+                lock.unlock();
+                return;
             }
-            close(client_socket);
+        }
+
+        conn->output.push_back(std::move(bytes));
+        if (conn->output.size() > 1)
+        {
+            lock.unlock();
+            return; // Already on the flush list
+        }
+        conn->output_offset = offset;
+        lock.unlock();
+
+        bool first;
+        {
+            std::lock_guard<std::mutex> reactor_lock(conn->reactor->mutex);
+            first = conn->reactor->flush.empty();
+            conn->reactor->flush.push_back(conn);
+        }
+        if (first)
+        {
+            wake(*conn->reactor);
+        }
+    }
+
+    SocketServer::ResponseStream::ResponseStream(int client_socket)
+        : server_(SocketServer::getInstance()), client_socket_(client_socket)
+    {
+    }
+
+    SocketServer::ResponseStream::~ResponseStream()
+    {
+        if (open_)
+        {
+            abort();
+        }
+    }
+
+    /**
+     * @brief Write the next chunk of a streamed response
+     *
+     * Never waits: a worker must not be held up by a slow client. The
+     * first chunk claims the connection's output unless another stream owns
+     * it; a later chunk is taken while the client is less than
+     * STREAM_BACKLOG chunks behind. A declined chunk is left untouched.
+     *
+     * @param chunk The bytes to write
+     * @return false if the chunk was declined or the connection is gone
+     */
+    bool SocketServer::ResponseStream::write(std::string &&chunk)
+    {
+        return push(std::move(chunk), false);
+    }
+
+    /**
+     * @brief Write the rest of a streamed response and release the connection
+     *
+     * The rest is queued whatever the backlog, for the reactor to write as
+     * the client reads. If nothing was streamed and another stream owns the
+     * connection, the response is held back like any other one completed
+     * in the meantime.
+     *
+     * @param tail The rest of the response
+     * @return false if the connection is gone; a started stream is then aborted
+     */
+    bool SocketServer::ResponseStream::finish(std::string &&tail)
+    {
+        tail.push_back('\n');
+        if (!push(std::move(tail), true))
+        {
+            abort();
+            return false;
+        }
+        if (open_)
+            end(true);
+        return true;
+    }
+
+    bool SocketServer::ResponseStream::push(std::string &&chunk, bool last)
+    {
+        if (failed_)
+        {
+            return false;
+        }
+        if (!conn_ && !(conn_ = server_.findConnection(client_socket_)))
+        {
+            failed_ = true;
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(conn_->mutex);
+        if (conn_->closed || !server_.running_.load())
+        {
+            failed_ = true;
+            return false;
+        }
+        if (!open_ && conn_->streaming)
+        {
+            // Another stream owns the output: keep the response whole
+            if (!last)
+                return false;
+            conn_->held.push_back(std::move(chunk));
+            return true;
+        }
+        if (!last && open_ && conn_->output.size() >= STREAM_BACKLOG)
+        {
+            // The client is behind: the rest goes out in one piece with the last chunk
+            return false;
+        }
+
+        open_ = true;
+        conn_->streaming = true;
+        if (!chunk.empty())
+            server_.pushOutput(conn_, std::move(chunk), lock);
+        return true;
+    }
+
+    /**
+     * @brief Give up on a started response
+     *
+     * The client has part of a response it cannot complete, so the socket is
+     * shut down; the reactor then sees the disconnect and closes the
+     * connection as usual. Responses held back meanwhile are dropped.
+     */
+    void SocketServer::ResponseStream::abort()
+    {
+        if (!conn_)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(conn_->mutex);
+            if (!conn_->closed)
+            {
+                ::shutdown(conn_->fd, SHUT_RDWR);
+            }
+        }
+        if (open_)
+        {
+            end(false);
+        }
+        failed_ = true;
+    }
+
+    void SocketServer::ResponseStream::end(bool deliver)
+    {
+        std::deque<std::string> held;
+        {
+            std::lock_guard<std::mutex> lock(conn_->mutex);
+            conn_->streaming = false;
+            held.swap(conn_->held);
+        }
+        open_ = false;
+
+        // Completed independently of the stream, so their order relative to newer responses does not matter
+        for (std::string &frame : held)
+        {
+            if (!deliver || !server_.queueFrame(conn_, std::move(frame)))
+                break;
+        }
+    }
+
+    /**
+     * @brief Remove a connection from the server
+     *
+     * Marks the connection closed so that late responses are discarded, drops
+     * it from its reactor's client list and shuts the socket down so the peer
+     * sees the disconnect immediately. Only called by the owning reactor, or
+     * after the reactors have stopped, so the connection's timer can be
+     * cancelled here.
+     *
+     * @param conn The connection to close
+     */
+    void SocketServer::closeConnection(const ConnectionPtr &conn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if (conn->closed)
+            {
+                return;
+            }
+            conn->closed = true;
+            conn->output.clear();
+            conn->held.clear();
+        }
+        // Abandon the connection's queued and running requests
+        conn->cancel.cancel();
+
+        ::shutdown(conn->fd, SHUT_RDWR);
+        conn->reactor->timers.cancel(*conn);
+
+        std::lock_guard<std::mutex> lock(conn->reactor->mutex);
+        auto it = conn->reactor->connections.find(conn->fd);
+        if (it != conn->reactor->connections.end() && it->second == conn)
+        {
+            conn->reactor->connections.erase(it);
+            client_count_.fetch_sub(1);
+        }
+    }
+
+    /**
+     * @brief Release a connection once it is no longer referenced
+     *
+     * Runs when the last reference (held by the client list or by an in-flight
+     * request) goes away. Notifies the disconnect handler before closing the
+     * descriptor, so per-client state is gone before the number can be reused.
+     *
+     * @param conn The connection being destroyed
+     */
+    void SocketServer::releaseConnection(Connection *conn)
+    {
+        if (conn->handed_over)
+        {
+            // The descriptor and the client's state now belong to the successor
+            delete conn;
+            return;
+        }
+        if (disconnect_handler_)
+        {
+            try
+            {
+                disconnect_handler_(conn->fd);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Error in disconnect handler for client " << conn->fd << ": " << e.what() << std::endl;
+            }
+        }
+        close(conn->fd);
+        delete conn;
+    }
+
+    /**
+     * @brief Look up a connected client by socket descriptor
+     *
+     * @param client_socket The client socket descriptor
+     * @return The connection, or nullptr if the client is not connected
+     */
+    SocketServer::ConnectionPtr SocketServer::findConnection(int client_socket)
+    {
+        for (auto &reactor : reactors_)
+        {
+            std::lock_guard<std::mutex> lock(reactor->mutex);
+            auto it = reactor->connections.find(client_socket);
+            if (it != reactor->connections.end())
+            {
+                return it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Wake a reactor thread from its wait for I/O
+     *
+     * Writes a byte to the reactor's self-pipe. The pipe is non-blocking, so a
+     * full pipe (which already guarantees a pending wake-up) is silently ignored.
+     *
+     * @param reactor The reactor to wake
+     */
+    void SocketServer::wake(Reactor &reactor)
+    {
+        if (reactor.wake_fds[1] != -1)
+        {
+            char byte = 1;
+            ssize_t ignored = write(reactor.wake_fds[1], &byte, 1);
+            (void)ignored;
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,221 @@
+/**
+ * @file Subscription.cpp
+ * @brief Implementation of push subscriptions for QNX Remote Process Monitor
+ *
+ * This file implements the SubscriptionManager class. Subscriptions are
+ * grouped by the canonical key of their query (and the subscriber's wire
+ * format) when publishing, so a topic with many subscribers is selected and
+ * encoded (and, per codec, compressed) only once per cycle and the same
+ * message is then broadcast to every subscribed socket.
+ */
+
+#include "Subscription.hpp"
+#include "SocketServer.hpp"
+#include "JsonHandler.hpp"
+#include "Session.hpp"
+#include "Compression.hpp"
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+namespace qnx
+{
+    namespace
+    {
+        // Collection cycles are not perfectly periodic, so allow a push that is
+        // due slightly after the next cycle starts to go out on that cycle.
+        constexpr std::chrono::milliseconds PUBLISH_SLACK{100};
+
+        std::string encodeUpdate(WireFormat format, const std::string &topic,
+                                 const std::vector<const ProcessInfo *> &processes)
+        {
+            auto writer = ResponseWriter::acquire(format);
+            writer->startObject(NULL);
+            writer->addString("command", "update");
+            writer->addString("topic", topic.c_str());
+            writer->addInt("timestamp", static_cast<long long>(std::time(nullptr)));
+            encodeProcessList(*writer, "processes", processes);
+            writer->endObject();
+            return writer->finish();
+        }
+    }
+
+    SubscriptionManager &SubscriptionManager::getInstance()
+    {
+        static SubscriptionManager instance;
+        return instance;
+    }
+
+    std::optional<Subscription> SubscriptionManager::subscribe(int client_socket, const ProcessQuery &query,
+                                                               std::chrono::milliseconds interval)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        size_t owned = std::count_if(subscriptions_.begin(), subscriptions_.end(),
+                                     [client_socket](const auto &entry)
+                                     { return entry.second.client_socket == client_socket; });
+        if (owned >= MAX_SUBSCRIPTIONS_PER_CLIENT)
+        {
+            return std::nullopt;
+        }
+
+        Subscription subscription;
+        subscription.id = next_subscription_id_++;
+        subscription.client_socket = client_socket;
+        subscription.connection_id = SocketServer::getInstance().connectionId(client_socket);
+        subscription.query = query;
+        subscription.interval = std::clamp(interval, MIN_INTERVAL, MAX_INTERVAL);
+        subscriptions_[subscription.id] = subscription;
+
+        return subscription;
+    }
+
+    bool SubscriptionManager::unsubscribe(int client_socket, int subscription_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = subscriptions_.find(subscription_id);
+        if (it == subscriptions_.end() || it->second.client_socket != client_socket)
+        {
+            return false;
+        }
+
+        subscriptions_.erase(it);
+        return true;
+    }
+
+    std::vector<Subscription> SubscriptionManager::getSubscriptions(int client_socket) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<Subscription> result;
+        for (const auto &entry : subscriptions_)
+        {
+            if (entry.second.client_socket == client_socket)
+                result.push_back(entry.second);
+        }
+        return result;
+    }
+
+    bool SubscriptionManager::restore(const Subscription &subscription)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!subscriptions_.emplace(subscription.id, subscription).second)
+        {
+            return false;
+        }
+        next_subscription_id_ = std::max(next_subscription_id_, subscription.id + 1);
+        return true;
+    }
+
+    void SubscriptionManager::bindConnection(int client_socket, uint64_t connection_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto &entry : subscriptions_)
+        {
+            if (entry.second.client_socket == client_socket && entry.second.connection_id == 0)
+                entry.second.connection_id = connection_id;
+        }
+    }
+
+    size_t SubscriptionManager::unsubscribeAll(int client_socket)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        size_t removed = 0;
+        for (auto it = subscriptions_.begin(); it != subscriptions_.end();)
+        {
+            if (it->second.client_socket == client_socket)
+            {
+                it = subscriptions_.erase(it);
+                ++removed;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    void SubscriptionManager::publish()
+    {
+        struct DueTopic
+        {
+            ProcessQuery query;
+            std::vector<ClientConnection> clients;
+        };
+
+        // Collect due topics under the lock, but encode and send without it so
+        // that subscribe/unsubscribe requests are never blocked behind a push.
+        // Topics are keyed by wire format too, since each format is encoded once.
+        std::map<std::pair<std::string, WireFormat>, DueTopic> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::steady_clock::now();
+
+            for (auto &entry : subscriptions_)
+            {
+                Subscription &subscription = entry.second;
+                if (subscription.connection_id == 0 ||
+                    now + PUBLISH_SLACK - subscription.last_push < subscription.interval)
+                {
+                    continue; // Not due, or restored but not yet adopted
+                }
+                subscription.last_push = now;
+
+                WireFormat format = SessionManager::getInstance().get(subscription.client_socket).format;
+                DueTopic &topic = due[{subscription.query.key(), format}];
+                topic.query = subscription.query;
+                // Sent by connection id, so a socket reused by a new client in the meantime gets nothing
+                if (std::none_of(topic.clients.begin(), topic.clients.end(),
+                                 [&subscription](const ClientConnection &client)
+                                 { return client.socket == subscription.client_socket; }))
+                {
+                    topic.clients.push_back({subscription.client_socket, subscription.connection_id});
+                }
+            }
+        }
+
+        if (due.empty())
+        {
+            return;
+        }
+
+        const std::vector<ProcessInfo> processes = ProcessCore::getInstance().getProcessListSnapshot();
+        for (const auto &entry : due)
+        {
+            const std::string &key = entry.first.first;
+            std::string message = encodeUpdate(entry.first.second, key, entry.second.query.select(processes));
+            if (message.empty())
+            {
+                std::cerr << "Failed to encode update for topic " << key << std::endl;
+                continue;
+            }
+
+            // Recipients that negotiated compression get a compressed copy; each
+            // codec is applied at most once per topic
+            std::vector<ClientConnection> plain;
+            std::map<CompressionCodec, std::vector<ClientConnection>> by_codec;
+            for (const ClientConnection &client : entry.second.clients)
+            {
+                const ClientSession session = SessionManager::getInstance().get(client.socket);
+                if (session.compression != CompressionCodec::NONE && message.size() >= session.compression_threshold)
+                    by_codec[session.compression].push_back(client);
+                else
+                    plain.push_back(client);
+            }
+            for (const auto &group : by_codec)
+            {
+                SocketServer::getInstance().broadcast(group.second, compressResponse(message, group.first, 0));
+            }
+            if (!plain.empty())
+            {
+                SocketServer::getInstance().broadcast(plain, message);
+            }
+        }
+    }
+} // namespace qnx
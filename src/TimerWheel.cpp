@@ -0,0 +1,123 @@
+/**
+ * @file TimerWheel.cpp
+ * @brief Implementation of the hashed timer wheel for QNX Remote Process Monitor
+ *
+ * Each slot is a circular doubly-linked list threaded through the nodes, with
+ * a sentinel node owned by the wheel. A timer lives in the slot of its expiry
+ * tick modulo the number of slots; advancing by one tick walks one slot and
+ * takes out the nodes whose expiry has been reached.
+ */
+
+#include "TimerWheel.hpp"
+
+namespace qnx
+{
+    TimerWheel::TimerWheel(int64_t tick_ms, size_t slots)
+        : tick_ms_(tick_ms > 0 ? tick_ms : 1)
+    {
+        size_t count = 1;
+        while (count < slots)
+        {
+            count <<= 1;
+        }
+        mask_ = count - 1;
+        slots_.resize(count);
+        reset(0);
+    }
+
+    void TimerWheel::reset(int64_t now_ms)
+    {
+        for (TimerNode &sentinel : slots_)
+        {
+            // Unlink whatever is left so the nodes read as unscheduled
+            TimerNode *node = sentinel.timer_next;
+            while (node && node != &sentinel)
+            {
+                TimerNode *next = node->timer_next;
+                node->timer_prev = nullptr;
+                node->timer_next = nullptr;
+                node = next;
+            }
+            sentinel.timer_prev = &sentinel;
+            sentinel.timer_next = &sentinel;
+        }
+        size_ = 0;
+        current_tick_ = static_cast<uint64_t>(now_ms / tick_ms_);
+    }
+
+    void TimerWheel::schedule(TimerNode &node, int64_t deadline_ms)
+    {
+        cancel(node);
+
+        // Round up so a timer never fires before its deadline
+        uint64_t expiry = deadline_ms > 0 ? static_cast<uint64_t>((deadline_ms + tick_ms_ - 1) / tick_ms_) : 0;
+        if (expiry <= current_tick_)
+        {
+            expiry = current_tick_ + 1;
+        }
+        node.timer_expiry = expiry;
+        link(node);
+    }
+
+    void TimerWheel::cancel(TimerNode &node)
+    {
+        if (!node.timerScheduled())
+        {
+            return;
+        }
+        node.timer_prev->timer_next = node.timer_next;
+        node.timer_next->timer_prev = node.timer_prev;
+        node.timer_prev = nullptr;
+        node.timer_next = nullptr;
+        --size_;
+    }
+
+    int64_t TimerWheel::msUntilNextTick(int64_t now_ms) const
+    {
+        int64_t next = static_cast<int64_t>(current_tick_ + 1) * tick_ms_;
+        return next > now_ms ? next - now_ms : 0;
+    }
+
+    void TimerWheel::link(TimerNode &node)
+    {
+        TimerNode &sentinel = slots_[node.timer_expiry & mask_];
+        node.timer_prev = sentinel.timer_prev;
+        node.timer_next = &sentinel;
+        sentinel.timer_prev->timer_next = &node;
+        sentinel.timer_prev = &node;
+        ++size_;
+    }
+
+    void TimerWheel::collectExpired(int64_t now_ms)
+    {
+        const uint64_t target = static_cast<uint64_t>(now_ms / tick_ms_);
+        if (target <= current_tick_)
+        {
+            return;
+        }
+
+        // After a long stall every slot is visited once, which covers all timers
+        uint64_t ticks = target - current_tick_;
+        if (ticks > mask_ + 1)
+        {
+            ticks = mask_ + 1;
+        }
+
+        for (uint64_t i = 1; i <= ticks && size_ > 0; ++i)
+        {
+            TimerNode &sentinel = slots_[(current_tick_ + i) & mask_];
+            TimerNode *node = sentinel.timer_next;
+            while (node != &sentinel)
+            {
+                TimerNode *next = node->timer_next;
+                if (node->timer_expiry <= target)
+                {
+                    cancel(*node);
+                    due_.push_back(node);
+                }
+                node = next;
+            }
+        }
+        current_tick_ = target;
+    }
+} // namespace qnx
@@ -0,0 +1,142 @@
+/**
+ * @file WorkerPool.cpp
+ * @brief Implementation of the worker thread pool for QNX Remote Process Monitor
+ *
+ * This file implements a thread pool with one FIFO queue per request class.
+ * Exceptions thrown by tasks are caught and logged so that a failing task
+ * cannot terminate a worker.
+ */
+
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace qnx
+{
+    WorkerPool::~WorkerPool()
+    {
+        shutdown();
+    }
+
+    void WorkerPool::start(size_t num_threads, size_t reserved_control)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_)
+        {
+            return;
+        }
+
+        num_threads = std::max<size_t>(num_threads, 1);
+        shared_limit_ = num_threads - std::min(reserved_control, num_threads - 1);
+        running_ = true;
+        for (size_t i = 0; i < num_threads; ++i)
+        {
+            workers_.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    bool WorkerPool::submit(Task task, RequestClass request_class)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_)
+            {
+                return false;
+            }
+            tasks_[static_cast<size_t>(request_class)].push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    void WorkerPool::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_)
+            {
+                return;
+            }
+            running_ = false;
+        }
+        cv_.notify_all();
+
+        for (auto &worker : workers_)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+        workers_.clear();
+    }
+
+    bool WorkerPool::hasRunnableTask() const
+    {
+        if (!tasks_[static_cast<size_t>(RequestClass::CONTROL)].empty())
+        {
+            return true;
+        }
+        return shared_running_ < shared_limit_ && (!tasks_[static_cast<size_t>(RequestClass::POINT)].empty() ||
+                                                   !tasks_[static_cast<size_t>(RequestClass::BULK)].empty());
+    }
+
+    bool WorkerPool::drained() const
+    {
+        return std::all_of(std::begin(tasks_), std::end(tasks_), [](const std::deque<Task> &queue)
+                           { return queue.empty(); });
+    }
+
+    void WorkerPool::workerLoop()
+    {
+        while (true)
+        {
+            Task task;
+            bool shared = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]
+                         { return hasRunnableTask() || (!running_ && drained()); });
+                if (!hasRunnableTask())
+                {
+                    return; // Stopped and fully drained
+                }
+
+                // Highest-priority non-empty queue; hasRunnableTask() guarantees a shared slot for the others
+                for (std::deque<Task> &queue : tasks_)
+                {
+                    if (!queue.empty())
+                    {
+                        shared = &queue != &tasks_[static_cast<size_t>(RequestClass::CONTROL)];
+                        task = std::move(queue.front());
+                        queue.pop_front();
+                        break;
+                    }
+                }
+                if (shared)
+                {
+                    ++shared_running_;
+                }
+            }
+
+            try
+            {
+                task();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Unhandled exception in worker task: " << e.what() << std::endl;
+            }
+
+            if (shared)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --shared_running_;
+                }
+                // A worker may be waiting for a shared slot to run a queued task
+                cv_.notify_one();
+            }
+        }
+    }
+} // namespace qnx
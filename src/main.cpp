@@ -8,7 +8,15 @@
  * and process control (suspend, resume, terminate).
  *
  * The server communicates with clients using a JSON-based protocol over TCP/IP
- * and handles concurrent client connections.
+ * (and optionally a Unix domain socket for on-box clients) and handles
+ * concurrent client connections.
+ *
+ * Usage: qnx-rpm-server [-p port] [-u unix_socket_path] [-m unix_socket_mode] [-r reactors] [-b backend] [-i idle_timeout] [-q request_rate] [-c cache_mib]
+ *                       [-d cpu_decimals] [-x handover_socket_path [-X]]
+ *
+ * With -x, a server started while another one is running with the same
+ * handover socket takes over its listening sockets and state (and with -X
+ * its idle client connections), and the old server exits.
  */
 
 #include "ProcessCore.hpp"
@@ -18,6 +26,12 @@
 #include "ProcessHistory.hpp"
 #include "Authenticator.hpp"
 #include "JsonHandler.hpp" // Include the new handler
+#include "Subscription.hpp"
+#include "Session.hpp"
+#include "AdmissionControl.hpp"
+#include "ResponseCache.hpp"
+#include "Handover.hpp"
+#include "ResponseWriter.hpp"
 
 #include <iostream>
 #include <thread>
@@ -29,7 +43,8 @@
 #include <vector>
 #include <string>
 #include <optional>
-#include <sys/json.h> // QNX native JSON library
+#include <cstdlib>
+#include <unistd.h>
 
 // For chrono literals like 500ms
 using namespace std::chrono_literals;
@@ -76,6 +91,9 @@ void statsUpdateLoop()
                 // Call addEntry with individual values
                 proc_hist.addEntry(pinfo.getPid(), pinfo.getCpuUsage(), pinfo.getMemoryUsage());
             }
+
+            // Push the fresh data to subscribed clients
+            qnx::SubscriptionManager::getInstance().publish();
         }
         else
         {
@@ -88,24 +106,131 @@ void statsUpdateLoop()
     std::cout << "Stats update loop exiting." << std::endl;
 }
 
+/**
+ * @brief Print command line usage
+ */
+void printUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [-p port] [-u unix_socket_path] [-m unix_socket_mode] [-r reactors] [-b backend] [-i idle_timeout] [-q request_rate] [-c cache_mib]\n"
+              << "       [-d cpu_decimals] [-x handover_socket_path [-X]]\n"
+              << "  -p port   TCP port to listen on (default 8080)\n"
+              << "  -u path   Also listen on a Unix domain socket at this path\n"
+              << "  -m mode   Octal permissions of the Unix domain socket (default 0660)\n"
+              << "  -r count  Number of reactor threads, 0 for one per CPU (default 1)\n"
+              << "  -b name   I/O backend: select, epoll or io_uring (default select)\n"
+              << "  -i secs   Close connections idle for this long, 0 to never (default 300)\n"
+              << "  -q rate   Requests per second allowed per connection, 0 for no limit (default 100);\n"
+              << "            each logged-in user may make four times as many across their connections\n"
+              << "  -c MiB    Memory budget of the response cache, 0 to disable (default 8)\n"
+              << "  -d count  Decimal places of CPU usage figures in responses, -1 for full precision (default -1)\n"
+              << "  -x path   Take over from the server listening on this handover socket, then listen on it\n"
+              << "            for a successor to hand over to (zero-downtime restart)\n"
+              << "  -X        With -x, also take over the previous server's idle client connections" << std::endl;
+}
+
 /**
  * @brief Main entry point for the application
  */
 int main(int argc, char *argv[])
 {
+    int port = 8080;
+    qnx::ServerOptions options;
+    qnx::AdmissionLimits limits;
+    size_t cache_budget = qnx::ResponseCache::DEFAULT_BUDGET;
+    std::string handover_path;
+    bool take_over_clients = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:u:m:r:b:i:q:c:d:x:X")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            port = std::atoi(optarg);
+            break;
+        case 'u':
+            options.unix_path = optarg;
+            break;
+        case 'm':
+            options.unix_mode = static_cast<mode_t>(std::strtoul(optarg, nullptr, 8));
+            break;
+        case 'r':
+            options.reactors = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'b':
+            if (!qnx::parseIoBackend(optarg, options.backend))
+            {
+                std::cerr << "Unknown I/O backend: " << optarg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'i':
+            options.idle_timeout = std::chrono::seconds(std::strtoul(optarg, nullptr, 10));
+            break;
+        case 'q':
+            limits.connection_rate = std::strtod(optarg, nullptr);
+            limits.connection_burst = 2 * limits.connection_rate;
+            limits.user_rate = 4 * limits.connection_rate;
+            limits.user_burst = 2 * limits.user_rate;
+            break;
+        case 'c':
+            cache_budget = std::strtoul(optarg, nullptr, 10) * 1024 * 1024;
+            break;
+        case 'd':
+            qnx::ResponseWriter::setPercentageDecimals(std::atoi(optarg));
+            break;
+        case 'x':
+            handover_path = optarg;
+            break;
+        case 'X':
+            take_over_clients = true;
+            break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (port <= 0 || port > 65535)
+    {
+        std::cerr << "Invalid port: " << port << std::endl;
+        return 1;
+    }
+
     std::cout << "QNX Remote Process Monitor Server Starting..." << std::endl;
 
+    qnx::AdmissionControl::getInstance().configure(limits);
+    qnx::ResponseCache::getInstance().setBudget(cache_budget);
+
     // Setup signal handling
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGPIPE, SIG_IGN); // Disconnected clients are detected from send() errors instead
 
     // Singletons auto-initialize upon first access (no manual init() needed)
 
+    // Take the sockets and state of a running server before touching either
+    std::vector<int> inherited_clients;
+    if (!handover_path.empty())
+    {
+        qnx::takeOverServer(handover_path, take_over_clients, options.inherited, inherited_clients);
+    }
+
     // Start the background statistics update thread
     std::thread stats_thread(statsUpdateLoop);
 
+    // Release a client's subscriptions and session when its connection closes
+    qnx::SocketServer::getInstance().setDisconnectHandler([](int client_socket)
+                                                          {
+        qnx::SubscriptionManager::getInstance().unsubscribeAll(client_socket);
+        qnx::SessionManager::getInstance().release(client_socket);
+        qnx::AdmissionControl::getInstance().release(client_socket); });
+
+    // Let process control commands overtake queued listing requests
+    qnx::SocketServer::getInstance().setRequestClassifier(qnx::classifyRequest);
+
     // Initialize and start the socket server (using updated namespace and handler)
-    if (!qnx::SocketServer::getInstance().init(8080, qnx::handleMessage))
+    if (!qnx::SocketServer::getInstance().init(port, qnx::handleMessage, options))
     {
         std::cerr << "Failed to initialize socket server. Exiting." << std::endl;
         running = false; // Signal stats thread to stop
@@ -115,17 +240,43 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    for (int client_socket : inherited_clients)
+    {
+        if (qnx::SocketServer::getInstance().adoptClient(client_socket))
+            qnx::SubscriptionManager::getInstance().bindConnection(
+                client_socket, qnx::SocketServer::getInstance().connectionId(client_socket));
+    }
+
+    // Wait for a successor from here on
+    int handover_fd = handover_path.empty() ? -1 : qnx::openHandoverSocket(handover_path);
+    bool handed_over = false;
+
     std::cout << "Server is running. Waiting for connections..." << std::endl;
 
-    // Wait for shutdown signal
+    // Wait for shutdown signal or a successor
     while (running.load())
     {
-        std::this_thread::sleep_for(500ms); // Check more often
+        if (handover_fd == -1)
+        {
+            std::this_thread::sleep_for(500ms); // Check more often
+        }
+        else if (qnx::serveHandover(handover_fd, handover_path, 500ms))
+        {
+            handed_over = true;
+            running = false;
+        }
+    }
+
+    if (handover_fd != -1)
+    {
+        close(handover_fd);
+        if (!handed_over)
+            unlink(handover_path.c_str());
     }
 
     std::cout << "Shutting down server..." << std::endl;
 
-    // Perform clean shutdown (using updated namespaces)
+    // Perform clean shutdown (using updated namespaces); a no-op after a handover
     qnx::SocketServer::getInstance().shutdown();
 
     // Wait for the stats update thread to finish (ensure running is false)